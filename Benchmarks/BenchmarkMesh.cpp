@@ -0,0 +1,110 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "BenchmarkMesh.h"
+
+#include <algorithm>
+
+namespace SectionedUVBenchmarks
+{
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FBenchMesh MakeBenchMesh(uint32_t numVertices, int32_t numSlots, int32_t numMorphTargets, uint32_t seed)
+	{
+		FRandom random(seed);
+		FBenchMesh mesh;
+		numSlots = std::max(numSlots, 1);
+
+		// Split the vertices over the slots, +-50% around the average so sections are not all the same size
+		std::vector<uint32_t> sectionVerts(static_cast<size_t>(numSlots));
+		const uint32_t averageVerts = std::max(numVertices / static_cast<uint32_t>(numSlots), 3u);
+		uint32_t assignedVerts = 0;
+		for(int32_t slot = 0; slot < numSlots; ++slot)
+		{
+			uint32_t verts = averageVerts / 2 + random.Next() % (averageVerts + 1);
+			if(slot == numSlots - 1)
+			{
+				verts = numVertices > assignedVerts ? numVertices - assignedVerts : averageVerts;
+			}
+			verts = std::max(verts, 3u);
+			sectionVerts[slot] = verts;
+			assignedVerts += verts;
+		}
+
+		uint32_t baseVertex = 0;
+		for(int32_t slot = 0; slot < numSlots; ++slot)
+		{
+			SectionedUVCore::FSection section;
+			section.BaseIndex = static_cast<uint32_t>(mesh.Indices.size());
+			section.BaseVertexIndex = baseVertex;
+			section.NumVertices = sectionVerts[slot];
+			section.NumTriangles = section.NumVertices * 3 / 2;
+			section.MaterialIndex = slot;
+
+			// Strip-ish triangles with some jitter so the index stream is not perfectly ordered
+			for(uint32_t tri = 0; tri < section.NumTriangles; ++tri)
+			{
+				const uint32_t start = tri / 2 + (random.Next() & 7);
+				for(uint32_t corner = 0; corner < 3; ++corner)
+				{
+					mesh.Indices.push_back(baseVertex + (start + corner) % section.NumVertices);
+				}
+			}
+
+			mesh.Sections.push_back(section);
+			// A run of skeleton bones starting near the previous section's
+			const uint16_t boneMapSize = static_cast<uint16_t>(20 + random.Next() % 50);
+			const uint16_t firstBone = static_cast<uint16_t>((slot * 8 + random.Next() % 16) % (BenchSkeletonBones - boneMapSize));
+			mesh.BoneMapOffsets.push_back(static_cast<uint32_t>(mesh.BoneMaps.size()));
+			for(uint16_t bone = 0; bone < boneMapSize; ++bone)
+			{
+				mesh.BoneMaps.push_back(static_cast<uint16_t>(firstBone + bone));
+			}
+			baseVertex += section.NumVertices;
+		}
+		mesh.BoneMapOffsets.push_back(static_cast<uint32_t>(mesh.BoneMaps.size()));
+
+		mesh.Vertices.resize(baseVertex);
+		uint32_t vertIndex = 0;
+		for(int32_t slot = 0; slot < numSlots; ++slot)
+		{
+			const uint16_t boneMapSize = static_cast<uint16_t>(mesh.BoneMapOffsets[slot + 1] - mesh.BoneMapOffsets[slot]);
+			for(uint32_t sectionVert = 0; sectionVert < sectionVerts[slot]; ++sectionVert, ++vertIndex)
+			{
+				FBenchVertex& vert = mesh.Vertices[vertIndex];
+				vert = FBenchVertex();
+				for(int32_t axis = 0; axis < 3; ++axis)
+				{
+					vert.Position[axis] = random.NextFloat() * 100.0f;
+				}
+				vert.TangentX[0] = 1.0f;
+				vert.TangentY[1] = 1.0f;
+				vert.TangentZ[2] = 1.0f;
+				vert.TangentZ[3] = 1.0f;
+				vert.UVs[0][0] = random.NextFloat();
+				vert.UVs[0][1] = random.NextFloat();
+				for(int32_t influence = 0; influence < 4; ++influence)
+				{
+					vert.InfluenceBones[influence] = static_cast<uint16_t>(random.Next() % boneMapSize);
+					vert.InfluenceWeights[influence] = influence == 0 ? 0xFFFF : 0;
+				}
+			}
+		}
+
+		// Each morph target moves every fourth vertex from a random start, sorted like engine morph deltas
+		mesh.MorphTargets.resize(static_cast<size_t>(std::max(numMorphTargets, 0)));
+		for(std::vector<FBenchMorphDelta>& morphTarget : mesh.MorphTargets)
+		{
+			morphTarget.reserve(baseVertex / 4 + 1);
+			for(uint32_t sourceIdx = random.Next() % 4; sourceIdx < baseVertex; sourceIdx += 4)
+			{
+				FBenchMorphDelta delta = {};
+				delta.PositionDelta[0] = random.NextFloat();
+				delta.SourceIdx = sourceIdx;
+				morphTarget.push_back(delta);
+			}
+		}
+
+		return mesh;
+	}
+}
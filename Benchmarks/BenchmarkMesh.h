@@ -0,0 +1,94 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "SectionedUVCore.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace SectionedUVBenchmarks
+{
+	/** Small LCG, good enough for repeatable synthetic data */
+	struct FRandom
+	{
+		uint32_t State;
+
+		explicit FRandom(uint32_t seed) : State(seed ? seed : 1u) {}
+
+		uint32_t Next()
+		{
+			State = State * 1664525u + 1013904223u;
+			return State >> 8;
+		}
+
+		float NextFloat()
+		{
+			return static_cast<float>(Next() & 0xFFFF) / 65535.0f;
+		}
+	};
+
+	/** Number of bones in the synthetic skeleton the bone maps index */
+	static constexpr uint16_t BenchSkeletonBones = 256;
+
+	/** Same layout and size as an engine FSoftSkinVertex (UE5, 12 influences, 16 bit weights) */
+	struct FBenchVertex
+	{
+		float Position[3];
+		float TangentX[3];
+		float TangentY[3];
+		float TangentZ[4];
+		float UVs[4][2];
+		uint32_t Color;
+		uint16_t InfluenceBones[12];
+		uint16_t InfluenceWeights[12];
+	};
+
+	/** Same layout and size as an engine FMorphTargetDelta */
+	struct FBenchMorphDelta
+	{
+		float PositionDelta[3];
+		float TangentZDelta[3];
+		uint32_t SourceIdx;
+	};
+
+	/**
+	 * A synthetic skeletal LOD with one section per material slot, laid out back to back like FSkeletalMeshLODModel.
+	 */
+	struct FBenchMesh
+	{
+		std::vector<SectionedUVCore::FSection> Sections;
+		std::vector<FBenchVertex> Vertices;
+		std::vector<uint32_t> Indices;
+		std::vector<std::vector<FBenchMorphDelta>> MorphTargets;
+		/** Bone maps of all sections back to back. Neighbouring sections share a lot of bones, like the parts of a character. */
+		std::vector<uint16_t> BoneMaps;
+		/** Per section plus one past the end, where its bone map starts in BoneMaps */
+		std::vector<uint32_t> BoneMapOffsets;
+	};
+
+	/**
+	 * Builds a synthetic mesh.
+	 * @param numVertices Total number of vertices.
+	 * @param numSlots Number of material slots, one section each.
+	 * @param numMorphTargets Number of morph targets. Each one moves a quarter of the vertices.
+	 * @param seed Seed for the generator so runs are repeatable.
+	 */
+	FBenchMesh MakeBenchMesh(uint32_t numVertices, int32_t numSlots, int32_t numMorphTargets, uint32_t seed);
+
+	/** Simple scope timer */
+	class FStopwatch
+	{
+	public:
+		FStopwatch() : Start(std::chrono::steady_clock::now()) {}
+
+		double ElapsedSeconds() const
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point Start;
+	};
+}
@@ -0,0 +1,631 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "BenchmarkMesh.h"
+#include "SectionedUVCore.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace SectionedUVBenchmarks;
+
+namespace
+{
+	/** Set when an optimized path does not produce the same result as the reference path */
+	bool bMismatch = false;
+
+	struct FBenchSettings
+	{
+		std::vector<uint32_t> VertexCounts = { 10000, 100000, 1000000 };
+		std::vector<int32_t> SlotCounts = { 2, 8, 64 };
+		int32_t NumMorphTargets = 8;
+	};
+
+	void PrintResult(uint32_t numVertices, int32_t numSlots, const char* stage, double seconds, double count, const char* unit)
+	{
+		const double perSecond = seconds > 0.0 ? count / seconds : 0.0;
+		std::printf("%10u verts %3d slots  %-12s %10.3f ms  %10.2f M%s/s\n", numVertices, numSlots, stage, seconds * 1000.0, perSecond / 1000000.0, unit);
+	}
+
+	/** The bone limit the bone map merge splits against, the lowest limit UE has shipped with (older mobile GPUs) */
+	static constexpr int32_t MobileMaxBones = 75;
+
+	/** Rows of UV sections start once a row holds this many, the same as a 16 x N section grid */
+	static constexpr int32_t MaxUVSectionsPerRow = 16;
+
+	/**
+	* The UV section layout the tool would need for the slot count, rounded up to powers of two like artists pick.
+	* Slot counts past a row are laid out as a grid.
+	*/
+	void GetUVSectionGrid(int32_t numMergedSlots, int32_t& outNumSections, int32_t& outNumRows)
+	{
+		outNumSections = 2;
+		while(outNumSections < numMergedSlots && outNumSections < MaxUVSectionsPerRow)
+		{
+			outNumSections *= 2;
+		}
+		outNumRows = 1;
+		while(outNumSections * outNumRows < numMergedSlots)
+		{
+			outNumRows *= 2;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Runs the same stages CreateSectionedUVSkeletalMesh runs for one LOD, plus the static mesh face remap.
+	*/
+	void RunBenchmark(uint32_t numVertices, int32_t numSlots, int32_t numMorphTargets)
+	{
+		FBenchMesh mesh = MakeBenchMesh(numVertices, numSlots, numMorphTargets, numVertices ^ static_cast<uint32_t>(numSlots));
+		const int32_t numSections = static_cast<int32_t>(mesh.Sections.size());
+		const uint32_t meshVertices = static_cast<uint32_t>(mesh.Vertices.size());
+
+		// Merge everything but the first slot (think eyes) unless there is nothing else to merge
+		std::vector<int32_t> materialSlots;
+		for(int32_t slot = numSlots > 2 ? 1 : 0; slot < numSlots; ++slot)
+		{
+			materialSlots.push_back(slot);
+		}
+		int32_t numUVSections = 0;
+		int32_t numUVRows = 0;
+		GetUVSectionGrid(static_cast<int32_t>(materialSlots.size()), numUVSections, numUVRows);
+
+		SectionedUVCore::FSlotMapping mapping;
+		SectionedUVCore::BuildSlotMapping(numSlots, materialSlots.data(), static_cast<int32_t>(materialSlots.size()), mapping);
+
+		// Content hash of the source geometry, what the conversion cache keys on
+		{
+			FStopwatch stopwatch;
+			SectionedUVCore::FHasher hasher;
+			hasher.Update(mesh.Vertices.data(), mesh.Vertices.size() * sizeof(FBenchVertex));
+			hasher.Update(mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+			const uint64_t hash = hasher.Finalize();
+			PrintResult(meshVertices, numSlots, "hash", stopwatch.ElapsedSeconds(), meshVertices, "verts");
+			if(hash == 0)
+			{
+				std::printf("Unexpected zero hash\n");
+			}
+		}
+
+		// Section merge
+		SectionedUVCore::FSectionMerge merge;
+		{
+			FStopwatch stopwatch;
+			SectionedUVCore::MergeSections(mesh.Sections.data(), numSections, mesh.Indices.data(), mesh.Indices.size(), mapping, merge);
+			PrintResult(meshVertices, numSlots, "merge", stopwatch.ElapsedSeconds(), static_cast<double>(mesh.Indices.size()), "indices");
+		}
+
+		// Bone map merge, against the 75 bone limit of older mobile GPUs so the split shows up
+		SectionedUVCore::FBoneMapMerge boneMerge;
+		{
+			FStopwatch stopwatch;
+			SectionedUVCore::MergeBoneMaps(mesh.Sections.data(), numSections, mesh.BoneMaps.data(), mesh.BoneMapOffsets.data(), merge, MobileMaxBones, boneMerge);
+			const double seconds = stopwatch.ElapsedSeconds();
+
+			size_t appendedBones = 0;
+			for(const int32_t sectionIndex : merge.SectionsToRemove)
+			{
+				appendedBones += mesh.BoneMapOffsets[sectionIndex + 1] - mesh.BoneMapOffsets[sectionIndex];
+			}
+			size_t mergedBones = 0;
+			for(const std::vector<uint16_t>& chunkBoneMap : boneMerge.ChunkBoneMaps)
+			{
+				mergedBones += chunkBoneMap.size();
+				if(chunkBoneMap.size() > static_cast<size_t>(MobileMaxBones) && boneMerge.ChunkBoneMaps.size() > 1)
+				{
+					std::printf("MISMATCH: merged bone map chunk is over the bone limit\n");
+					bMismatch = true;
+				}
+			}
+			PrintResult(meshVertices, numSlots, "bone maps", seconds, static_cast<double>(appendedBones), "bones");
+			std::printf("%10u verts %3d slots  %-12s appended %zu deduplicated %zu in %zu sections (%d bone limit)\n",
+						meshVertices, numSlots, "bone stats", appendedBones, mergedBones, boneMerge.Chunks.size(), MobileMaxBones);
+		}
+
+		// Sectioned UV rewrite and bone influence remap
+		{
+			FStopwatch stopwatch;
+			for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+			{
+				const SectionedUVCore::FSection& section = mesh.Sections[sectionIndex];
+				FBenchVertex* firstVert = &mesh.Vertices[section.BaseVertexIndex];
+				const int32_t uvSection = SectionedUVCore::GetUVSection(mapping, section.MaterialIndex);
+				if(uvSection != SectionedUVCore::InvalidIndex)
+				{
+					size_t numRemapBones = 0;
+					const uint16_t* boneRemap = SectionedUVCore::GetSectionBoneRemap(boneMerge, sectionIndex, numRemapBones);
+					SectionedUVCore::RemapBoneInfluences(firstVert->InfluenceBones, section.NumVertices, sizeof(FBenchVertex), 4, boneRemap, numRemapBones);
+					SectionedUVCore::WriteSectionedUVs(firstVert->UVs[0], firstVert->UVs[1], section.NumVertices, sizeof(FBenchVertex),
+													   SectionedUVCore::GetSectionCenterU(uvSection, numUVSections),
+													   SectionedUVCore::GetSectionCenterV(uvSection, numUVSections, numUVRows));
+				}
+				else
+				{
+					SectionedUVCore::WriteSectionedUVs(firstVert->UVs[0], firstVert->UVs[1], section.NumVertices, sizeof(FBenchVertex), -1.0f);
+				}
+			}
+			PrintResult(meshVertices, numSlots, "uv rewrite", stopwatch.ElapsedSeconds(), meshVertices, "verts");
+		}
+
+		// Vertex color encoding, the alternative to the UV rewrite which only touches the merged vertices
+		{
+			FStopwatch stopwatch;
+			for(const SectionedUVCore::FSection& section : mesh.Sections)
+			{
+				const int32_t uvSection = SectionedUVCore::GetUVSection(mapping, section.MaterialIndex);
+				if(uvSection != SectionedUVCore::InvalidIndex)
+				{
+					uint8_t* colorAlpha = reinterpret_cast<uint8_t*>(&mesh.Vertices[section.BaseVertexIndex].Color) + 3;
+					SectionedUVCore::WriteSectionIds(colorAlpha, section.NumVertices, sizeof(FBenchVertex), static_cast<uint8_t>(uvSection));
+				}
+			}
+			PrintResult(meshVertices, numSlots, "section ids", stopwatch.ElapsedSeconds(), meshVertices, "verts");
+		}
+
+		// Atlas packing of the merged slots' textures and the UV0 move into the atlas rectangles
+		{
+			// Power of two textures shrunk by the gutter the same way the editor bakes them, so the padded rectangles stay powers of two
+			static constexpr uint32_t AtlasPadding = 4;
+			FRandom random(numVertices + static_cast<uint32_t>(numSlots));
+			std::vector<uint32_t> widths;
+			std::vector<uint32_t> heights;
+			for(size_t slotIndex = 0; slotIndex < materialSlots.size(); ++slotIndex)
+			{
+				widths.push_back((64u << (random.Next() % 4)) - AtlasPadding * 2);
+				heights.push_back((64u << (random.Next() % 4)) - AtlasPadding * 2);
+			}
+
+			std::vector<SectionedUVCore::FAtlasRect> rects;
+			uint32_t atlasWidth = 0;
+			uint32_t atlasHeight = 0;
+			if(!SectionedUVCore::PackAtlas(widths.data(), heights.data(), static_cast<int32_t>(widths.size()), AtlasPadding, AtlasPadding, 16384, rects, atlasWidth, atlasHeight))
+			{
+				std::printf("Atlas packing failed for %d slots\n", numSlots);
+				bMismatch = true;
+			}
+
+			uint64_t usedTexels = 0;
+			for(size_t rectIndex = 0; rectIndex < rects.size(); ++rectIndex)
+			{
+				const SectionedUVCore::FAtlasRect& rect = rects[rectIndex];
+				usedTexels += static_cast<uint64_t>(rect.Width) * rect.Height;
+				bool bOverlaps = rect.X < AtlasPadding || rect.Y < AtlasPadding || rect.X + rect.Width + AtlasPadding > atlasWidth || rect.Y + rect.Height + AtlasPadding > atlasHeight;
+				for(size_t otherIndex = 0; otherIndex < rectIndex; ++otherIndex)
+				{
+					const SectionedUVCore::FAtlasRect& other = rects[otherIndex];
+					bOverlaps |= rect.X < other.X + other.Width + AtlasPadding * 2 && other.X < rect.X + rect.Width + AtlasPadding * 2 &&
+								 rect.Y < other.Y + other.Height + AtlasPadding * 2 && other.Y < rect.Y + rect.Height + AtlasPadding * 2;
+				}
+				if(bOverlaps)
+				{
+					std::printf("Atlas rectangle %zu overlaps another gutter or the atlas edge\n", rectIndex);
+					bMismatch = true;
+				}
+			}
+
+			FStopwatch stopwatch;
+			for(const SectionedUVCore::FSection& section : mesh.Sections)
+			{
+				const int32_t uvSection = SectionedUVCore::GetUVSection(mapping, section.MaterialIndex);
+				if(uvSection != SectionedUVCore::InvalidIndex && static_cast<size_t>(uvSection) < rects.size())
+				{
+					SectionedUVCore::WriteAtlasUVs(mesh.Vertices[section.BaseVertexIndex].UVs[2], section.NumVertices, sizeof(FBenchVertex),
+												   SectionedUVCore::GetAtlasRegion(rects[uvSection], atlasWidth, atlasHeight));
+				}
+			}
+			PrintResult(meshVertices, numSlots, "atlas uvs", stopwatch.ElapsedSeconds(), meshVertices, "verts");
+			std::printf("%10u verts %3d slots  %-12s %u x %u atlas, %.1f%% used\n", meshVertices, numSlots, "atlas stats", atlasWidth, atlasHeight,
+						atlasWidth ? 100.0 * static_cast<double>(usedTexels) / (static_cast<double>(atlasWidth) * atlasHeight) : 0.0);
+		}
+
+		// Section removal and merged section append, one section at a time and batched
+		std::vector<SectionedUVCore::FSection> sections = mesh.Sections;
+		std::vector<uint32_t> indices = mesh.Indices;
+		size_t numIndices = indices.size();
+		uint32_t numModelVertices = meshVertices;
+		{
+			FStopwatch stopwatch;
+			for(auto sectionIt = merge.SectionsToRemove.rbegin(); sectionIt != merge.SectionsToRemove.rend(); ++sectionIt)
+			{
+				SectionedUVCore::RemoveSection(sections, indices.data(), numIndices, numModelVertices, *sectionIt);
+			}
+			PrintResult(meshVertices, numSlots, "removal", stopwatch.ElapsedSeconds(), static_cast<double>(mesh.Indices.size()), "indices");
+		}
+		{
+			std::vector<SectionedUVCore::FSection> batchSections = mesh.Sections;
+			std::vector<uint32_t> batchIndices = mesh.Indices;
+			std::vector<int32_t> removedSections;
+			size_t batchNumIndices = batchIndices.size();
+			uint32_t batchNumVertices = meshVertices;
+
+			FStopwatch stopwatch;
+			SectionedUVCore::RemoveSections(batchSections, batchIndices.data(), batchNumIndices, batchNumVertices,
+											merge.SectionsToRemove.data(), static_cast<int32_t>(merge.SectionsToRemove.size()), removedSections);
+			PrintResult(meshVertices, numSlots, "batch remove", stopwatch.ElapsedSeconds(), static_cast<double>(mesh.Indices.size()), "indices");
+
+			const bool sectionsMatch = batchSections.size() == sections.size() &&
+				std::equal(sections.begin(), sections.end(), batchSections.begin(), [](const SectionedUVCore::FSection& a, const SectionedUVCore::FSection& b)
+				{
+					return a.BaseIndex == b.BaseIndex && a.BaseVertexIndex == b.BaseVertexIndex && a.ClothAssetIndex == b.ClothAssetIndex;
+				});
+			if(!sectionsMatch || batchNumIndices != numIndices || batchNumVertices != numModelVertices ||
+			   !std::equal(indices.begin(), indices.begin() + numIndices, batchIndices.begin()))
+			{
+				std::printf("MISMATCH: batched section removal differs from per section removal\n");
+				bMismatch = true;
+			}
+		}
+
+		int32_t mergedSectionIndex = 0;
+		{
+			SectionedUVCore::FSection mergedSection;
+			mergedSection.BaseIndex = static_cast<uint32_t>(numIndices);
+			mergedSection.BaseVertexIndex = numModelVertices;
+			mergedSection.NumVertices = merge.NumMergedVertices;
+			mergedSection.NumTriangles = merge.NumMergedTriangles;
+			indices.resize(numIndices + merge.MergedIndices.size());
+			SectionedUVCore::RebaseIndices(merge.MergedIndices.data(), merge.MergedIndices.size(), numModelVertices, indices.data() + numIndices);
+			mergedSectionIndex = static_cast<int32_t>(sections.size());
+			sections.push_back(mergedSection);
+		}
+
+		// Morph target remap, section search per delta and through the vertex remap table
+		{
+			std::vector<uint32_t> sectionBaseVertices;
+			uint32_t accumVerts = 0;
+			for(const SectionedUVCore::FSection& section : sections)
+			{
+				sectionBaseVertices.push_back(accumVerts);
+				accumVerts += section.NumVertices;
+			}
+
+			std::vector<std::vector<FBenchMorphDelta>> tableMorphTargets = mesh.MorphTargets;
+			bool bMorphMismatch = false;
+
+			size_t numDeltas = 0;
+			std::vector<std::vector<int32_t>> searchSectionIndices(mesh.MorphTargets.size());
+			{
+				FStopwatch stopwatch;
+				for(size_t morphIndex = 0; morphIndex < mesh.MorphTargets.size(); ++morphIndex)
+				{
+					std::vector<FBenchMorphDelta>& morphTarget = mesh.MorphTargets[morphIndex];
+					if(morphTarget.empty())
+					{
+						continue;
+					}
+					SectionedUVCore::RemapMorphSourceIndices(&morphTarget[0].SourceIdx, morphTarget.size(), sizeof(FBenchMorphDelta),
+															 mesh.Sections.data(), numSections, merge, sectionBaseVertices.data(),
+															 mergedSectionIndex, searchSectionIndices[morphIndex]);
+					numDeltas += morphTarget.size();
+				}
+				PrintResult(meshVertices, numSlots, "morph remap", stopwatch.ElapsedSeconds(), static_cast<double>(numDeltas), "deltas");
+			}
+
+			{
+				FStopwatch stopwatch;
+				SectionedUVCore::FVertexRemap vertexRemap;
+				SectionedUVCore::BuildVertexRemap(mesh.Sections.data(), numSections, merge, sectionBaseVertices.data(),
+												  static_cast<int32_t>(sections.size()), mergedSectionIndex, vertexRemap);
+				std::vector<int32_t> sectionIndices;
+				for(size_t morphIndex = 0; morphIndex < tableMorphTargets.size(); ++morphIndex)
+				{
+					std::vector<FBenchMorphDelta>& morphTarget = tableMorphTargets[morphIndex];
+					if(morphTarget.empty())
+					{
+						continue;
+					}
+					SectionedUVCore::RemapMorphDeltas(&morphTarget[0].SourceIdx, morphTarget.size(), sizeof(FBenchMorphDelta), vertexRemap, sectionIndices);
+
+					std::vector<int32_t>& searchSections = searchSectionIndices[morphIndex];
+					std::sort(searchSections.begin(), searchSections.end());
+					if(searchSections != sectionIndices)
+					{
+						bMorphMismatch = true;
+					}
+				}
+				PrintResult(meshVertices, numSlots, "morph table", stopwatch.ElapsedSeconds(), static_cast<double>(numDeltas), "deltas");
+			}
+
+			for(size_t morphIndex = 0; morphIndex < mesh.MorphTargets.size(); ++morphIndex)
+			{
+				if(!std::equal(mesh.MorphTargets[morphIndex].begin(), mesh.MorphTargets[morphIndex].end(), tableMorphTargets[morphIndex].begin(),
+							   [](const FBenchMorphDelta& a, const FBenchMorphDelta& b) { return a.SourceIdx == b.SourceIdx; }))
+				{
+					bMorphMismatch = true;
+				}
+			}
+			if(bMorphMismatch)
+			{
+				std::printf("MISMATCH: morph remap table differs from the per delta section search\n");
+				bMismatch = true;
+			}
+		}
+
+		// Merged section triangle and vertex order optimization
+		{
+			std::vector<FBenchVertex> mergedVertices;
+			mergedVertices.reserve(merge.NumMergedVertices);
+			for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+			{
+				if(merge.MergedVertexOffset[sectionIndex] != SectionedUVCore::InvalidVertex)
+				{
+					const SectionedUVCore::FSection& section = mesh.Sections[sectionIndex];
+					mergedVertices.insert(mergedVertices.end(), mesh.Vertices.begin() + section.BaseVertexIndex, mesh.Vertices.begin() + section.BaseVertexIndex + section.NumVertices);
+				}
+			}
+			std::vector<uint32_t> mergedIndices = merge.MergedIndices;
+			const uint32_t numMergedVertices = static_cast<uint32_t>(mergedVertices.size());
+			const SectionedUVCore::FVertexCacheStats source = SectionedUVCore::AnalyzeVertexCache(mergedIndices.data(), mergedIndices.size(), numMergedVertices,
+																								  SectionedUVCore::DefaultVertexCacheSize);
+
+			// The synthetic sections are already strip ordered, shuffle the triangles so the optimizer has real work to do
+			FRandom random(meshVertices);
+			for(size_t triIndex = mergedIndices.size() / 3; triIndex > 1; --triIndex)
+			{
+				const size_t swapIndex = random.Next() % triIndex;
+				std::swap_ranges(mergedIndices.begin() + (triIndex - 1) * 3, mergedIndices.begin() + triIndex * 3, mergedIndices.begin() + swapIndex * 3);
+			}
+			const SectionedUVCore::FVertexCacheStats before = SectionedUVCore::AnalyzeVertexCache(mergedIndices.data(), mergedIndices.size(), numMergedVertices,
+																								  SectionedUVCore::DefaultVertexCacheSize);
+			{
+				FStopwatch stopwatch;
+				SectionedUVCore::OptimizeVertexCache(mergedIndices.data(), mergedIndices.size(), numMergedVertices);
+				PrintResult(meshVertices, numSlots, "cache opt", stopwatch.ElapsedSeconds(), static_cast<double>(mergedIndices.size()), "indices");
+			}
+			const SectionedUVCore::FVertexCacheStats optimized = SectionedUVCore::AnalyzeVertexCache(mergedIndices.data(), mergedIndices.size(), numMergedVertices,
+																									 SectionedUVCore::DefaultVertexCacheSize);
+			{
+				FStopwatch stopwatch;
+				SectionedUVCore::OptimizeOverdraw(mergedIndices.data(), mergedIndices.size(), mergedVertices.empty() ? nullptr : mergedVertices[0].Position, sizeof(FBenchVertex),
+												  numMergedVertices);
+				PrintResult(meshVertices, numSlots, "overdraw", stopwatch.ElapsedSeconds(), static_cast<double>(mergedIndices.size()), "indices");
+			}
+			{
+				FStopwatch stopwatch;
+				std::vector<uint32_t> vertexOrder;
+				if(SectionedUVCore::OptimizeVertexFetch(mergedIndices.data(), mergedIndices.size(), numMergedVertices, vertexOrder))
+				{
+					SectionedUVCore::ReorderVertices(mergedVertices.data(), numMergedVertices, sizeof(FBenchVertex), vertexOrder.data());
+				}
+				PrintResult(meshVertices, numSlots, "vertex fetch", stopwatch.ElapsedSeconds(), numMergedVertices, "verts");
+			}
+			const SectionedUVCore::FVertexCacheStats after = SectionedUVCore::AnalyzeVertexCache(mergedIndices.data(), mergedIndices.size(), numMergedVertices,
+																								 SectionedUVCore::DefaultVertexCacheSize);
+			std::printf("%10u verts %3d slots  %-12s ACMR source %.3f shuffled %.3f optimized %.3f overdraw/fetch %.3f  ATVR source %.3f shuffled %.3f final %.3f\n",
+						meshVertices, numSlots, "cache stats", source.ACMR, before.ACMR, optimized.ACMR, after.ACMR, source.ATVR, before.ATVR, after.ATVR);
+			if(after.ACMR > before.ACMR)
+			{
+				std::printf("Optimized merged section has a worse ACMR than the source order\n");
+				bMismatch = true;
+			}
+		}
+
+		// Merged section welding. Every eighth vertex gets a seam copy nudged within the tolerance, which the weld has to fold back.
+		{
+			static constexpr float WeldTolerance = 0.001f;
+			std::vector<FBenchVertex> weldVertices;
+			weldVertices.reserve(merge.NumMergedVertices + merge.NumMergedVertices / 8 + 1);
+			for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+			{
+				if(merge.MergedVertexOffset[sectionIndex] != SectionedUVCore::InvalidVertex)
+				{
+					const SectionedUVCore::FSection& section = mesh.Sections[sectionIndex];
+					weldVertices.insert(weldVertices.end(), mesh.Vertices.begin() + section.BaseVertexIndex, mesh.Vertices.begin() + section.BaseVertexIndex + section.NumVertices);
+				}
+			}
+			const uint32_t numUniqueVertices = static_cast<uint32_t>(weldVertices.size());
+			std::vector<uint32_t> weldIndices = merge.MergedIndices;
+			for(uint32_t vertIndex = 0; vertIndex < numUniqueVertices; vertIndex += 8)
+			{
+				FBenchVertex seamVertex = weldVertices[vertIndex];
+				seamVertex.Position[0] += WeldTolerance * 0.5f;
+				weldVertices.push_back(seamVertex);
+			}
+
+			// Point the seam copies' triangles at them, like the second of two sections sharing the seam
+			const uint32_t numWeldVertices = static_cast<uint32_t>(weldVertices.size());
+			for(size_t index = 1; index < weldIndices.size(); index += 2)
+			{
+				if(weldIndices[index] % 8 == 0)
+				{
+					weldIndices[index] = numUniqueVertices + weldIndices[index] / 8;
+				}
+			}
+
+			const auto canWeld = [&weldVertices](uint32_t first, uint32_t second)
+			{
+				const FBenchVertex& a = weldVertices[first];
+				const FBenchVertex& b = weldVertices[second];
+				return std::memcmp(a.UVs, b.UVs, sizeof(a.UVs)) == 0 && a.Color == b.Color &&
+					   std::memcmp(a.InfluenceBones, b.InfluenceBones, sizeof(a.InfluenceBones)) == 0 &&
+					   std::memcmp(a.InfluenceWeights, b.InfluenceWeights, sizeof(a.InfluenceWeights)) == 0;
+			};
+
+			FStopwatch stopwatch;
+			std::vector<uint32_t> weldMap;
+			const uint32_t numWelded = SectionedUVCore::WeldVertices(weldIndices.data(), weldIndices.size(), weldVertices.empty() ? nullptr : weldVertices[0].Position,
+																	 sizeof(FBenchVertex), numWeldVertices, WeldTolerance, canWeld, weldMap);
+			SectionedUVCore::CompactWeldedVertices(weldVertices.data(), numWeldVertices, sizeof(FBenchVertex), weldMap.data());
+			PrintResult(meshVertices, numSlots, "weld", stopwatch.ElapsedSeconds(), numWeldVertices, "verts");
+
+			bool bWeldMatches = numWelded == numUniqueVertices;
+			for(uint32_t vertIndex = numUniqueVertices; bWeldMatches && vertIndex < numWeldVertices; ++vertIndex)
+			{
+				bWeldMatches = weldMap[vertIndex] == weldMap[(vertIndex - numUniqueVertices) * 8];
+			}
+			for(size_t index = 0; bWeldMatches && index < weldIndices.size(); ++index)
+			{
+				bWeldMatches = weldIndices[index] == merge.MergedIndices[index];
+			}
+			if(!bWeldMatches)
+			{
+				std::printf("MISMATCH: welding did not fold the seam copies back onto their source vertices\n");
+				bMismatch = true;
+			}
+		}
+
+		// Static mesh face material remap over the same triangles
+		{
+			const size_t numFaces = mesh.Indices.size() / 3;
+			std::vector<int32_t> faceMaterials(numFaces);
+			for(const SectionedUVCore::FSection& section : mesh.Sections)
+			{
+				std::fill(faceMaterials.begin() + section.BaseIndex / 3, faceMaterials.begin() + section.BaseIndex / 3 + section.NumTriangles, section.MaterialIndex);
+			}
+			std::vector<float> wedgeUVs(numFaces * 3 * 2, 0.5f);
+
+			FStopwatch stopwatch;
+			SectionedUVCore::RemapFaceMaterials(faceMaterials.data(), numFaces, wedgeUVs.data(), mapping, numSlots, numUVSections, numUVRows);
+			PrintResult(meshVertices, numSlots, "static faces", stopwatch.ElapsedSeconds(), static_cast<double>(numFaces * 3), "wedges");
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Removes many sections from a large index buffer, the case batched removal is for. The regular runs merge every
+	* section but one, which leaves next to nothing after the removed sections for per section removal to shift.
+	* Here every other one of 30 sections is removed from ~500k indices, so each per section removal shifts and
+	* re-bases most of the buffer.
+	*/
+	void CompareSectionRemoval()
+	{
+		static constexpr int32_t NumSlots = 30;
+		static constexpr uint32_t NumIndices = 500000;
+		// The synthetic mesh has 4.5 indices per vertex
+		FBenchMesh mesh = MakeBenchMesh(NumIndices * 2 / 9, NumSlots, 0, NumIndices);
+		const uint32_t meshVertices = static_cast<uint32_t>(mesh.Vertices.size());
+
+		std::vector<int32_t> sectionsToRemove;
+		for(int32_t sectionIndex = 1; sectionIndex < static_cast<int32_t>(mesh.Sections.size()); sectionIndex += 2)
+		{
+			sectionsToRemove.push_back(sectionIndex);
+		}
+
+		std::vector<SectionedUVCore::FSection> sections = mesh.Sections;
+		std::vector<uint32_t> indices = mesh.Indices;
+		size_t numIndices = indices.size();
+		uint32_t numModelVertices = meshVertices;
+		{
+			FStopwatch stopwatch;
+			for(auto sectionIt = sectionsToRemove.rbegin(); sectionIt != sectionsToRemove.rend(); ++sectionIt)
+			{
+				SectionedUVCore::RemoveSection(sections, indices.data(), numIndices, numModelVertices, *sectionIt);
+			}
+			PrintResult(meshVertices, NumSlots, "removal", stopwatch.ElapsedSeconds(), static_cast<double>(mesh.Indices.size()), "indices");
+		}
+
+		std::vector<SectionedUVCore::FSection> batchSections = mesh.Sections;
+		std::vector<uint32_t> batchIndices = mesh.Indices;
+		std::vector<int32_t> removedSections;
+		size_t batchNumIndices = batchIndices.size();
+		uint32_t batchNumVertices = meshVertices;
+		{
+			FStopwatch stopwatch;
+			SectionedUVCore::RemoveSections(batchSections, batchIndices.data(), batchNumIndices, batchNumVertices,
+											sectionsToRemove.data(), static_cast<int32_t>(sectionsToRemove.size()), removedSections);
+			PrintResult(meshVertices, NumSlots, "batch remove", stopwatch.ElapsedSeconds(), static_cast<double>(mesh.Indices.size()), "indices");
+		}
+
+		const bool sectionsMatch = batchSections.size() == sections.size() &&
+			std::equal(sections.begin(), sections.end(), batchSections.begin(), [](const SectionedUVCore::FSection& a, const SectionedUVCore::FSection& b)
+			{
+				return a.BaseIndex == b.BaseIndex && a.NumTriangles == b.NumTriangles && a.BaseVertexIndex == b.BaseVertexIndex &&
+					   a.NumVertices == b.NumVertices && a.MaterialIndex == b.MaterialIndex;
+			});
+		if(removedSections != sectionsToRemove || !sectionsMatch || batchNumIndices != numIndices || batchNumVertices != numModelVertices ||
+		   !std::equal(indices.begin(), indices.begin() + numIndices, batchIndices.begin()))
+		{
+			std::printf("MISMATCH: batched removal of %zu sections differs from per section removal\n", sectionsToRemove.size());
+			bMismatch = true;
+		}
+	}
+
+	/**
+	* Checks the half float conversion the sectioned UV precision check relies on. Every finite half has to survive a
+	* round trip, and the section grids the tool is used with have to fit in half precision UVs.
+	*/
+	void CheckHalfPrecision()
+	{
+		for(uint32_t half = 0; half <= 0xFFFFu; ++half)
+		{
+			if((half & 0x7C00u) == 0x7C00u)
+			{
+				continue;
+			}
+			if(SectionedUVCore::FloatToHalf(SectionedUVCore::HalfToFloat(static_cast<uint16_t>(half))) != half)
+			{
+				std::printf("MISMATCH: half float 0x%04x does not survive a round trip\n", half);
+				bMismatch = true;
+				return;
+			}
+		}
+
+		int32_t numSections = 1;
+		while(SectionedUVCore::AreSectionCentersHalfSafe(numSections, numSections))
+		{
+			numSections *= 2;
+		}
+		std::printf("Half precision UVs hold section grids up to %d x %d\n", numSections / 2, numSections / 2);
+		if(numSections / 2 < SectionedUVCore::MaxPackedSections)
+		{
+			std::printf("MISMATCH: half precision UVs cannot hold %d sections\n", SectionedUVCore::MaxPackedSections);
+			bMismatch = true;
+		}
+	}
+
+	void PrintUsage()
+	{
+		std::printf("SectionedUVBenchmarks [--full] [--verts N] [--slots N] [--morphs N]\n"
+					"  --full      Sweep 10k to 10M vertices and 2 to 64 slots\n"
+					"  --verts N   Only run N vertices\n"
+					"  --slots N   Only run N material slots\n"
+					"  --morphs N  Number of morph targets, each moving a quarter of the vertices (default 8)\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	FBenchSettings settings;
+	for(int argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		const std::string arg = argv[argIndex];
+		const bool hasValue = argIndex + 1 < argc;
+		if(arg == "--full")
+		{
+			settings.VertexCounts = { 10000, 100000, 1000000, 10000000 };
+			settings.SlotCounts = { 2, 4, 8, 16, 32, 64 };
+		}
+		else if(arg == "--verts" && hasValue)
+		{
+			settings.VertexCounts = { static_cast<uint32_t>(std::strtoul(argv[++argIndex], nullptr, 10)) };
+		}
+		else if(arg == "--slots" && hasValue)
+		{
+			settings.SlotCounts = { std::atoi(argv[++argIndex]) };
+		}
+		else if(arg == "--morphs" && hasValue)
+		{
+			settings.NumMorphTargets = std::atoi(argv[++argIndex]);
+		}
+		else
+		{
+			PrintUsage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	CheckHalfPrecision();
+	CompareSectionRemoval();
+	for(const uint32_t numVertices : settings.VertexCounts)
+	{
+		for(const int32_t numSlots : settings.SlotCounts)
+		{
+			RunBenchmark(numVertices, numSlots, settings.NumMorphTargets);
+		}
+	}
+	return bMismatch ? 1 : 0;
+}
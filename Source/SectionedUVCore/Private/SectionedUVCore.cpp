@@ -0,0 +1,1098 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace SectionedUVCore
+{
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool BuildSlotMapping(int32_t numMaterials,
+						  const int32_t* materialSlots,
+						  int32_t numMaterialSlots,
+						  FSlotMapping& outMapping)
+	{
+		const std::vector<int32_t> slotGroups(static_cast<size_t>(std::max(numMaterialSlots, 0)), 0);
+		return BuildGroupedSlotMapping(numMaterials, materialSlots, slotGroups.data(), numMaterialSlots, outMapping);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool BuildGroupedSlotMapping(int32_t numMaterials,
+								 const int32_t* materialSlots,
+								 const int32_t* slotGroups,
+								 int32_t numMaterialSlots,
+								 FSlotMapping& outMapping)
+	{
+		outMapping.SlotToUVSection.assign(static_cast<size_t>(std::max(numMaterials, 0)), InvalidIndex);
+		outMapping.SlotRemap.assign(static_cast<size_t>(std::max(numMaterials, 0)), InvalidIndex);
+		outMapping.SlotToGroup.assign(static_cast<size_t>(std::max(numMaterials, 0)), InvalidIndex);
+		outMapping.NumKeptSlots = 0;
+		outMapping.NumGroups = 0;
+
+		// Each group hands out its own UV sections
+		std::vector<int32_t> groupSectionCounts;
+		for(int32_t slotIndex = 0; slotIndex < numMaterialSlots; ++slotIndex)
+		{
+			const int32_t materialSlot = materialSlots[slotIndex];
+			const int32_t group = slotGroups[slotIndex];
+			if(materialSlot < 0 || materialSlot >= numMaterials || outMapping.SlotToUVSection[materialSlot] != InvalidIndex || group < 0)
+			{
+				return false;
+			}
+			if(group >= static_cast<int32_t>(groupSectionCounts.size()))
+			{
+				groupSectionCounts.resize(static_cast<size_t>(group) + 1, 0);
+			}
+			outMapping.SlotToUVSection[materialSlot] = groupSectionCounts[group]++;
+			outMapping.SlotToGroup[materialSlot] = group;
+		}
+		outMapping.NumGroups = static_cast<int32_t>(groupSectionCounts.size());
+
+		for(int32_t materialSlot = 0; materialSlot < numMaterials; ++materialSlot)
+		{
+			if(outMapping.SlotToUVSection[materialSlot] == InvalidIndex)
+			{
+				outMapping.SlotRemap[materialSlot] = outMapping.NumKeptSlots++;
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void BuildGroupPassMapping(const FSlotMapping& mapping, int32_t group, FSlotMapping& outPassMapping)
+	{
+		const int32_t numPassSlots = static_cast<int32_t>(mapping.SlotToUVSection.size()) + mapping.NumGroups;
+		outPassMapping.SlotToUVSection.assign(static_cast<size_t>(numPassSlots), InvalidIndex);
+		outPassMapping.SlotToGroup.assign(static_cast<size_t>(numPassSlots), InvalidIndex);
+		outPassMapping.SlotRemap.resize(static_cast<size_t>(numPassSlots));
+		outPassMapping.NumKeptSlots = 0;
+		outPassMapping.NumGroups = 1;
+
+		for(int32_t passSlot = 0; passSlot < numPassSlots; ++passSlot)
+		{
+			if(GetSlotGroup(mapping, passSlot) == group)
+			{
+				outPassMapping.SlotToUVSection[passSlot] = mapping.SlotToUVSection[passSlot];
+				outPassMapping.SlotToGroup[passSlot] = 0;
+				outPassMapping.SlotRemap[passSlot] = InvalidIndex;
+			}
+			else
+			{
+				outPassMapping.SlotRemap[passSlot] = passSlot;
+				++outPassMapping.NumKeptSlots;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	int32_t BuildCollapsedSlotMapping(const FSlotMapping& mapping, FSlotMapping& outCollapsedMapping)
+	{
+		const size_t numMaterials = mapping.SlotToUVSection.size();
+		outCollapsedMapping.SlotToUVSection.assign(numMaterials, InvalidIndex);
+		outCollapsedMapping.SlotToGroup.assign(numMaterials, 0);
+		outCollapsedMapping.SlotRemap.assign(numMaterials, InvalidIndex);
+		outCollapsedMapping.NumKeptSlots = 0;
+		outCollapsedMapping.NumGroups = numMaterials ? 1 : 0;
+
+		// The first group hands out its sections from 0 without gaps, the rest go after them
+		int32_t numUVSections = 0;
+		for(size_t materialSlot = 0; materialSlot < numMaterials; ++materialSlot)
+		{
+			if(mapping.SlotToGroup[materialSlot] == 0)
+			{
+				outCollapsedMapping.SlotToUVSection[materialSlot] = mapping.SlotToUVSection[materialSlot];
+				++numUVSections;
+			}
+		}
+		for(size_t materialSlot = 0; materialSlot < numMaterials; ++materialSlot)
+		{
+			if(mapping.SlotToGroup[materialSlot] != 0)
+			{
+				outCollapsedMapping.SlotToUVSection[materialSlot] = numUVSections++;
+			}
+		}
+		return numUVSections;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool MergeSections(const FSection* sections,
+					   int32_t numSections,
+					   const uint32_t* indexBuffer,
+					   size_t numIndices,
+					   const FSlotMapping& mapping,
+					   FSectionMerge& outMerge)
+	{
+		outMerge.OldToNewSection.clear();
+		outMerge.OldToNewSection.reserve(static_cast<size_t>(numSections));
+		outMerge.MergedVertexOffset.assign(static_cast<size_t>(numSections), InvalidVertex);
+		outMerge.MergedIndices.clear();
+		outMerge.SectionsToRemove.clear();
+		outMerge.NumMergedVertices = 0;
+		outMerge.NumMergedTriangles = 0;
+
+		// Size the merged index buffer once instead of growing it an index at a time
+		size_t numMergedIndices = 0;
+		for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+		{
+			if(GetUVSection(mapping, sections[sectionIndex].MaterialIndex) != InvalidIndex)
+			{
+				numMergedIndices += static_cast<size_t>(sections[sectionIndex].NumTriangles) * 3;
+			}
+		}
+		outMerge.MergedIndices.reserve(numMergedIndices);
+
+		uint32_t accumVertsCount = 0;
+		int32_t newSectionIndex = 0;
+		for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+		{
+			const FSection& section = sections[sectionIndex];
+			if(GetUVSection(mapping, section.MaterialIndex) != InvalidIndex)
+			{
+				const size_t numSectionIndices = static_cast<size_t>(section.NumTriangles) * 3;
+				if(section.BaseIndex + numSectionIndices > numIndices)
+				{
+					return false;
+				}
+
+				outMerge.OldToNewSection.push_back(InvalidIndex);
+
+				// Add the indices, offsetting away the current accumulation to this point, and adding the merged count to this point
+				const size_t firstMergedIndex = outMerge.MergedIndices.size();
+				outMerge.MergedIndices.resize(firstMergedIndex + numSectionIndices);
+				RebaseIndices(indexBuffer + section.BaseIndex, numSectionIndices, outMerge.NumMergedVertices - accumVertsCount, outMerge.MergedIndices.data() + firstMergedIndex);
+
+				outMerge.MergedVertexOffset[sectionIndex] = outMerge.NumMergedVertices;
+				outMerge.NumMergedVertices += section.NumVertices;
+				outMerge.NumMergedTriangles += section.NumTriangles;
+				outMerge.SectionsToRemove.push_back(sectionIndex);
+			}
+			else
+			{
+				outMerge.OldToNewSection.push_back(newSectionIndex++);
+			}
+
+			accumVertsCount += section.NumVertices;
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool RemoveSection(std::vector<FSection>& sections,
+					   uint32_t* indexBuffer,
+					   size_t& numIndices,
+					   uint32_t& numVertices,
+					   int32_t sectionIndex)
+	{
+		// Need a valid section
+		if(sectionIndex < 0 || sectionIndex >= static_cast<int32_t>(sections.size()))
+		{
+			return false;
+		}
+
+		const FSection sectionToRemove = sections[sectionIndex];
+
+		if(sectionToRemove.ClothAssetIndex != InvalidIndex)
+		{
+			// Can't remove this, clothing currently relies on it
+			return false;
+		}
+
+		const uint32_t numVertsToRemove = sectionToRemove.NumVertices;
+		const uint32_t baseVertToRemove = sectionToRemove.BaseVertexIndex;
+		const size_t numIndicesToRemove = static_cast<size_t>(sectionToRemove.NumTriangles) * 3;
+		const size_t baseIndexToRemove = sectionToRemove.BaseIndex;
+		if(baseIndexToRemove + numIndicesToRemove > numIndices)
+		{
+			return false;
+		}
+
+		// Strip indices
+		std::memmove(indexBuffer + baseIndexToRemove,
+					 indexBuffer + baseIndexToRemove + numIndicesToRemove,
+					 (numIndices - baseIndexToRemove - numIndicesToRemove) * sizeof(uint32_t));
+		numIndices -= numIndicesToRemove;
+
+		sections.erase(sections.begin() + sectionIndex);
+
+		// Fixup indices above base vert
+		for(size_t index = 0; index < numIndices; ++index)
+		{
+			if(indexBuffer[index] >= baseVertToRemove)
+			{
+				indexBuffer[index] -= numVertsToRemove;
+			}
+		}
+
+		numVertices -= numVertsToRemove;
+
+		// Fixup anything needing section indices
+		for(FSection& section : sections)
+		{
+			// Push back clothing indices
+			if(section.ClothAssetIndex > sectionIndex)
+			{
+				section.ClothAssetIndex--;
+			}
+
+			// Removed indices, re-base further sections
+			if(section.BaseIndex > baseIndexToRemove)
+			{
+				section.BaseIndex -= static_cast<uint32_t>(numIndicesToRemove);
+			}
+
+			// Remove verts, re-base further sections
+			if(section.BaseVertexIndex > baseVertToRemove)
+			{
+				section.BaseVertexIndex -= numVertsToRemove;
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void RemoveSections(std::vector<FSection>& sections,
+						uint32_t* indexBuffer,
+						size_t& numIndices,
+						uint32_t& numVertices,
+						const int32_t* sectionsToRemove,
+						int32_t numSectionsToRemove,
+						std::vector<int32_t>& outRemovedSections)
+	{
+		outRemovedSections.clear();
+
+		const int32_t numSections = static_cast<int32_t>(sections.size());
+		std::vector<bool> removeSection(sections.size(), false);
+		for(int32_t removeIndex = 0; removeIndex < numSectionsToRemove; ++removeIndex)
+		{
+			const int32_t sectionIndex = sectionsToRemove[removeIndex];
+			if(sectionIndex < 0 || sectionIndex >= numSections || removeSection[sectionIndex])
+			{
+				continue;
+			}
+
+			const FSection& section = sections[sectionIndex];
+			if(section.ClothAssetIndex != InvalidIndex || section.BaseIndex + static_cast<size_t>(section.NumTriangles) * 3 > numIndices)
+			{
+				// Can't remove this, clothing currently relies on it
+				continue;
+			}
+			removeSection[sectionIndex] = true;
+		}
+
+		// Vertex offset table, each removed vertex range and the total number of removed vertices up to and including it
+		struct FRemovedRange
+		{
+			uint32_t BaseVertex;
+			uint32_t AccumVertices;
+		};
+		std::vector<FRemovedRange> removedRanges;
+		for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+		{
+			if(removeSection[sectionIndex])
+			{
+				outRemovedSections.push_back(sectionIndex);
+				removedRanges.push_back({ sections[sectionIndex].BaseVertexIndex, sections[sectionIndex].NumVertices });
+			}
+		}
+		if(removedRanges.empty())
+		{
+			return;
+		}
+
+		std::sort(removedRanges.begin(), removedRanges.end(), [](const FRemovedRange& a, const FRemovedRange& b)
+		{
+			return a.BaseVertex < b.BaseVertex;
+		});
+		for(size_t rangeIndex = 1; rangeIndex < removedRanges.size(); ++rangeIndex)
+		{
+			removedRanges[rangeIndex].AccumVertices += removedRanges[rangeIndex - 1].AccumVertices;
+		}
+
+		// Number of removed vertices at or below the passed in vertex
+		auto vertexShift = [&removedRanges](uint32_t vertIndex) -> uint32_t
+		{
+			auto rangeIt = std::upper_bound(removedRanges.begin(), removedRanges.end(), vertIndex, [](uint32_t vert, const FRemovedRange& range)
+			{
+				return vert < range.BaseVertex;
+			});
+			return rangeIt == removedRanges.begin() ? 0 : (rangeIt - 1)->AccumVertices;
+		};
+
+		// Walk the sections in index buffer order, compacting the indices we keep and re-basing them as we go
+		std::vector<int32_t> sectionOrder(sections.size());
+		for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+		{
+			sectionOrder[sectionIndex] = sectionIndex;
+		}
+		std::stable_sort(sectionOrder.begin(), sectionOrder.end(), [&sections](int32_t a, int32_t b)
+		{
+			return sections[a].BaseIndex < sections[b].BaseIndex;
+		});
+
+		size_t readIndex = 0;
+		size_t writeIndex = 0;
+		auto copyUnowned = [&](size_t endIndex)
+		{
+			// Indices no section claims, look the shift up per index
+			for(; readIndex < endIndex; ++readIndex, ++writeIndex)
+			{
+				indexBuffer[writeIndex] = indexBuffer[readIndex] - vertexShift(indexBuffer[readIndex]);
+			}
+		};
+
+		for(const int32_t sectionIndex : sectionOrder)
+		{
+			const FSection& section = sections[sectionIndex];
+			const size_t sectionBegin = std::max<size_t>(section.BaseIndex, readIndex);
+			const size_t sectionEnd = std::min<size_t>(section.BaseIndex + static_cast<size_t>(section.NumTriangles) * 3, numIndices);
+			if(sectionEnd <= sectionBegin)
+			{
+				continue;
+			}
+			copyUnowned(sectionBegin);
+
+			if(removeSection[sectionIndex])
+			{
+				readIndex = sectionEnd;
+				continue;
+			}
+
+			// A section only references its own vertices so the shift is the same for all of its indices
+			const uint32_t shift = vertexShift(section.BaseVertexIndex);
+			for(; readIndex < sectionEnd; ++readIndex, ++writeIndex)
+			{
+				indexBuffer[writeIndex] = indexBuffer[readIndex] - shift;
+			}
+		}
+		copyUnowned(numIndices);
+		numIndices = writeIndex;
+		numVertices -= removedRanges.back().AccumVertices;
+
+		// Re-base the kept sections' indices in index buffer order, past the removed sections starting before them
+		uint32_t removedIndicesBefore = 0;
+		uint32_t groupBaseIndex = 0;
+		uint32_t groupRemovedIndices = 0;
+		for(const int32_t sectionIndex : sectionOrder)
+		{
+			FSection& section = sections[sectionIndex];
+			if(section.BaseIndex != groupBaseIndex)
+			{
+				// Sections starting at the same index do not count each other
+				removedIndicesBefore += groupRemovedIndices;
+				groupRemovedIndices = 0;
+				groupBaseIndex = section.BaseIndex;
+			}
+
+			if(removeSection[sectionIndex])
+			{
+				groupRemovedIndices += section.NumTriangles * 3;
+			}
+			else
+			{
+				section.BaseIndex -= removedIndicesBefore;
+			}
+		}
+
+		// Fixup anything needing section indices, compacting the kept sections in place
+		size_t numKeptSections = 0;
+		for(int32_t sectionIndex = 0; sectionIndex < numSections; ++sectionIndex)
+		{
+			if(removeSection[sectionIndex])
+			{
+				continue;
+			}
+
+			FSection section = sections[sectionIndex];
+
+			// Push back clothing indices
+			if(section.ClothAssetIndex != InvalidIndex)
+			{
+				section.ClothAssetIndex -= static_cast<int32_t>(std::lower_bound(outRemovedSections.begin(), outRemovedSections.end(), section.ClothAssetIndex) - outRemovedSections.begin());
+			}
+
+			// Removed verts, re-base further sections
+			section.BaseVertexIndex -= section.BaseVertexIndex ? vertexShift(section.BaseVertexIndex - 1) : 0;
+			sections[numKeptSections++] = section;
+		}
+		sections.resize(numKeptSections);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void RebaseIndices(const uint32_t* src, size_t count, uint32_t offset, uint32_t* dst)
+	{
+		for(size_t index = 0; index < count; ++index)
+		{
+			dst[index] = src[index] + offset;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void WriteSectionedUVs(const float* uv0,
+						   float* sectionedUV,
+						   size_t numVertices,
+						   size_t strideBytes,
+						   float sectionU,
+						   float sectionV)
+	{
+		const unsigned char* srcBytes = reinterpret_cast<const unsigned char*>(uv0);
+		unsigned char* dstBytes = reinterpret_cast<unsigned char*>(sectionedUV);
+		for(size_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			const float* src = reinterpret_cast<const float*>(srcBytes + vertIndex * strideBytes);
+			float* dst = reinterpret_cast<float*>(dstBytes + vertIndex * strideBytes);
+			dst[0] = sectionU < 0.0f ? src[0] : sectionU;
+			dst[1] = sectionV < 0.0f ? src[1] : sectionV;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void WriteSectionIds(uint8_t* sectionIds,
+						 size_t numVertices,
+						 size_t strideBytes,
+						 uint8_t sectionId)
+	{
+		for(size_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			sectionIds[vertIndex * strideBytes] = sectionId;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+		const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFFu);
+		uint32_t mantissa = bits & 0x7FFFFFu;
+
+		// Infinity and NaN keep their class
+		if(exponent == 0xFF)
+		{
+			return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+		}
+
+		const int32_t halfExponent = exponent - 127 + 15;
+		if(halfExponent >= 0x1F)
+		{
+			return static_cast<uint16_t>(sign | 0x7C00u);
+		}
+
+		// Too small for a normal half, shift the implicit bit down into a denormal. Rounding up can carry into the exponent, which is still right.
+		uint32_t shift = 13;
+		uint32_t half = (static_cast<uint32_t>(std::max(halfExponent, 0)) << 10);
+		if(halfExponent <= 0)
+		{
+			if(halfExponent < -10)
+			{
+				return sign;
+			}
+			mantissa |= 0x800000u;
+			shift = static_cast<uint32_t>(14 - halfExponent);
+		}
+		half |= mantissa >> shift;
+
+		// Round to nearest even
+		const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		const uint32_t halfway = 1u << (shift - 1u);
+		if(remainder > halfway || (remainder == halfway && (half & 1u)))
+		{
+			++half;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	float HalfToFloat(uint16_t value)
+	{
+		const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+		const uint32_t exponent = (value >> 10) & 0x1Fu;
+		const uint32_t mantissa = value & 0x3FFu;
+		if(exponent == 0)
+		{
+			const float denormal = std::ldexp(static_cast<float>(mantissa), -24);
+			return sign ? -denormal : denormal;
+		}
+
+		const uint32_t bits = sign | (exponent == 0x1F ? 0x7F800000u : (exponent + 127 - 15) << 23) | (mantissa << 13);
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool AreSectionCentersHalfSafe(int32_t numSections, int32_t numRows)
+	{
+		if(numSections <= 0)
+		{
+			return false;
+		}
+
+		const float maxSectionError = 0.25f / numSections;
+		for(int32_t column = 0; column < numSections; ++column)
+		{
+			const float center = GetSectionCenterU(column, numSections);
+			if(std::fabs(HalfToFloat(FloatToHalf(center)) - center) > maxSectionError)
+			{
+				return false;
+			}
+		}
+
+		const float maxRowError = 0.25f / std::max(numRows, 1);
+		for(int32_t row = 0; row < numRows && numRows > 1; ++row)
+		{
+			const float center = GetSectionCenterV(row * numSections, numSections, numRows);
+			if(std::fabs(HalfToFloat(FloatToHalf(center)) - center) > maxRowError)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Shelf packs the padded rectangles into an atlas atlasWidth wide
+	* @return The height used.
+	*/
+	static uint32_t PackShelves(const std::vector<int32_t>& order,
+								const std::vector<uint32_t>& paddedWidths,
+								const std::vector<uint32_t>& paddedHeights,
+								uint32_t atlasWidth,
+								std::vector<FAtlasRect>& outPaddedRects)
+	{
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t shelfHeight = 0;
+		for(const int32_t rectIndex : order)
+		{
+			if(x + paddedWidths[rectIndex] > atlasWidth)
+			{
+				y += shelfHeight;
+				x = 0;
+				shelfHeight = 0;
+			}
+
+			FAtlasRect& rect = outPaddedRects[rectIndex];
+			rect.X = x;
+			rect.Y = y;
+			rect.Width = paddedWidths[rectIndex];
+			rect.Height = paddedHeights[rectIndex];
+			x += rect.Width;
+			shelfHeight = std::max(shelfHeight, rect.Height);
+		}
+		return y + shelfHeight;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool PackAtlas(const uint32_t* widths,
+				   const uint32_t* heights,
+				   int32_t numRects,
+				   uint32_t padding,
+				   uint32_t alignment,
+				   uint32_t maxAtlasSize,
+				   std::vector<FAtlasRect>& outRects,
+				   uint32_t& outAtlasWidth,
+				   uint32_t& outAtlasHeight)
+	{
+		outRects.assign(static_cast<size_t>(std::max(numRects, 0)), FAtlasRect());
+		outAtlasWidth = 0;
+		outAtlasHeight = 0;
+		if(!alignment || (alignment & (alignment - 1)))
+		{
+			return false;
+		}
+
+		// Round the padded sizes up to the alignment so every position stays on it
+		std::vector<uint32_t> paddedWidths(outRects.size());
+		std::vector<uint32_t> paddedHeights(outRects.size());
+		std::vector<int32_t> order(outRects.size());
+		uint32_t widest = alignment;
+		for(int32_t rectIndex = 0; rectIndex < numRects; ++rectIndex)
+		{
+			paddedWidths[rectIndex] = (widths[rectIndex] + padding * 2 + alignment - 1) & ~(alignment - 1);
+			paddedHeights[rectIndex] = (heights[rectIndex] + padding * 2 + alignment - 1) & ~(alignment - 1);
+			widest = std::max(widest, paddedWidths[rectIndex]);
+			order[rectIndex] = rectIndex;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&](int32_t a, int32_t b)
+		{
+			return paddedHeights[a] != paddedHeights[b] ? paddedHeights[a] > paddedHeights[b] : paddedWidths[a] > paddedWidths[b];
+		});
+
+		uint32_t atlasWidth = alignment;
+		while(atlasWidth < widest)
+		{
+			atlasWidth *= 2;
+		}
+
+		// Grow the atlas until the shelves fit in a square, then trim the height to the power of two they need
+		std::vector<FAtlasRect> paddedRects(outRects.size());
+		for(; atlasWidth <= maxAtlasSize; atlasWidth *= 2)
+		{
+			const uint32_t usedHeight = PackShelves(order, paddedWidths, paddedHeights, atlasWidth, paddedRects);
+			if(usedHeight > atlasWidth)
+			{
+				continue;
+			}
+
+			outAtlasWidth = atlasWidth;
+			outAtlasHeight = alignment;
+			while(outAtlasHeight < usedHeight)
+			{
+				outAtlasHeight *= 2;
+			}
+
+			for(int32_t rectIndex = 0; rectIndex < numRects; ++rectIndex)
+			{
+				FAtlasRect& rect = outRects[rectIndex];
+				rect.X = paddedRects[rectIndex].X + padding;
+				rect.Y = paddedRects[rectIndex].Y + padding;
+				rect.Width = widths[rectIndex];
+				rect.Height = heights[rectIndex];
+			}
+			return true;
+		}
+		return false;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FAtlasRegion GetAtlasRegion(const FAtlasRect& rect, uint32_t atlasWidth, uint32_t atlasHeight)
+	{
+		FAtlasRegion region;
+		region.OffsetU = static_cast<float>(rect.X) / static_cast<float>(atlasWidth);
+		region.OffsetV = static_cast<float>(rect.Y) / static_cast<float>(atlasHeight);
+		region.ScaleU = static_cast<float>(rect.Width) / static_cast<float>(atlasWidth);
+		region.ScaleV = static_cast<float>(rect.Height) / static_cast<float>(atlasHeight);
+		return region;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void WriteAtlasUVs(float* uvs, size_t numVertices, size_t strideBytes, const FAtlasRegion& region)
+	{
+		unsigned char* bytes = reinterpret_cast<unsigned char*>(uvs);
+		for(size_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			float* uv = reinterpret_cast<float*>(bytes + vertIndex * strideBytes);
+			uv[0] = std::min(std::max(uv[0], 0.0f), 1.0f) * region.ScaleU + region.OffsetU;
+			uv[1] = std::min(std::max(uv[1], 0.0f), 1.0f) * region.ScaleV + region.OffsetV;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void MergeBoneMaps(const FSection* sections,
+					   int32_t numSections,
+					   const uint16_t* boneMaps,
+					   const uint32_t* boneMapOffsets,
+					   const FSectionMerge& merge,
+					   int32_t maxBonesPerChunk,
+					   FBoneMapMerge& outBoneMerge)
+	{
+		outBoneMerge.Chunks.clear();
+		outBoneMerge.ChunkBoneMaps.clear();
+		outBoneMerge.SectionChunk.assign(static_cast<size_t>(numSections), InvalidIndex);
+		outBoneMerge.SectionBoneRemapOffsets.assign(boneMapOffsets, boneMapOffsets + numSections + 1);
+		outBoneMerge.SectionBoneRemap.assign(boneMapOffsets[numSections], 0);
+
+		size_t numSkeletonBones = 0;
+		for(const int32_t sectionIndex : merge.SectionsToRemove)
+		{
+			for(uint32_t boneIndex = boneMapOffsets[sectionIndex]; boneIndex < boneMapOffsets[sectionIndex + 1]; ++boneIndex)
+			{
+				numSkeletonBones = std::max(numSkeletonBones, static_cast<size_t>(boneMaps[boneIndex]) + 1);
+			}
+		}
+
+		// Skeleton bone to its index in the current chunk's bone map
+		static constexpr int32_t PendingBone = -2;
+		std::vector<int32_t> chunkBoneIndex(numSkeletonBones, InvalidIndex);
+		const size_t maxBones = maxBonesPerChunk > 0 ? static_cast<size_t>(maxBonesPerChunk) : SIZE_MAX;
+
+		// Greedy in section order, a section only starts a new chunk when its new bones do not fit in the current one
+		uint32_t mergedIndexOffset = 0;
+		for(const int32_t sectionIndex : merge.SectionsToRemove)
+		{
+			const uint16_t* boneMapBegin = boneMaps + boneMapOffsets[sectionIndex];
+			const uint16_t* boneMapEnd = boneMaps + boneMapOffsets[sectionIndex + 1];
+
+			bool bNewChunk = outBoneMerge.Chunks.empty();
+			if(!bNewChunk)
+			{
+				size_t numNewBones = 0;
+				for(const uint16_t* bone = boneMapBegin; bone != boneMapEnd; ++bone)
+				{
+					if(chunkBoneIndex[*bone] == InvalidIndex)
+					{
+						chunkBoneIndex[*bone] = PendingBone;
+						++numNewBones;
+					}
+				}
+				for(const uint16_t* bone = boneMapBegin; bone != boneMapEnd; ++bone)
+				{
+					if(chunkBoneIndex[*bone] == PendingBone)
+					{
+						chunkBoneIndex[*bone] = InvalidIndex;
+					}
+				}
+				bNewChunk = outBoneMerge.ChunkBoneMaps.back().size() + numNewBones > maxBones;
+			}
+
+			if(bNewChunk)
+			{
+				if(!outBoneMerge.ChunkBoneMaps.empty())
+				{
+					for(const uint16_t bone : outBoneMerge.ChunkBoneMaps.back())
+					{
+						chunkBoneIndex[bone] = InvalidIndex;
+					}
+				}
+
+				FSection& chunk = outBoneMerge.Chunks.emplace_back();
+				chunk.BaseIndex = mergedIndexOffset;
+				chunk.BaseVertexIndex = merge.MergedVertexOffset[sectionIndex];
+				outBoneMerge.ChunkBoneMaps.emplace_back().reserve(std::min(numSkeletonBones, maxBones));
+			}
+
+			const int32_t chunkIndex = static_cast<int32_t>(outBoneMerge.Chunks.size()) - 1;
+			std::vector<uint16_t>& chunkBoneMap = outBoneMerge.ChunkBoneMaps.back();
+			uint16_t* boneRemap = outBoneMerge.SectionBoneRemap.data() + boneMapOffsets[sectionIndex];
+			for(const uint16_t* bone = boneMapBegin; bone != boneMapEnd; ++bone, ++boneRemap)
+			{
+				if(chunkBoneIndex[*bone] == InvalidIndex)
+				{
+					chunkBoneIndex[*bone] = static_cast<int32_t>(chunkBoneMap.size());
+					chunkBoneMap.push_back(*bone);
+				}
+				*boneRemap = static_cast<uint16_t>(chunkBoneIndex[*bone]);
+			}
+
+			const FSection& section = sections[sectionIndex];
+			FSection& chunk = outBoneMerge.Chunks.back();
+			chunk.NumTriangles += section.NumTriangles;
+			chunk.NumVertices += section.NumVertices;
+			outBoneMerge.SectionChunk[sectionIndex] = chunkIndex;
+			mergedIndexOffset += section.NumTriangles * 3;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void RemapBoneInfluences(uint16_t* influenceBones,
+							 size_t numVertices,
+							 size_t strideBytes,
+							 int32_t numInfluences,
+							 const uint16_t* boneRemap,
+							 size_t boneRemapSize)
+	{
+		unsigned char* bytes = reinterpret_cast<unsigned char*>(influenceBones);
+		for(size_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			uint16_t* bones = reinterpret_cast<uint16_t*>(bytes + vertIndex * strideBytes);
+			for(int32_t boneInfIndex = 0; boneInfIndex < numInfluences; ++boneInfIndex)
+			{
+				bones[boneInfIndex] = bones[boneInfIndex] < boneRemapSize ? boneRemap[bones[boneInfIndex]] : 0;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool GetSectionFromVertexIndex(const FSection* sections,
+								   int32_t numSections,
+								   uint32_t vertIndex,
+								   int32_t& outSectionIndex,
+								   uint32_t& outVertIndex)
+	{
+		outSectionIndex = 0;
+		outVertIndex = 0;
+
+		uint32_t vertCount = 0;
+
+		// Iterate over each chunk
+		for(int32_t sectionCount = 0; sectionCount < numSections; sectionCount++)
+		{
+			const FSection& section = sections[sectionCount];
+			outSectionIndex = sectionCount;
+
+			// Is it in Soft vertex range?
+			if(vertIndex < vertCount + section.NumVertices)
+			{
+				outVertIndex = vertIndex - vertCount;
+				return true;
+			}
+			vertCount += section.NumVertices;
+		}
+
+		return false;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void RemapMorphSourceIndices(uint32_t* sourceIndices,
+								 size_t numDeltas,
+								 size_t strideBytes,
+								 const FSection* oldSections,
+								 int32_t numOldSections,
+								 const FSectionMerge& merge,
+								 const uint32_t* newSectionBaseVertices,
+								 int32_t mergedSectionIndex,
+								 std::vector<int32_t>& outSectionIndices,
+								 const int32_t* sectionChunks)
+	{
+		outSectionIndices.clear();
+
+		unsigned char* bytes = reinterpret_cast<unsigned char*>(sourceIndices);
+		for(size_t deltaIndex = 0; deltaIndex < numDeltas; ++deltaIndex)
+		{
+			uint32_t& sourceIdx = *reinterpret_cast<uint32_t*>(bytes + deltaIndex * strideBytes);
+
+			// Get the original section and vertex index
+			int32_t outSectionIndex; uint32_t outVertIndex;
+			if(!GetSectionFromVertexIndex(oldSections, numOldSections, sourceIdx, outSectionIndex, outVertIndex))
+			{
+				continue;
+			}
+
+			// Translate into the new section locations
+			int32_t foundNewIndex = merge.OldToNewSection[outSectionIndex];
+			uint32_t newBaseVertex = 0;
+			if(foundNewIndex == InvalidIndex)
+			{
+				// Chunks are back to back, so the offset from the start of the first chunk still holds
+				newBaseVertex = newSectionBaseVertices[mergedSectionIndex] + merge.MergedVertexOffset[outSectionIndex];
+				foundNewIndex = mergedSectionIndex + (sectionChunks ? sectionChunks[outSectionIndex] : 0);
+			}
+			else
+			{
+				newBaseVertex = newSectionBaseVertices[foundNewIndex];
+			}
+
+			sourceIdx = outVertIndex + newBaseVertex;
+			if(std::find(outSectionIndices.begin(), outSectionIndices.end(), foundNewIndex) == outSectionIndices.end())
+			{
+				outSectionIndices.push_back(foundNewIndex);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool BuildVertexRemap(const FSection* oldSections,
+						  int32_t numOldSections,
+						  const FSectionMerge& merge,
+						  const uint32_t* newSectionBaseVertices,
+						  int32_t numNewSections,
+						  int32_t mergedSectionIndex,
+						  FVertexRemap& outRemap,
+						  const int32_t* sectionChunks)
+	{
+		if(numNewSections > MaxRemapSections)
+		{
+			return false;
+		}
+
+		uint32_t numOldVertices = 0;
+		for(int32_t sectionIndex = 0; sectionIndex < numOldSections; ++sectionIndex)
+		{
+			numOldVertices += oldSections[sectionIndex].NumVertices;
+		}
+
+		outRemap.OldToNewVertex.resize(numOldVertices);
+		outRemap.NewSection.resize(numOldVertices);
+		outRemap.NumNewSections = numNewSections;
+
+		// Sections are back to back so every old section maps onto one contiguous run of new vertices
+		uint32_t oldBaseVertex = 0;
+		for(int32_t sectionIndex = 0; sectionIndex < numOldSections; ++sectionIndex)
+		{
+			const uint32_t numVertices = oldSections[sectionIndex].NumVertices;
+			int32_t newSectionIndex = merge.OldToNewSection[sectionIndex];
+			uint32_t newBaseVertex = 0;
+			if(newSectionIndex == InvalidIndex)
+			{
+				// Chunks are back to back, so the offset from the start of the first chunk still holds
+				newSectionIndex = mergedSectionIndex + (sectionChunks ? sectionChunks[sectionIndex] : 0);
+				newBaseVertex = newSectionBaseVertices[mergedSectionIndex] + merge.MergedVertexOffset[sectionIndex];
+			}
+			else
+			{
+				newBaseVertex = newSectionBaseVertices[newSectionIndex];
+			}
+
+			uint32_t* newVertices = outRemap.OldToNewVertex.data() + oldBaseVertex;
+			for(uint32_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+			{
+				newVertices[vertIndex] = newBaseVertex + vertIndex;
+			}
+			std::fill_n(outRemap.NewSection.data() + oldBaseVertex, numVertices, static_cast<uint16_t>(newSectionIndex));
+			oldBaseVertex += numVertices;
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void RemapMorphDeltas(uint32_t* sourceIndices,
+						  size_t numDeltas,
+						  size_t strideBytes,
+						  const FVertexRemap& remap,
+						  std::vector<int32_t>& outSectionIndices)
+	{
+		outSectionIndices.clear();
+
+		// Bit per new section instead of a unique add per delta
+		std::vector<uint64_t> touchedSections((static_cast<size_t>(remap.NumNewSections) + 63) / 64, 0);
+
+		const uint32_t numOldVertices = static_cast<uint32_t>(remap.OldToNewVertex.size());
+		const uint32_t* oldToNew = remap.OldToNewVertex.data();
+		const uint16_t* newSection = remap.NewSection.data();
+		unsigned char* bytes = reinterpret_cast<unsigned char*>(sourceIndices);
+		for(size_t deltaIndex = 0; deltaIndex < numDeltas; ++deltaIndex)
+		{
+			uint32_t& sourceIdx = *reinterpret_cast<uint32_t*>(bytes + deltaIndex * strideBytes);
+			if(sourceIdx < numOldVertices)
+			{
+				const uint16_t section = newSection[sourceIdx];
+				touchedSections[section >> 6] |= uint64_t(1) << (section & 63);
+				sourceIdx = oldToNew[sourceIdx];
+			}
+		}
+
+		for(int32_t sectionIndex = 0; sectionIndex < remap.NumNewSections; ++sectionIndex)
+		{
+			if(touchedSections[sectionIndex >> 6] & (uint64_t(1) << (sectionIndex & 63)))
+			{
+				outSectionIndices.push_back(sectionIndex);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void RemapFaceMaterials(int32_t* faceMaterialIndices,
+							size_t numFaces,
+							float* sectionedWedgeUVs,
+							const FSlotMapping& mapping,
+							int32_t sectionedMatIndex,
+							int32_t numSections,
+							int32_t numRows)
+	{
+		for(size_t faceIndex = 0; faceIndex < numFaces; ++faceIndex)
+		{
+			int32_t& matIndex = faceMaterialIndices[faceIndex];
+			const int32_t sectionToUse = GetUVSection(mapping, matIndex);
+			if(sectionToUse == InvalidIndex)
+			{
+				if(matIndex >= 0 && matIndex < static_cast<int32_t>(mapping.SlotRemap.size()))
+				{
+					matIndex = mapping.SlotRemap[matIndex];
+				}
+				continue;
+			}
+
+			matIndex = sectionedMatIndex + std::max(GetSlotGroup(mapping, matIndex), 0);
+			const float sectionMidX = GetSectionCenterU(sectionToUse, numSections);
+			const float sectionMidY = GetSectionCenterV(sectionToUse, numSections, numRows);
+
+			// Update the UVs for this face
+			const size_t firstWedgeIndex = faceIndex * 3;
+			for(size_t wedgeIndex = 0; wedgeIndex < 3; ++wedgeIndex)
+			{
+				sectionedWedgeUVs[(firstWedgeIndex + wedgeIndex) * 2] = sectionMidX;
+				if(sectionMidY >= 0.0f)
+				{
+					sectionedWedgeUVs[(firstWedgeIndex + wedgeIndex) * 2 + 1] = sectionMidY;
+				}
+			}
+		}
+	}
+
+	namespace
+	{
+		/** Murmur3 finalizer, used as the per word mix */
+		inline uint64_t MixHash(uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xFF51AFD7ED558CCDull;
+			value ^= value >> 33;
+			value *= 0xC4CEB9FE1A85EC53ull;
+			value ^= value >> 33;
+			return value;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FHasher::Update(const void* data, size_t numBytes)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		const size_t numWords = numBytes / sizeof(uint64_t);
+		for(size_t wordIndex = 0; wordIndex < numWords; ++wordIndex)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + wordIndex * sizeof(uint64_t), sizeof(uint64_t));
+			State = MixHash(State ^ word) + 0x9E3779B97F4A7C15ull;
+		}
+
+		const size_t tailBytes = numBytes - numWords * sizeof(uint64_t);
+		if(tailBytes)
+		{
+			uint64_t word = 0;
+			std::memcpy(&word, bytes + numWords * sizeof(uint64_t), tailBytes);
+			State = MixHash(State ^ word ^ (static_cast<uint64_t>(tailBytes) << 56)) + 0x9E3779B97F4A7C15ull;
+		}
+		Length += numBytes;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	uint64_t FHasher::Finalize() const
+	{
+		return MixHash(State ^ Length);
+	}
+}
@@ -0,0 +1,6 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "Modules/ModuleManager.h"
+
+// Kept out of SectionedUVCore.cpp so the core can be built without the engine.
+IMPLEMENT_MODULE(FDefaultModuleImpl, SectionedUVCore)
@@ -0,0 +1,589 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+// Index and vertex order optimization and vertex welding for merged sections. Kept apart from the sectioning itself in SectionedUVCore.cpp.
+
+#include "SectionedUVCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace SectionedUVCore
+{
+	namespace
+	{
+		/** Cache size Forsyth scores against, larger than any real cache on purpose so the order holds up on all of them */
+		constexpr int32_t ForsythCacheSize = 32;
+		constexpr float ForsythCacheDecayPower = 1.5f;
+		constexpr float ForsythLastTriangleScore = 0.75f;
+		constexpr float ForsythValenceBoostScale = 2.0f;
+		constexpr float ForsythValenceBoostPower = 0.5f;
+
+		/** Valence scores are looked up below this many remaining triangles and computed above */
+		constexpr uint32_t ForsythMaxTabledValence = 64;
+
+		/**
+		* Forsyth vertex score, vertices recently used and with few triangles left score highest.
+		* The pow calls are tabled, they dominate the optimization otherwise.
+		*/
+		class FForsythScores
+		{
+		public:
+			FForsythScores()
+			{
+				for(int32_t cachePosition = 0; cachePosition < ForsythCacheSize; ++cachePosition)
+				{
+					if(cachePosition < 3)
+					{
+						// Vertices of the triangle just added, fixed score so the next triangle does not favour one of them
+						CacheScores[cachePosition] = ForsythLastTriangleScore;
+					}
+					else
+					{
+						const float scaler = 1.0f / (ForsythCacheSize - 3);
+						CacheScores[cachePosition] = std::pow(1.0f - (cachePosition - 3) * scaler, ForsythCacheDecayPower);
+					}
+				}
+
+				ValenceScores[0] = 0.0f;
+				for(uint32_t valence = 1; valence < ForsythMaxTabledValence; ++valence)
+				{
+					ValenceScores[valence] = GetValenceScore(valence);
+				}
+			}
+
+			float GetVertexScore(int32_t cachePosition, uint32_t numRemainingTriangles) const
+			{
+				if(numRemainingTriangles == 0)
+				{
+					return -1.0f;
+				}
+
+				// Boost vertices with few triangles left so they get finished off instead of becoming lone triangles later
+				const float cacheScore = cachePosition >= 0 ? CacheScores[cachePosition] : 0.0f;
+				return cacheScore + (numRemainingTriangles < ForsythMaxTabledValence ? ValenceScores[numRemainingTriangles] : GetValenceScore(numRemainingTriangles));
+			}
+
+		private:
+			static float GetValenceScore(uint32_t numRemainingTriangles)
+			{
+				return ForsythValenceBoostScale * std::pow(static_cast<float>(numRemainingTriangles), -ForsythValenceBoostPower);
+			}
+
+			float CacheScores[ForsythCacheSize];
+			float ValenceScores[ForsythMaxTabledValence];
+		};
+
+		bool AreIndicesInRange(const uint32_t* indices, size_t numIndices, uint32_t numVertices)
+		{
+			for(size_t index = 0; index < numIndices; ++index)
+			{
+				if(indices[index] >= numVertices)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		const float* GetPosition(const float* positions, size_t strideBytes, uint32_t vertIndex)
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) + vertIndex * strideBytes);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FVertexCacheStats AnalyzeVertexCache(const uint32_t* indices,
+										 size_t numIndices,
+										 uint32_t numVertices,
+										 int32_t cacheSize)
+	{
+		FVertexCacheStats stats;
+		const size_t numTriangles = numIndices / 3;
+		if(!numTriangles || !AreIndicesInRange(indices, numTriangles * 3, numVertices))
+		{
+			return stats;
+		}
+
+		// A vertex is in the FIFO cache if fewer than cacheSize misses happened since it was last loaded
+		std::vector<uint32_t> loadedAt(numVertices, 0);
+		std::vector<uint8_t> referenced(numVertices, 0);
+		uint32_t numMisses = 0;
+		uint32_t numReferenced = 0;
+		for(size_t index = 0; index < numTriangles * 3; ++index)
+		{
+			const uint32_t vertIndex = indices[index];
+			if(!referenced[vertIndex])
+			{
+				referenced[vertIndex] = 1;
+				++numReferenced;
+			}
+			if(loadedAt[vertIndex] == 0 || numMisses - loadedAt[vertIndex] >= static_cast<uint32_t>(cacheSize))
+			{
+				++numMisses;
+				loadedAt[vertIndex] = numMisses;
+			}
+		}
+
+		stats.ACMR = static_cast<float>(numMisses) / numTriangles;
+		stats.ATVR = numReferenced ? static_cast<float>(numMisses) / numReferenced : 0.0f;
+		return stats;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool OptimizeVertexCache(uint32_t* indices, size_t numIndices, uint32_t numVertices)
+	{
+		const size_t numTriangles = numIndices / 3;
+		if(!AreIndicesInRange(indices, numTriangles * 3, numVertices))
+		{
+			return false;
+		}
+		if(numTriangles < 2)
+		{
+			return true;
+		}
+
+		// Triangles using each vertex. The first numRemaining entries of a vertex are the triangles not added yet.
+		std::vector<uint32_t> triangleOffsets(static_cast<size_t>(numVertices) + 1, 0);
+		for(size_t index = 0; index < numTriangles * 3; ++index)
+		{
+			++triangleOffsets[indices[index] + 1];
+		}
+		for(uint32_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			triangleOffsets[vertIndex + 1] += triangleOffsets[vertIndex];
+		}
+
+		std::vector<uint32_t> vertexTriangles(numTriangles * 3);
+		std::vector<uint32_t> numRemaining(numVertices, 0);
+		for(size_t triIndex = 0; triIndex < numTriangles; ++triIndex)
+		{
+			for(size_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertIndex = indices[triIndex * 3 + corner];
+				vertexTriangles[triangleOffsets[vertIndex] + numRemaining[vertIndex]++] = static_cast<uint32_t>(triIndex);
+			}
+		}
+
+		static const FForsythScores scores;
+		std::vector<float> vertexScores(numVertices);
+		for(uint32_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			vertexScores[vertIndex] = scores.GetVertexScore(-1, numRemaining[vertIndex]);
+		}
+
+		std::vector<uint8_t> triangleAdded(numTriangles, 0);
+
+		std::vector<uint32_t> optimized;
+		optimized.reserve(numTriangles * 3);
+
+		uint32_t cache[ForsythCacheSize + 3];
+		int32_t cacheCount = 0;
+		size_t scanCursor = 0;
+		int64_t bestTriangle = -1;
+
+		for(size_t numAdded = 0; numAdded < numTriangles; ++numAdded)
+		{
+			if(bestTriangle < 0)
+			{
+				// Nothing in the cache has triangles left, carry on with the next triangle in the original order
+				while(triangleAdded[scanCursor])
+				{
+					++scanCursor;
+				}
+				bestTriangle = static_cast<int64_t>(scanCursor);
+			}
+
+			const size_t triIndex = static_cast<size_t>(bestTriangle);
+			const uint32_t* triangle = indices + triIndex * 3;
+			triangleAdded[triIndex] = 1;
+			optimized.insert(optimized.end(), triangle, triangle + 3);
+
+			// Take the triangle off its vertices' remaining lists
+			for(size_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertIndex = triangle[corner];
+				uint32_t* remaining = vertexTriangles.data() + triangleOffsets[vertIndex];
+				for(uint32_t remainingIndex = 0; remainingIndex < numRemaining[vertIndex]; ++remainingIndex)
+				{
+					if(remaining[remainingIndex] == triIndex)
+					{
+						remaining[remainingIndex] = remaining[--numRemaining[vertIndex]];
+						break;
+					}
+				}
+			}
+
+			// Move the triangle's vertices to the front of the LRU cache, the tail falls out
+			uint32_t newCache[ForsythCacheSize + 3];
+			int32_t newCacheCount = 0;
+			for(size_t corner = 0; corner < 3; ++corner)
+			{
+				if(std::find(newCache, newCache + newCacheCount, triangle[corner]) == newCache + newCacheCount)
+				{
+					newCache[newCacheCount++] = triangle[corner];
+				}
+			}
+			const int32_t numTriangleVertices = newCacheCount;
+			for(int32_t cacheIndex = 0; cacheIndex < cacheCount; ++cacheIndex)
+			{
+				if(std::find(newCache, newCache + numTriangleVertices, cache[cacheIndex]) == newCache + numTriangleVertices)
+				{
+					newCache[newCacheCount++] = cache[cacheIndex];
+				}
+			}
+
+			for(int32_t cacheIndex = 0; cacheIndex < newCacheCount; ++cacheIndex)
+			{
+				const uint32_t vertIndex = newCache[cacheIndex];
+				vertexScores[vertIndex] = scores.GetVertexScore(cacheIndex < ForsythCacheSize ? cacheIndex : -1, numRemaining[vertIndex]);
+			}
+
+			// Rescore the triangles around the cache and continue with the best one
+			float bestScore = -1.0f;
+			bestTriangle = -1;
+			for(int32_t cacheIndex = 0; cacheIndex < newCacheCount; ++cacheIndex)
+			{
+				const uint32_t vertIndex = newCache[cacheIndex];
+				const uint32_t* remaining = vertexTriangles.data() + triangleOffsets[vertIndex];
+				for(uint32_t remainingIndex = 0; remainingIndex < numRemaining[vertIndex]; ++remainingIndex)
+				{
+					const uint32_t remainingTriangle = remaining[remainingIndex];
+					const uint32_t* corners = indices + static_cast<size_t>(remainingTriangle) * 3;
+					const float score = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+					if(score > bestScore)
+					{
+						bestScore = score;
+						bestTriangle = remainingTriangle;
+					}
+				}
+			}
+
+			cacheCount = std::min(newCacheCount, ForsythCacheSize);
+			std::copy(newCache, newCache + cacheCount, cache);
+		}
+
+		std::memcpy(indices, optimized.data(), optimized.size() * sizeof(uint32_t));
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool OptimizeOverdraw(uint32_t* indices,
+						  size_t numIndices,
+						  const float* positions,
+						  size_t strideBytes,
+						  uint32_t numVertices)
+	{
+		const size_t numTriangles = numIndices / 3;
+		if(!AreIndicesInRange(indices, numTriangles * 3, numVertices))
+		{
+			return false;
+		}
+		if(numTriangles < 2)
+		{
+			return true;
+		}
+
+		// Split into clusters where a triangle misses the cache on all three vertices, reordering whole clusters
+		// only costs those misses which happened anyway
+		std::vector<size_t> clusterStarts;
+		{
+			std::vector<uint32_t> loadedAt(numVertices, 0);
+			uint32_t numMisses = 0;
+			for(size_t triIndex = 0; triIndex < numTriangles; ++triIndex)
+			{
+				int32_t triangleMisses = 0;
+				for(size_t corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t vertIndex = indices[triIndex * 3 + corner];
+					if(loadedAt[vertIndex] == 0 || numMisses - loadedAt[vertIndex] >= static_cast<uint32_t>(DefaultVertexCacheSize))
+					{
+						loadedAt[vertIndex] = ++numMisses;
+						++triangleMisses;
+					}
+				}
+				if(triIndex == 0 || triangleMisses == 3)
+				{
+					clusterStarts.push_back(triIndex);
+				}
+			}
+		}
+		if(clusterStarts.size() < 2)
+		{
+			return true;
+		}
+
+		// Area weighted centroid and normal of each cluster and of the whole section
+		struct FCluster
+		{
+			size_t FirstTriangle = 0;
+			size_t NumTriangles = 0;
+			double Centroid[3] = {0.0, 0.0, 0.0};
+			double Normal[3] = {0.0, 0.0, 0.0};
+			double Area = 0.0;
+			double SortKey = 0.0;
+		};
+
+		std::vector<FCluster> clusters(clusterStarts.size());
+		double meshCentroid[3] = {0.0, 0.0, 0.0};
+		double meshArea = 0.0;
+		for(size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex)
+		{
+			FCluster& cluster = clusters[clusterIndex];
+			cluster.FirstTriangle = clusterStarts[clusterIndex];
+			cluster.NumTriangles = (clusterIndex + 1 < clusters.size() ? clusterStarts[clusterIndex + 1] : numTriangles) - cluster.FirstTriangle;
+
+			for(size_t triIndex = cluster.FirstTriangle; triIndex < cluster.FirstTriangle + cluster.NumTriangles; ++triIndex)
+			{
+				const float* p0 = GetPosition(positions, strideBytes, indices[triIndex * 3]);
+				const float* p1 = GetPosition(positions, strideBytes, indices[triIndex * 3 + 1]);
+				const float* p2 = GetPosition(positions, strideBytes, indices[triIndex * 3 + 2]);
+
+				const double e1[3] = {double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2]};
+				const double e2[3] = {double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2]};
+				const double normal[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+				const double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+				for(int32_t axis = 0; axis < 3; ++axis)
+				{
+					const double center = (double(p0[axis]) + p1[axis] + p2[axis]) / 3.0;
+					cluster.Centroid[axis] += center * area;
+					cluster.Normal[axis] += normal[axis];
+				}
+				cluster.Area += area;
+			}
+
+			for(int32_t axis = 0; axis < 3; ++axis)
+			{
+				meshCentroid[axis] += cluster.Centroid[axis];
+			}
+			meshArea += cluster.Area;
+		}
+
+		if(meshArea <= 0.0)
+		{
+			return true;
+		}
+		for(int32_t axis = 0; axis < 3; ++axis)
+		{
+			meshCentroid[axis] /= meshArea;
+		}
+
+		// Clusters facing away from the middle of the section are on the outside and draw first
+		for(FCluster& cluster : clusters)
+		{
+			const double normalLength = std::sqrt(cluster.Normal[0] * cluster.Normal[0] + cluster.Normal[1] * cluster.Normal[1] + cluster.Normal[2] * cluster.Normal[2]);
+			if(cluster.Area <= 0.0 || normalLength <= 0.0)
+			{
+				continue;
+			}
+			for(int32_t axis = 0; axis < 3; ++axis)
+			{
+				cluster.SortKey += (cluster.Centroid[axis] / cluster.Area - meshCentroid[axis]) * (cluster.Normal[axis] / normalLength);
+			}
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const FCluster& a, const FCluster& b)
+		{
+			return a.SortKey > b.SortKey;
+		});
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(numTriangles * 3);
+		for(const FCluster& cluster : clusters)
+		{
+			sorted.insert(sorted.end(), indices + cluster.FirstTriangle * 3, indices + (cluster.FirstTriangle + cluster.NumTriangles) * 3);
+		}
+		std::memcpy(indices, sorted.data(), sorted.size() * sizeof(uint32_t));
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool OptimizeVertexFetch(uint32_t* indices,
+							 size_t numIndices,
+							 uint32_t numVertices,
+							 std::vector<uint32_t>& outOldToNew)
+	{
+		if(!AreIndicesInRange(indices, numIndices, numVertices))
+		{
+			return false;
+		}
+
+		outOldToNew.assign(numVertices, InvalidVertex);
+		uint32_t nextVertex = 0;
+		for(size_t index = 0; index < numIndices; ++index)
+		{
+			uint32_t& newVertex = outOldToNew[indices[index]];
+			if(newVertex == InvalidVertex)
+			{
+				newVertex = nextVertex++;
+			}
+			indices[index] = newVertex;
+		}
+
+		for(uint32_t& newVertex : outOldToNew)
+		{
+			if(newVertex == InvalidVertex)
+			{
+				newVertex = nextVertex++;
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void ReorderVertices(void* vertices, uint32_t numVertices, size_t strideBytes, const uint32_t* oldToNew)
+	{
+		unsigned char* bytes = static_cast<unsigned char*>(vertices);
+		const std::vector<unsigned char> source(bytes, bytes + numVertices * strideBytes);
+		for(uint32_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			std::memcpy(bytes + oldToNew[vertIndex] * strideBytes, source.data() + vertIndex * strideBytes, strideBytes);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	uint32_t WeldVertices(uint32_t* indices,
+						  size_t numIndices,
+						  const float* positions,
+						  size_t strideBytes,
+						  uint32_t numVertices,
+						  float positionTolerance,
+						  const std::function<bool(uint32_t, uint32_t)>& canWeld,
+						  std::vector<uint32_t>& outOldToNew)
+	{
+		if(!numVertices || !AreIndicesInRange(indices, numIndices, numVertices))
+		{
+			return 0;
+		}
+
+		// Cells twice the tolerance wide, so the tolerance box around a vertex touches at most 2 x 2 x 2 of them
+		const float tolerance = std::max(positionTolerance, 0.0f);
+		const float cellSize = std::max(tolerance * 2.0f, 1e-6f);
+		const float toleranceSquared = tolerance * tolerance;
+		uint32_t numBuckets = 1;
+		while(numBuckets < static_cast<uint64_t>(numVertices) * 2 && numBuckets < 0x80000000u)
+		{
+			numBuckets <<= 1;
+		}
+
+		// Only kept vertices go into the hash, chained per bucket. Cells sharing a bucket just add candidates.
+		std::vector<uint32_t> bucketHeads(numBuckets, InvalidVertex);
+		std::vector<uint32_t> nextInBucket(numVertices, InvalidVertex);
+		const auto getBucket = [numBuckets](int64_t cellX, int64_t cellY, int64_t cellZ)
+		{
+			const uint64_t hash = static_cast<uint64_t>(cellX) * 73856093ull ^ static_cast<uint64_t>(cellY) * 19349663ull ^ static_cast<uint64_t>(cellZ) * 83492791ull;
+			return static_cast<uint32_t>((hash ^ (hash >> 32)) & (numBuckets - 1));
+		};
+		const auto getCell = [cellSize](float value)
+		{
+			return static_cast<int64_t>(std::floor(value / cellSize));
+		};
+
+		outOldToNew.assign(numVertices, InvalidVertex);
+		uint32_t numWelded = 0;
+		for(uint32_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			const float* position = GetPosition(positions, strideBytes, vertIndex);
+			int64_t minCell[3], maxCell[3];
+			for(int32_t axis = 0; axis < 3; ++axis)
+			{
+				minCell[axis] = getCell(position[axis] - tolerance);
+				maxCell[axis] = getCell(position[axis] + tolerance);
+			}
+
+			uint32_t weldedOnto = InvalidVertex;
+			for(int64_t cellX = minCell[0]; cellX <= maxCell[0] && weldedOnto == InvalidVertex; ++cellX)
+			{
+				for(int64_t cellY = minCell[1]; cellY <= maxCell[1] && weldedOnto == InvalidVertex; ++cellY)
+				{
+					for(int64_t cellZ = minCell[2]; cellZ <= maxCell[2] && weldedOnto == InvalidVertex; ++cellZ)
+					{
+						for(uint32_t candidate = bucketHeads[getBucket(cellX, cellY, cellZ)]; candidate != InvalidVertex; candidate = nextInBucket[candidate])
+						{
+							const float* candidatePosition = GetPosition(positions, strideBytes, candidate);
+							const float deltaX = candidatePosition[0] - position[0];
+							const float deltaY = candidatePosition[1] - position[1];
+							const float deltaZ = candidatePosition[2] - position[2];
+							if(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ <= toleranceSquared && canWeld(candidate, vertIndex))
+							{
+								weldedOnto = candidate;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if(weldedOnto != InvalidVertex)
+			{
+				outOldToNew[vertIndex] = outOldToNew[weldedOnto];
+				continue;
+			}
+
+			outOldToNew[vertIndex] = numWelded++;
+			uint32_t& bucketHead = bucketHeads[getBucket(getCell(position[0]), getCell(position[1]), getCell(position[2]))];
+			nextInBucket[vertIndex] = bucketHead;
+			bucketHead = vertIndex;
+		}
+
+		for(size_t index = 0; index < numIndices; ++index)
+		{
+			indices[index] = outOldToNew[indices[index]];
+		}
+		return numWelded;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	uint32_t CompactWeldedVertices(void* vertices, uint32_t numVertices, size_t strideBytes, const uint32_t* oldToNew)
+	{
+		// Kept vertices get their numbers in order, so a vertex is kept when it is the next number handed out
+		unsigned char* bytes = static_cast<unsigned char*>(vertices);
+		uint32_t numKept = 0;
+		for(uint32_t vertIndex = 0; vertIndex < numVertices; ++vertIndex)
+		{
+			if(oldToNew[vertIndex] == numKept)
+			{
+				if(numKept != vertIndex)
+				{
+					std::memcpy(bytes + numKept * strideBytes, bytes + vertIndex * strideBytes, strideBytes);
+				}
+				++numKept;
+			}
+		}
+		return numKept;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void ReorderMergedVertices(FVertexRemap& remap,
+							   int32_t mergedSectionIndex,
+							   uint32_t oldBaseVertex,
+							   uint32_t newBaseVertex,
+							   const uint32_t* mergedOldToNew)
+	{
+		for(size_t vertIndex = 0; vertIndex < remap.OldToNewVertex.size(); ++vertIndex)
+		{
+			if(remap.NewSection[vertIndex] == mergedSectionIndex)
+			{
+				uint32_t& newVertex = remap.OldToNewVertex[vertIndex];
+				newVertex = newBaseVertex + mergedOldToNew[newVertex - oldBaseVertex];
+			}
+		}
+	}
+}
@@ -0,0 +1,636 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+// NOTE: This header is engine independent on purpose. It is compiled inside the SectionedUVCore module by UBT and
+// standalone by the CMake benchmark build (see Benchmarks/). Only use the standard library in here.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#ifndef SECTIONEDUVCORE_API
+#define SECTIONEDUVCORE_API
+#endif
+
+namespace SectionedUVCore
+{
+	static constexpr int32_t InvalidIndex = -1;
+	static constexpr uint32_t InvalidVertex = 0xFFFFFFFFu;
+	/** The number of sections which fit in a packed 8 bit section id */
+	static constexpr int32_t MaxPackedSections = 256;
+	/** The number of sections a vertex remap table can index */
+	static constexpr int32_t MaxRemapSections = 0xFFFF;
+	/** FIFO post transform cache size used to report cache statistics, a conservative size for current GPUs */
+	static constexpr int32_t DefaultVertexCacheSize = 16;
+
+	/**
+	 * A render section living inside a shared index / vertex buffer.
+	 * Mirrors the parts of FSkelMeshSection the sectioning touches.
+	 */
+	struct FSection
+	{
+		uint32_t BaseIndex = 0;
+		uint32_t NumTriangles = 0;
+		uint32_t BaseVertexIndex = 0;
+		uint32_t NumVertices = 0;
+		int32_t MaterialIndex = InvalidIndex;
+		/** Same as FSkelMeshSection::CorrespondClothAssetIndex */
+		int32_t ClothAssetIndex = InvalidIndex;
+	};
+
+	/**
+	 * How the source material slots map onto UV sections and onto the reduced slot list.
+	 */
+	struct FSlotMapping
+	{
+		/** Per source slot, the UV section the slot is squished into or InvalidIndex if the slot is kept */
+		std::vector<int32_t> SlotToUVSection;
+		/** Per source slot, the slot index once the merged slots are removed or InvalidIndex if the slot is merged */
+		std::vector<int32_t> SlotRemap;
+		/** Number of slots left once the merged slots are removed (not counting the new sectioned slots) */
+		int32_t NumKeptSlots = 0;
+		/** Per source slot, the sectioned slot the slot is merged into or InvalidIndex if the slot is kept */
+		std::vector<int32_t> SlotToGroup;
+		/** Number of sectioned slots, they go after the kept slots. UV sections are handed out per sectioned slot. */
+		int32_t NumGroups = 0;
+	};
+
+	/**
+	 * Result of gathering the sections to merge for one LOD.
+	 */
+	struct FSectionMerge
+	{
+		/** Per source section, the section index after removal or InvalidIndex if the section was merged */
+		std::vector<int32_t> OldToNewSection;
+		/** Per source section, where its vertices start inside the merged section or InvalidVertex if not merged */
+		std::vector<uint32_t> MergedVertexOffset;
+		/** The source sections which were merged, in ascending order */
+		std::vector<int32_t> SectionsToRemove;
+		/** Indices of the merged section, relative to the first vertex of the merged section */
+		std::vector<uint32_t> MergedIndices;
+		uint32_t NumMergedVertices = 0;
+		uint32_t NumMergedTriangles = 0;
+	};
+
+	/**
+	 * Old vertex to new vertex lookup for one LOD, built once and shared by every morph target of the LOD.
+	 */
+	struct FVertexRemap
+	{
+		/** Per source vertex, the vertex index after the merge */
+		std::vector<uint32_t> OldToNewVertex;
+		/** Per source vertex, the section it lives in after the merge */
+		std::vector<uint16_t> NewSection;
+		/** The number of sections after the merge */
+		int32_t NumNewSections = 0;
+	};
+
+	/**
+	 * How the bone maps of the merged sections combine. When the unique bones do not fit in one bone map the merged
+	 * section is split into chunks, laid out back to back in merged section order.
+	 */
+	struct FBoneMapMerge
+	{
+		/** The chunks of the merged section. Indices and vertices are relative to the merged section, MaterialIndex is unused. */
+		std::vector<FSection> Chunks;
+		/** The deduplicated bone map of each chunk */
+		std::vector<std::vector<uint16_t>> ChunkBoneMaps;
+		/** Per source section, the chunk it is merged into or InvalidIndex if the section is kept */
+		std::vector<int32_t> SectionChunk;
+		/**
+		 * Each entry of every source bone map translated into its chunk's bone map, laid out like the bone maps passed to
+		 * MergeBoneMaps. Entries of kept sections are left at 0. See GetSectionBoneRemap.
+		 */
+		std::vector<uint16_t> SectionBoneRemap;
+		/** Per source section plus one past the end, where its entries start in SectionBoneRemap */
+		std::vector<uint32_t> SectionBoneRemapOffsets;
+	};
+
+	/**
+	 * A rectangle of an atlas, in texels.
+	 */
+	struct FAtlasRect
+	{
+		uint32_t X = 0;
+		uint32_t Y = 0;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+	};
+
+	/**
+	 * Where the 0-1 UV square of a section lands in an atlas, UV * Scale + Offset.
+	 */
+	struct FAtlasRegion
+	{
+		float OffsetU = 0.0f;
+		float OffsetV = 0.0f;
+		float ScaleU = 1.0f;
+		float ScaleV = 1.0f;
+	};
+
+	/**
+	 * Post transform vertex cache statistics of an index buffer, from a FIFO cache simulation.
+	 */
+	struct FVertexCacheStats
+	{
+		/** Average cache miss ratio, vertices transformed per triangle. Around 0.5 to 0.7 is good, 3 is the worst case. */
+		float ACMR = 0.0f;
+		/** Average transform to vertex ratio, vertices transformed per referenced vertex. 1 is ideal. */
+		float ATVR = 0.0f;
+	};
+
+	/**
+	 * Builds the slot mapping for the passed in slots to merge.
+	 * @param numMaterials The number of material slots on the source mesh.
+	 * @param materialSlots The slots to merge, sorted ascending. UV sections are handed out in this order.
+	 * @param numMaterialSlots The number of entries in materialSlots.
+	 * @param outMapping The mapping to fill.
+	 * @return False if a slot is out of range or listed twice.
+	 */
+	SECTIONEDUVCORE_API bool BuildSlotMapping(int32_t numMaterials,
+											  const int32_t* materialSlots,
+											  int32_t numMaterialSlots,
+											  FSlotMapping& outMapping);
+
+	/**
+	 * Builds the slot mapping for merging slots into several sectioned slots, for example one per blend mode.
+	 * @param numMaterials The number of material slots on the source mesh.
+	 * @param materialSlots The slots to merge, sorted ascending. UV sections are handed out in this order within each group.
+	 * @param slotGroups Per entry of materialSlots, the sectioned slot it is merged into. Groups are numbered from 0 without gaps.
+	 * @param numMaterialSlots The number of entries in materialSlots.
+	 * @param outMapping The mapping to fill.
+	 * @return False if a slot is out of range or listed twice, or a group is negative.
+	 */
+	SECTIONEDUVCORE_API bool BuildGroupedSlotMapping(int32_t numMaterials,
+													 const int32_t* materialSlots,
+													 const int32_t* slotGroups,
+													 int32_t numMaterialSlots,
+													 FSlotMapping& outMapping);
+
+	/**
+	 * The mapping for merging one group of a grouped mapping on its own, when the groups are merged one after the other.
+	 * Material indices are in the pass layout: the source slots followed by one slot per group (see GetPassGroupSlot).
+	 * Only the group's slots get a UV section, every other slot maps onto itself. Once every group is merged, move the
+	 * pass layout into the final one with GetGroupedMaterialIndex.
+	 */
+	SECTIONEDUVCORE_API void BuildGroupPassMapping(const FSlotMapping& mapping, int32_t group, FSlotMapping& outPassMapping);
+
+	/**
+	 * The mapping which merges every slot into the first group, for LODs far enough away that the kept slots and the
+	 * other groups are not worth their own draws. The first group's slots keep their UV sections, every other slot takes
+	 * the next section in slot order. Material indices after the merge are still in the layout of the passed in mapping,
+	 * the merged sections go to its first sectioned slot.
+	 * @return The number of UV sections the mapping uses.
+	 */
+	SECTIONEDUVCORE_API int32_t BuildCollapsedSlotMapping(const FSlotMapping& mapping, FSlotMapping& outCollapsedMapping);
+
+	/** The material index of a group's sectioned slot in the pass layout of BuildGroupPassMapping */
+	inline int32_t GetPassGroupSlot(const FSlotMapping& mapping, int32_t group)
+	{
+		return static_cast<int32_t>(mapping.SlotToUVSection.size()) + group;
+	}
+
+	/**
+	 * Moves a material index in the pass layout of BuildGroupPassMapping to the final slot layout, the kept slots
+	 * followed by one sectioned slot per group. A merged source slot moves to its group's sectioned slot.
+	 */
+	inline int32_t GetGroupedMaterialIndex(const FSlotMapping& mapping, int32_t passMaterialIndex)
+	{
+		const int32_t numSourceSlots = static_cast<int32_t>(mapping.SlotRemap.size());
+		if(passMaterialIndex < 0 || passMaterialIndex >= numSourceSlots + mapping.NumGroups)
+		{
+			return passMaterialIndex;
+		}
+		if(passMaterialIndex >= numSourceSlots)
+		{
+			return mapping.NumKeptSlots + passMaterialIndex - numSourceSlots;
+		}
+		const int32_t group = mapping.SlotToGroup[passMaterialIndex];
+		return group == InvalidIndex ? mapping.SlotRemap[passMaterialIndex] : mapping.NumKeptSlots + group;
+	}
+
+	/** The sectioned slot group the slot is merged into, or InvalidIndex if the slot is kept */
+	inline int32_t GetSlotGroup(const FSlotMapping& mapping, int32_t materialSlot)
+	{
+		if(materialSlot < 0 || materialSlot >= static_cast<int32_t>(mapping.SlotToGroup.size()))
+		{
+			return InvalidIndex;
+		}
+		return mapping.SlotToGroup[materialSlot];
+	}
+
+	/** The UV section the slot is merged into, or InvalidIndex if the slot is kept */
+	inline int32_t GetUVSection(const FSlotMapping& mapping, int32_t materialSlot)
+	{
+		if(materialSlot < 0 || materialSlot >= static_cast<int32_t>(mapping.SlotToUVSection.size()))
+		{
+			return InvalidIndex;
+		}
+		return mapping.SlotToUVSection[materialSlot];
+	}
+
+	/**
+	 * The U coordinate in the middle of the passed in section.
+	 * Sections past numSections wrap onto the next row of a section grid, see GetSectionCenterV.
+	 */
+	inline float GetSectionCenterU(int32_t uvSection, int32_t numSections)
+	{
+		const float halfStride = (1.0f / numSections) / 2.0f;
+		return (uvSection % numSections) * (1.0f / numSections) + halfStride;
+	}
+
+	/**
+	 * The V coordinate in the middle of the row the section lands in when the sections are laid out as a grid of
+	 * numSections columns by numRows rows, filled row by row.
+	 * @return A negative value for a single row, V is left as UV0 in that case.
+	 */
+	inline float GetSectionCenterV(int32_t uvSection, int32_t numSections, int32_t numRows)
+	{
+		if(numRows <= 1)
+		{
+			return -1.0f;
+		}
+		const float halfStride = (1.0f / numRows) / 2.0f;
+		return (uvSection / numSections) * (1.0f / numRows) + halfStride;
+	}
+
+	/**
+	 * Gathers all sections using a merged slot and builds the merged index buffer for them.
+	 * Sections are expected to be laid out back to back in the vertex buffer, the same as FSkeletalMeshLODModel.
+	 * The merged index buffer is sized once up front, and reusing outMerge keeps its buffers.
+	 * @return False if a section references indices outside of the index buffer.
+	 */
+	SECTIONEDUVCORE_API bool MergeSections(const FSection* sections,
+										   int32_t numSections,
+										   const uint32_t* indexBuffer,
+										   size_t numIndices,
+										   const FSlotMapping& mapping,
+										   FSectionMerge& outMerge);
+
+	/**
+	 * Removes a section from the index buffer and re-bases the indices and sections after it.
+	 * @param sections The sections of the model. The removed section is erased from this.
+	 * @param indexBuffer The index buffer of the model. Compacted in place.
+	 * @param numIndices In: number of valid indices. Out: number of indices left.
+	 * @param numVertices In: number of vertices in the model. Out: number of vertices left.
+	 * @param sectionIndex The section to remove.
+	 * @return False if the section is invalid or clothing relies on it.
+	 */
+	SECTIONEDUVCORE_API bool RemoveSection(std::vector<FSection>& sections,
+										   uint32_t* indexBuffer,
+										   size_t& numIndices,
+										   uint32_t& numVertices,
+										   int32_t sectionIndex);
+
+	/**
+	 * Removes a batch of sections in a single linear pass over the index buffer.
+	 * Same result as calling RemoveSection for each section in reverse order, without shifting the index buffer and
+	 * re-basing every index once per removed section.
+	 * @param sections The sections of the model. Removed sections are erased from this, compacting it in place.
+	 * @param indexBuffer The index buffer of the model. Compacted in place.
+	 * @param numIndices In: number of valid indices. Out: number of indices left.
+	 * @param numVertices In: number of vertices in the model. Out: number of vertices left.
+	 * @param sectionsToRemove The sections to remove, ascending.
+	 * @param numSectionsToRemove The number of entries in sectionsToRemove.
+	 * @param outRemovedSections The sections which were actually removed, ascending. Sections clothing relies on are kept.
+	 */
+	SECTIONEDUVCORE_API void RemoveSections(std::vector<FSection>& sections,
+											uint32_t* indexBuffer,
+											size_t& numIndices,
+											uint32_t& numVertices,
+											const int32_t* sectionsToRemove,
+											int32_t numSectionsToRemove,
+											std::vector<int32_t>& outRemovedSections);
+
+	/** Writes src + offset into dst for count indices. src and dst may be the same buffer. */
+	SECTIONEDUVCORE_API void RebaseIndices(const uint32_t* src, size_t count, uint32_t offset, uint32_t* dst);
+
+	/**
+	 * Copies UV0 into the sectioned UV channel of a strided vertex array and squishes U into the section.
+	 * @param uv0 Pointer to UV0.X of the first vertex.
+	 * @param sectionedUV Pointer to the sectioned UV X of the first vertex.
+	 * @param numVertices The number of vertices to write.
+	 * @param strideBytes The size of one vertex.
+	 * @param sectionU The U to write, or a negative value to only copy UV0.
+	 * @param sectionV The V to write, or a negative value to copy V from UV0.
+	 */
+	SECTIONEDUVCORE_API void WriteSectionedUVs(const float* uv0,
+											   float* sectionedUV,
+											   size_t numVertices,
+											   size_t strideBytes,
+											   float sectionU,
+											   float sectionV = -1.0f);
+
+	/** Rounds a float to the nearest IEEE half float, the format half precision UV channels are stored in */
+	SECTIONEDUVCORE_API uint16_t FloatToHalf(float value);
+
+	/** Expands an IEEE half float back to a float */
+	SECTIONEDUVCORE_API float HalfToFloat(uint16_t value);
+
+	/**
+	 * True if every section center of a numSections by numRows grid still lands in its own section once stored in a
+	 * half precision UV channel, with at least a quarter of a section to spare so filtering stays inside the section.
+	 * Only very large grids (2048 sections on one axis) fail this.
+	 */
+	SECTIONEDUVCORE_API bool AreSectionCentersHalfSafe(int32_t numSections, int32_t numRows = 1);
+
+	/**
+	 * Writes a packed 8 bit section id into a strided vertex array, for example one channel of the vertex color.
+	 * Used instead of WriteSectionedUVs when the section is encoded without an extra UV channel.
+	 * @param sectionIds Pointer to the id byte of the first vertex.
+	 * @param numVertices The number of vertices to write.
+	 * @param strideBytes The size of one vertex.
+	 * @param sectionId The UV section to write.
+	 */
+	SECTIONEDUVCORE_API void WriteSectionIds(uint8_t* sectionIds,
+											 size_t numVertices,
+											 size_t strideBytes,
+											 uint8_t sectionId);
+
+	/**
+	 * Packs rectangles into the smallest power of two atlas holding them, tallest first onto shelves.
+	 * Each rectangle gets a gutter of padding texels on every side and the padded rectangles are placed on multiples of
+	 * alignment, so mips down to log2(alignment) never average texels of two rectangles together.
+	 * @param widths The width of each rectangle in texels, without the gutter.
+	 * @param heights The height of each rectangle in texels, without the gutter.
+	 * @param numRects The number of rectangles.
+	 * @param padding The gutter around each rectangle in texels.
+	 * @param alignment The power of two the padded rectangles are placed and sized on.
+	 * @param maxAtlasSize The largest width and height the atlas may have.
+	 * @param outRects Per rectangle, where its texels go inside the atlas, gutter excluded.
+	 * @param outAtlasWidth The width of the atlas.
+	 * @param outAtlasHeight The height of the atlas, at most its width.
+	 * @return False if the rectangles do not fit in maxAtlasSize or alignment is not a power of two.
+	 */
+	SECTIONEDUVCORE_API bool PackAtlas(const uint32_t* widths,
+									   const uint32_t* heights,
+									   int32_t numRects,
+									   uint32_t padding,
+									   uint32_t alignment,
+									   uint32_t maxAtlasSize,
+									   std::vector<FAtlasRect>& outRects,
+									   uint32_t& outAtlasWidth,
+									   uint32_t& outAtlasHeight);
+
+	/** The UV region of a packed rectangle */
+	SECTIONEDUVCORE_API FAtlasRegion GetAtlasRegion(const FAtlasRect& rect, uint32_t atlasWidth, uint32_t atlasHeight);
+
+	/**
+	 * Moves the UVs of a strided vertex array into an atlas region. UVs outside 0-1 are clamped, a region cannot tile.
+	 * @param uvs Pointer to the U of the first vertex.
+	 * @param numVertices The number of vertices to write.
+	 * @param strideBytes The size of one vertex.
+	 * @param region Where the UVs go.
+	 */
+	SECTIONEDUVCORE_API void WriteAtlasUVs(float* uvs, size_t numVertices, size_t strideBytes, const FAtlasRegion& region);
+
+	/**
+	 * Merges the bone maps of the merged sections, sharing the bones sections have in common instead of appending the maps.
+	 * Sections are packed in order into the fewest chunks of at most maxBonesPerChunk bones. A section is never split,
+	 * one whose own bone map is over the limit gets a chunk to itself.
+	 * @param sections The sections before the merge.
+	 * @param numSections The number of sections.
+	 * @param boneMaps The bone maps of all sections back to back, so callers can gather them into one buffer.
+	 * @param boneMapOffsets Per section plus one past the end, where its bone map starts in boneMaps.
+	 * @param merge The merge the sections go through.
+	 * @param maxBonesPerChunk The most bones a chunk may reference, 0 or less for no limit.
+	 * @param outBoneMerge The result. Reusing one keeps its buffers.
+	 */
+	SECTIONEDUVCORE_API void MergeBoneMaps(const FSection* sections,
+										   int32_t numSections,
+										   const uint16_t* boneMaps,
+										   const uint32_t* boneMapOffsets,
+										   const FSectionMerge& merge,
+										   int32_t maxBonesPerChunk,
+										   FBoneMapMerge& outBoneMerge);
+
+	/** The bone remap of one merged section, see FBoneMapMerge::SectionBoneRemap */
+	inline const uint16_t* GetSectionBoneRemap(const FBoneMapMerge& boneMerge, int32_t sectionIndex, size_t& outNumBones)
+	{
+		const uint32_t begin = boneMerge.SectionBoneRemapOffsets[sectionIndex];
+		outNumBones = boneMerge.SectionBoneRemapOffsets[sectionIndex + 1] - begin;
+		return boneMerge.SectionBoneRemap.data() + begin;
+	}
+
+	/**
+	 * Translates the first numInfluences bone indices of each vertex in a strided vertex array through a bone map remap,
+	 * see FBoneMapMerge::SectionBoneRemap. Indices past the end of the remap are set to 0.
+	 */
+	SECTIONEDUVCORE_API void RemapBoneInfluences(uint16_t* influenceBones,
+												 size_t numVertices,
+												 size_t strideBytes,
+												 int32_t numInfluences,
+												 const uint16_t* boneRemap,
+												 size_t boneRemapSize);
+
+	/**
+	 * Finds the section and section relative vertex for a vertex in a back to back section layout.
+	 * @return False if the vertex is past the last section.
+	 */
+	SECTIONEDUVCORE_API bool GetSectionFromVertexIndex(const FSection* sections,
+													   int32_t numSections,
+													   uint32_t vertIndex,
+													   int32_t& outSectionIndex,
+													   uint32_t& outVertIndex);
+
+	/**
+	 * Remaps morph target delta source indices from the source section layout into the merged layout.
+	 * @param sourceIndices Pointer to the SourceIdx of the first delta.
+	 * @param numDeltas The number of deltas.
+	 * @param strideBytes The size of one delta.
+	 * @param oldSections The sections before the merge.
+	 * @param numOldSections The number of old sections.
+	 * @param merge The merge the sections went through.
+	 * @param newSectionBaseVertices The first vertex of each section after the merge.
+	 * @param mergedSectionIndex The index of the merged section after the merge, its first chunk when it was split.
+	 * @param outSectionIndices The new sections touched by the deltas.
+	 * @param sectionChunks Per old section, the merged section chunk it went into (FBoneMapMerge::SectionChunk). Null if the merged section was not split.
+	 */
+	SECTIONEDUVCORE_API void RemapMorphSourceIndices(uint32_t* sourceIndices,
+													 size_t numDeltas,
+													 size_t strideBytes,
+													 const FSection* oldSections,
+													 int32_t numOldSections,
+													 const FSectionMerge& merge,
+													 const uint32_t* newSectionBaseVertices,
+													 int32_t mergedSectionIndex,
+													 std::vector<int32_t>& outSectionIndices,
+													 const int32_t* sectionChunks = nullptr);
+
+	/**
+	 * Builds the old vertex to new vertex table for a LOD so morph targets can be remapped with a single lookup per delta.
+	 * @param oldSections The sections before the merge.
+	 * @param numOldSections The number of old sections.
+	 * @param merge The merge the sections went through.
+	 * @param newSectionBaseVertices The first vertex of each section after the merge.
+	 * @param numNewSections The number of sections after the merge.
+	 * @param mergedSectionIndex The index of the merged section after the merge, its first chunk when it was split.
+	 * @param outRemap The table to fill.
+	 * @param sectionChunks Per old section, the merged section chunk it went into (FBoneMapMerge::SectionChunk). Null if the merged section was not split.
+	 * @return False if there are too many sections to index.
+	 */
+	SECTIONEDUVCORE_API bool BuildVertexRemap(const FSection* oldSections,
+											  int32_t numOldSections,
+											  const FSectionMerge& merge,
+											  const uint32_t* newSectionBaseVertices,
+											  int32_t numNewSections,
+											  int32_t mergedSectionIndex,
+											  FVertexRemap& outRemap,
+											  const int32_t* sectionChunks = nullptr);
+
+	/**
+	 * Remaps morph target delta source indices through a vertex remap table. Deltas pointing past the old vertices are left alone.
+	 * @param sourceIndices Pointer to the SourceIdx of the first delta.
+	 * @param numDeltas The number of deltas.
+	 * @param strideBytes The size of one delta.
+	 * @param remap The table built by BuildVertexRemap.
+	 * @param outSectionIndices The new sections touched by the deltas, ascending.
+	 */
+	SECTIONEDUVCORE_API void RemapMorphDeltas(uint32_t* sourceIndices,
+											  size_t numDeltas,
+											  size_t strideBytes,
+											  const FVertexRemap& remap,
+											  std::vector<int32_t>& outSectionIndices);
+
+	/**
+	 * Static mesh variant of the merge. Remaps per face material indices and squishes the sectioned UV of the
+	 * merged faces into their section.
+	 * @param faceMaterialIndices The material index of each face. Remapped in place.
+	 * @param numFaces The number of faces.
+	 * @param sectionedWedgeUVs The sectioned UV channel (X, Y pairs), three wedges per face. Expected to hold a copy of UV0.
+	 * @param mapping The slot mapping.
+	 * @param sectionedMatIndex The material index merged faces are moved to. With several groups, faces of group N go to sectionedMatIndex + N.
+	 * @param numSections The number of UV sections in a row.
+	 * @param numRows The number of rows of UV sections, 1 to only section U.
+	 */
+	SECTIONEDUVCORE_API void RemapFaceMaterials(int32_t* faceMaterialIndices,
+												size_t numFaces,
+												float* sectionedWedgeUVs,
+												const FSlotMapping& mapping,
+												int32_t sectionedMatIndex,
+												int32_t numSections,
+												int32_t numRows = 1);
+
+	/**
+	 * Fast 64 bit hash used to key conversion results on their inputs.
+	 * Not a cryptographic hash. The result depends on how the data is split between Update calls, so always feed
+	 * the same things in the same order.
+	 */
+	class SECTIONEDUVCORE_API FHasher
+	{
+	public:
+		/** Hashes numBytes of data */
+		void Update(const void* data, size_t numBytes);
+
+		/** Hashes the bytes of a single value, only use this for types without padding */
+		template<typename T>
+		void UpdateValue(const T& value)
+		{
+			Update(&value, sizeof(T));
+		}
+
+		/** The hash of everything passed in so far */
+		uint64_t Finalize() const;
+
+	private:
+		uint64_t State = 0x9E3779B97F4A7C15ull;
+		uint64_t Length = 0;
+	};
+
+	/**
+	 * Simulates a FIFO post transform vertex cache over an index buffer.
+	 * @param indices The triangle list.
+	 * @param numIndices The number of indices.
+	 * @param numVertices The number of vertices the indices reference.
+	 * @param cacheSize The number of vertices the cache holds.
+	 */
+	SECTIONEDUVCORE_API FVertexCacheStats AnalyzeVertexCache(const uint32_t* indices,
+															 size_t numIndices,
+															 uint32_t numVertices,
+															 int32_t cacheSize);
+
+	/**
+	 * Reorders the triangles of a triangle list for post transform vertex cache locality (Forsyth's linear speed
+	 * vertex cache optimization). Does not depend on an exact cache size.
+	 * @return False if an index is out of range, the indices are left alone in that case.
+	 */
+	SECTIONEDUVCORE_API bool OptimizeVertexCache(uint32_t* indices, size_t numIndices, uint32_t numVertices);
+
+	/**
+	 * Reorders clusters of a cache optimized triangle list so outward facing clusters draw first and occlude the rest.
+	 * Clusters are split where the cache restarts so the cache statistics are kept.
+	 * @param indices The cache optimized triangle list.
+	 * @param numIndices The number of indices.
+	 * @param positions Pointer to the X of the first vertex position.
+	 * @param strideBytes The size of one vertex.
+	 * @param numVertices The number of vertices.
+	 * @return False if an index is out of range, the indices are left alone in that case.
+	 */
+	SECTIONEDUVCORE_API bool OptimizeOverdraw(uint32_t* indices,
+											  size_t numIndices,
+											  const float* positions,
+											  size_t strideBytes,
+											  uint32_t numVertices);
+
+	/**
+	 * Renumbers vertices in the order the triangle list first uses them so vertex fetch walks memory forwards.
+	 * Unreferenced vertices are kept at the end.
+	 * @param indices The triangle list. Rewritten with the new vertex numbers.
+	 * @param numIndices The number of indices.
+	 * @param numVertices The number of vertices.
+	 * @param outOldToNew Per old vertex, its new index. Pass this to ReorderVertices.
+	 * @return False if an index is out of range, the indices are left alone in that case.
+	 */
+	SECTIONEDUVCORE_API bool OptimizeVertexFetch(uint32_t* indices,
+												 size_t numIndices,
+												 uint32_t numVertices,
+												 std::vector<uint32_t>& outOldToNew);
+
+	/** Moves every vertex of a vertex array to its new index. The vertices must be safe to copy as bytes. */
+	SECTIONEDUVCORE_API void ReorderVertices(void* vertices, uint32_t numVertices, size_t strideBytes, const uint32_t* oldToNew);
+
+	/**
+	 * Merges vertices which sit within positionTolerance of each other and which canWeld accepts, found through a
+	 * spatial hash so only nearby vertices are compared. Each vertex is welded onto the first earlier vertex it matches.
+	 * @param indices The triangle list. Rewritten with the welded vertex numbers.
+	 * @param numIndices The number of indices.
+	 * @param positions Pointer to the X of the first vertex position.
+	 * @param strideBytes The size of one vertex.
+	 * @param numVertices The number of vertices.
+	 * @param positionTolerance The largest distance between welded positions.
+	 * @param canWeld Compares the other attributes of two vertices, called with the earlier vertex first.
+	 * @param outOldToNew Per old vertex, its welded index. Kept vertices stay in order. Pass this to CompactWeldedVertices.
+	 * @return The number of vertices left, or 0 if an index is out of range. The indices are left alone in that case.
+	 */
+	SECTIONEDUVCORE_API uint32_t WeldVertices(uint32_t* indices,
+											  size_t numIndices,
+											  const float* positions,
+											  size_t strideBytes,
+											  uint32_t numVertices,
+											  float positionTolerance,
+											  const std::function<bool(uint32_t, uint32_t)>& canWeld,
+											  std::vector<uint32_t>& outOldToNew);
+
+	/**
+	 * Drops the vertices WeldVertices welded away, moving the kept ones down. The vertices must be safe to copy as bytes.
+	 * @return The number of vertices left.
+	 */
+	SECTIONEDUVCORE_API uint32_t CompactWeldedVertices(void* vertices, uint32_t numVertices, size_t strideBytes, const uint32_t* oldToNew);
+
+	/**
+	 * Applies a vertex reorder or weld of the merged section to a vertex remap table so morph targets follow the vertices.
+	 * Welding shrinks the merged sections, so the table's merged vertices can start somewhere else than they do now.
+	 * @param remap The table built by BuildVertexRemap.
+	 * @param mergedSectionIndex The index of the merged section after the merge.
+	 * @param oldBaseVertex Where the table currently starts the merged section's vertices.
+	 * @param newBaseVertex The first vertex of the merged section.
+	 * @param mergedOldToNew The reorder, relative to the first vertex of the merged section. Welded vertices share an entry.
+	 */
+	SECTIONEDUVCORE_API void ReorderMergedVertices(FVertexRemap& remap,
+												   int32_t mergedSectionIndex,
+												   uint32_t oldBaseVertex,
+												   uint32_t newBaseVertex,
+												   const uint32_t* mergedOldToNew);
+}
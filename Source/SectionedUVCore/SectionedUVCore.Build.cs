@@ -0,0 +1,20 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+using UnrealBuildTool;
+
+public class SectionedUVCore : ModuleRules
+{
+	public SectionedUVCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		//OptimizeCode = CodeOptimization.Never;
+
+		// The sectioning core is engine independent (see Benchmarks/CMakeLists.txt), Core is only needed for the module boilerplate.
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+			}
+			);
+	}
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVCustomData.h"
+#include "SectionedUVRuntimeMerge.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/PrimitiveComponent.h"
+
+namespace SectionedUVCustomData
+{
+	/** Floats each section takes, a float4 the material reads in one go */
+	static constexpr int32 FloatsPerSection = 4;
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Makes sure section 0 starts on a float4 so the material can index the sections directly
+	*/
+	static bool IsValidFirstDataIndex(const int32 firstDataIndex)
+	{
+		if(firstDataIndex < 0 || firstDataIndex % FloatsPerSection != 0)
+		{
+			UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot set the section colors. The first data index %d should be a positive multiple of %d!"), firstDataIndex, FloatsPerSection);
+			return false;
+		}
+		return true;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+bool USectionedUVCustomDataLibrary::SetSectionColors(UPrimitiveComponent* component, const TArray<FLinearColor>& sectionColors, const int32 firstDataIndex)
+{
+	if(!component || !SectionedUVCustomData::IsValidFirstDataIndex(firstDataIndex))
+	{
+		return false;
+	}
+
+	if(sectionColors.Num() > GetMaxSectionColors(firstDataIndex))
+	{
+		UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot set %d section colors on '%s'. Custom primitive data only has room for %d after index %d!"),
+			   sectionColors.Num(), *component->GetPathName(), GetMaxSectionColors(firstDataIndex), firstDataIndex);
+		return false;
+	}
+
+	for(int32 section = 0; section < sectionColors.Num(); ++section)
+	{
+		component->SetCustomPrimitiveDataVector4(firstDataIndex + section * SectionedUVCustomData::FloatsPerSection, FVector4(sectionColors[section]));
+	}
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+bool USectionedUVCustomDataLibrary::SetSectionColor(UPrimitiveComponent* component, const int32 section, const FLinearColor color, const int32 firstDataIndex)
+{
+	if(!component || !SectionedUVCustomData::IsValidFirstDataIndex(firstDataIndex))
+	{
+		return false;
+	}
+
+	if(section < 0 || section >= GetMaxSectionColors(firstDataIndex))
+	{
+		UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot set the color of section %d on '%s'. Custom primitive data only has room for %d sections after index %d!"),
+			   section, *component->GetPathName(), GetMaxSectionColors(firstDataIndex), firstDataIndex);
+		return false;
+	}
+
+	component->SetCustomPrimitiveDataVector4(firstDataIndex + section * SectionedUVCustomData::FloatsPerSection, FVector4(color));
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+bool USectionedUVCustomDataLibrary::SetInstanceSectionColors(UInstancedStaticMeshComponent* component, const int32 instanceIndex, const TArray<FLinearColor>& sectionColors, const int32 firstDataIndex)
+{
+	if(!component || !SectionedUVCustomData::IsValidFirstDataIndex(firstDataIndex))
+	{
+		return false;
+	}
+
+	if(instanceIndex < 0 || instanceIndex >= component->GetInstanceCount())
+	{
+		UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot set the section colors. '%s' has no instance %d!"), *component->GetPathName(), instanceIndex);
+		return false;
+	}
+
+	// Growing the custom data resets it for every instance, only do it when the colors do not fit and write every
+	// instance's old floats back at the new stride
+	const int32 numDataFloats = firstDataIndex + sectionColors.Num() * SectionedUVCustomData::FloatsPerSection;
+	const int32 oldNumDataFloats = component->NumCustomDataFloats;
+	if(oldNumDataFloats < numDataFloats)
+	{
+		const TArray<float> oldCustomData = component->PerInstanceSMCustomData;
+		component->SetNumCustomDataFloats(numDataFloats);
+		if(oldNumDataFloats > 0)
+		{
+			for(int32 instance = 0; instance < component->GetInstanceCount() && (instance + 1) * oldNumDataFloats <= oldCustomData.Num(); ++instance)
+			{
+				component->SetCustomData(instance, MakeArrayView(oldCustomData.GetData() + instance * oldNumDataFloats, oldNumDataFloats), false);
+			}
+		}
+	}
+
+	// Only the last value pushes the instance to the renderer
+	for(int32 section = 0; section < sectionColors.Num(); ++section)
+	{
+		const FLinearColor& color = sectionColors[section];
+		const int32 dataIndex = firstDataIndex + section * SectionedUVCustomData::FloatsPerSection;
+		const bool bLastSection = section == sectionColors.Num() - 1;
+		component->SetCustomDataValue(instanceIndex, dataIndex + 0, color.R, false);
+		component->SetCustomDataValue(instanceIndex, dataIndex + 1, color.G, false);
+		component->SetCustomDataValue(instanceIndex, dataIndex + 2, color.B, false);
+		component->SetCustomDataValue(instanceIndex, dataIndex + 3, color.A, bLastSection);
+	}
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+int32 USectionedUVCustomDataLibrary::GetMaxSectionColors(const int32 firstDataIndex)
+{
+	return FMath::Max(0, (FCustomPrimitiveData::NumCustomPrimitiveDataFloats - firstDataIndex) / SectionedUVCustomData::FloatsPerSection);
+}
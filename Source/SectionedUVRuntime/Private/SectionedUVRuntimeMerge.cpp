@@ -0,0 +1,710 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVRuntimeMerge.h"
+#include "SectionedUVCore.h"
+#include "Animation/Skeleton.h"
+#include "Async/Async.h"
+#include "Engine/SkeletalMesh.h"
+#include "GPUSkinVertexFactory.h"
+#include "HAL/PlatformTime.h"
+#include "Materials/MaterialInterface.h"
+#include "Rendering/SkeletalMeshLODRenderData.h"
+#include "Rendering/SkeletalMeshRenderData.h"
+#include "UObject/GCObject.h"
+
+DEFINE_LOG_CATEGORY(LogSectionedUVRuntime);
+
+namespace SectionedUVRuntime
+{
+	static FName SectionedSlotName = FName("sectioned");
+
+#if ENGINE_MAJOR_VERSION >= 5
+	typedef FVector3f FMeshVector;
+	typedef FVector4f FMeshVector4;
+	typedef FVector2f FMeshUV;
+#else
+	typedef FVector FMeshVector;
+	typedef FVector4 FMeshVector4;
+	typedef FVector2D FMeshUV;
+#endif
+
+	/**
+	* Everything the LOD render data stores for a vertex in one place, so the core can work on the vertices strided
+	* the same way it does on FSoftSkinVertex in the editor.
+	*/
+	struct FMergeVertex
+	{
+		FMeshVector Position;
+		FMeshVector4 TangentX;
+		FMeshVector TangentY;
+		FMeshVector4 TangentZ;
+		FMeshUV UVs[MAX_TEXCOORDS];
+		FColor Color;
+		FSkinWeightInfo SkinWeights;
+	};
+
+	/**
+	* One part's LOD as the worker reads it
+	*/
+	struct FPartLOD
+	{
+		const FSkeletalMeshLODRenderData* LODData = nullptr;
+		/** Per render section, the merge slot of its material */
+		TArray<int32> SectionSlots;
+	};
+
+	/**
+	* A merge in flight. Shared between the game thread and the worker, the worker only reads the inputs and writes the outputs.
+	*/
+	struct FMergeTask : public FGCObject
+	{
+		// Inputs, set up on the game thread
+		FSectionedUVRuntimeMergeParams Params;
+		FOnSectionedUVRuntimeMergeComplete OnComplete;
+		USkeleton* Skeleton = nullptr;
+		FReferenceSkeleton RefSkeleton;
+		/** Every distinct material of the parts, the merge slots */
+		TArray<UMaterialInterface*> SlotMaterials;
+		SectionedUVCore::FSlotMapping SlotMapping;
+		/** Per part, its bones in the merged reference skeleton */
+		TArray<TArray<int32>> PartBoneRemaps;
+		/** Per LOD, per part */
+		TArray<TArray<FPartLOD>> LODParts;
+		int32 MaxBonesPerSection = 0;
+		bool bUseFullPrecisionUVs = false;
+		bool bUseHighPrecisionTangentBasis = false;
+		bool bUse16BitBoneWeight = false;
+		FBoxSphereBounds Bounds;
+		double GameThreadSeconds = 0.0;
+
+		// Outputs, written by the worker
+		TIndirectArray<FSkeletalMeshLODRenderData> LODRenderData;
+		bool bMerged = false;
+
+		//~ Begin FGCObject Interface
+		virtual void AddReferencedObjects(FReferenceCollector& collector) override
+		{
+			collector.AddReferencedObjects(Params.Parts);
+			collector.AddReferencedObject(Params.SectionedMaterial);
+			collector.AddReferencedObjects(SlotMaterials);
+			collector.AddReferencedObject(Skeleton);
+		}
+
+		virtual FString GetReferencerName() const override
+		{
+			return TEXT("FSectionedUVRuntimeMerge");
+		}
+		//~ End FGCObject Interface
+	};
+
+	typedef TSharedPtr<FMergeTask, ESPMode::ThreadSafe> FMergeTaskPtr;
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The material a part's render section draws with, going through the LOD material override like the component does
+	*/
+	static UMaterialInterface* GetSectionMaterial(USkeletalMesh* part, const int32 lodIndex, const int32 sectionIndex, const int32 materialIndex)
+	{
+		const TArray<FSkeletalMaterial>& materials = part->GetMaterials();
+		int32 slotIndex = materialIndex;
+		const FSkeletalMeshLODInfo* lodInfo = part->GetLODInfo(lodIndex);
+		if(lodInfo && lodInfo->LODMaterialMap.IsValidIndex(sectionIndex) && materials.IsValidIndex(lodInfo->LODMaterialMap[sectionIndex]))
+		{
+			slotIndex = lodInfo->LODMaterialMap[sectionIndex];
+		}
+		return materials.IsValidIndex(slotIndex) ? materials[slotIndex].MaterialInterface : nullptr;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Checks the parts on the game thread and gathers everything the worker needs so it never touches a UObject.
+	*/
+	static bool PrepareMerge(FMergeTask& task)
+	{
+		const FSectionedUVRuntimeMergeParams& params = task.Params;
+		if(!params.Parts.Num() || params.Parts.Contains(nullptr))
+		{
+			UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. No parts or a part is None!"));
+			return false;
+		}
+
+		if(params.NumSections < 2 || params.NumRows < 1)
+		{
+			UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. Number of sections should be at least 2 and number of rows at least 1."));
+			return false;
+		}
+
+		USkeletalMesh* firstPart = params.Parts[0];
+		task.Skeleton = firstPart->GetSkeleton();
+		int32 numLODs = MAX_int32;
+		for(USkeletalMesh* part : params.Parts)
+		{
+			if(part->GetSkeleton() != task.Skeleton)
+			{
+				UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. '%s' does not use the skeleton of '%s'!"), *part->GetPathName(), *firstPart->GetPathName());
+				return false;
+			}
+
+			FSkeletalMeshRenderData* renderData = part->GetResourceForRendering();
+			if(!renderData || !renderData->LODRenderData.Num())
+			{
+				UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. '%s' has no render data!"), *part->GetPathName());
+				return false;
+			}
+			numLODs = FMath::Min(numLODs, renderData->LODRenderData.Num());
+
+			for(const FSkeletalMeshLODRenderData& lodData : renderData->LODRenderData)
+			{
+				if(!lodData.StaticVertexBuffers.PositionVertexBuffer.GetVertexData() || !lodData.SkinWeightVertexBuffer.GetNeedsCPUAccess() ||
+				   !lodData.MultiSizeIndexContainer.IsIndexBufferValid())
+				{
+					UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. '%s' has no CPU copy of its render data, enable Allow CPU Access on its LODs!"), *part->GetPathName());
+					return false;
+				}
+
+				for(const FSkelMeshRenderSection& renderSection : lodData.RenderSections)
+				{
+					if(renderSection.HasClothingData())
+					{
+						UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. '%s' has clothing, which the runtime merge does not support!"), *part->GetPathName());
+						return false;
+					}
+				}
+
+				if(params.Encoding == ESectionedUVEncoding::UVChannel && lodData.GetNumTexCoords() >= MAX_TEXCOORDS)
+				{
+					UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. '%s' uses every UV channel, use a vertex color encoding!"), *part->GetPathName());
+					return false;
+				}
+
+#if ENGINE_MAJOR_VERSION >= 5
+				if(lodData.SkinWeightVertexBuffer.Use16BitBoneWeight() != renderData->LODRenderData[0].SkinWeightVertexBuffer.Use16BitBoneWeight())
+				{
+					UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. '%s' mixes 8 and 16 bit skin weights!"), *part->GetPathName());
+					return false;
+				}
+#endif
+			}
+		}
+
+		// The merged skeleton is the first part's with any bones only the other parts have added under their parents
+		task.RefSkeleton = firstPart->GetRefSkeleton();
+		{
+			FReferenceSkeletonModifier refSkeletonModifier(task.RefSkeleton, task.Skeleton);
+			for(USkeletalMesh* part : params.Parts)
+			{
+				const FReferenceSkeleton& partRefSkeleton = part->GetRefSkeleton();
+				for(int32 boneIndex = 0; boneIndex < partRefSkeleton.GetRawBoneNum(); ++boneIndex)
+				{
+					const FName boneName = partRefSkeleton.GetBoneName(boneIndex);
+					if(refSkeletonModifier.FindBoneIndex(boneName) != INDEX_NONE)
+					{
+						continue;
+					}
+
+					const int32 parentIndex = partRefSkeleton.GetParentIndex(boneIndex);
+					const int32 mergedParentIndex = parentIndex != INDEX_NONE ? refSkeletonModifier.FindBoneIndex(partRefSkeleton.GetBoneName(parentIndex)) : INDEX_NONE;
+					refSkeletonModifier.Add(FMeshBoneInfo(boneName, boneName.ToString(), mergedParentIndex), partRefSkeleton.GetRefBonePose()[boneIndex]);
+				}
+			}
+		}
+
+		task.PartBoneRemaps.SetNum(params.Parts.Num());
+		for(int32 partIndex = 0; partIndex < params.Parts.Num(); ++partIndex)
+		{
+			const FReferenceSkeleton& partRefSkeleton = params.Parts[partIndex]->GetRefSkeleton();
+			TArray<int32>& boneRemap = task.PartBoneRemaps[partIndex];
+			boneRemap.SetNum(partRefSkeleton.GetRawBoneNum());
+			for(int32 boneIndex = 0; boneIndex < boneRemap.Num(); ++boneIndex)
+			{
+				boneRemap[boneIndex] = task.RefSkeleton.FindRawBoneIndex(partRefSkeleton.GetBoneName(boneIndex));
+			}
+		}
+
+		// Every distinct material is a merge slot, the ones not kept each get a UV section
+		task.LODParts.SetNum(numLODs);
+		for(int32 lodIndex = 0; lodIndex < numLODs; ++lodIndex)
+		{
+			for(USkeletalMesh* part : params.Parts)
+			{
+				FPartLOD& partLOD = task.LODParts[lodIndex].AddDefaulted_GetRef();
+				partLOD.LODData = &part->GetResourceForRendering()->LODRenderData[lodIndex];
+				for(int32 sectionIndex = 0; sectionIndex < partLOD.LODData->RenderSections.Num(); ++sectionIndex)
+				{
+					UMaterialInterface* material = GetSectionMaterial(part, lodIndex, sectionIndex, partLOD.LODData->RenderSections[sectionIndex].MaterialIndex);
+					partLOD.SectionSlots.Add(task.SlotMaterials.AddUnique(material));
+				}
+			}
+		}
+
+		std::vector<int32> mergedSlots;
+		for(int32 slotIndex = 0; slotIndex < task.SlotMaterials.Num(); ++slotIndex)
+		{
+			if(!params.KeptMaterials.Contains(task.SlotMaterials[slotIndex]))
+			{
+				mergedSlots.push_back(slotIndex);
+			}
+		}
+
+		if(mergedSlots.empty())
+		{
+			UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. Every material is kept, there is nothing to merge!"));
+			return false;
+		}
+
+		if(params.NumSections * params.NumRows < static_cast<int32>(mergedSlots.size()) ||
+		   (params.Encoding != ESectionedUVEncoding::UVChannel && static_cast<int32>(mergedSlots.size()) > SectionedUVCore::MaxPackedSections))
+		{
+			UE_LOG(LogSectionedUVRuntime, Error, TEXT("Cannot merge the parts. %d materials are merged, more than the sections can hold!"), static_cast<int32>(mergedSlots.size()));
+			return false;
+		}
+
+		SectionedUVCore::BuildSlotMapping(task.SlotMaterials.Num(), mergedSlots.data(), static_cast<int32>(mergedSlots.size()), task.SlotMapping);
+
+		const FSkeletalMeshLODRenderData& firstLODData = firstPart->GetResourceForRendering()->LODRenderData[0];
+		task.MaxBonesPerSection = FGPUBaseSkinVertexFactory::GetMaxGPUSkinBones();
+		// Half precision UVs hold any grid the tools are normally used with, huge grids need full precision to decode
+		task.bUseFullPrecisionUVs = firstLODData.StaticVertexBuffers.StaticMeshVertexBuffer.GetUseFullPrecisionUVs() ||
+									(params.Encoding == ESectionedUVEncoding::UVChannel && !SectionedUVCore::AreSectionCentersHalfSafe(params.NumSections, params.NumRows));
+		task.bUseHighPrecisionTangentBasis = firstLODData.StaticVertexBuffers.StaticMeshVertexBuffer.GetUseHighPrecisionTangentBasis();
+#if ENGINE_MAJOR_VERSION >= 5
+		task.bUse16BitBoneWeight = firstLODData.SkinWeightVertexBuffer.Use16BitBoneWeight();
+#endif
+
+		task.Bounds = firstPart->GetBounds();
+		for(USkeletalMesh* part : params.Parts)
+		{
+			task.Bounds = task.Bounds + part->GetBounds();
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Appends the vertices of a LOD render data to the merge vertices
+	*/
+	static void ReadVertices(const FSkeletalMeshLODRenderData& lodData, TArray<FMergeVertex>& vertices)
+	{
+		const FStaticMeshVertexBuffers& vertexBuffers = lodData.StaticVertexBuffers;
+		const uint32 numVertices = lodData.GetNumVertices();
+		const uint32 numTexCoords = lodData.GetNumTexCoords();
+		const bool bHasColors = vertexBuffers.ColorVertexBuffer.GetNumVertices() == numVertices;
+
+		const int32 firstVertex = vertices.AddZeroed(numVertices);
+		for(uint32 vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex)
+		{
+			FMergeVertex& vertex = vertices[firstVertex + vertexIndex];
+			vertex.Position = vertexBuffers.PositionVertexBuffer.VertexPosition(vertexIndex);
+			vertex.TangentX = vertexBuffers.StaticMeshVertexBuffer.VertexTangentX(vertexIndex);
+			vertex.TangentY = vertexBuffers.StaticMeshVertexBuffer.VertexTangentY(vertexIndex);
+			vertex.TangentZ = vertexBuffers.StaticMeshVertexBuffer.VertexTangentZ(vertexIndex);
+			for(uint32 uvIndex = 0; uvIndex < numTexCoords; ++uvIndex)
+			{
+				vertex.UVs[uvIndex] = vertexBuffers.StaticMeshVertexBuffer.GetVertexUV(vertexIndex, uvIndex);
+			}
+			vertex.Color = bHasColors ? vertexBuffers.ColorVertexBuffer.VertexColor(vertexIndex) : FColor::White;
+			vertex.SkinWeights = lodData.SkinWeightVertexBuffer.GetVertexSkinWeights(vertexIndex);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Merges one LOD of every part into a new LOD render data. Runs on the worker, only reads the task inputs.
+	*/
+	static bool MergeLOD(const FMergeTask& task, const int32 lodIndex, FSkeletalMeshLODRenderData& outLODData)
+	{
+		const FSectionedUVRuntimeMergeParams& params = task.Params;
+		const TArray<FPartLOD>& partLODs = task.LODParts[lodIndex];
+
+		// Lay every part's sections back to back as if the parts were one LOD, the core merges that like an editor LOD model
+		std::vector<SectionedUVCore::FSection> sections;
+		std::vector<uint16> sectionBoneMaps;
+		std::vector<uint32> sectionBoneMapOffsets;
+		TArray<const FSkelMeshRenderSection*> sourceSections;
+		TArray<FMergeVertex> vertices;
+		TArray<uint32> indices;
+		uint32 numTexCoords = 1;
+		uint32 maxBoneInfluences = 0;
+		bool bUse16BitBoneIndex = false;
+		for(int32 partIndex = 0; partIndex < partLODs.Num(); ++partIndex)
+		{
+			const FPartLOD& partLOD = partLODs[partIndex];
+			const FSkeletalMeshLODRenderData& lodData = *partLOD.LODData;
+			const TArray<int32>& boneRemap = task.PartBoneRemaps[partIndex];
+			const uint32 baseVertex = vertices.Num();
+			const uint32 baseIndex = indices.Num();
+			numTexCoords = FMath::Max(numTexCoords, lodData.GetNumTexCoords());
+			maxBoneInfluences = FMath::Max(maxBoneInfluences, lodData.SkinWeightVertexBuffer.GetMaxBoneInfluences());
+			bUse16BitBoneIndex |= lodData.SkinWeightVertexBuffer.Use16BitBoneIndex();
+
+			ReadVertices(lodData, vertices);
+
+			TArray<uint32> partIndices;
+			lodData.MultiSizeIndexContainer.GetIndexBuffer(partIndices);
+			indices.AddUninitialized(partIndices.Num());
+			SectionedUVCore::RebaseIndices(partIndices.GetData(), partIndices.Num(), baseVertex, indices.GetData() + baseIndex);
+
+			for(int32 sectionIndex = 0; sectionIndex < lodData.RenderSections.Num(); ++sectionIndex)
+			{
+				const FSkelMeshRenderSection& renderSection = lodData.RenderSections[sectionIndex];
+				SectionedUVCore::FSection& section = sections.emplace_back();
+				section.BaseIndex = baseIndex + renderSection.BaseIndex;
+				section.NumTriangles = renderSection.NumTriangles;
+				section.BaseVertexIndex = baseVertex + renderSection.BaseVertexIndex;
+				section.NumVertices = renderSection.NumVertices;
+				section.MaterialIndex = partLOD.SectionSlots[sectionIndex];
+
+				sectionBoneMapOffsets.push_back(static_cast<uint32>(sectionBoneMaps.size()));
+				for(const FBoneIndexType boneIndex : renderSection.BoneMap)
+				{
+					sectionBoneMaps.push_back(static_cast<uint16>(boneRemap[boneIndex]));
+				}
+				sourceSections.Add(&renderSection);
+			}
+		}
+		sectionBoneMapOffsets.push_back(static_cast<uint32>(sectionBoneMaps.size()));
+
+		SectionedUVCore::FSectionMerge merge;
+		if(!SectionedUVCore::MergeSections(sections.data(), static_cast<int32>(sections.size()), indices.GetData(), indices.Num(), task.SlotMapping, merge))
+		{
+			UE_LOG(LogSectionedUVRuntime, Error, TEXT("LOD %d has sections outside of its index buffer, cannot merge it."), lodIndex);
+			return false;
+		}
+
+		SectionedUVCore::FBoneMapMerge boneMerge;
+		SectionedUVCore::MergeBoneMaps(sections.data(), static_cast<int32>(sections.size()), sectionBoneMaps.data(), sectionBoneMapOffsets.data(), merge, task.MaxBonesPerSection, boneMerge);
+
+		// The merged vertices in merged section order, which is also chunk order, with their section written in
+		const bool bEncodeInUV = params.Encoding == ESectionedUVEncoding::UVChannel;
+		TArray<FMergeVertex> mergedVertices;
+		mergedVertices.Reserve(merge.NumMergedVertices);
+		std::vector<int32> chunkInfluences(boneMerge.Chunks.size(), 0);
+		for(const int32 sectionIndex : merge.SectionsToRemove)
+		{
+			const SectionedUVCore::FSection& section = sections[sectionIndex];
+			chunkInfluences[boneMerge.SectionChunk[sectionIndex]] = FMath::Max(chunkInfluences[boneMerge.SectionChunk[sectionIndex]], sourceSections[sectionIndex]->MaxBoneInfluences);
+			if(!section.NumVertices)
+			{
+				continue;
+			}
+
+			const int32 firstVertex = mergedVertices.Num();
+			mergedVertices.Append(vertices.GetData() + section.BaseVertexIndex, section.NumVertices);
+			FMergeVertex& vertex = mergedVertices[firstVertex];
+
+			size_t numRemapBones = 0;
+			const uint16* boneRemap = SectionedUVCore::GetSectionBoneRemap(boneMerge, sectionIndex, numRemapBones);
+			SectionedUVCore::RemapBoneInfluences(&vertex.SkinWeights.InfluenceBones[0], section.NumVertices, sizeof(FMergeVertex), MAX_TOTAL_INFLUENCES, boneRemap, numRemapBones);
+
+			const int32 uvSection = SectionedUVCore::GetUVSection(task.SlotMapping, section.MaterialIndex);
+			if(bEncodeInUV)
+			{
+				SectionedUVCore::WriteSectionedUVs(&vertex.UVs[0].X, &vertex.UVs[numTexCoords].X, section.NumVertices, sizeof(FMergeVertex),
+												   SectionedUVCore::GetSectionCenterU(uvSection, params.NumSections),
+												   SectionedUVCore::GetSectionCenterV(uvSection, params.NumSections, params.NumRows));
+			}
+			else
+			{
+				SectionedUVCore::WriteSectionIds(SectionedUVEncoding::GetEncodedColorChannel(vertex.Color, params.Encoding), section.NumVertices, sizeof(FMergeVertex), static_cast<uint8>(uvSection));
+			}
+		}
+
+		// Drop the merged sections from the part layout, the kept sections stay in front
+		std::vector<SectionedUVCore::FSection> keptSections = sections;
+		std::vector<int32> removedSections;
+		size_t numIndices = indices.Num();
+		uint32 numKeptVertices = vertices.Num();
+		SectionedUVCore::RemoveSections(keptSections, indices.GetData(), numIndices, numKeptVertices,
+										merge.SectionsToRemove.data(), static_cast<int32>(merge.SectionsToRemove.size()), removedSections);
+
+		TArray<FMergeVertex> outVertices;
+		outVertices.Reserve(numKeptVertices + mergedVertices.Num());
+		TArray<FSkelMeshRenderSection>& renderSections = outLODData.RenderSections;
+		auto removedIt = removedSections.begin();
+		for(int32 sectionIndex = 0; sectionIndex < static_cast<int32>(sections.size()); ++sectionIndex)
+		{
+			if(removedIt != removedSections.end() && *removedIt == sectionIndex)
+			{
+				++removedIt;
+				continue;
+			}
+
+			const SectionedUVCore::FSection& keptSection = keptSections[renderSections.Num()];
+			const FSkelMeshRenderSection& sourceSection = *sourceSections[sectionIndex];
+			const int32 firstVertex = outVertices.Num();
+			outVertices.Append(vertices.GetData() + sections[sectionIndex].BaseVertexIndex, keptSection.NumVertices);
+			if(bEncodeInUV && keptSection.NumVertices)
+			{
+				SectionedUVCore::WriteSectionedUVs(&outVertices[firstVertex].UVs[0].X, &outVertices[firstVertex].UVs[numTexCoords].X, keptSection.NumVertices, sizeof(FMergeVertex), -1.0f);
+			}
+
+			FSkelMeshRenderSection& renderSection = renderSections.AddDefaulted_GetRef();
+			renderSection.MaterialIndex = static_cast<uint16>(task.SlotMapping.SlotRemap[keptSection.MaterialIndex]);
+			renderSection.BaseIndex = keptSection.BaseIndex;
+			renderSection.NumTriangles = keptSection.NumTriangles;
+			renderSection.BaseVertexIndex = keptSection.BaseVertexIndex;
+			renderSection.NumVertices = keptSection.NumVertices;
+			renderSection.MaxBoneInfluences = sourceSection.MaxBoneInfluences;
+			renderSection.bCastShadow = sourceSection.bCastShadow;
+			renderSection.BoneMap.Append(sectionBoneMaps.data() + sectionBoneMapOffsets[sectionIndex],
+										 static_cast<int32>(sectionBoneMapOffsets[sectionIndex + 1] - sectionBoneMapOffsets[sectionIndex]));
+		}
+
+		// Optimize each merged draw as a whole, there are no morph targets to follow the vertices so they can always move
+		const uint32 mergedBaseVertex = outVertices.Num();
+		outVertices.Append(mergedVertices);
+		for(int32 chunkIndex = 0; chunkIndex < static_cast<int32>(boneMerge.Chunks.size()); ++chunkIndex)
+		{
+			const SectionedUVCore::FSection& chunk = boneMerge.Chunks[chunkIndex];
+			uint32* chunkIndices = merge.MergedIndices.data() + chunk.BaseIndex;
+			const size_t numChunkIndices = static_cast<size_t>(chunk.NumTriangles) * 3;
+			FMergeVertex* chunkVertices = outVertices.GetData() + mergedBaseVertex + chunk.BaseVertexIndex;
+			for(size_t index = 0; index < numChunkIndices; ++index)
+			{
+				chunkIndices[index] -= chunk.BaseVertexIndex;
+			}
+
+			std::vector<uint32> vertexOrder;
+			if(SectionedUVCore::OptimizeVertexCache(chunkIndices, numChunkIndices, chunk.NumVertices))
+			{
+				SectionedUVCore::OptimizeOverdraw(chunkIndices, numChunkIndices, &chunkVertices->Position.X, sizeof(FMergeVertex), chunk.NumVertices);
+				if(SectionedUVCore::OptimizeVertexFetch(chunkIndices, numChunkIndices, chunk.NumVertices, vertexOrder))
+				{
+					SectionedUVCore::ReorderVertices(chunkVertices, chunk.NumVertices, sizeof(FMergeVertex), vertexOrder.data());
+				}
+			}
+			SectionedUVCore::RebaseIndices(chunkIndices, numChunkIndices, chunk.BaseVertexIndex, chunkIndices);
+
+			const std::vector<uint16>& chunkBoneMap = boneMerge.ChunkBoneMaps[chunkIndex];
+			FSkelMeshRenderSection& renderSection = renderSections.AddDefaulted_GetRef();
+			renderSection.MaterialIndex = static_cast<uint16>(task.SlotMapping.NumKeptSlots);
+			renderSection.BaseIndex = static_cast<uint32>(numIndices) + chunk.BaseIndex;
+			renderSection.NumTriangles = chunk.NumTriangles;
+			renderSection.BaseVertexIndex = mergedBaseVertex + chunk.BaseVertexIndex;
+			renderSection.NumVertices = chunk.NumVertices;
+			renderSection.MaxBoneInfluences = chunkInfluences[chunkIndex];
+			renderSection.BoneMap.Append(chunkBoneMap.data(), static_cast<int32>(chunkBoneMap.size()));
+			bUse16BitBoneIndex |= chunkBoneMap.size() > MAX_uint8 + 1;
+		}
+
+		for(FSkelMeshRenderSection& renderSection : renderSections)
+		{
+			// Recompute tangents is off, the duplicated vertices are never read
+			renderSection.DuplicatedVerticesBuffer.Init(1, TMap<int, TArray<int32>>());
+		}
+
+		indices.SetNum(static_cast<int32>(numIndices + merge.MergedIndices.size()), false);
+		SectionedUVCore::RebaseIndices(merge.MergedIndices.data(), merge.MergedIndices.size(), mergedBaseVertex, indices.GetData() + numIndices);
+
+		// Write the vertex buffers
+		const uint32 numVertices = outVertices.Num();
+		const uint32 numOutTexCoords = bEncodeInUV ? numTexCoords + 1 : numTexCoords;
+		FStaticMeshVertexBuffers& vertexBuffers = outLODData.StaticVertexBuffers;
+		vertexBuffers.PositionVertexBuffer.Init(numVertices);
+		vertexBuffers.StaticMeshVertexBuffer.SetUseFullPrecisionUVs(task.bUseFullPrecisionUVs);
+		vertexBuffers.StaticMeshVertexBuffer.SetUseHighPrecisionTangentBasis(task.bUseHighPrecisionTangentBasis);
+		vertexBuffers.StaticMeshVertexBuffer.Init(numVertices, numOutTexCoords);
+		TArray<FColor> colors;
+		colors.SetNumUninitialized(numVertices);
+		TArray<FSkinWeightInfo> skinWeights;
+		skinWeights.SetNumUninitialized(numVertices);
+		for(uint32 vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex)
+		{
+			const FMergeVertex& vertex = outVertices[vertexIndex];
+			vertexBuffers.PositionVertexBuffer.VertexPosition(vertexIndex) = vertex.Position;
+			vertexBuffers.StaticMeshVertexBuffer.SetVertexTangents(vertexIndex, FMeshVector(vertex.TangentX), vertex.TangentY, FMeshVector(vertex.TangentZ));
+			for(uint32 uvIndex = 0; uvIndex < numOutTexCoords; ++uvIndex)
+			{
+				vertexBuffers.StaticMeshVertexBuffer.SetVertexUV(vertexIndex, uvIndex, vertex.UVs[uvIndex]);
+			}
+			colors[vertexIndex] = vertex.Color;
+			skinWeights[vertexIndex] = vertex.SkinWeights;
+		}
+		vertexBuffers.ColorVertexBuffer.InitFromColorArray(colors);
+
+		outLODData.SkinWeightVertexBuffer.SetMaxBoneInfluences(maxBoneInfluences);
+		outLODData.SkinWeightVertexBuffer.SetUse16BitBoneIndex(bUse16BitBoneIndex);
+#if ENGINE_MAJOR_VERSION >= 5
+		outLODData.SkinWeightVertexBuffer.SetUse16BitBoneWeight(task.bUse16BitBoneWeight);
+#endif
+		outLODData.SkinWeightVertexBuffer = skinWeights;
+
+		outLODData.MultiSizeIndexContainer.RebuildIndexBuffer(numVertices > MAX_uint16 ? sizeof(uint32) : sizeof(uint16), indices);
+
+		// Every bone any part needs, in the parent before child order of the reference skeleton
+		for(int32 partIndex = 0; partIndex < partLODs.Num(); ++partIndex)
+		{
+			const FSkeletalMeshLODRenderData& lodData = *partLODs[partIndex].LODData;
+			const TArray<int32>& boneRemap = task.PartBoneRemaps[partIndex];
+			for(const FBoneIndexType boneIndex : lodData.ActiveBoneIndices)
+			{
+				outLODData.ActiveBoneIndices.AddUnique(static_cast<FBoneIndexType>(boneRemap[boneIndex]));
+			}
+			for(const FBoneIndexType boneIndex : lodData.RequiredBones)
+			{
+				outLODData.RequiredBones.AddUnique(static_cast<FBoneIndexType>(boneRemap[boneIndex]));
+			}
+		}
+		outLODData.ActiveBoneIndices.Sort();
+		outLODData.RequiredBones.Sort();
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The worker side of the merge
+	*/
+	static void RunMerge(FMergeTask& task)
+	{
+		const double startTime = FPlatformTime::Seconds();
+		for(int32 lodIndex = 0; lodIndex < task.LODParts.Num(); ++lodIndex)
+		{
+			FSkeletalMeshLODRenderData* lodData = new FSkeletalMeshLODRenderData();
+			task.LODRenderData.Add(lodData);
+			if(!MergeLOD(task, lodIndex, *lodData))
+			{
+				return;
+			}
+		}
+		task.bMerged = true;
+		UE_LOG(LogSectionedUVRuntime, Verbose, TEXT("Merged %d parts into %d LODs in %.2f ms on the worker."), task.Params.Parts.Num(), task.LODParts.Num(), (FPlatformTime::Seconds() - startTime) * 1000.0);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Creates the transient mesh around the merged render data, back on the game thread
+	*/
+	static USkeletalMesh* CreateMergedMesh(FMergeTask& task)
+	{
+		const FSectionedUVRuntimeMergeParams& params = task.Params;
+		USkeletalMesh* mergedMesh = NewObject<USkeletalMesh>(GetTransientPackage(), NAME_None, RF_Transient);
+		mergedMesh->SetSkeleton(task.Skeleton);
+		mergedMesh->SetRefSkeleton(task.RefSkeleton);
+		mergedMesh->SetImportedBounds(task.Bounds);
+		mergedMesh->NeverStream = true;
+
+		TArray<FSkeletalMaterial>& materials = mergedMesh->GetMaterials();
+		for(int32 slotIndex = 0; slotIndex < task.SlotMaterials.Num(); ++slotIndex)
+		{
+			if(task.SlotMapping.SlotRemap[slotIndex] != SectionedUVCore::InvalidIndex)
+			{
+				UMaterialInterface* material = task.SlotMaterials[slotIndex];
+				const FName slotName = material ? material->GetFName() : NAME_None;
+				materials.Emplace(material, true, false, slotName, slotName);
+			}
+		}
+		materials.Emplace(params.SectionedMaterial, true, false, SectionedSlotName, SectionedSlotName);
+
+		for(int32 lodIndex = 0; lodIndex < task.LODRenderData.Num(); ++lodIndex)
+		{
+			FSkeletalMeshLODInfo& lodInfo = mergedMesh->AddLODInfo();
+			if(const FSkeletalMeshLODInfo* sourceLODInfo = params.Parts[0]->GetLODInfo(lodIndex))
+			{
+				lodInfo.ScreenSize = sourceLODInfo->ScreenSize;
+				lodInfo.LODHysteresis = sourceLODInfo->LODHysteresis;
+			}
+			lodInfo.bAllowCPUAccess = true;
+		}
+
+		mergedMesh->AllocateResourceForRendering();
+		FSkeletalMeshRenderData* renderData = mergedMesh->GetResourceForRendering();
+		renderData->LODRenderData = MoveTemp(task.LODRenderData);
+		renderData->NumInlinedLODs = static_cast<uint8>(renderData->LODRenderData.Num());
+		renderData->NumNonOptionalLODs = static_cast<uint8>(renderData->LODRenderData.Num());
+		renderData->CurrentFirstLODIdx = 0;
+		renderData->PendingFirstLODIdx = 0;
+
+		mergedMesh->CalculateInvRefMatrices();
+		mergedMesh->InitResources();
+		return mergedMesh;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Hands the merged mesh to the caller, back on the game thread
+	*/
+	static void FinishMerge(FMergeTask& task)
+	{
+		const double startTime = FPlatformTime::Seconds();
+		USkeletalMesh* mergedMesh = task.bMerged ? CreateMergedMesh(task) : nullptr;
+		task.GameThreadSeconds += FPlatformTime::Seconds() - startTime;
+
+		TArray<UMaterialInterface*> sectionMaterials;
+		for(int32 slotIndex = 0; slotIndex < task.SlotMaterials.Num(); ++slotIndex)
+		{
+			const int32 uvSection = SectionedUVCore::GetUVSection(task.SlotMapping, slotIndex);
+			if(uvSection != SectionedUVCore::InvalidIndex)
+			{
+				sectionMaterials.SetNum(FMath::Max(sectionMaterials.Num(), uvSection + 1));
+				sectionMaterials[uvSection] = task.SlotMaterials[slotIndex];
+			}
+		}
+
+		UE_LOG(LogSectionedUVRuntime, Verbose, TEXT("Runtime merge spent %.2f ms on the game thread."), task.GameThreadSeconds * 1000.0);
+		task.OnComplete.ExecuteIfBound(mergedMesh, sectionMaterials);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void FSectionedUVRuntimeMerge::MergeAsync(const FSectionedUVRuntimeMergeParams& params, FOnSectionedUVRuntimeMergeComplete onComplete)
+{
+	check(IsInGameThread());
+
+	const double startTime = FPlatformTime::Seconds();
+	SectionedUVRuntime::FMergeTaskPtr task = MakeShared<SectionedUVRuntime::FMergeTask, ESPMode::ThreadSafe>();
+	task->Params = params;
+	task->OnComplete = MoveTemp(onComplete);
+	if(!SectionedUVRuntime::PrepareMerge(*task))
+	{
+		task->OnComplete.ExecuteIfBound(nullptr, TArray<UMaterialInterface*>());
+		return;
+	}
+	task->GameThreadSeconds = FPlatformTime::Seconds() - startTime;
+
+	// The worker hands the task back to the game thread, so the last reference to it always goes away there
+	Async(EAsyncExecution::ThreadPool, [task]() mutable
+	{
+		SectionedUVRuntime::RunMerge(*task);
+		AsyncTask(ENamedThreads::GameThread, [task = MoveTemp(task)]()
+		{
+			SectionedUVRuntime::FinishMerge(*task);
+		});
+	});
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVRuntimeMergeAction* USectionedUVRuntimeMergeAction::MergeSectionedSkeletalMeshAsync(UObject* worldContextObject, const FSectionedUVRuntimeMergeParams& params)
+{
+	USectionedUVRuntimeMergeAction* action = NewObject<USectionedUVRuntimeMergeAction>();
+	action->Params = params;
+	action->RegisterWithGameInstance(worldContextObject);
+	return action;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVRuntimeMergeAction::Activate()
+{
+	FSectionedUVRuntimeMerge::MergeAsync(Params, FOnSectionedUVRuntimeMergeComplete::CreateUObject(this, &USectionedUVRuntimeMergeAction::OnMergeComplete));
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVRuntimeMergeAction::OnMergeComplete(USkeletalMesh* mergedMesh, const TArray<UMaterialInterface*>& sectionMaterials)
+{
+	if(mergedMesh)
+	{
+		Completed.Broadcast(mergedMesh, sectionMaterials);
+	}
+	else
+	{
+		Failed.Broadcast(nullptr, sectionMaterials);
+	}
+	SetReadyToDestroy();
+}
@@ -0,0 +1,5 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, SectionedUVRuntime)
@@ -0,0 +1,65 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+
+#include "SectionedUVCustomData.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UPrimitiveComponent;
+
+/**
+ * Per section color overrides through custom primitive data. Each section takes four floats starting at
+ * firstDataIndex + section * 4: the color in RGB and a free parameter in A. A material reading its section colors from
+ * the primitive data instead of parameters can be shared by every color variant of a mesh, so tinted crowds stay
+ * instanced and batched. See the readme for the material side.
+ */
+UCLASS()
+class SECTIONEDUVRUNTIME_API USectionedUVCustomDataLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Sets the color of every section of a static or skeletal mesh component, from section 0 up.
+	 * @param component The component drawing the sectioned mesh.
+	 * @param sectionColors Per section, its color in RGB and its parameter in A.
+	 * @param firstDataIndex The custom primitive data index of section 0. A multiple of 4 so each section is one float4.
+	 * @return False if the colors do not fit in the custom primitive data, see GetMaxSectionColors.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="firstDataIndex"), DisplayName="Set Section Colors")
+	static bool SetSectionColors(UPrimitiveComponent* component, const TArray<FLinearColor>& sectionColors, const int32 firstDataIndex = 0);
+
+	/**
+	 * Sets the color of one section of a static or skeletal mesh component.
+	 * @param component The component drawing the sectioned mesh.
+	 * @param section The UV section or section id.
+	 * @param color The section's color in RGB and its parameter in A.
+	 * @param firstDataIndex The custom primitive data index of section 0. A multiple of 4.
+	 * @return False if the section does not fit in the custom primitive data.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="firstDataIndex"), DisplayName="Set Section Color")
+	static bool SetSectionColor(UPrimitiveComponent* component, const int32 section, const FLinearColor color, const int32 firstDataIndex = 0);
+
+	/**
+	 * Instanced version of SetSectionColors, setting the colors of one instance through its per instance custom data.
+	 * The component's custom data floats are grown to fit the colors, keeping every instance's existing custom data.
+	 * Size the component up front with SetNumCustomDataFloats when coloring many instances, growing it copies them all.
+	 * @param component The instanced static mesh component drawing the sectioned mesh.
+	 * @param instanceIndex The instance to color.
+	 * @param sectionColors Per section, its color in RGB and its parameter in A.
+	 * @param firstDataIndex The custom data index of section 0. A multiple of 4.
+	 * @return False if the instance does not exist.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="firstDataIndex"), DisplayName="Set Instance Section Colors")
+	static bool SetInstanceSectionColors(UInstancedStaticMeshComponent* component, const int32 instanceIndex, const TArray<FLinearColor>& sectionColors, const int32 firstDataIndex = 0);
+
+	/**
+	 * The number of section colors custom primitive data has room for after firstDataIndex. The instanced variant
+	 * has no such limit.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Sectioned UV", meta=(AdvancedDisplay="firstDataIndex"), DisplayName="Get Max Section Colors")
+	static int32 GetMaxSectionColors(const int32 firstDataIndex = 0);
+};
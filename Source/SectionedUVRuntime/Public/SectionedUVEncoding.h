@@ -0,0 +1,46 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SectionedUVEncoding.generated.h"
+
+/**
+ * Where the section of each merged vertex is stored.
+ */
+UENUM(BlueprintType)
+enum class ESectionedUVEncoding : uint8
+{
+	/** An extra UV channel holding UV0 moved into the section. Used by MF_Sectioned_UV_Color_Mask. */
+	UVChannel,
+	/** The section index in the red channel of the vertex color. No extra vertex data, up to 256 sections. */
+	VertexColorRed,
+	/** The section index in the green channel of the vertex color. */
+	VertexColorGreen,
+	/** The section index in the blue channel of the vertex color. */
+	VertexColorBlue,
+	/** The section index in the alpha channel of the vertex color. */
+	VertexColorAlpha
+};
+
+namespace SectionedUVEncoding
+{
+	/** The vertex color channel a color encoding writes the section id into, or nullptr for the UV channel encoding */
+	inline uint8* GetEncodedColorChannel(FColor& color, const ESectionedUVEncoding encoding)
+	{
+		switch(encoding)
+		{
+		case ESectionedUVEncoding::VertexColorRed:
+			return &color.R;
+		case ESectionedUVEncoding::VertexColorGreen:
+			return &color.G;
+		case ESectionedUVEncoding::VertexColorBlue:
+			return &color.B;
+		case ESectionedUVEncoding::VertexColorAlpha:
+			return &color.A;
+		default:
+			return nullptr;
+		}
+	}
+}
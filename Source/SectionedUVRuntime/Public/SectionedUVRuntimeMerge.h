@@ -0,0 +1,111 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "SectionedUVEncoding.h"
+
+#include "SectionedUVRuntimeMerge.generated.h"
+
+class UMaterialInterface;
+class USkeletalMesh;
+
+SECTIONEDUVRUNTIME_API DECLARE_LOG_CATEGORY_EXTERN(LogSectionedUVRuntime, Log, All);
+
+/**
+ * What to merge at runtime and how to section it.
+ */
+USTRUCT(BlueprintType)
+struct SECTIONEDUVRUNTIME_API FSectionedUVRuntimeMergeParams
+{
+	GENERATED_BODY()
+
+	/**
+	 * The skeletal mesh parts to merge. They must share a skeleton, have no clothing and keep a CPU copy of their
+	 * render data (Allow CPU Access on every LOD). LODs past the part with the fewest LODs are dropped.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sectioned UV")
+	TArray<USkeletalMesh*> Parts;
+
+	/** The material of the merged section, using the sectioned UV material function */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sectioned UV")
+	UMaterialInterface* SectionedMaterial = nullptr;
+
+	/** Sections using these materials keep their own draw instead of merging, for eyes, hair cards and the like */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sectioned UV")
+	TArray<UMaterialInterface*> KeptMaterials;
+
+	/** The number of horizonal sections */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sectioned UV")
+	int32 NumSections = 16;
+
+	/** The number of vertical sections */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sectioned UV")
+	int32 NumRows = 1;
+
+	/** Where the section is stored */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sectioned UV")
+	ESectionedUVEncoding Encoding = ESectionedUVEncoding::UVChannel;
+};
+
+/**
+ * Called on the game thread once a runtime merge is done.
+ * @param mergedMesh The merged transient mesh, or nullptr if the merge failed.
+ * @param sectionMaterials The source material each UV section stands for, to set up the sectioned material with.
+ */
+DECLARE_DELEGATE_TwoParams(FOnSectionedUVRuntimeMergeComplete, USkeletalMesh* /*mergedMesh*/, const TArray<UMaterialInterface*>& /*sectionMaterials*/);
+
+/**
+ * Merges skeletal mesh parts into one sectioned skeletal mesh at runtime, from their render data. Every part section
+ * not using a kept material goes into one merged section (split only past the GPU skin bone limit), each distinct
+ * material getting its own UV section. The vertex work runs on a worker thread, the game thread only validates the
+ * parts up front and creates the mesh at the end. Morph targets are not carried over.
+ */
+class SECTIONEDUVRUNTIME_API FSectionedUVRuntimeMerge
+{
+public:
+	/**
+	 * Starts a merge. Must be called on the game thread, the parts must not change until it completes.
+	 * @param params What to merge.
+	 * @param onComplete Called on the game thread when done. Called before returning if the parts cannot be merged.
+	 */
+	static void MergeAsync(const FSectionedUVRuntimeMergeParams& params, FOnSectionedUVRuntimeMergeComplete onComplete);
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSectionedUVRuntimeMergePin, USkeletalMesh*, MergedMesh, const TArray<UMaterialInterface*>&, SectionMaterials);
+
+/**
+ * Blueprint node for FSectionedUVRuntimeMerge.
+ */
+UCLASS()
+class SECTIONEDUVRUNTIME_API USectionedUVRuntimeMergeAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	/** The merged mesh and the source material of each UV section */
+	UPROPERTY(BlueprintAssignable)
+	FSectionedUVRuntimeMergePin Completed;
+
+	/** The parts could not be merged, see the log */
+	UPROPERTY(BlueprintAssignable)
+	FSectionedUVRuntimeMergePin Failed;
+
+	/**
+	 * Merges skeletal mesh parts into one sectioned skeletal mesh on a worker thread, for runtime character customization.
+	 * @param params What to merge, see FSectionedUVRuntimeMergeParams.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(BlueprintInternalUseOnly="true", WorldContext="worldContextObject"), DisplayName="Merge Sectioned Skeletal Mesh Async")
+	static USectionedUVRuntimeMergeAction* MergeSectionedSkeletalMeshAsync(UObject* worldContextObject, const FSectionedUVRuntimeMergeParams& params);
+
+	//~ Begin UBlueprintAsyncActionBase Interface
+	virtual void Activate() override;
+	//~ End UBlueprintAsyncActionBase Interface
+
+private:
+	void OnMergeComplete(USkeletalMesh* mergedMesh, const TArray<UMaterialInterface*>& sectionMaterials);
+
+	UPROPERTY()
+	FSectionedUVRuntimeMergeParams Params;
+};
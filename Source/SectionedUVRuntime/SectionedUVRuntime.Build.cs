@@ -0,0 +1,30 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+using UnrealBuildTool;
+
+public class SectionedUVRuntime : ModuleRules
+{
+	public SectionedUVRuntime(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		//OptimizeCode = CodeOptimization.Never;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"CoreUObject",
+				"Engine",
+			}
+			);
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"RenderCore",
+				"RHI",
+				"SectionedUVCore",
+			}
+			);
+	}
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVAtlas.h"
+#include "SectionedUVBake.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "Engine/Texture.h"
+#include "Engine/Texture2D.h"
+#include "Materials/MaterialInstanceConstant.h"
+#include "Materials/MaterialInterface.h"
+#include "Misc/PackageName.h"
+
+namespace SectionedUVAtlas
+{
+	const FName BaseColorParameterName = FName("BaseColorAtlas");
+	const FName NormalParameterName = FName("NormalAtlas");
+	const FName ORMParameterName = FName("ORMAtlas");
+
+	/** The largest atlas the rectangles are packed into */
+	static constexpr int32 MaxAtlasSize = 8192;
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The size of the largest texture a material samples, or zero if it samples none
+	*/
+	static FIntPoint GetLargestTextureSize(UMaterialInterface* material)
+	{
+		FIntPoint largestSize = FIntPoint::ZeroValue;
+		if(!material)
+		{
+			return largestSize;
+		}
+
+		TArray<UTexture*> textures;
+		material->GetUsedTextures(textures, EMaterialQualityLevel::Num, true, ERHIFeatureLevel::Num, true);
+		for(UTexture* texture : textures)
+		{
+			if(texture)
+			{
+				largestSize.X = FMath::Max(largestSize.X, texture->Source.GetSizeX());
+				largestSize.Y = FMath::Max(largestSize.Y, texture->Source.GetSizeY());
+			}
+		}
+		return largestSize;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool BuildAtlasLayout(const TArray<UMaterialInterface*>& sectionMaterials, UMaterialInterface* parentMaterial, const int32 maxSectionSize, const int32 padding, FAtlasLayout& outLayout)
+	{
+		if(!parentMaterial)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot atlas the sectioned materials. No parent material for the atlas material!"));
+			return false;
+		}
+
+		// Rectangles with their gutter are powers of two at least four gutters wide, so there is always room for texels
+		const int32 minSectionSize = FMath::Max(16, static_cast<int32>(FMath::RoundUpToPowerOfTwo(FMath::Max(padding, 1) * 4)));
+		if(padding < 0 || !FMath::IsPowerOfTwo(maxSectionSize) || maxSectionSize < minSectionSize || maxSectionSize > MaxAtlasSize)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot atlas the sectioned materials. The section size should be a power of two between %d and %d."), minSectionSize, MaxAtlasSize);
+			return false;
+		}
+
+		outLayout.ParentMaterial = parentMaterial;
+		outLayout.SectionMaterials = sectionMaterials;
+		outLayout.Padding = static_cast<uint32>(padding);
+
+		std::vector<uint32> widths;
+		std::vector<uint32> heights;
+		for(UMaterialInterface* material : sectionMaterials)
+		{
+			// Materials without textures only need a handful of texels for their constants
+			const FIntPoint textureSize = GetLargestTextureSize(material);
+			const int32 paddedWidth = FMath::Clamp(static_cast<int32>(FMath::RoundUpToPowerOfTwo(FMath::Max(textureSize.X, 1))), minSectionSize, maxSectionSize);
+			const int32 paddedHeight = FMath::Clamp(static_cast<int32>(FMath::RoundUpToPowerOfTwo(FMath::Max(textureSize.Y, 1))), minSectionSize, maxSectionSize);
+			widths.push_back(static_cast<uint32>(paddedWidth - padding * 2));
+			heights.push_back(static_cast<uint32>(paddedHeight - padding * 2));
+		}
+
+		// Every padded rectangle is a multiple of the smallest size, aligning on it keeps whole mip blocks inside one material
+		if(!SectionedUVCore::PackAtlas(widths.data(), heights.data(), static_cast<int32>(widths.size()), outLayout.Padding, static_cast<uint32>(minSectionSize),
+									   static_cast<uint32>(MaxAtlasSize), outLayout.Rects, outLayout.Width, outLayout.Height))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot atlas the sectioned materials. %d materials do not fit in a %dx%d atlas, lower the section size!"),
+				   sectionMaterials.Num(), MaxAtlasSize, MaxAtlasSize);
+			return false;
+		}
+
+		outLayout.Regions.clear();
+		for(const SectionedUVCore::FAtlasRect& rect : outLayout.Rects)
+		{
+			outLayout.Regions.push_back(SectionedUVCore::GetAtlasRegion(rect, outLayout.Width, outLayout.Height));
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Copies a baked rectangle into the atlas, extending its edge texels out over the gutter
+	*/
+	static void CopyIntoAtlas(const TArray<FColor>& baked, const SectionedUVCore::FAtlasRect& rect, const FAtlasLayout& layout, TArray<FColor>& atlas)
+	{
+		const int32 padding = static_cast<int32>(layout.Padding);
+		const int32 minX = FMath::Max(static_cast<int32>(rect.X) - padding, 0);
+		const int32 minY = FMath::Max(static_cast<int32>(rect.Y) - padding, 0);
+		const int32 maxX = FMath::Min(static_cast<int32>(rect.X + rect.Width) + padding, static_cast<int32>(layout.Width));
+		const int32 maxY = FMath::Min(static_cast<int32>(rect.Y + rect.Height) + padding, static_cast<int32>(layout.Height));
+		for(int32 y = minY; y < maxY; ++y)
+		{
+			const int32 bakedY = FMath::Clamp(y - static_cast<int32>(rect.Y), 0, static_cast<int32>(rect.Height) - 1);
+			for(int32 x = minX; x < maxX; ++x)
+			{
+				const int32 bakedX = FMath::Clamp(x - static_cast<int32>(rect.X), 0, static_cast<int32>(rect.Width) - 1);
+				atlas[y * layout.Width + x] = baked[bakedY * rect.Width + bakedX];
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	UMaterialInstanceConstant* BakeAtlasMaterial(UObject* sectionedMesh, const FString& packageName, const FName sectionedSlotName, const FAtlasLayout& layout)
+	{
+		const int32 atlasTexels = static_cast<int32>(layout.Width * layout.Height);
+		TArray<FColor> baseColorAtlas;
+		TArray<FColor> normalAtlas;
+		TArray<FColor> ormAtlas;
+		baseColorAtlas.Init(FColor::Black, atlasTexels);
+		normalAtlas.Init(FColor(128, 128, 255), atlasTexels);
+		ormAtlas.Init(FColor(255, 128, 0), atlasTexels);
+		for(int32 uvSection = 0; uvSection < layout.SectionMaterials.Num(); ++uvSection)
+		{
+			const SectionedUVCore::FAtlasRect& rect = layout.Rects[uvSection];
+			SectionedUVBake::FBakedMaterial baked;
+			SectionedUVBake::BakeMaterial(layout.SectionMaterials[uvSection], static_cast<int32>(rect.Width), static_cast<int32>(rect.Height), baked);
+			CopyIntoAtlas(baked.BaseColor, rect, layout, baseColorAtlas);
+			CopyIntoAtlas(baked.Normal, rect, layout, normalAtlas);
+			CopyIntoAtlas(baked.ORM, rect, layout, ormAtlas);
+		}
+
+		// Baked before the mesh replaces the existing sectioned mesh, so the names come from where it ends up
+		const FString packagePath = FPackageName::GetLongPackagePath(packageName);
+		const FString baseName = FPackageName::GetLongPackageAssetName(packageName) + TEXT("_") + sectionedSlotName.ToString() + TEXT("_Atlas");
+		const int32 width = static_cast<int32>(layout.Width);
+		const int32 height = static_cast<int32>(layout.Height);
+		UClass* textureClass = UTexture2D::StaticClass();
+		UTexture* baseColorTexture = SectionedUVBake::WriteTexture(textureClass, packagePath, TEXT("T_") + baseName + TEXT("_BaseColor"), width, height, 1, baseColorAtlas, true, TC_Default);
+		UTexture* normalTexture = SectionedUVBake::WriteTexture(textureClass, packagePath, TEXT("T_") + baseName + TEXT("_Normal"), width, height, 1, normalAtlas, false, TC_Normalmap);
+		UTexture* ormTexture = SectionedUVBake::WriteTexture(textureClass, packagePath, TEXT("T_") + baseName + TEXT("_ORM"), width, height, 1, ormAtlas, false, TC_Masks);
+		if(!baseColorTexture || !normalTexture || !ormTexture)
+		{
+			return nullptr;
+		}
+
+		TMap<FName, UTexture*> textureParameters;
+		textureParameters.Add(BaseColorParameterName, baseColorTexture);
+		textureParameters.Add(NormalParameterName, normalTexture);
+		textureParameters.Add(ORMParameterName, ormTexture);
+		UMaterialInstanceConstant* materialInstance = SectionedUVBake::WriteMaterialInstance(packagePath, TEXT("MI_") + baseName, layout.ParentMaterial, textureParameters, TMap<FName, float>());
+		if(!materialInstance)
+		{
+			return nullptr;
+		}
+
+		SectionedUVBake::AssignSlotMaterial(sectionedMesh, sectionedSlotName, materialInstance);
+		UE_LOG(LogSectionedUVTools, Log, TEXT("Baked %d sections of '%s' into a %dx%d atlas."), layout.SectionMaterials.Num(), *sectionedSlotName.ToString(), width, height);
+		return materialInstance;
+	}
+}
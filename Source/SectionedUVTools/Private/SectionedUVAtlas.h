@@ -0,0 +1,68 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SectionedUVCore.h"
+
+class UMaterialInstanceConstant;
+class UMaterialInterface;
+
+/**
+ * Packs the source materials of the merged slots into one set of atlas textures. The conversion moves UV0 of each
+ * merged section into its material's atlas rectangle, so the sectioned slot draws with a single material and texture set.
+ */
+namespace SectionedUVAtlas
+{
+	/** Texture parameter the baked base color atlas goes into */
+	extern const FName BaseColorParameterName;
+
+	/** Texture parameter the baked tangent space normal atlas goes into */
+	extern const FName NormalParameterName;
+
+	/** Texture parameter the baked occlusion, roughness and metallic atlas goes into, in R, G and B */
+	extern const FName ORMParameterName;
+
+	/** The atlas of one sectioned slot */
+	struct FAtlasLayout
+	{
+		/** The material the atlas material instance is made from */
+		UMaterialInterface* ParentMaterial = nullptr;
+
+		/** Per UV section, the source material baked into its rectangle */
+		TArray<UMaterialInterface*> SectionMaterials;
+
+		/** Per UV section, where its texels go, gutter excluded */
+		std::vector<SectionedUVCore::FAtlasRect> Rects;
+
+		/** Per UV section, the UV region UV0 is moved into */
+		std::vector<SectionedUVCore::FAtlasRegion> Regions;
+
+		/** The gutter around each rectangle in texels */
+		uint32 Padding = 0;
+
+		uint32 Width = 0;
+		uint32 Height = 0;
+	};
+
+	/**
+	 * Sizes each material's rectangle from the largest texture it samples and packs them. Rectangles and their gutter
+	 * stay powers of two so mips down to the gutter size never mix two materials.
+	 * @param sectionMaterials Per UV section, its source material.
+	 * @param parentMaterial The material the atlas material instance is made from.
+	 * @param maxSectionSize The largest a material's rectangle may be, gutter included. A power of two.
+	 * @param padding The gutter around each rectangle in texels.
+	 * @return False if the inputs are invalid or the rectangles do not fit in the largest atlas.
+	 */
+	bool BuildAtlasLayout(const TArray<UMaterialInterface*>& sectionMaterials, UMaterialInterface* parentMaterial, int32 maxSectionSize, int32 padding, FAtlasLayout& outLayout);
+
+	/**
+	 * Bakes the materials into base color, normal and ORM atlases, fills the gutters with the rectangle edges and
+	 * creates a material instance of the layout's parent material using them. Everything is created next to the mesh
+	 * (T_<mesh>_<slot>_Atlas_BaseColor..., MI_<mesh>_<slot>_Atlas) and assigned to the sectioned slot.
+	 * @param sectionedMesh The converted mesh, which may still have its temporary name.
+	 * @param packageName The package the sectioned mesh ends up in, the atlas assets are named after it.
+	 * @return The material instance, or nullptr if it could not be created.
+	 */
+	UMaterialInstanceConstant* BakeAtlasMaterial(UObject* sectionedMesh, const FString& packageName, FName sectionedSlotName, const FAtlasLayout& layout);
+}
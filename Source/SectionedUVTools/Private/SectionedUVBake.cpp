@@ -0,0 +1,212 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVBake.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInstanceConstant.h"
+#include "MaterialUtilities.h"
+
+namespace SectionedUVBake
+{
+	static const EFlattenMaterialProperties BakedProperties[] =
+	{
+		EFlattenMaterialProperties::Diffuse,
+		EFlattenMaterialProperties::Normal,
+		EFlattenMaterialProperties::AmbientOcclusion,
+		EFlattenMaterialProperties::Roughness,
+		EFlattenMaterialProperties::Metallic,
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* What a property bakes to when the material has nothing for it
+	*/
+	static FColor GetDefaultSample(const EFlattenMaterialProperties property)
+	{
+		switch(property)
+		{
+		case EFlattenMaterialProperties::Normal:
+			return FColor(128, 128, 255);
+		case EFlattenMaterialProperties::AmbientOcclusion:
+			return FColor::White;
+		case EFlattenMaterialProperties::Roughness:
+			return FColor(128, 128, 128);
+		default:
+			return FColor::Black;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The nearest sample of a baked property to a texel. Constant properties bake down to a single sample.
+	*/
+	static FColor GetSample(const FFlattenMaterial& flattenMaterial, const EFlattenMaterialProperties property, const int32 x, const int32 y, const int32 width, const int32 height)
+	{
+		const TArray<FColor>& samples = flattenMaterial.GetPropertySamples(property);
+		const FIntPoint sampleSize = flattenMaterial.GetPropertySize(property);
+		if(!samples.Num() || samples.Num() != sampleSize.X * sampleSize.Y)
+		{
+			return GetDefaultSample(property);
+		}
+		return samples[(y * sampleSize.Y / height) * sampleSize.X + (x * sampleSize.X / width)];
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void BakeMaterial(UMaterialInterface* material, const int32 width, const int32 height, FBakedMaterial& outBaked)
+	{
+		FFlattenMaterial flattenMaterial;
+		for(const EFlattenMaterialProperties property : BakedProperties)
+		{
+			flattenMaterial.SetPropertySize(property, FIntPoint(width, height));
+		}
+		FMaterialUtilities::ExportMaterial(material ? material : UMaterial::GetDefaultMaterial(MD_Surface), flattenMaterial);
+
+		outBaked.Width = width;
+		outBaked.Height = height;
+		outBaked.BaseColor.SetNumUninitialized(width * height);
+		outBaked.Normal.SetNumUninitialized(width * height);
+		outBaked.ORM.SetNumUninitialized(width * height);
+		for(int32 y = 0; y < height; ++y)
+		{
+			for(int32 x = 0; x < width; ++x)
+			{
+				const int32 texelIndex = y * width + x;
+				outBaked.BaseColor[texelIndex] = GetSample(flattenMaterial, EFlattenMaterialProperties::Diffuse, x, y, width, height);
+				outBaked.Normal[texelIndex] = GetSample(flattenMaterial, EFlattenMaterialProperties::Normal, x, y, width, height);
+				outBaked.ORM[texelIndex] = FColor(GetSample(flattenMaterial, EFlattenMaterialProperties::AmbientOcclusion, x, y, width, height).R,
+												  GetSample(flattenMaterial, EFlattenMaterialProperties::Roughness, x, y, width, height).R,
+												  GetSample(flattenMaterial, EFlattenMaterialProperties::Metallic, x, y, width, height).R,
+												  255);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	UObject* FindOrCreateAsset(UClass* assetClass, const FString& packagePath, const FString& assetName, bool& outCreated)
+	{
+		const FString packageName = packagePath / assetName;
+		outCreated = false;
+		if(UObject* existingAsset = LoadObject<UObject>(nullptr, *(packageName + TEXT(".") + assetName), nullptr, LOAD_NoWarn | LOAD_Quiet))
+		{
+			if(!existingAsset->IsA(assetClass))
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. '%s' already exists and is not a %s!"), *packageName, *assetClass->GetName());
+				return nullptr;
+			}
+			return existingAsset;
+		}
+
+		UPackage* package = CreatePackage(*packageName);
+		if(!package)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create package '%s' for the sectioned materials!"), *packageName);
+			return nullptr;
+		}
+		outCreated = true;
+		return NewObject<UObject>(package, assetClass, *assetName, RF_Public | RF_Standalone);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	UTexture* WriteTexture(UClass* textureClass,
+						   const FString& packagePath,
+						   const FString& assetName,
+						   const int32 width,
+						   const int32 height,
+						   const int32 numLayers,
+						   const TArray<FColor>& texels,
+						   const bool bSRGB,
+						   const TextureCompressionSettings compressionSettings)
+	{
+		bool bCreated = false;
+		UTexture* texture = Cast<UTexture>(FindOrCreateAsset(textureClass, packagePath, assetName, bCreated));
+		if(!texture)
+		{
+			return nullptr;
+		}
+
+		texture->PreEditChange(nullptr);
+		texture->Source.Init(width, height, numLayers, 1, TSF_BGRA8, reinterpret_cast<const uint8*>(texels.GetData()));
+		texture->SRGB = bSRGB;
+		texture->CompressionSettings = compressionSettings;
+		texture->PostEditChange();
+		texture->MarkPackageDirty();
+		if(bCreated)
+		{
+			FAssetRegistryModule::AssetCreated(texture);
+		}
+		return texture;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	UMaterialInstanceConstant* WriteMaterialInstance(const FString& packagePath,
+													 const FString& assetName,
+													 UMaterialInterface* parentMaterial,
+													 const TMap<FName, UTexture*>& textureParameters,
+													 const TMap<FName, float>& scalarParameters)
+	{
+		bool bCreated = false;
+		UMaterialInstanceConstant* materialInstance = Cast<UMaterialInstanceConstant>(FindOrCreateAsset(UMaterialInstanceConstant::StaticClass(), packagePath, assetName, bCreated));
+		if(!materialInstance)
+		{
+			return nullptr;
+		}
+
+		materialInstance->PreEditChange(nullptr);
+		materialInstance->SetParentEditorOnly(parentMaterial);
+		for(const TPair<FName, UTexture*>& textureParameter : textureParameters)
+		{
+			materialInstance->SetTextureParameterValueEditorOnly(FMaterialParameterInfo(textureParameter.Key), textureParameter.Value);
+		}
+		for(const TPair<FName, float>& scalarParameter : scalarParameters)
+		{
+			materialInstance->SetScalarParameterValueEditorOnly(FMaterialParameterInfo(scalarParameter.Key), scalarParameter.Value);
+		}
+		materialInstance->PostEditChange();
+		materialInstance->MarkPackageDirty();
+		if(bCreated)
+		{
+			FAssetRegistryModule::AssetCreated(materialInstance);
+		}
+		return materialInstance;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void AssignSlotMaterial(UObject* mesh, const FName slotName, UMaterialInterface* material)
+	{
+		mesh->Modify();
+		if(USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(mesh))
+		{
+			for(FSkeletalMaterial& slot : skeletalMesh->GetMaterials())
+			{
+				if(slot.MaterialSlotName == slotName)
+				{
+					slot.MaterialInterface = material;
+				}
+			}
+		}
+		else if(UStaticMesh* staticMesh = Cast<UStaticMesh>(mesh))
+		{
+			for(FStaticMaterial& slot : staticMesh->GetStaticMaterials())
+			{
+				if(slot.MaterialSlotName == slotName)
+				{
+					slot.MaterialInterface = material;
+				}
+			}
+		}
+	}
+}
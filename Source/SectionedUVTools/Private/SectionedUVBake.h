@@ -0,0 +1,64 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/TextureDefines.h"
+
+class UMaterialInstanceConstant;
+class UMaterialInterface;
+class UTexture;
+
+/**
+ * Renders source materials into textures and writes them out as assets next to a sectioned mesh. Shared by the
+ * texture array and atlas bakes.
+ */
+namespace SectionedUVBake
+{
+	/** What a material bakes down to, one texel array per texture */
+	struct FBakedMaterial
+	{
+		int32 Width = 0;
+		int32 Height = 0;
+		TArray<FColor> BaseColor;
+		/** Tangent space */
+		TArray<FColor> Normal;
+		/** Occlusion, roughness and metallic in R, G and B */
+		TArray<FColor> ORM;
+	};
+
+	/** Renders the base color, normal, occlusion, roughness and metallic of a material over its 0-1 UV square */
+	void BakeMaterial(UMaterialInterface* material, int32 width, int32 height, FBakedMaterial& outBaked);
+
+	/**
+	 * Loads the asset baked into the package before or creates it.
+	 * @param outCreated True if the asset is new, register it with FAssetRegistryModule::AssetCreated once it is filled in.
+	 * @return The asset, or nullptr if something else already lives there.
+	 */
+	UObject* FindOrCreateAsset(UClass* assetClass, const FString& packagePath, const FString& assetName, bool& outCreated);
+
+	/**
+	 * Writes texels into the source of a texture asset and rebuilds it, creating the asset if needed.
+	 * @param textureClass UTexture2D, or UTexture2DArray with one slice per layer.
+	 * @param texels numLayers layers of width x height texels, back to back.
+	 */
+	UTexture* WriteTexture(UClass* textureClass,
+						   const FString& packagePath,
+						   const FString& assetName,
+						   int32 width,
+						   int32 height,
+						   int32 numLayers,
+						   const TArray<FColor>& texels,
+						   bool bSRGB,
+						   TextureCompressionSettings compressionSettings);
+
+	/** Creates or updates a material instance of parentMaterial with the passed in parameter values */
+	UMaterialInstanceConstant* WriteMaterialInstance(const FString& packagePath,
+													 const FString& assetName,
+													 UMaterialInterface* parentMaterial,
+													 const TMap<FName, UTexture*>& textureParameters,
+													 const TMap<FName, float>& scalarParameters);
+
+	/** Points the slots of a static or skeletal mesh with the passed in name at the material */
+	void AssignSlotMaterial(UObject* mesh, FName slotName, UMaterialInterface* material);
+}
@@ -0,0 +1,461 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVCache.h"
+#include "SectionedUVAssetUserData.h"
+#include "SectionedUVAtlas.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "SectionedUVCore.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Animation/MorphTarget.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "HAL/IConsoleManager.h"
+#include "Interfaces/Interface_AssetUserData.h"
+#include "Misc/PackageName.h"
+#include "ObjectTools.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "StaticMeshAttributes.h"
+
+namespace SectionedUVCache
+{
+	/** Bump when the conversion changes so every sectioned mesh gets regenerated */
+	static constexpr uint32 CacheVersion = 2;
+
+#if ENGINE_MAJOR_VERSION >= 5
+	typedef FVector2f FMeshUV;
+	typedef FVector3f FMeshVector;
+#else
+	typedef FVector2D FMeshUV;
+	typedef FVector FMeshVector;
+#endif
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static void HashString(SectionedUVCore::FHasher& hasher, const FString& string)
+	{
+		hasher.UpdateValue(string.Len());
+		hasher.Update(*string, string.Len() * sizeof(TCHAR));
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Hashes the parts shared by both mesh types
+	*/
+	static void HashInputs(SectionedUVCore::FHasher& hasher, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding)
+	{
+		hasher.UpdateValue(CacheVersion);
+		hasher.UpdateValue(numSections);
+		hasher.UpdateValue(numRows);
+		hasher.UpdateValue(encoding);
+		hasher.UpdateValue(materialSlots.Num());
+		hasher.Update(materialSlots.GetData(), materialSlots.Num() * sizeof(int32));
+		for(const FName sectionedSlotName : sectionedSlotNames)
+		{
+			HashString(hasher, sectionedSlotName.ToString());
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static FString FinalizeHash(const SectionedUVCore::FHasher& hasher)
+	{
+		return FString::Printf(TEXT("%016llx"), static_cast<unsigned long long>(hasher.Finalize()));
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Hashes where each merged material lands in the atlas, the section materials themselves are hashed with the mesh
+	*/
+	static void HashAtlasLayout(SectionedUVCore::FHasher& hasher, const SectionedUVAtlas::FAtlasLayout* atlasLayout)
+	{
+		hasher.UpdateValue(atlasLayout != nullptr);
+		if(atlasLayout)
+		{
+			HashString(hasher, GetPathNameSafe(atlasLayout->ParentMaterial));
+			hasher.UpdateValue(atlasLayout->Padding);
+			hasher.UpdateValue(atlasLayout->Width);
+			hasher.UpdateValue(atlasLayout->Height);
+			hasher.UpdateValue(atlasLayout->Rects.size());
+			hasher.Update(atlasLayout->Rects.data(), atlasLayout->Rects.size() * sizeof(SectionedUVCore::FAtlasRect));
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Hashes the far LOD merge. Nothing is added when it is unused, so hashes from before it existed still match.
+	*/
+	static void HashMergeAllFromLOD(SectionedUVCore::FHasher& hasher, const int32 mergeAllFromLOD)
+	{
+		if(mergeAllFromLOD != INDEX_NONE)
+		{
+			hasher.UpdateValue(mergeAllFromLOD);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Hashes the merged section welding console variables, which only change skeletal meshes. Nothing is added while
+	* welding is off, so hashes from before it existed still match.
+	*/
+	static void HashWelding(SectionedUVCore::FHasher& hasher)
+	{
+		static IConsoleVariable* weldCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("SectionedUVTools.WeldMergedSection"));
+		static IConsoleVariable* toleranceCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("SectionedUVTools.WeldPositionTolerance"));
+		if(weldCVar && weldCVar->GetInt() != 0)
+		{
+			hasher.UpdateValue(toleranceCVar ? toleranceCVar->GetFloat() : 0.0f);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Hashes the materials, geometry and morph targets of a skeletal mesh
+	*/
+	static void HashSkeletalMeshData(SectionedUVCore::FHasher& hasher, USkeletalMesh* skeletalMesh)
+	{
+		for(const FSkeletalMaterial& material : skeletalMesh->GetMaterials())
+		{
+			HashString(hasher, material.MaterialSlotName.ToString());
+			HashString(hasher, GetPathNameSafe(material.MaterialInterface));
+		}
+
+		if(FSkeletalMeshModel* skelMeshModel = skeletalMesh->GetImportedModel())
+		{
+			for(const FSkeletalMeshLODModel& lodModel : skelMeshModel->LODModels)
+			{
+				hasher.UpdateValue(lodModel.NumTexCoords);
+				hasher.Update(lodModel.IndexBuffer.GetData(), lodModel.IndexBuffer.Num() * sizeof(uint32));
+				for(const FSkelMeshSection& section : lodModel.Sections)
+				{
+					hasher.UpdateValue(section.MaterialIndex);
+					hasher.UpdateValue(section.CorrespondClothAssetIndex);
+					hasher.UpdateValue(section.MaxBoneInfluences);
+					hasher.Update(section.BoneMap.GetData(), section.BoneMap.Num() * sizeof(FBoneIndexType));
+
+					// Field by field, the vertex has padding which is not guaranteed to be stable
+					for(const FSoftSkinVertex& vertex : section.SoftVertices)
+					{
+						hasher.UpdateValue(vertex.Position);
+						hasher.UpdateValue(vertex.TangentX);
+						hasher.UpdateValue(vertex.TangentY);
+						hasher.UpdateValue(vertex.TangentZ);
+						hasher.Update(vertex.UVs, sizeof(vertex.UVs));
+						hasher.UpdateValue(vertex.Color);
+						hasher.Update(vertex.InfluenceBones, sizeof(vertex.InfluenceBones));
+						hasher.Update(vertex.InfluenceWeights, sizeof(vertex.InfluenceWeights));
+					}
+				}
+			}
+		}
+
+		for(UMorphTarget* morphTarget : skeletalMesh->GetMorphTargets())
+		{
+			if(!morphTarget)
+			{
+				continue;
+			}
+
+			HashString(hasher, morphTarget->GetName());
+#if ENGINE_MAJOR_VERSION >= 5
+			const TArray<FMorphTargetLODModel>& morphLODModels = morphTarget->GetMorphLODModels();
+#else
+			const TArray<FMorphTargetLODModel>& morphLODModels = morphTarget->MorphLODModels;
+#endif
+			for(const FMorphTargetLODModel& morphLODModel : morphLODModels)
+			{
+				for(const FMorphTargetDelta& delta : morphLODModel.Vertices)
+				{
+					hasher.UpdateValue(delta.PositionDelta);
+					hasher.UpdateValue(delta.TangentZDelta);
+					hasher.UpdateValue(delta.SourceIdx);
+				}
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Hashes the materials, build settings and mesh descriptions of a static mesh
+	*/
+	static void HashStaticMeshData(SectionedUVCore::FHasher& hasher, UStaticMesh* staticMesh)
+	{
+		for(const FStaticMaterial& material : staticMesh->GetStaticMaterials())
+		{
+			HashString(hasher, material.MaterialSlotName.ToString());
+			HashString(hasher, material.ImportedMaterialSlotName.ToString());
+			HashString(hasher, GetPathNameSafe(material.MaterialInterface));
+		}
+
+		for(int32 sourceModelIndex = 0; sourceModelIndex < staticMesh->GetNumSourceModels(); ++sourceModelIndex)
+		{
+			const FStaticMeshSourceModel& srcModel = staticMesh->GetSourceModel(sourceModelIndex);
+			hasher.UpdateValue(srcModel.BuildSettings.bGenerateLightmapUVs);
+			hasher.UpdateValue(srcModel.BuildSettings.DstLightmapIndex);
+
+			FMeshDescription* meshDescription = staticMesh->GetMeshDescription(sourceModelIndex);
+			if(!meshDescription)
+			{
+				continue;
+			}
+
+			FStaticMeshAttributes attributes(*meshDescription);
+			TArrayView<const FMeshVector> positions = attributes.GetVertexPositions().GetRawArray();
+			hasher.Update(positions.GetData(), positions.Num() * sizeof(FMeshVector));
+
+			TArrayView<const FMeshVector> normals = attributes.GetVertexInstanceNormals().GetRawArray();
+			hasher.Update(normals.GetData(), normals.Num() * sizeof(FMeshVector));
+
+			TVertexInstanceAttributesConstRef<FMeshUV> vertexInstanceUVs = attributes.GetVertexInstanceUVs();
+			for(int32 uvChannel = 0; uvChannel < vertexInstanceUVs.GetNumChannels(); ++uvChannel)
+			{
+				TArrayView<const FMeshUV> uvs = vertexInstanceUVs.GetRawArray(uvChannel);
+				hasher.Update(uvs.GetData(), uvs.Num() * sizeof(FMeshUV));
+			}
+
+			for(const FVertexInstanceID vertexInstanceID : meshDescription->VertexInstances().GetElementIDs())
+			{
+				hasher.UpdateValue(meshDescription->GetVertexInstanceVertex(vertexInstanceID).GetValue());
+			}
+
+			for(const FTriangleID triangleID : meshDescription->Triangles().GetElementIDs())
+			{
+				hasher.UpdateValue(meshDescription->GetTrianglePolygonGroup(triangleID).GetValue());
+				for(const FVertexInstanceID vertexInstanceID : meshDescription->GetTriangleVertexInstances(triangleID))
+				{
+					hasher.UpdateValue(vertexInstanceID.GetValue());
+				}
+			}
+
+			TPolygonGroupAttributesConstRef<FName> slotNames = attributes.GetPolygonGroupMaterialSlotNames();
+			for(const FPolygonGroupID polygonGroupID : meshDescription->PolygonGroups().GetElementIDs())
+			{
+				HashString(hasher, slotNames[polygonGroupID].ToString());
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FString HashSkeletalMesh(USkeletalMesh* skeletalMesh, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding,
+							const SectionedUVAtlas::FAtlasLayout* atlasLayout, int32 mergeAllFromLOD)
+	{
+		SectionedUVCore::FHasher hasher;
+		HashInputs(hasher, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+		HashSkeletalMeshData(hasher, skeletalMesh);
+		HashAtlasLayout(hasher, atlasLayout);
+		HashMergeAllFromLOD(hasher, mergeAllFromLOD);
+		HashWelding(hasher);
+		return FinalizeHash(hasher);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FString HashStaticMesh(UStaticMesh* staticMesh, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding,
+							const SectionedUVAtlas::FAtlasLayout* atlasLayout, int32 mergeAllFromLOD)
+	{
+		SectionedUVCore::FHasher hasher;
+		HashInputs(hasher, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+		HashStaticMeshData(hasher, staticMesh);
+		HashAtlasLayout(hasher, atlasLayout);
+		HashMergeAllFromLOD(hasher, mergeAllFromLOD);
+		return FinalizeHash(hasher);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FString HashMergedSkeletalMesh(const TArray<USkeletalMesh*>& skeletalMeshes, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding)
+	{
+		SectionedUVCore::FHasher hasher;
+		HashInputs(hasher, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+		hasher.UpdateValue(skeletalMeshes.Num());
+		for(USkeletalMesh* skeletalMesh : skeletalMeshes)
+		{
+			HashString(hasher, skeletalMesh->GetPathName());
+			HashSkeletalMeshData(hasher, skeletalMesh);
+		}
+		HashWelding(hasher);
+		return FinalizeHash(hasher);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FString HashMergedStaticMesh(const TArray<UStaticMesh*>& staticMeshes, const TArray<FTransform>& transforms, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding)
+	{
+		SectionedUVCore::FHasher hasher;
+		HashInputs(hasher, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+		hasher.UpdateValue(staticMeshes.Num());
+		for(int32 meshIndex = 0; meshIndex < staticMeshes.Num(); ++meshIndex)
+		{
+			HashString(hasher, staticMeshes[meshIndex]->GetPathName());
+			HashStaticMeshData(hasher, staticMeshes[meshIndex]);
+
+			const FTransform transform = transforms.IsValidIndex(meshIndex) ? transforms[meshIndex] : FTransform::Identity;
+			hasher.UpdateValue(transform.GetLocation());
+			hasher.UpdateValue(transform.GetRotation());
+			hasher.UpdateValue(transform.GetScale3D());
+		}
+		return FinalizeHash(hasher);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	USectionedUVAssetUserData* GetSectionedUserData(UObject* mesh)
+	{
+		IInterface_AssetUserData* assetUserData = Cast<IInterface_AssetUserData>(mesh);
+		return assetUserData ? Cast<USectionedUVAssetUserData>(assetUserData->GetAssetUserDataOfClass(USectionedUVAssetUserData::StaticClass())) : nullptr;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static TArray<FSoftObjectPath> GetMergedMeshPaths(const USectionedUVAssetUserData* userData)
+	{
+		TArray<FSoftObjectPath> mergedPaths;
+		for(const TSoftObjectPtr<UObject>& mergedMesh : userData->MergedMeshes)
+		{
+			mergedPaths.Add(mergedMesh.ToSoftObjectPath());
+		}
+		return mergedPaths;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	UObject* FindSectionedMesh(UObject* sourceMesh, FString& outPackageName, const TArray<UObject*>& mergedMeshes, const bool bAtlased)
+	{
+		const TCHAR* packageSuffix = mergedMeshes.Num() ? TEXT("_merged") : (bAtlased ? TEXT("_atlased") : TEXT("_sectioned"));
+		const FString basePackageName = sourceMesh->GetPackage()->GetPathName() + packageSuffix;
+		const FSoftObjectPath sourcePath(sourceMesh);
+
+		TArray<FSoftObjectPath> mergedPaths;
+		for(UObject* mergedMesh : mergedMeshes)
+		{
+			mergedPaths.Emplace(mergedMesh);
+		}
+
+		// Walk _sectioned, _sectioned1, ... until a free name. Packages on disk count as taken even if they are not loaded.
+		for(int32 suffix = 0; ; ++suffix)
+		{
+			const FString packageName = suffix ? basePackageName + FString::FromInt(suffix) : basePackageName;
+			if(!FindPackage(nullptr, *packageName) && !FPackageName::DoesPackageExist(packageName))
+			{
+				outPackageName = packageName;
+				return nullptr;
+			}
+
+			const FString objectPath = packageName + TEXT(".") + FPaths::GetBaseFilename(packageName);
+			UObject* candidate = LoadObject<UObject>(nullptr, *objectPath, nullptr, LOAD_NoWarn | LOAD_Quiet);
+			if(candidate && candidate->GetClass() == sourceMesh->GetClass())
+			{
+				USectionedUVAssetUserData* userData = GetSectionedUserData(candidate);
+				if(userData && userData->SourceMesh.ToSoftObjectPath() == sourcePath && GetMergedMeshPaths(userData) == mergedPaths && userData->bAtlased == bAtlased)
+				{
+					outPackageName = packageName;
+					return candidate;
+				}
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool IsUpToDate(UObject* sectionedMesh, const FString& sourceHash)
+	{
+		USectionedUVAssetUserData* userData = GetSectionedUserData(sectionedMesh);
+		return userData && userData->SourceHash == sourceHash;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	UObject* DuplicateSourceMesh(UObject* sourceMesh, UObject* existingMesh, const FString& packageName)
+	{
+		UPackage* package = existingMesh ? existingMesh->GetPackage() : CreatePackage(*packageName);
+		if(!package)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create package for new sectioned mesh!"));
+			return nullptr;
+		}
+
+		const FName meshName = existingMesh ? MakeUniqueObjectName(package, sourceMesh->GetClass()) : FName(*FPaths::GetBaseFilename(packageName));
+		return DuplicateObject<UObject>(sourceMesh, package, meshName);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void DiscardSectionedMesh(UObject* sectionedMesh, UObject* existingMesh)
+	{
+		UPackage* package = sectionedMesh->GetPackage();
+		sectionedMesh->ConditionalBeginDestroy();
+		if(!existingMesh)
+		{
+			package->ConditionalBeginDestroy();
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FinishSectionedMesh(UObject* sectionedMesh,
+							 UObject* existingMesh,
+							 UObject* sourceMesh,
+							 const FString& sourceHash,
+							 const TArray<int32>& materialSlots,
+							 const TArray<FName>& sectionedSlotNames,
+							 int32 numSections,
+							 int32 numRows,
+							 ESectionedUVEncoding encoding,
+							 const TArray<UObject*>& mergedMeshes)
+	{
+		if(IInterface_AssetUserData* assetUserData = Cast<IInterface_AssetUserData>(sectionedMesh))
+		{
+			assetUserData->RemoveUserDataOfClass(USectionedUVAssetUserData::StaticClass());
+			USectionedUVAssetUserData* userData = NewObject<USectionedUVAssetUserData>(sectionedMesh);
+			userData->SourceMesh = sourceMesh;
+			for(UObject* mergedMesh : mergedMeshes)
+			{
+				userData->MergedMeshes.Add(mergedMesh);
+			}
+			userData->SourceHash = sourceHash;
+			userData->MaterialSlots = materialSlots;
+			userData->SectionedSlotNames = sectionedSlotNames;
+			userData->NumSections = numSections;
+			userData->NumRows = numRows;
+			userData->Encoding = encoding;
+			assetUserData->AddAssetUserData(userData);
+		}
+
+		if(!existingMesh)
+		{
+			FAssetRegistryModule::AssetCreated(sectionedMesh);
+			return;
+		}
+
+		// Move the old mesh out of the way and take over its name, anything referencing the asset path picks up the new mesh
+		const FName meshName = existingMesh->GetFName();
+		existingMesh->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional);
+		existingMesh->ClearFlags(RF_Public | RF_Standalone);
+		sectionedMesh->Rename(*meshName.ToString(), nullptr, REN_DontCreateRedirectors | REN_NonTransactional);
+
+		// Loaded objects hold the old mesh itself rather than its path. Components, blueprint defaults and other assets
+		// are all pointed at the new mesh so nothing is left referencing the old one once it is marked as garbage.
+		TArray<UObject*> replacedMeshes;
+		replacedMeshes.Add(existingMesh);
+		ObjectTools::ForceReplaceReferences(sectionedMesh, replacedMeshes);
+#if ENGINE_MAJOR_VERSION >= 5
+		existingMesh->MarkAsGarbage();
+#else
+		existingMesh->MarkPendingKill();
+#endif
+		sectionedMesh->MarkPackageDirty();
+	}
+}
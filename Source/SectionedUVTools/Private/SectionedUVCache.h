@@ -0,0 +1,95 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+
+class USectionedUVAssetUserData;
+class USkeletalMesh;
+class UStaticMesh;
+
+namespace SectionedUVAtlas
+{
+	struct FAtlasLayout;
+}
+
+/**
+ * Keeps sectioned meshes tied to the mesh they were generated from. Converting a mesh again reuses its existing
+ * sectioned mesh, updating it in place when the inputs changed and skipping it when they did not.
+ */
+namespace SectionedUVCache
+{
+	/**
+	 * Hashes everything a skeletal mesh conversion depends on.
+	 * @param skeletalMesh The source mesh.
+	 * @param materialSlots The slots being merged, sorted.
+	 * @param sectionedSlotNames Per entry of materialSlots, the sectioned slot it is merged into.
+	 * @param numSections The number of UV sections in a row.
+	 * @param numRows The number of rows of UV sections.
+	 * @param encoding Where the section is stored.
+	 * @param atlasLayout The atlas UV0 of the merged sections is moved into, nullptr if it is left alone.
+	 * @param mergeAllFromLOD The first LOD merging every slot, INDEX_NONE for none. Left out of the hash when unused so
+	 *                        meshes converted before it existed stay up to date.
+	 */
+	FString HashSkeletalMesh(USkeletalMesh* skeletalMesh, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding,
+							 const SectionedUVAtlas::FAtlasLayout* atlasLayout = nullptr, int32 mergeAllFromLOD = INDEX_NONE);
+
+	/** Static mesh version of HashSkeletalMesh */
+	FString HashStaticMesh(UStaticMesh* staticMesh, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding,
+						   const SectionedUVAtlas::FAtlasLayout* atlasLayout = nullptr, int32 mergeAllFromLOD = INDEX_NONE);
+
+	/**
+	 * Hashes everything a merged skeletal mesh conversion depends on, see HashSkeletalMesh.
+	 * @param skeletalMeshes The meshes being merged, in order.
+	 */
+	FString HashMergedSkeletalMesh(const TArray<USkeletalMesh*>& skeletalMeshes, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding);
+
+	/**
+	 * Static mesh version of HashMergedSkeletalMesh.
+	 * @param transforms The transform each mesh is placed with, missing entries are the identity.
+	 */
+	FString HashMergedStaticMesh(const TArray<UStaticMesh*>& staticMeshes, const TArray<FTransform>& transforms, const TArray<int32>& materialSlots, const TArray<FName>& sectionedSlotNames, int32 numSections, int32 numRows, ESectionedUVEncoding encoding);
+
+	/**
+	 * Finds the sectioned mesh previously generated from the source mesh.
+	 * @param sourceMesh The source mesh, the first mesh for a merged mesh.
+	 * @param outPackageName The package of the existing sectioned mesh, or a free package name for a new one.
+	 * @param mergedMeshes The meshes merged after the source mesh. Merged meshes live in "_merged" packages and only
+	 *                     match when the same meshes were merged in the same order.
+	 * @param bAtlased True for a mesh with its UV0 moved into an atlas. Those live in "_atlased" packages so they sit
+	 *                 next to the plain sectioned mesh of the same source.
+	 * @return The existing sectioned mesh or nullptr if there is none.
+	 */
+	UObject* FindSectionedMesh(UObject* sourceMesh, FString& outPackageName, const TArray<UObject*>& mergedMeshes = TArray<UObject*>(), bool bAtlased = false);
+
+	/** The inputs a sectioned mesh was generated with, or nullptr if the mesh was not generated by the tools */
+	USectionedUVAssetUserData* GetSectionedUserData(UObject* mesh);
+
+	/** True if the sectioned mesh was generated from inputs with the passed in hash */
+	bool IsUpToDate(UObject* sectionedMesh, const FString& sourceHash);
+
+	/**
+	 * Duplicates the source mesh into the package the sectioned mesh lives in. When there is an existing sectioned mesh
+	 * the duplicate gets a temporary name, the existing mesh is left alone until FinishSectionedMesh.
+	 */
+	UObject* DuplicateSourceMesh(UObject* sourceMesh, UObject* existingMesh, const FString& packageName);
+
+	/** Throws away a duplicate which failed to convert. The existing sectioned mesh is kept. */
+	void DiscardSectionedMesh(UObject* sectionedMesh, UObject* existingMesh);
+
+	/**
+	 * Records the inputs on the converted mesh and puts it in place of the existing sectioned mesh if there is one.
+	 * Every loaded object referencing the existing mesh is pointed at the new one, see ObjectTools::ForceReplaceReferences.
+	 */
+	void FinishSectionedMesh(UObject* sectionedMesh,
+							 UObject* existingMesh,
+							 UObject* sourceMesh,
+							 const FString& sourceHash,
+							 const TArray<int32>& materialSlots,
+							 const TArray<FName>& sectionedSlotNames,
+							 int32 numSections,
+							 int32 numRows,
+							 ESectionedUVEncoding encoding,
+							 const TArray<UObject*>& mergedMeshes = TArray<UObject*>());
+}
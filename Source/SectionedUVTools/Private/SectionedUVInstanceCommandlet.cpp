@@ -0,0 +1,127 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVInstanceCommandlet.h"
+#include "SectionedUVInstancing.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "UObject/SavePackage.h"
+#include "UObject/UObjectGlobals.h"
+
+namespace SectionedUVInstanceCommandlet
+{
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static bool SavePackage(UObject* asset, const FString& extension)
+	{
+		UPackage* package = asset->GetOutermost();
+		const FString filename = FPackageName::LongPackageNameToFilename(package->GetName(), extension);
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1)
+		FSavePackageArgs saveArgs;
+		saveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		saveArgs.Error = GError;
+		return UPackage::SavePackage(package, asset, *filename, saveArgs);
+#else
+		return UPackage::SavePackage(package, asset, RF_Public | RF_Standalone, *filename, GError);
+#endif
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVInstanceCommandlet::USectionedUVInstanceCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+int32 USectionedUVInstanceCommandlet::Main(const FString& Params)
+{
+	FString mapsParam;
+	FString colorParameterName = TEXT("Color");
+	SectionedUVInstancing::FSettings settings;
+	FParse::Value(*Params, TEXT("Maps="), mapsParam, false);
+	FParse::Value(*Params, TEXT("NumSections="), settings.NumSections);
+	FParse::Value(*Params, TEXT("MinInstances="), settings.MinInstances);
+	FParse::Value(*Params, TEXT("ClusterSize="), settings.ClusterSize);
+	FParse::Value(*Params, TEXT("ColorParameter="), colorParameterName);
+	FParse::Value(*Params, TEXT("FirstDataIndex="), settings.FirstDataIndex);
+	settings.bHierarchical = !FParse::Param(*Params, TEXT("ISM"));
+	settings.ColorParameterName = FName(*colorParameterName);
+	const bool bNoSave = FParse::Param(*Params, TEXT("NoSave"));
+
+	TArray<FString> maps;
+	mapsParam.ParseIntoArray(maps, TEXT("+"));
+	if(!maps.Num())
+	{
+		UE_LOG(LogSectionedUVTools, Error, TEXT("No maps to instance. Usage: -run=SectionedUVInstance -Maps=/Game/Maps/Town+/Game/Maps/Town_Props [-NumSections=16] [-MinInstances=2] [-ClusterSize=5000] [-ISM] [-ColorParameter=Color] [-FirstDataIndex=0] [-NoSave]"));
+		return 1;
+	}
+
+	int32 numFailed = 0;
+	int32 totalReplaced = 0;
+	for(const FString& map : maps)
+	{
+		UPackage* mapPackage = LoadPackage(nullptr, *map, LOAD_None);
+		UWorld* world = mapPackage ? UWorld::FindWorldInPackage(mapPackage) : nullptr;
+		if(!world)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to load map '%s'."), *map);
+			++numFailed;
+			continue;
+		}
+
+		// Actors can only be spawned and destroyed in an initialized world
+		world->AddToRoot();
+		const bool bInitWorld = !world->bIsWorldInitialized;
+		if(bInitWorld)
+		{
+			world->WorldType = EWorldType::Editor;
+			UWorld::InitializationValues initValues;
+			initValues.RequiresHitProxies(false).ShouldSimulatePhysics(false).EnableTraceCollision(false).CreateNavigation(false).CreateAISystem(false).AllowAudioPlayback(false);
+			world->InitWorld(initValues);
+			world->UpdateWorldComponents(true, false);
+		}
+
+		TArray<UStaticMesh*> sectionedMeshes;
+		const int32 numReplaced = SectionedUVInstancing::InstanceStaticMeshActors(world, settings, sectionedMeshes);
+		bool bSaved = true;
+		if(numReplaced > 0 && !bNoSave)
+		{
+			for(UStaticMesh* sectionedMesh : sectionedMeshes)
+			{
+				bSaved &= !sectionedMesh->GetOutermost()->IsDirty() || SectionedUVInstanceCommandlet::SavePackage(sectionedMesh, FPackageName::GetAssetPackageExtension());
+			}
+			bSaved &= SectionedUVInstanceCommandlet::SavePackage(world, FPackageName::GetMapPackageExtension());
+		}
+
+		if(numReplaced < 0 || !bSaved)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Failed to instance '%s'."), *map);
+			++numFailed;
+		}
+		else
+		{
+			UE_LOG(LogSectionedUVTools, Display, TEXT("Replaced %d actors in '%s' with instances of %d sectioned meshes."), numReplaced, *map, sectionedMeshes.Num());
+			totalReplaced += numReplaced;
+		}
+
+		if(bInitWorld)
+		{
+			world->CleanupWorld();
+		}
+		world->RemoveFromRoot();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	UE_LOG(LogSectionedUVTools, Display, TEXT("Replaced %d actors in %d maps, %d failed."), totalReplaced, maps.Num() - numFailed, numFailed);
+	return numFailed ? 1 : 0;
+}
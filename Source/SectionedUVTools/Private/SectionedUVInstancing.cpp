@@ -0,0 +1,433 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVInstancing.h"
+#include "SectionedUVAssetUserData.h"
+#include "SectionedUVCache.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "SectionedUVCore.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "Materials/MaterialInterface.h"
+#include "ScopedTransaction.h"
+
+#define LOCTEXT_NAMESPACE "SectionedUVInstancing"
+
+namespace SectionedUVInstancing
+{
+	/**
+	* A converted mesh and where its merged slots keep their colors
+	*/
+	struct FSectionedMesh
+	{
+		UStaticMesh* Mesh = nullptr;
+		/** Per source slot, the sectioned mesh slot drawing it or INDEX_NONE if the slot is merged */
+		TArray<int32> KeptSlots;
+		/** Per source slot, the custom data section holding its color or INDEX_NONE if the slot is kept */
+		TArray<int32> DataSections;
+		/** Sections of all sectioned slots, each sectioned slot's sections go after the ones of the slot before */
+		int32 NumDataSections = 0;
+	};
+
+	/**
+	* Placements which can be drawn by the same instanced component
+	*/
+	struct FComponentKey
+	{
+		UStaticMesh* Mesh = nullptr;
+		/** Per sectioned mesh slot, the material the placement draws a kept slot with */
+		TArray<UMaterialInterface*> Materials;
+		EComponentMobility::Type Mobility = EComponentMobility::Static;
+		FName CollisionProfileName;
+		bool bCastShadow = true;
+		FIntVector Cell = FIntVector::ZeroValue;
+
+		bool operator==(const FComponentKey& other) const
+		{
+			return Mesh == other.Mesh && Materials == other.Materials && Mobility == other.Mobility &&
+				   CollisionProfileName == other.CollisionProfileName && bCastShadow == other.bCastShadow && Cell == other.Cell;
+		}
+
+		friend uint32 GetTypeHash(const FComponentKey& key)
+		{
+			uint32 hash = HashCombine(GetTypeHash(key.Mesh), GetTypeHash(key.Cell));
+			for(const UMaterialInterface* material : key.Materials)
+			{
+				hash = HashCombine(hash, GetTypeHash(material));
+			}
+			return HashCombine(hash, GetTypeHash(key.CollisionProfileName));
+		}
+	};
+
+	/**
+	* One placement turned into an instance
+	*/
+	struct FInstance
+	{
+		FTransform Transform;
+		/** The custom primitive data of the placed component */
+		TArray<float> CustomData;
+		TArray<FLinearColor> SectionColors;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Plain static mesh actors standing on their own, anything more could lose behaviour or attachments as an instance
+	*/
+	static UStaticMeshComponent* GetInstanceableComponent(AActor* actor)
+	{
+		if(!actor || actor->GetClass() != AStaticMeshActor::StaticClass() || actor->IsPendingKillPending() || actor->GetAttachParentActor())
+		{
+			return nullptr;
+		}
+
+		TArray<AActor*> attachedActors;
+		actor->GetAttachedActors(attachedActors);
+		UStaticMeshComponent* component = CastChecked<AStaticMeshActor>(actor)->GetStaticMeshComponent();
+		if(attachedActors.Num() || !component || !component->GetStaticMesh() || component->GetAttachChildren().Num())
+		{
+			return nullptr;
+		}
+		return component;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Sections a mesh if an auto conversion would merge any of its slots and lays out the custom data of its merged slots
+	*/
+	static bool ConvertMesh(UStaticMesh* staticMesh, const FSettings& settings, FSectionedMesh& outSectionedMesh)
+	{
+		TArray<int32> materialSlots;
+		TArray<FName> sectionedSlotNames;
+		USectionedUVToolsFunctionLibrary::GetAutoSectionedSlots(staticMesh, materialSlots, sectionedSlotNames);
+		if(!materialSlots.Num())
+		{
+			return false;
+		}
+
+		UStaticMesh* sectionedMesh = USectionedUVToolsFunctionLibrary::CreateAutoSectionedUVStaticMesh(staticMesh, settings.NumSections);
+		const USectionedUVAssetUserData* userData = sectionedMesh ? SectionedUVCache::GetSectionedUserData(sectionedMesh) : nullptr;
+		if(!userData)
+		{
+			return false;
+		}
+
+		TArray<FName> groupSlotNames;
+		TArray<int32> slotGroups;
+		for(const FName slotName : userData->SectionedSlotNames)
+		{
+			slotGroups.Add(groupSlotNames.AddUnique(slotName));
+		}
+
+		const int32 numSlots = staticMesh->GetStaticMaterials().Num();
+		SectionedUVCore::FSlotMapping slotMapping;
+		if(!SectionedUVCore::BuildGroupedSlotMapping(numSlots, userData->MaterialSlots.GetData(), slotGroups.GetData(), userData->MaterialSlots.Num(), slotMapping))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot instance '%s'. Its slots do not match the sectioned mesh!"), *staticMesh->GetPathName());
+			return false;
+		}
+
+		// Sectioned slots number their sections from 0 each, in custom data they follow one another
+		TArray<int32> groupOffsets;
+		groupOffsets.SetNumZeroed(slotMapping.NumGroups + 1);
+		for(int32 materialSlot = 0; materialSlot < numSlots; ++materialSlot)
+		{
+			const int32 group = SectionedUVCore::GetSlotGroup(slotMapping, materialSlot);
+			if(group != INDEX_NONE)
+			{
+				groupOffsets[group + 1] = FMath::Max(groupOffsets[group + 1], SectionedUVCore::GetUVSection(slotMapping, materialSlot) + 1);
+			}
+		}
+		for(int32 group = 1; group < groupOffsets.Num(); ++group)
+		{
+			groupOffsets[group] += groupOffsets[group - 1];
+		}
+
+		outSectionedMesh.Mesh = sectionedMesh;
+		outSectionedMesh.NumDataSections = groupOffsets.Last();
+		for(int32 materialSlot = 0; materialSlot < numSlots; ++materialSlot)
+		{
+			const int32 group = SectionedUVCore::GetSlotGroup(slotMapping, materialSlot);
+			outSectionedMesh.KeptSlots.Add(group == INDEX_NONE ? slotMapping.SlotRemap[materialSlot] : INDEX_NONE);
+			outSectionedMesh.DataSections.Add(group == INDEX_NONE ? INDEX_NONE : groupOffsets[group] + SectionedUVCore::GetUVSection(slotMapping, materialSlot));
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The section colors of a placement. The placed component's custom primitive data is kept where its merged slot
+	* materials have no color parameter, so colors already set through USectionedUVCustomDataLibrary survive.
+	*/
+	static void GetSectionColors(const UStaticMeshComponent* component, const FSectionedMesh& sectionedMesh, const FSettings& settings, TArray<FLinearColor>& outSectionColors)
+	{
+		const TArray<float>& customData = component->GetCustomPrimitiveData().Data;
+		outSectionColors.Init(FLinearColor::White, sectionedMesh.NumDataSections);
+		for(int32 section = 0; section < sectionedMesh.NumDataSections; ++section)
+		{
+			const int32 dataIndex = settings.FirstDataIndex + section * 4;
+			if(dataIndex + 3 < customData.Num())
+			{
+				outSectionColors[section] = FLinearColor(customData[dataIndex], customData[dataIndex + 1], customData[dataIndex + 2], customData[dataIndex + 3]);
+			}
+		}
+
+		for(int32 materialSlot = 0; materialSlot < sectionedMesh.DataSections.Num(); ++materialSlot)
+		{
+			const int32 section = sectionedMesh.DataSections[materialSlot];
+			const UMaterialInterface* material = section != INDEX_NONE ? component->GetMaterial(materialSlot) : nullptr;
+			FLinearColor color;
+			if(material && material->GetVectorParameterValue(FHashedMaterialParameterInfo(settings.ColorParameterName), color))
+			{
+				outSectionColors[section] = color;
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* An empty actor in the level to hold the instanced components of one cluster
+	*/
+	static AActor* SpawnInstanceActor(ULevel* level, const FVector& location, const int32 clusterIndex)
+	{
+		FActorSpawnParameters spawnParameters;
+		spawnParameters.OverrideLevel = level;
+		spawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		AActor* actor = level->OwningWorld->SpawnActor<AActor>(AActor::StaticClass(), FTransform(location), spawnParameters);
+		if(!actor)
+		{
+			return nullptr;
+		}
+
+		USceneComponent* rootComponent = NewObject<USceneComponent>(actor, TEXT("Root"), RF_Transactional);
+		rootComponent->SetMobility(EComponentMobility::Static);
+		rootComponent->SetWorldTransform(FTransform(location));
+		actor->SetRootComponent(rootComponent);
+		actor->AddInstanceComponent(rootComponent);
+		rootComponent->RegisterComponent();
+		actor->SetActorLabel(FString::Printf(TEXT("SectionedUVInstances_%d"), clusterIndex));
+		return actor;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Adds an instanced component drawing the instances to the cluster's actor
+	*/
+	static void CreateInstancedComponent(AActor* actor, const FComponentKey& key, const TArray<FInstance>& instances, const FSettings& settings)
+	{
+		UInstancedStaticMeshComponent* component = settings.bHierarchical ? NewObject<UHierarchicalInstancedStaticMeshComponent>(actor, NAME_None, RF_Transactional)
+																		  : NewObject<UInstancedStaticMeshComponent>(actor, NAME_None, RF_Transactional);
+		component->SetMobility(key.Mobility);
+		component->SetupAttachment(actor->GetRootComponent());
+		component->SetStaticMesh(key.Mesh);
+		component->SetCollisionProfileName(key.CollisionProfileName);
+		component->SetCastShadow(key.bCastShadow);
+		for(int32 materialIndex = 0; materialIndex < key.Materials.Num(); ++materialIndex)
+		{
+			if(key.Materials[materialIndex] && key.Materials[materialIndex] != key.Mesh->GetMaterial(materialIndex))
+			{
+				component->SetMaterial(materialIndex, key.Materials[materialIndex]);
+			}
+		}
+
+		const FTransform& actorTransform = actor->GetActorTransform();
+		TArray<FTransform> instanceTransforms;
+		int32 numCustomDataFloats = 0;
+		for(const FInstance& instance : instances)
+		{
+			instanceTransforms.Add(instance.Transform.GetRelativeTransform(actorTransform));
+			numCustomDataFloats = FMath::Max(numCustomDataFloats, instance.CustomData.Num());
+			if(instance.SectionColors.Num())
+			{
+				numCustomDataFloats = FMath::Max(numCustomDataFloats, settings.FirstDataIndex + instance.SectionColors.Num() * 4);
+			}
+		}
+
+		// Resizing the custom data resets it for every instance, so it is sized for the colors once before any is written
+		component->SetNumCustomDataFloats(numCustomDataFloats);
+		component->AddInstances(instanceTransforms, false);
+
+		// Primitive data first, the section colors go over it. Only the last value of an instance pushes it to the renderer.
+		for(int32 instanceIndex = 0; instanceIndex < instances.Num(); ++instanceIndex)
+		{
+			const FInstance& instance = instances[instanceIndex];
+			const int32 numColorFloats = instance.SectionColors.Num() * 4;
+			for(int32 dataIndex = 0; dataIndex < instance.CustomData.Num(); ++dataIndex)
+			{
+				const bool bLastValue = !numColorFloats && dataIndex == instance.CustomData.Num() - 1;
+				component->SetCustomDataValue(instanceIndex, dataIndex, instance.CustomData[dataIndex], bLastValue);
+			}
+			for(int32 colorFloat = 0; colorFloat < numColorFloats; ++colorFloat)
+			{
+				const FLinearColor& color = instance.SectionColors[colorFloat / 4];
+				component->SetCustomDataValue(instanceIndex, settings.FirstDataIndex + colorFloat, color.Component(colorFloat % 4), colorFloat == numColorFloats - 1);
+			}
+		}
+
+		actor->AddInstanceComponent(component);
+		component->RegisterComponent();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	int32 InstanceStaticMeshActors(UWorld* world, const FSettings& settings, TArray<UStaticMesh*>& outSectionedMeshes)
+	{
+		if(!world)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot instance the static mesh actors. Pass a world!"));
+			return INDEX_NONE;
+		}
+
+#if ENGINE_MAJOR_VERSION >= 5
+		if(world->GetWorldPartition())
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot instance the static mesh actors of '%s'. World partition maps store their actors in their own packages, which are not supported!"), *world->GetName());
+			return INDEX_NONE;
+		}
+#endif
+
+		if(settings.FirstDataIndex < 0 || settings.FirstDataIndex % 4 != 0)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot instance the static mesh actors. The first data index should be a positive multiple of 4."));
+			return INDEX_NONE;
+		}
+
+		// Every mesh placed often enough in a level is converted once for the whole world
+		TMap<ULevel*, TArray<TPair<AActor*, UStaticMeshComponent*>>> levelPlacements;
+		TMap<UStaticMesh*, FSectionedMesh> sectionedMeshes;
+		for(ULevel* level : world->GetLevels())
+		{
+			if(!level)
+			{
+				continue;
+			}
+
+			TMap<UStaticMesh*, TArray<TPair<AActor*, UStaticMeshComponent*>>> meshPlacements;
+			for(AActor* actor : level->Actors)
+			{
+				if(UStaticMeshComponent* component = GetInstanceableComponent(actor))
+				{
+					meshPlacements.FindOrAdd(component->GetStaticMesh()).Emplace(actor, component);
+				}
+			}
+
+			for(TPair<UStaticMesh*, TArray<TPair<AActor*, UStaticMeshComponent*>>>& placements : meshPlacements)
+			{
+				if(placements.Value.Num() < FMath::Max(settings.MinInstances, 1) || USectionedUVToolsFunctionLibrary::IsSectionedMesh(placements.Key))
+				{
+					continue;
+				}
+
+				if(!sectionedMeshes.Contains(placements.Key))
+				{
+					FSectionedMesh sectionedMesh;
+					ConvertMesh(placements.Key, settings, sectionedMesh);
+					sectionedMeshes.Add(placements.Key, sectionedMesh);
+					if(sectionedMesh.Mesh)
+					{
+						outSectionedMeshes.Add(sectionedMesh.Mesh);
+					}
+				}
+
+				if(sectionedMeshes[placements.Key].Mesh)
+				{
+					levelPlacements.FindOrAdd(level).Append(placements.Value);
+				}
+			}
+		}
+
+		// Conversions stay out of the transaction, undoing the replacement leaves the sectioned meshes around
+		const FScopedTransaction transaction(LOCTEXT("InstanceStaticMeshActors", "Instance Sectioned Static Mesh Actors"));
+		int32 numReplaced = 0;
+		for(TPair<ULevel*, TArray<TPair<AActor*, UStaticMeshComponent*>>>& placements : levelPlacements)
+		{
+			ULevel* level = placements.Key;
+			level->Modify();
+
+			TMap<FComponentKey, TArray<FInstance>> components;
+			for(const TPair<AActor*, UStaticMeshComponent*>& placement : placements.Value)
+			{
+				const UStaticMeshComponent* component = placement.Value;
+				const FSectionedMesh& sectionedMesh = sectionedMeshes[component->GetStaticMesh()];
+				const FTransform transform = component->GetComponentTransform();
+
+				FComponentKey key;
+				key.Mesh = sectionedMesh.Mesh;
+				key.Materials.SetNumZeroed(sectionedMesh.Mesh->GetStaticMaterials().Num());
+				for(int32 materialSlot = 0; materialSlot < sectionedMesh.KeptSlots.Num(); ++materialSlot)
+				{
+					if(key.Materials.IsValidIndex(sectionedMesh.KeptSlots[materialSlot]))
+					{
+						key.Materials[sectionedMesh.KeptSlots[materialSlot]] = component->GetMaterial(materialSlot);
+					}
+				}
+				key.Mobility = component->Mobility;
+				key.CollisionProfileName = component->GetCollisionProfileName();
+				key.bCastShadow = component->CastShadow;
+				if(settings.ClusterSize > 0.0f)
+				{
+					const FVector cell = transform.GetLocation() / settings.ClusterSize;
+					key.Cell = FIntVector(FMath::FloorToInt(cell.X), FMath::FloorToInt(cell.Y), FMath::FloorToInt(cell.Z));
+				}
+
+				FInstance& instance = components.FindOrAdd(key).AddDefaulted_GetRef();
+				instance.Transform = transform;
+				instance.CustomData = component->GetCustomPrimitiveData().Data;
+				GetSectionColors(component, sectionedMesh, settings, instance.SectionColors);
+			}
+
+			// One actor per cluster, placed at the center of its instances
+			TMap<FIntVector, TPair<FVector, int32>> clusterCenters;
+			for(const TPair<FComponentKey, TArray<FInstance>>& component : components)
+			{
+				TPair<FVector, int32>& center = clusterCenters.FindOrAdd(component.Key.Cell, TPair<FVector, int32>(FVector::ZeroVector, 0));
+				for(const FInstance& instance : component.Value)
+				{
+					center.Key += instance.Transform.GetLocation();
+					center.Value += 1;
+				}
+			}
+
+			TMap<FIntVector, AActor*> clusterActors;
+			for(const TPair<FIntVector, TPair<FVector, int32>>& center : clusterCenters)
+			{
+				if(AActor* actor = SpawnInstanceActor(level, center.Value.Key / center.Value.Value, clusterActors.Num()))
+				{
+					clusterActors.Add(center.Key, actor);
+				}
+			}
+
+			if(clusterActors.Num() != clusterCenters.Num())
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot instance the static mesh actors of '%s'. Spawning the instance actors failed!"), *level->GetOuter()->GetName());
+				for(const TPair<FIntVector, AActor*>& clusterActor : clusterActors)
+				{
+					world->EditorDestroyActor(clusterActor.Value, true);
+				}
+				continue;
+			}
+
+			for(const TPair<FComponentKey, TArray<FInstance>>& component : components)
+			{
+				CreateInstancedComponent(clusterActors[component.Key.Cell], component.Key, component.Value, settings);
+			}
+
+			for(const TPair<AActor*, UStaticMeshComponent*>& placement : placements.Value)
+			{
+				world->EditorDestroyActor(placement.Key, true);
+			}
+
+			numReplaced += placements.Value.Num();
+			UE_LOG(LogSectionedUVTools, Log, TEXT("Replaced %d static mesh actors in '%s' with %d instanced components in %d clusters."),
+				   placements.Value.Num(), *level->GetOuter()->GetName(), components.Num(), clusterActors.Num());
+		}
+		return numReplaced;
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,43 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UStaticMesh;
+class UWorld;
+
+/**
+ * Replaces placed static mesh actors with instances of their sectioned mesh. Every mesh worth sectioning is converted
+ * once and its actors become instances of one instanced static mesh component per cluster, the merged slot materials
+ * they overrode carried over as per instance section colors.
+ */
+namespace SectionedUVInstancing
+{
+	struct FSettings
+	{
+		/** The number of horizontal sections of the converted meshes */
+		int32 NumSections = 16;
+		/** Meshes placed fewer times than this in a level are left alone */
+		int32 MinInstances = 2;
+		/** Width of the grid cells instances are clustered by, 0 puts all instances of a mesh in one cluster */
+		float ClusterSize = 0.0f;
+		/** Hierarchical instanced components, which cull and LOD per instance cluster */
+		bool bHierarchical = true;
+		/** The vector parameter of the merged slot materials holding the color of their section */
+		FName ColorParameterName = FName("Color");
+		/** The custom data index of the first section, see USectionedUVCustomDataLibrary */
+		int32 FirstDataIndex = 0;
+	};
+
+	/**
+	 * Instances the qualifying static mesh actors of every loaded level of a world. Actors qualify if they are plain
+	 * static mesh actors, attach to nothing and nothing attaches to them, and their mesh has slots an auto conversion
+	 * would merge. Each level gets its own instance actors.
+	 * @param world The world whose levels to instance.
+	 * @param settings How to convert and cluster.
+	 * @param outSectionedMeshes The sectioned meshes the instances draw, to save along with the levels.
+	 * @return The number of actors replaced, or INDEX_NONE if the world cannot be instanced.
+	 */
+	int32 InstanceStaticMeshActors(UWorld* world, const FSettings& settings, TArray<UStaticMesh*>& outSectionedMeshes);
+}
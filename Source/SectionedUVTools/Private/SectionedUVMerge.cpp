@@ -0,0 +1,485 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVMerge.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "SectionedUVCore.h"
+#include "Animation/MorphTarget.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "StaticMeshAttributes.h"
+#include "StaticMeshOperations.h"
+
+namespace SectionedUVMerge
+{
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void GetMeshSlots(UObject* mesh, TArray<FName>& outSlotNames, TArray<UMaterialInterface*>& outMaterials)
+	{
+		if(USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(mesh))
+		{
+			for(const FSkeletalMaterial& material : skeletalMesh->GetMaterials())
+			{
+				outSlotNames.Add(material.MaterialSlotName);
+				outMaterials.Add(material.MaterialInterface);
+			}
+		}
+		else if(UStaticMesh* staticMesh = Cast<UStaticMesh>(mesh))
+		{
+			for(const FStaticMaterial& material : staticMesh->GetStaticMaterials())
+			{
+				outSlotNames.Add(material.MaterialSlotName);
+				outMaterials.Add(material.MaterialInterface);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static TArray<FMorphTargetLODModel>& GetMorphLODModels(UMorphTarget* morphTarget)
+	{
+#if ENGINE_MAJOR_VERSION >= 5
+		return morphTarget->GetMorphLODModels();
+#else
+		return morphTarget->MorphLODModels;
+#endif
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void BuildMergedSlots(const TArray<UObject*>& meshes, FMergedSlots& outMergedSlots)
+	{
+		outMergedSlots.Slots.Reset();
+		outMergedSlots.MeshSlots.Reset();
+		outMergedSlots.MeshSlots.SetNum(meshes.Num());
+
+		// The name and material each combined slot was made from, before any suffix
+		TArray<FName> sourceSlotNames;
+		TArray<UMaterialInterface*> sourceMaterials;
+		for(int32 meshIndex = 0; meshIndex < meshes.Num(); ++meshIndex)
+		{
+			TArray<FName> slotNames;
+			TArray<UMaterialInterface*> materials;
+			GetMeshSlots(meshes[meshIndex], slotNames, materials);
+
+			for(int32 slotIndex = 0; slotIndex < slotNames.Num(); ++slotIndex)
+			{
+				// Parts of a character often share a skin or eye material in the same named slot, those render as one
+				int32 mergedSlot = INDEX_NONE;
+				for(int32 candidate = 0; candidate < outMergedSlots.Slots.Num(); ++candidate)
+				{
+					if(outMergedSlots.Slots[candidate].MeshIndex != meshIndex && sourceSlotNames[candidate] == slotNames[slotIndex] && sourceMaterials[candidate] == materials[slotIndex])
+					{
+						mergedSlot = candidate;
+						break;
+					}
+				}
+
+				if(mergedSlot == INDEX_NONE)
+				{
+					FName slotName = slotNames[slotIndex];
+					for(int32 suffix = 1; outMergedSlots.Slots.ContainsByPredicate([slotName](const FMergedSlot& slot) { return slot.SlotName == slotName; }); ++suffix)
+					{
+						slotName = FName(*FString::Printf(TEXT("%s_%d"), *slotNames[slotIndex].ToString(), suffix));
+					}
+
+					mergedSlot = outMergedSlots.Slots.Num();
+					FMergedSlot& slot = outMergedSlots.Slots.AddDefaulted_GetRef();
+					slot.MeshIndex = meshIndex;
+					slot.SlotIndex = slotIndex;
+					slot.SlotName = slotName;
+					sourceSlotNames.Add(slotNames[slotIndex]);
+					sourceMaterials.Add(materials[slotIndex]);
+				}
+
+				outMergedSlots.MeshSlots[meshIndex].Add(mergedSlot);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool CanMergeSkeletalMeshes(const TArray<USkeletalMesh*>& skeletalMeshes)
+	{
+		const FReferenceSkeleton& refSkeleton = skeletalMeshes[0]->GetRefSkeleton();
+		for(int32 meshIndex = 0; meshIndex < skeletalMeshes.Num(); ++meshIndex)
+		{
+			USkeletalMesh* skeletalMesh = skeletalMeshes[meshIndex];
+			if(skeletalMesh->GetSkeleton() != skeletalMeshes[0]->GetSkeleton())
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot merge the skeletal meshes. '%s' does not use the skeleton of '%s'!"), *skeletalMesh->GetPathName(), *skeletalMeshes[0]->GetPathName());
+				return false;
+			}
+
+			FSkeletalMeshModel* skelMeshModel = skeletalMesh->GetImportedModel();
+			if(!skelMeshModel || !skelMeshModel->LODModels.Num() || !skeletalMesh->GetMaterials().Num())
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot merge the skeletal meshes. '%s' has no imported model or no material slots!"), *skeletalMesh->GetPathName());
+				return false;
+			}
+
+			if(meshIndex == 0)
+			{
+				continue;
+			}
+
+			const FReferenceSkeleton& meshRefSkeleton = skeletalMesh->GetRefSkeleton();
+			for(const FSkeletalMeshLODModel& lodModel : skelMeshModel->LODModels)
+			{
+				for(const FSkelMeshSection& section : lodModel.Sections)
+				{
+					if(section.HasClothingData())
+					{
+						UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot merge the skeletal meshes. Only the first mesh can have clothing, '%s' has some!"), *skeletalMesh->GetPathName());
+						return false;
+					}
+
+					for(const FBoneIndexType boneIndex : section.BoneMap)
+					{
+						const FName boneName = meshRefSkeleton.GetBoneName(boneIndex);
+						if(refSkeleton.FindRawBoneIndex(boneName) == INDEX_NONE)
+						{
+							UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot merge the skeletal meshes. Bone '%s' of '%s' is missing from '%s', put the mesh with the most bones first!"),
+								   *boneName.ToString(), *skeletalMesh->GetPathName(), *skeletalMeshes[0]->GetPathName());
+							return false;
+						}
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool AppendSkeletalMeshes(USkeletalMesh* mergedMesh, const TArray<USkeletalMesh*>& skeletalMeshes, const FMergedSlots& mergedSlots)
+	{
+		FSkeletalMeshModel* mergedModel = mergedMesh->GetImportedModel();
+		if(!mergedModel)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot merge the skeletal meshes. No imported model on the merged mesh?!"));
+			return false;
+		}
+
+		const FReferenceSkeleton& refSkeleton = mergedMesh->GetRefSkeleton();
+
+		TArray<FSkeletalMaterial> materials;
+		for(const FMergedSlot& mergedSlot : mergedSlots.Slots)
+		{
+			FSkeletalMaterial& material = materials.Add_GetRef(skeletalMeshes[mergedSlot.MeshIndex]->GetMaterials()[mergedSlot.SlotIndex]);
+			material.MaterialSlotName = mergedSlot.SlotName;
+		}
+		mergedMesh->GetMaterials() = materials;
+
+		// The first mesh's sections and material overrides move onto the combined slots too
+		const TArray<int32>& firstMeshSlots = mergedSlots.MeshSlots[0];
+		for(FSkeletalMeshLODModel& lodModel : mergedModel->LODModels)
+		{
+			for(FSkelMeshSection& section : lodModel.Sections)
+			{
+				section.MaterialIndex = static_cast<uint16>(firstMeshSlots[FMath::Clamp<int32>(section.MaterialIndex, 0, firstMeshSlots.Num() - 1)]);
+			}
+		}
+		for(int32 lodIndex = 0; lodIndex < mergedMesh->GetLODNum(); ++lodIndex)
+		{
+			if(FSkeletalMeshLODInfo* lodInfo = mergedMesh->GetLODInfo(lodIndex))
+			{
+				for(int32& materialIndex : lodInfo->LODMaterialMap)
+				{
+					if(firstMeshSlots.IsValidIndex(materialIndex))
+					{
+						materialIndex = firstMeshSlots[materialIndex];
+					}
+				}
+			}
+		}
+
+		TArray<UMorphTarget*>& morphTargets = mergedMesh->GetMorphTargets();
+		FBoxSphereBounds bounds = mergedMesh->GetImportedBounds();
+		for(int32 meshIndex = 1; meshIndex < skeletalMeshes.Num(); ++meshIndex)
+		{
+			USkeletalMesh* skeletalMesh = skeletalMeshes[meshIndex];
+			const FSkeletalMeshModel* skelMeshModel = skeletalMesh->GetImportedModel();
+			const TArray<int32>& meshSlots = mergedSlots.MeshSlots[meshIndex];
+			bounds = bounds + skeletalMesh->GetImportedBounds();
+
+			// Bones of this mesh in the merged reference skeleton, CanMergeSkeletalMeshes made sure the skinned ones are there
+			const FReferenceSkeleton& meshRefSkeleton = skeletalMesh->GetRefSkeleton();
+			TArray<int32> boneRemap;
+			boneRemap.SetNum(meshRefSkeleton.GetRawBoneNum());
+			for(int32 boneIndex = 0; boneIndex < boneRemap.Num(); ++boneIndex)
+			{
+				boneRemap[boneIndex] = refSkeleton.FindRawBoneIndex(meshRefSkeleton.GetBoneName(boneIndex));
+			}
+
+			// Where this mesh starts in each merged LOD, for its morph targets
+			TArray<uint32> lodBaseVertices;
+			TArray<int32> lodBaseSections;
+			for(int32 lodIndex = 0; lodIndex < mergedModel->LODModels.Num(); ++lodIndex)
+			{
+				FSkeletalMeshLODModel& lodModel = mergedModel->LODModels[lodIndex];
+				const FSkeletalMeshLODModel& sourceLODModel = skelMeshModel->LODModels[FMath::Min(lodIndex, skelMeshModel->LODModels.Num() - 1)];
+				const uint32 baseVertex = lodModel.NumVertices;
+				const int32 baseIndex = lodModel.IndexBuffer.Num();
+				const int32 baseSection = lodModel.Sections.Num();
+				lodBaseVertices.Add(baseVertex);
+				lodBaseSections.Add(baseSection);
+
+				for(const FSkelMeshSection& sourceSection : sourceLODModel.Sections)
+				{
+					const int32 sectionIndex = lodModel.Sections.Add(sourceSection);
+					FSkelMeshSection& section = lodModel.Sections[sectionIndex];
+					section.MaterialIndex = static_cast<uint16>(meshSlots[FMath::Clamp<int32>(sourceSection.MaterialIndex, 0, meshSlots.Num() - 1)]);
+					section.BaseIndex = baseIndex + sourceSection.BaseIndex;
+					section.BaseVertexIndex = baseVertex + sourceSection.BaseVertexIndex;
+					section.OriginalDataSectionIndex = sectionIndex;
+					if(section.ChunkedParentSectionIndex != INDEX_NONE)
+					{
+						section.ChunkedParentSectionIndex += baseSection;
+					}
+					for(FBoneIndexType& boneIndex : section.BoneMap)
+					{
+						boneIndex = static_cast<FBoneIndexType>(boneRemap[boneIndex]);
+					}
+				}
+
+				lodModel.IndexBuffer.AddUninitialized(sourceLODModel.IndexBuffer.Num());
+				SectionedUVCore::RebaseIndices(sourceLODModel.IndexBuffer.GetData(), sourceLODModel.IndexBuffer.Num(), baseVertex, lodModel.IndexBuffer.GetData() + baseIndex);
+				lodModel.NumVertices += sourceLODModel.NumVertices;
+				lodModel.NumTexCoords = FMath::Max(lodModel.NumTexCoords, sourceLODModel.NumTexCoords);
+
+				// Keep the import vertex map lined up with the vertices, the appended ones come after every imported point
+				if(lodModel.MeshToImportVertexMap.Num())
+				{
+					const int32 baseImportVertex = lodModel.MaxImportVertex + 1;
+					const bool bHasImportMap = sourceLODModel.MeshToImportVertexMap.Num() == static_cast<int32>(sourceLODModel.NumVertices);
+					for(uint32 vertexIndex = 0; vertexIndex < sourceLODModel.NumVertices; ++vertexIndex)
+					{
+						lodModel.MeshToImportVertexMap.Add(bHasImportMap ? baseImportVertex + sourceLODModel.MeshToImportVertexMap[vertexIndex] : INDEX_NONE);
+					}
+					lodModel.MaxImportVertex = baseImportVertex + sourceLODModel.MaxImportVertex;
+				}
+
+				// The bones the new sections need evaluated, in the parent before child order of the reference skeleton
+				for(const FBoneIndexType boneIndex : sourceLODModel.RequiredBones)
+				{
+					if(boneRemap[boneIndex] != INDEX_NONE)
+					{
+						lodModel.RequiredBones.AddUnique(static_cast<FBoneIndexType>(boneRemap[boneIndex]));
+					}
+				}
+				for(const FBoneIndexType boneIndex : sourceLODModel.ActiveBoneIndices)
+				{
+					if(boneRemap[boneIndex] != INDEX_NONE)
+					{
+						lodModel.ActiveBoneIndices.AddUnique(static_cast<FBoneIndexType>(boneRemap[boneIndex]));
+					}
+				}
+				lodModel.RequiredBones.Sort();
+				lodModel.ActiveBoneIndices.Sort();
+			}
+
+			// Morph targets with the same name drive all of the parts, a blink on the head and lashes stays one curve
+			for(UMorphTarget* sourceMorphTarget : skeletalMesh->GetMorphTargets())
+			{
+				if(!sourceMorphTarget)
+				{
+					continue;
+				}
+
+				UMorphTarget** existingMorphTarget = morphTargets.FindByPredicate([sourceMorphTarget](const UMorphTarget* morphTarget)
+				{
+					return morphTarget && morphTarget->GetFName() == sourceMorphTarget->GetFName();
+				});
+				UMorphTarget* morphTarget = existingMorphTarget ? *existingMorphTarget : nullptr;
+				if(!morphTarget)
+				{
+					morphTarget = NewObject<UMorphTarget>(mergedMesh, sourceMorphTarget->GetFName());
+					morphTarget->BaseSkelMesh = mergedMesh;
+					morphTargets.Add(morphTarget);
+				}
+
+				TArray<FMorphTargetLODModel>& morphLODModels = GetMorphLODModels(morphTarget);
+				const TArray<FMorphTargetLODModel>& sourceMorphLODModels = GetMorphLODModels(sourceMorphTarget);
+				if(morphLODModels.Num() < mergedModel->LODModels.Num())
+				{
+					morphLODModels.SetNum(mergedModel->LODModels.Num());
+				}
+
+				for(int32 lodIndex = 0; lodIndex < mergedModel->LODModels.Num(); ++lodIndex)
+				{
+					const int32 sourceLODIndex = FMath::Min(lodIndex, skelMeshModel->LODModels.Num() - 1);
+					if(!sourceMorphLODModels.IsValidIndex(sourceLODIndex))
+					{
+						continue;
+					}
+
+					const FMorphTargetLODModel& sourceMorphLODModel = sourceMorphLODModels[sourceLODIndex];
+					FMorphTargetLODModel& morphLODModel = morphLODModels[lodIndex];
+					const int32 firstDelta = morphLODModel.Vertices.Num();
+					morphLODModel.Vertices.Append(sourceMorphLODModel.Vertices);
+					for(int32 deltaIndex = firstDelta; deltaIndex < morphLODModel.Vertices.Num(); ++deltaIndex)
+					{
+						morphLODModel.Vertices[deltaIndex].SourceIdx += lodBaseVertices[lodIndex];
+					}
+					for(const int32 sectionIndex : sourceMorphLODModel.SectionIndices)
+					{
+						morphLODModel.SectionIndices.AddUnique(lodBaseSections[lodIndex] + sectionIndex);
+					}
+				}
+			}
+		}
+
+		for(UMorphTarget* morphTarget : morphTargets)
+		{
+			if(!morphTarget)
+			{
+				continue;
+			}
+
+			TArray<FMorphTargetLODModel>& morphLODModels = GetMorphLODModels(morphTarget);
+			for(int32 lodIndex = 0; lodIndex < morphLODModels.Num() && lodIndex < mergedModel->LODModels.Num(); ++lodIndex)
+			{
+				morphLODModels[lodIndex].NumBaseMeshVerts = mergedModel->LODModels[lodIndex].NumVertices;
+			}
+		}
+
+		mergedMesh->SetImportedBounds(bounds);
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	bool AppendStaticMeshes(UStaticMesh* mergedMesh, const TArray<UStaticMesh*>& staticMeshes, const TArray<FTransform>& transforms, const FMergedSlots& mergedSlots)
+	{
+		// The slot names the polygon groups of each mesh refer to
+		TArray<TArray<FName>> meshImportedSlotNames;
+		for(UStaticMesh* staticMesh : staticMeshes)
+		{
+			TArray<FName>& importedSlotNames = meshImportedSlotNames.AddDefaulted_GetRef();
+			for(const FStaticMaterial& material : staticMesh->GetStaticMaterials())
+			{
+				importedSlotNames.Add(material.ImportedMaterialSlotName);
+			}
+		}
+
+		TArray<FStaticMaterial> materials;
+		for(const FMergedSlot& mergedSlot : mergedSlots.Slots)
+		{
+			FStaticMaterial& material = materials.Add_GetRef(staticMeshes[mergedSlot.MeshIndex]->GetStaticMaterials()[mergedSlot.SlotIndex]);
+			material.MaterialSlotName = mergedSlot.SlotName;
+			material.ImportedMaterialSlotName = mergedSlot.SlotName;
+		}
+
+		FMeshSectionInfoMap& sectionInfoMap = mergedMesh->GetSectionInfoMap();
+		sectionInfoMap.Clear();
+		for(int32 sourceModelIndex = 0; sourceModelIndex < mergedMesh->GetNumSourceModels(); ++sourceModelIndex)
+		{
+			// Reduced LODs have no description of their own and get generated from the merged LOD 0
+			if(!mergedMesh->GetMeshDescription(sourceModelIndex))
+			{
+				continue;
+			}
+
+			// Meshes missing this LOD use their closest lower LOD with a description
+			TArray<const FMeshDescription*> meshDescriptions;
+			int32 numUVChannels = 1;
+			for(UStaticMesh* staticMesh : staticMeshes)
+			{
+				const FMeshDescription* meshDescription = nullptr;
+				for(int32 meshSourceModel = FMath::Min(sourceModelIndex, staticMesh->GetNumSourceModels() - 1); meshSourceModel >= 0 && !meshDescription; --meshSourceModel)
+				{
+					meshDescription = staticMesh->GetMeshDescription(meshSourceModel);
+				}
+
+				if(!meshDescription)
+				{
+					UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot merge the static meshes. '%s' has no mesh description!"), *staticMesh->GetPathName());
+					return false;
+				}
+				meshDescriptions.Add(meshDescription);
+				numUVChannels = FMath::Max(numUVChannels, FStaticMeshConstAttributes(*meshDescription).GetVertexInstanceUVs().GetNumChannels());
+			}
+
+			FMeshDescription mergedDescription;
+			FStaticMeshAttributes mergedAttributes(mergedDescription);
+			mergedAttributes.Register();
+			while(mergedAttributes.GetVertexInstanceUVs().GetNumChannels() < numUVChannels)
+			{
+				if(!FStaticMeshOperations::AddUVChannel(mergedDescription))
+				{
+					break;
+				}
+			}
+
+			for(int32 meshIndex = 0; meshIndex < meshDescriptions.Num(); ++meshIndex)
+			{
+				const TArray<FName>& importedSlotNames = meshImportedSlotNames[meshIndex];
+				const TArray<int32>& meshSlots = mergedSlots.MeshSlots[meshIndex];
+
+				FStaticMeshOperations::FAppendSettings appendSettings;
+				if(transforms.IsValidIndex(meshIndex))
+				{
+					appendSettings.MeshTransform = transforms[meshIndex];
+				}
+
+				// Polygon groups go into the group of their combined slot, the default would merge any groups sharing a slot name
+				appendSettings.PolygonGroupsDelegate = FAppendPolygonGroupsDelegate::CreateLambda([&](const FMeshDescription& sourceMesh, FMeshDescription& targetMesh, PolygonGroupMap& remapPolygonGroups)
+				{
+					TPolygonGroupAttributesConstRef<FName> sourceSlotNames = FStaticMeshConstAttributes(sourceMesh).GetPolygonGroupMaterialSlotNames();
+					TPolygonGroupAttributesRef<FName> targetSlotNames = FStaticMeshAttributes(targetMesh).GetPolygonGroupMaterialSlotNames();
+					for(const FPolygonGroupID groupID : sourceMesh.PolygonGroups().GetElementIDs())
+					{
+						// Same lookup the static mesh build uses, slot name first and the group index if that fails
+						int32 slotIndex = importedSlotNames.IndexOfByKey(sourceSlotNames[groupID]);
+						if(slotIndex == INDEX_NONE)
+						{
+							slotIndex = groupID.GetValue();
+						}
+						const FName slotName = mergedSlots.Slots[meshSlots[FMath::Clamp(slotIndex, 0, meshSlots.Num() - 1)]].SlotName;
+
+						FPolygonGroupID targetGroupID = FPolygonGroupID::Invalid;
+						for(const FPolygonGroupID candidateID : targetMesh.PolygonGroups().GetElementIDs())
+						{
+							if(targetSlotNames[candidateID] == slotName)
+							{
+								targetGroupID = candidateID;
+								break;
+							}
+						}
+						if(targetGroupID == FPolygonGroupID::Invalid)
+						{
+							targetGroupID = targetMesh.CreatePolygonGroup();
+							targetSlotNames[targetGroupID] = slotName;
+						}
+						remapPolygonGroups.Add(groupID, targetGroupID);
+					}
+				});
+
+				FStaticMeshOperations::AppendMeshDescription(*meshDescriptions[meshIndex], mergedDescription, appendSettings);
+			}
+
+			// One section per polygon group in order, like the build makes them
+			TPolygonGroupAttributesConstRef<FName> slotNames = mergedAttributes.GetPolygonGroupMaterialSlotNames();
+			int32 sectionIndex = 0;
+			for(const FPolygonGroupID groupID : mergedDescription.PolygonGroups().GetElementIDs())
+			{
+				FMeshSectionInfo sectionInfo;
+				sectionInfo.MaterialIndex = materials.IndexOfByPredicate([&](const FStaticMaterial& material) { return material.ImportedMaterialSlotName == slotNames[groupID]; });
+				sectionInfoMap.Set(sourceModelIndex, sectionIndex++, sectionInfo);
+			}
+
+			mergedMesh->CreateMeshDescription(sourceModelIndex, MoveTemp(mergedDescription));
+		}
+
+		mergedMesh->GetStaticMaterials() = materials;
+		mergedMesh->GetOriginalSectionInfoMap().CopyFrom(sectionInfoMap);
+		return true;
+	}
+}
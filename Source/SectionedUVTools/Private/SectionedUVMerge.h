@@ -0,0 +1,69 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UMaterialInterface;
+class USkeletalMesh;
+class UStaticMesh;
+
+/**
+ * Combines several meshes into one before sectioning. The first mesh is duplicated as usual and the others are
+ * appended onto the duplicate, the sectioning then runs over the combined material slots like it would on one mesh.
+ */
+namespace SectionedUVMerge
+{
+	/** Where a combined slot came from */
+	struct FMergedSlot
+	{
+		/** The mesh the slot was first seen on */
+		int32 MeshIndex = 0;
+
+		/** The slot on that mesh */
+		int32 SlotIndex = 0;
+
+		/** The name of the combined slot, the source name with a suffix if another material already took it */
+		FName SlotName;
+	};
+
+	/** The combined material slots of several meshes */
+	struct FMergedSlots
+	{
+		/** Each mesh's slots in order. Slots with the same name and material on different meshes are shared. */
+		TArray<FMergedSlot> Slots;
+
+		/** Per mesh, the combined slot each of its slots went into */
+		TArray<TArray<int32>> MeshSlots;
+	};
+
+	/** The slot names and materials of a static or skeletal mesh */
+	void GetMeshSlots(UObject* mesh, TArray<FName>& outSlotNames, TArray<UMaterialInterface*>& outMaterials);
+
+	/**
+	 * Lays out the combined slots of the meshes.
+	 * @param meshes Static or skeletal meshes, in merge order.
+	 */
+	void BuildMergedSlots(const TArray<UObject*>& meshes, FMergedSlots& outMergedSlots);
+
+	/**
+	 * Checks the skeletal meshes can be merged. They need a single skeleton, the first mesh's reference skeleton has to
+	 * hold every bone the others use and only the first mesh may have clothing.
+	 */
+	bool CanMergeSkeletalMeshes(const TArray<USkeletalMesh*>& skeletalMeshes);
+
+	/**
+	 * Appends the sections, materials and morph targets of the other meshes onto the duplicate of the first mesh.
+	 * LODs the other meshes are missing use their last LOD. Morph targets with the same name are combined into one.
+	 * @param mergedMesh The duplicate of skeletalMeshes[0].
+	 */
+	bool AppendSkeletalMeshes(USkeletalMesh* mergedMesh, const TArray<USkeletalMesh*>& skeletalMeshes, const FMergedSlots& mergedSlots);
+
+	/**
+	 * Rebuilds the mesh descriptions of the duplicate of the first mesh from every mesh placed at its transform.
+	 * LODs generated by reduction on the first mesh are left to be generated from the merged LOD 0.
+	 * @param mergedMesh The duplicate of staticMeshes[0].
+	 * @param transforms The transform of each mesh relative to the merged mesh, missing entries are the identity.
+	 */
+	bool AppendStaticMeshes(UStaticMesh* mergedMesh, const TArray<UStaticMesh*>& staticMeshes, const TArray<FTransform>& transforms, const FMergedSlots& mergedSlots);
+}
@@ -0,0 +1,443 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVReportCommandlet.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "Serialization/JsonWriter.h"
+#include "StaticMeshResources.h"
+#include "UObject/UObjectHash.h"
+
+namespace SectionedUVReportCommandlet
+{
+	/**
+	* How often a mesh is placed in the scanned maps
+	*/
+	struct FPlacements
+	{
+		/** Components drawing the mesh, each one costs its own draws */
+		int32 NumComponents = 0;
+		/** Instances drawn, an instanced component draws all of its instances with one draw per section */
+		int32 NumInstances = 0;
+	};
+
+	/**
+	* One LOD0 section, a draw of every placement of the mesh
+	*/
+	struct FSectionReport
+	{
+		int32 MaterialSlot = INDEX_NONE;
+		int32 NumTriangles = 0;
+		/** The sectioned slot the auto conversion merges it into, None if it keeps its own draw */
+		FName SectionedSlotName;
+	};
+
+	/**
+	* One row of the report
+	*/
+	struct FMeshReport
+	{
+		FString AssetPath;
+		FString Type;
+		int32 NumLODs = 0;
+		int32 NumSlots = 0;
+		int32 NumTriangles = 0;
+		TArray<FSectionReport> Sections;
+		/** LOD0 draws after an auto conversion */
+		int32 NumSectionedDraws = 0;
+		int32 NumMergedSlots = 0;
+		int32 NumSectionedSlots = 0;
+		FPlacements Placements;
+		/** Draws saved per placement times the placements, or per mesh when no maps were scanned */
+		int64 TotalDrawsSaved = 0;
+
+		int32 GetDrawsSaved() const
+		{
+			return Sections.Num() - NumSectionedDraws;
+		}
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Counts the static and skeletal mesh components of one map package, keyed by the mesh package name
+	*/
+	static void CountPlacements(UPackage* mapPackage, TMap<FName, FPlacements>& placements)
+	{
+		ForEachObjectWithOuter(mapPackage, [&placements](UObject* object)
+		{
+			if(object->HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+			{
+				return;
+			}
+
+			UObject* mesh = nullptr;
+			int32 numInstances = 1;
+			if(UStaticMeshComponent* staticMeshComponent = Cast<UStaticMeshComponent>(object))
+			{
+				mesh = staticMeshComponent->GetStaticMesh();
+				if(UInstancedStaticMeshComponent* instancedComponent = Cast<UInstancedStaticMeshComponent>(object))
+				{
+					numInstances = instancedComponent->GetInstanceCount();
+				}
+			}
+			else if(USkeletalMeshComponent* skeletalMeshComponent = Cast<USkeletalMeshComponent>(object))
+			{
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1)
+				mesh = skeletalMeshComponent->GetSkeletalMeshAsset();
+#else
+				mesh = skeletalMeshComponent->SkeletalMesh;
+#endif
+			}
+
+			if(mesh && numInstances > 0)
+			{
+				FPlacements& meshPlacements = placements.FindOrAdd(mesh->GetOutermost()->GetFName());
+				meshPlacements.NumComponents += 1;
+				meshPlacements.NumInstances += numInstances;
+			}
+		}, true);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Fills in the LOD0 sections of a mesh and the draws an auto conversion would leave
+	* @return False if the mesh has no LOD0 to report.
+	*/
+	static bool BuildMeshReport(UObject* mesh, FMeshReport& outReport)
+	{
+		if(USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(mesh))
+		{
+			FSkeletalMeshModel* skelMeshModel = skeletalMesh->GetImportedModel();
+			if(!skelMeshModel || !skelMeshModel->LODModels.Num())
+			{
+				return false;
+			}
+
+			outReport.Type = TEXT("Skeletal");
+			outReport.NumLODs = skelMeshModel->LODModels.Num();
+			outReport.NumSlots = skeletalMesh->GetMaterials().Num();
+			for(const FSkelMeshSection& section : skelMeshModel->LODModels[0].Sections)
+			{
+				if(!section.bDisabled)
+				{
+					FSectionReport& sectionReport = outReport.Sections.AddDefaulted_GetRef();
+					sectionReport.MaterialSlot = section.MaterialIndex;
+					sectionReport.NumTriangles = static_cast<int32>(section.NumTriangles);
+				}
+			}
+		}
+		else if(UStaticMesh* staticMesh = Cast<UStaticMesh>(mesh))
+		{
+			const FStaticMeshRenderData* renderData = staticMesh->GetRenderData();
+			if(!renderData || !renderData->LODResources.Num())
+			{
+				return false;
+			}
+
+			outReport.Type = TEXT("Static");
+			outReport.NumLODs = renderData->LODResources.Num();
+			outReport.NumSlots = staticMesh->GetStaticMaterials().Num();
+			for(const FStaticMeshSection& section : renderData->LODResources[0].Sections)
+			{
+				FSectionReport& sectionReport = outReport.Sections.AddDefaulted_GetRef();
+				sectionReport.MaterialSlot = section.MaterialIndex;
+				sectionReport.NumTriangles = static_cast<int32>(section.NumTriangles);
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		// Same grouping the auto conversion uses, so only slots that can share a material count as merged
+		TArray<int32> materialSlots;
+		TArray<FName> sectionedSlotNames;
+		USectionedUVToolsFunctionLibrary::GetAutoSectionedSlots(mesh, materialSlots, sectionedSlotNames);
+		outReport.NumMergedSlots = materialSlots.Num();
+
+		TSet<FName> drawnSectionedSlots;
+		for(FSectionReport& section : outReport.Sections)
+		{
+			outReport.NumTriangles += section.NumTriangles;
+			const int32 mergedIndex = materialSlots.Find(section.MaterialSlot);
+			if(mergedIndex == INDEX_NONE)
+			{
+				++outReport.NumSectionedDraws;
+				continue;
+			}
+
+			section.SectionedSlotName = sectionedSlotNames[mergedIndex];
+			bool bAlreadyDrawn = false;
+			drawnSectionedSlots.Add(section.SectionedSlotName, &bAlreadyDrawn);
+			outReport.NumSectionedDraws += bAlreadyDrawn ? 0 : 1;
+		}
+		outReport.NumSectionedSlots = drawnSectionedSlots.Num();
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The sections as "slot:triangles" separated by spaces, merged sections marked with their sectioned slot
+	*/
+	static FString GetSectionsString(const FMeshReport& report)
+	{
+		TArray<FString> sections;
+		for(const FSectionReport& section : report.Sections)
+		{
+			sections.Add(section.SectionedSlotName.IsNone() ? FString::Printf(TEXT("%d:%d"), section.MaterialSlot, section.NumTriangles)
+															: FString::Printf(TEXT("%d:%d>%s"), section.MaterialSlot, section.NumTriangles, *section.SectionedSlotName.ToString()));
+		}
+		return FString::Join(sections, TEXT(" "));
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static FString WriteCSV(const TArray<FMeshReport>& reports)
+	{
+		FString csv = TEXT("Asset,Type,LODs,Slots,Triangles,Draws,SectionedDraws,DrawsSaved,Placements,Instances,TotalDrawsSaved,MergedSlots,SectionedSlots,Sections\n");
+		for(const FMeshReport& report : reports)
+		{
+			csv += FString::Printf(TEXT("%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%lld,%d,%d,%s\n"),
+								   *report.AssetPath,
+								   *report.Type,
+								   report.NumLODs,
+								   report.NumSlots,
+								   report.NumTriangles,
+								   report.Sections.Num(),
+								   report.NumSectionedDraws,
+								   report.GetDrawsSaved(),
+								   report.Placements.NumComponents,
+								   report.Placements.NumInstances,
+								   report.TotalDrawsSaved,
+								   report.NumMergedSlots,
+								   report.NumSectionedSlots,
+								   *GetSectionsString(report));
+		}
+		return csv;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static FString WriteJSON(const TArray<FMeshReport>& reports)
+	{
+		FString json;
+		TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&json);
+		writer->WriteArrayStart();
+		for(const FMeshReport& report : reports)
+		{
+			writer->WriteObjectStart();
+			writer->WriteValue(TEXT("asset"), report.AssetPath);
+			writer->WriteValue(TEXT("type"), report.Type);
+			writer->WriteValue(TEXT("lods"), report.NumLODs);
+			writer->WriteValue(TEXT("slots"), report.NumSlots);
+			writer->WriteValue(TEXT("triangles"), report.NumTriangles);
+			writer->WriteValue(TEXT("draws"), report.Sections.Num());
+			writer->WriteValue(TEXT("sectionedDraws"), report.NumSectionedDraws);
+			writer->WriteValue(TEXT("drawsSaved"), report.GetDrawsSaved());
+			writer->WriteValue(TEXT("placements"), report.Placements.NumComponents);
+			writer->WriteValue(TEXT("instances"), report.Placements.NumInstances);
+			writer->WriteValue(TEXT("totalDrawsSaved"), report.TotalDrawsSaved);
+			writer->WriteValue(TEXT("mergedSlots"), report.NumMergedSlots);
+			writer->WriteValue(TEXT("sectionedSlots"), report.NumSectionedSlots);
+			writer->WriteArrayStart(TEXT("sections"));
+			for(const FSectionReport& section : report.Sections)
+			{
+				writer->WriteObjectStart();
+				writer->WriteValue(TEXT("slot"), section.MaterialSlot);
+				writer->WriteValue(TEXT("triangles"), section.NumTriangles);
+				writer->WriteValue(TEXT("sectionedSlot"), section.SectionedSlotName.IsNone() ? FString() : section.SectionedSlotName.ToString());
+				writer->WriteObjectEnd();
+			}
+			writer->WriteArrayEnd();
+			writer->WriteObjectEnd();
+		}
+		writer->WriteArrayEnd();
+		writer->Close();
+		return json;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVReportCommandlet::USectionedUVReportCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+int32 USectionedUVReportCommandlet::Main(const FString& Params)
+{
+	FString pathsParam;
+	FString mapsParam;
+	FString outputParam = FPaths::ProjectSavedDir() / TEXT("SectionedUVReport.csv");
+	FString typeParam = TEXT("All");
+	int32 batchSize = 32;
+	FParse::Value(*Params, TEXT("Paths="), pathsParam, false);
+	FParse::Value(*Params, TEXT("Maps="), mapsParam, false);
+	FParse::Value(*Params, TEXT("Output="), outputParam);
+	FParse::Value(*Params, TEXT("Type="), typeParam);
+	FParse::Value(*Params, TEXT("BatchSize="), batchSize);
+	batchSize = FMath::Max(batchSize, 1);
+
+	TArray<FString> paths;
+	TArray<FString> maps;
+	pathsParam.ParseIntoArray(paths, TEXT("+"));
+	mapsParam.ParseIntoArray(maps, TEXT("+"));
+	if(!paths.Num() && !maps.Num())
+	{
+		UE_LOG(LogSectionedUVTools, Error, TEXT("Nothing to report on. Usage: -run=SectionedUVReport [-Paths=/Game/Characters+/Game/Props] [-Maps=/Game/Maps/Town] [-Output=Report.csv|Report.json] [-Type=All|Skeletal|Static] [-BatchSize=32]"));
+		return 1;
+	}
+
+	const bool bSkeletal = typeParam == TEXT("All") || typeParam == TEXT("Skeletal");
+	const bool bStatic = typeParam == TEXT("All") || typeParam == TEXT("Static");
+
+	// Count the placements first, the meshes they use are reported along with the ones under the paths
+	TMap<FName, SectionedUVReportCommandlet::FPlacements> placements;
+	for(const FString& map : maps)
+	{
+		UPackage* mapPackage = LoadPackage(nullptr, *map, LOAD_None);
+		if(!mapPackage)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to load map '%s'."), *map);
+			return 1;
+		}
+		SectionedUVReportCommandlet::CountPlacements(mapPackage, placements);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	IAssetRegistry& assetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	assetRegistry.SearchAllAssets(true);
+
+	TSet<FName> packageNames;
+	placements.GetKeys(packageNames);
+	if(paths.Num())
+	{
+		FARFilter filter;
+		filter.bRecursivePaths = true;
+		for(const FString& path : paths)
+		{
+			filter.PackagePaths.Add(FName(*path));
+		}
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1)
+		filter.ClassPaths.Add(USkeletalMesh::StaticClass()->GetClassPathName());
+		filter.ClassPaths.Add(UStaticMesh::StaticClass()->GetClassPathName());
+#else
+		filter.ClassNames.Add(USkeletalMesh::StaticClass()->GetFName());
+		filter.ClassNames.Add(UStaticMesh::StaticClass()->GetFName());
+#endif
+
+		TArray<FAssetData> assets;
+		assetRegistry.GetAssets(filter, assets);
+		for(const FAssetData& assetData : assets)
+		{
+			packageNames.Add(assetData.PackageName);
+		}
+	}
+
+	TArray<FName> sortedPackageNames = packageNames.Array();
+	sortedPackageNames.Sort([](const FName& a, const FName& b)
+	{
+		return a.LexicalLess(b);
+	});
+	UE_LOG(LogSectionedUVTools, Display, TEXT("Found %d meshes to report on, %d placed in %d maps."), sortedPackageNames.Num(), placements.Num(), maps.Num());
+
+	TArray<SectionedUVReportCommandlet::FMeshReport> reports;
+	for(int32 batchStart = 0; batchStart < sortedPackageNames.Num(); batchStart += batchSize)
+	{
+		const int32 batchEnd = FMath::Min(batchStart + batchSize, sortedPackageNames.Num());
+		for(int32 packageIndex = batchStart; packageIndex < batchEnd; ++packageIndex)
+		{
+			LoadPackageAsync(sortedPackageNames[packageIndex].ToString());
+		}
+		FlushAsyncLoading();
+
+		for(int32 packageIndex = batchStart; packageIndex < batchEnd; ++packageIndex)
+		{
+			const FName packageName = sortedPackageNames[packageIndex];
+			TArray<FAssetData> packageAssets;
+			assetRegistry.GetAssetsByPackageName(packageName, packageAssets);
+			for(const FAssetData& assetData : packageAssets)
+			{
+				UObject* asset = assetData.GetAsset();
+				const bool bWantedType = (bSkeletal && Cast<USkeletalMesh>(asset)) || (bStatic && Cast<UStaticMesh>(asset));
+				if(!bWantedType || USectionedUVToolsFunctionLibrary::IsSectionedMesh(asset))
+				{
+					continue;
+				}
+
+				SectionedUVReportCommandlet::FMeshReport report;
+				report.AssetPath = packageName.ToString();
+				if(!SectionedUVReportCommandlet::BuildMeshReport(asset, report))
+				{
+					UE_LOG(LogSectionedUVTools, Warning, TEXT("'%s' has no LOD0 to report on, skipping."), *report.AssetPath);
+					continue;
+				}
+
+				report.Placements = placements.FindRef(packageName);
+				report.TotalDrawsSaved = static_cast<int64>(report.GetDrawsSaved()) * (maps.Num() ? report.Placements.NumComponents : 1);
+				reports.Add(MoveTemp(report));
+			}
+		}
+
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	// Biggest wins first
+	reports.Sort([](const SectionedUVReportCommandlet::FMeshReport& a, const SectionedUVReportCommandlet::FMeshReport& b)
+	{
+		if(a.TotalDrawsSaved != b.TotalDrawsSaved)
+		{
+			return a.TotalDrawsSaved > b.TotalDrawsSaved;
+		}
+		if(a.GetDrawsSaved() != b.GetDrawsSaved())
+		{
+			return a.GetDrawsSaved() > b.GetDrawsSaved();
+		}
+		return a.AssetPath < b.AssetPath;
+	});
+
+	const bool bJSON = FPaths::GetExtension(outputParam).Equals(TEXT("json"), ESearchCase::IgnoreCase);
+	const FString reportText = bJSON ? SectionedUVReportCommandlet::WriteJSON(reports) : SectionedUVReportCommandlet::WriteCSV(reports);
+	if(!FFileHelper::SaveStringToFile(reportText, *outputParam))
+	{
+		UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to write the report to '%s'."), *outputParam);
+		return 1;
+	}
+
+	// Summary
+	int64 totalDrawsSaved = 0;
+	int32 numCandidates = 0;
+	for(const SectionedUVReportCommandlet::FMeshReport& report : reports)
+	{
+		totalDrawsSaved += report.TotalDrawsSaved;
+		numCandidates += report.GetDrawsSaved() > 0 ? 1 : 0;
+	}
+
+	UE_LOG(LogSectionedUVTools, Display, TEXT("%12s %8s %8s %10s  %s"), TEXT("Total saved"), TEXT("Draws"), TEXT("After"), TEXT("Placements"), TEXT("Asset"));
+	for(int32 reportIndex = 0; reportIndex < reports.Num() && reportIndex < 20; ++reportIndex)
+	{
+		const SectionedUVReportCommandlet::FMeshReport& report = reports[reportIndex];
+		UE_LOG(LogSectionedUVTools, Display, TEXT("%12lld %8d %8d %10d  %s"), report.TotalDrawsSaved, report.Sections.Num(), report.NumSectionedDraws, report.Placements.NumComponents, *report.AssetPath);
+	}
+	UE_LOG(LogSectionedUVTools, Display, TEXT("%d of %d meshes would save draws, %lld draws saved in total. Report written to '%s'."),
+		   numCandidates, reports.Num(), totalDrawsSaved, *outputParam);
+	return 0;
+}
@@ -0,0 +1,300 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVStats.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+UE_TRACE_CHANNEL_DEFINE(SectionedUVChannel);
+
+TRACE_DECLARE_INT_COUNTER(SectionedUV_Vertices, TEXT("SectionedUV/Vertices"));
+TRACE_DECLARE_INT_COUNTER(SectionedUV_Indices, TEXT("SectionedUV/Indices"));
+TRACE_DECLARE_INT_COUNTER(SectionedUV_MorphDeltas, TEXT("SectionedUV/MorphDeltas"));
+TRACE_DECLARE_MEMORY_COUNTER(SectionedUV_BytesAllocated, TEXT("SectionedUV/BytesAllocated"));
+
+namespace SectionedUVStats
+{
+	/** The conversion each thread counts into, see FConversionScope */
+	static thread_local FConversion* CurrentConversion = nullptr;
+	static FSectionedUVConversionStats LastConversionStats;
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FConversion::Begin()
+	{
+		for(std::atomic<uint64>& cycles : StageCycles)
+		{
+			cycles = 0;
+		}
+		NumVertices = 0;
+		NumIndices = 0;
+		NumMorphDeltas = 0;
+		BytesAllocated = 0;
+		RenderVertices = 0;
+		VertexBufferBytes = 0;
+		IndexBufferBytes = 0;
+		StartSeconds = FPlatformTime::Seconds();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static float GetStageSeconds(const FConversion& conversion, const EStage stage)
+	{
+		return static_cast<float>(FPlatformTime::ToSeconds64(conversion.StageCycles[static_cast<int32>(stage)]));
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FConversion::End(const bool bSucceeded, const bool bUpToDate)
+	{
+		FSectionedUVConversionStats& stats = LastConversionStats;
+		stats.bSucceeded = bSucceeded;
+		stats.bUpToDate = bUpToDate;
+		stats.TotalSeconds = static_cast<float>(FPlatformTime::Seconds() - StartSeconds);
+		stats.HashSeconds = GetStageSeconds(*this, EStage::Hash);
+		stats.DuplicateSeconds = GetStageSeconds(*this, EStage::Duplicate);
+		stats.AppendSeconds = GetStageSeconds(*this, EStage::Append);
+		stats.SlotRemapSeconds = GetStageSeconds(*this, EStage::SlotRemap);
+		stats.SectionMergeSeconds = GetStageSeconds(*this, EStage::SectionMerge);
+		stats.SectionRemovalSeconds = GetStageSeconds(*this, EStage::SectionRemoval);
+		stats.OptimizeSeconds = GetStageSeconds(*this, EStage::Optimize);
+		stats.MorphFixupSeconds = GetStageSeconds(*this, EStage::MorphFixup);
+		stats.BuildSeconds = GetStageSeconds(*this, EStage::Build);
+		stats.InitMorphTargetsSeconds = GetStageSeconds(*this, EStage::InitMorphTargets);
+		stats.NumVertices = NumVertices;
+		stats.NumIndices = NumIndices;
+		stats.NumMorphDeltas = NumMorphDeltas;
+		stats.BytesAllocated = BytesAllocated;
+		stats.VertexBufferBytes = VertexBufferBytes;
+		stats.IndexBufferBytes = IndexBufferBytes;
+		stats.BytesPerVertex = RenderVertices > 0 ? static_cast<float>(static_cast<double>(stats.VertexBufferBytes) / RenderVertices) : 0.0f;
+
+		// The trace counters are not thread safe, they only step once per conversion from here
+		TRACE_COUNTER_SET(SectionedUV_Vertices, stats.NumVertices);
+		TRACE_COUNTER_SET(SectionedUV_Indices, stats.NumIndices);
+		TRACE_COUNTER_SET(SectionedUV_MorphDeltas, stats.NumMorphDeltas);
+		TRACE_COUNTER_SET(SectionedUV_BytesAllocated, stats.BytesAllocated);
+
+		UE_LOG(LogSectionedUVTools, Verbose, TEXT("Conversion took %.3fs: hash %.3fs, duplicate %.3fs, append %.3fs, slot remap %.3fs, section merge %.3fs, section removal %.3fs, optimize %.3fs, morph fixup %.3fs, build %.3fs, init morph targets %.3fs. %lld vertices, %lld indices, %lld morph deltas, %.2f MB allocated. Render data %.2f MB of vertices at %.1f bytes each, %.2f MB of indices."),
+			   stats.TotalSeconds, stats.HashSeconds, stats.DuplicateSeconds, stats.AppendSeconds, stats.SlotRemapSeconds, stats.SectionMergeSeconds, stats.SectionRemovalSeconds,
+			   stats.OptimizeSeconds, stats.MorphFixupSeconds, stats.BuildSeconds, stats.InitMorphTargetsSeconds,
+			   stats.NumVertices, stats.NumIndices, stats.NumMorphDeltas, stats.BytesAllocated / (1024.0 * 1024.0),
+			   stats.VertexBufferBytes / (1024.0 * 1024.0), stats.BytesPerVertex, stats.IndexBufferBytes / (1024.0 * 1024.0));
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FConversionScope::FConversionScope(FConversion* conversion)
+		: PreviousConversion(CurrentConversion)
+	{
+		CurrentConversion = conversion;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FConversionScope::~FConversionScope()
+	{
+		CurrentConversion = PreviousConversion;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FConversion* GetCurrentConversion()
+	{
+		return CurrentConversion;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	const FSectionedUVConversionStats& GetLastConversionStats()
+	{
+		return LastConversionStats;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void AddVertices(const int64 numVertices)
+	{
+		if(CurrentConversion)
+		{
+			CurrentConversion->NumVertices += numVertices;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void AddIndices(const int64 numIndices)
+	{
+		if(CurrentConversion)
+		{
+			CurrentConversion->NumIndices += numIndices;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void AddMorphDeltas(const int64 numMorphDeltas)
+	{
+		if(CurrentConversion)
+		{
+			CurrentConversion->NumMorphDeltas += numMorphDeltas;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void AddBytesAllocated(const int64 numBytes)
+	{
+		if(CurrentConversion)
+		{
+			CurrentConversion->BytesAllocated += numBytes;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void AddRenderData(const int64 numVertices, const int64 vertexBufferBytes, const int64 indexBufferBytes)
+	{
+		if(CurrentConversion)
+		{
+			CurrentConversion->RenderVertices += numVertices;
+			CurrentConversion->VertexBufferBytes += vertexBufferBytes;
+			CurrentConversion->IndexBufferBytes += indexBufferBytes;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The trace event type of each stage, registered once
+	*/
+	static uint32 GetStageEventType(const EStage stage)
+	{
+		static const TArray<uint32> eventTypes = []()
+		{
+			static const TCHAR* stageNames[] =
+			{
+				TEXT("SectionedUV_Hash"),
+				TEXT("SectionedUV_Duplicate"),
+				TEXT("SectionedUV_Append"),
+				TEXT("SectionedUV_SlotRemap"),
+				TEXT("SectionedUV_SectionMerge"),
+				TEXT("SectionedUV_SectionRemoval"),
+				TEXT("SectionedUV_Optimize"),
+				TEXT("SectionedUV_MorphFixup"),
+				TEXT("SectionedUV_Build"),
+				TEXT("SectionedUV_InitMorphTargets"),
+			};
+			static_assert(UE_ARRAY_COUNT(stageNames) == static_cast<int32>(EStage::Num), "Every stage needs a trace name");
+
+			TArray<uint32> types;
+			for(const TCHAR* stageName : stageNames)
+			{
+				types.Add(FCpuProfilerTrace::OutputEventType(stageName));
+			}
+			return types;
+		}();
+		return eventTypes[static_cast<int32>(stage)];
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FStageTimer::FStageTimer(const EStage stage)
+		: Stage(stage)
+	{
+		Begin(stage);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FStageTimer::~FStageTimer()
+	{
+		Stop();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FStageTimer::Next(const EStage stage)
+	{
+		Stop();
+		Begin(stage);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FStageTimer::Begin(const EStage stage)
+	{
+		Stage = stage;
+		Conversion = CurrentConversion;
+		bRunning = true;
+		bTraced = UE_TRACE_CHANNELEXPR_IS_ENABLED(SectionedUVChannel);
+		if(bTraced)
+		{
+			FCpuProfilerTrace::OutputBeginEvent(GetStageEventType(stage));
+		}
+		StartCycles = FPlatformTime::Cycles64();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FStageTimer::Stop()
+	{
+		if(!bRunning)
+		{
+			return;
+		}
+
+		bRunning = false;
+		if(Conversion)
+		{
+			Conversion->StageCycles[static_cast<int32>(Stage)] += FPlatformTime::Cycles64() - StartCycles;
+		}
+		if(bTraced)
+		{
+			FCpuProfilerTrace::OutputEndEvent();
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FScopedConversion::FScopedConversion()
+		: Scope(&Conversion)
+	{
+		Conversion.Begin();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	FScopedConversion::~FScopedConversion()
+	{
+		Conversion.End(bSucceeded, bUpToDate);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	void FScopedConversion::Finish(const bool bInUpToDate)
+	{
+		bSucceeded = true;
+		bUpToDate = bInUpToDate;
+	}
+}
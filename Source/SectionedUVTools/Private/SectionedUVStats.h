@@ -0,0 +1,144 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include <atomic>
+
+struct FSectionedUVConversionStats;
+
+/** Trace channel of the conversion scopes, enable it with -trace=cpu,SectionedUV */
+UE_TRACE_CHANNEL_EXTERN(SectionedUVChannel);
+
+/**
+ * Times the stages of a conversion and counts the data it touches. Stages show up as CPU scopes on the SectionedUV
+ * trace channel in Insights and are summed into the stats of the last conversion. LODs and morph targets are converted
+ * in parallel, so stage times are summed over threads. Every conversion counts into its own FConversion, so blocking
+ * and async conversions can run at the same time.
+ */
+namespace SectionedUVStats
+{
+	enum class EStage : uint8
+	{
+		Hash,
+		Duplicate,
+		Append,
+		SlotRemap,
+		SectionMerge,
+		SectionRemoval,
+		Optimize,
+		MorphFixup,
+		Build,
+		InitMorphTargets,
+		Num
+	};
+
+	/**
+	 * The counters and stage times of one conversion. The counters and stage timers count into the conversion of their
+	 * thread, see FConversionScope.
+	 */
+	class FConversion
+	{
+	public:
+		/** Clears the counters, called as the conversion starts */
+		void Begin();
+
+		/** Fills in the stats of the last conversion from the counters. Game thread only. */
+		void End(bool bSucceeded, bool bUpToDate);
+
+		std::atomic<uint64> StageCycles[static_cast<int32>(EStage::Num)];
+		std::atomic<int64> NumVertices{0};
+		std::atomic<int64> NumIndices{0};
+		std::atomic<int64> NumMorphDeltas{0};
+		std::atomic<int64> BytesAllocated{0};
+		std::atomic<int64> RenderVertices{0};
+		std::atomic<int64> VertexBufferBytes{0};
+		std::atomic<int64> IndexBufferBytes{0};
+		double StartSeconds = 0.0;
+	};
+
+	/**
+	 * Makes the counters and stage timers of the calling thread count into a conversion until it goes out of scope.
+	 * Scopes nest, work handed to other threads opens its own.
+	 */
+	class FConversionScope
+	{
+	public:
+		explicit FConversionScope(FConversion* conversion);
+		~FConversionScope();
+
+	private:
+		FConversion* PreviousConversion;
+	};
+
+	/** The conversion the calling thread counts into, nullptr if it is not converting */
+	FConversion* GetCurrentConversion();
+
+	/** The stats of the last finished conversion */
+	const FSectionedUVConversionStats& GetLastConversionStats();
+
+	/**
+	 * Counters, safe to call from any thread. They count into the conversion of the calling thread and also feed the
+	 * Insights counters of the same name.
+	 */
+	void AddVertices(int64 numVertices);
+	void AddIndices(int64 numIndices);
+	void AddMorphDeltas(int64 numMorphDeltas);
+	void AddBytesAllocated(int64 numBytes);
+
+	/** Adds one LOD of the rebuilt render data, what the converted mesh costs on the GPU */
+	void AddRenderData(int64 numVertices, int64 vertexBufferBytes, int64 indexBufferBytes);
+
+	/**
+	 * Times a stage until it goes out of scope or the next stage starts, so stages running back to back in one
+	 * function do not each need their own scope. Traced as a CPU scope named SectionedUV_<stage>.
+	 */
+	class FStageTimer
+	{
+	public:
+		explicit FStageTimer(EStage stage);
+		~FStageTimer();
+
+		/** Ends the current stage and starts timing the next one */
+		void Next(EStage stage);
+
+		/** Ends the current stage without starting another, before handing work to other threads which time themselves */
+		void Stop();
+
+	private:
+		void Begin(EStage stage);
+
+		EStage Stage;
+		FConversion* Conversion = nullptr;
+		uint64 StartCycles = 0;
+		bool bRunning = false;
+		bool bTraced = false;
+	};
+
+	/**
+	 * Begins a blocking conversion for its lifetime and counts the calling thread into it, the conversion ends with
+	 * whatever Finish recorded when it goes out of scope.
+	 */
+	class FScopedConversion
+	{
+	public:
+		FScopedConversion();
+		~FScopedConversion();
+
+		/** The conversion produced a mesh, bUpToDate if it was the existing one */
+		void Finish(bool bUpToDate = false);
+
+		FConversion* Get() { return &Conversion; }
+
+	private:
+		FConversion Conversion;
+		FConversionScope Scope;
+		bool bSucceeded = false;
+		bool bUpToDate = false;
+	};
+}
+
+/** Times the rest of the scope as one of the SectionedUVStats::EStage stages, in Insights and the conversion stats */
+#define SECTIONEDUV_STAGE_SCOPE(StageName) \
+	const SectionedUVStats::FStageTimer PREPROCESSOR_JOIN(stageTimer, __LINE__)(SectionedUVStats::EStage::StageName)
@@ -0,0 +1,207 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVTextureArrays.h"
+#include "SectionedUVAssetUserData.h"
+#include "SectionedUVBake.h"
+#include "SectionedUVCache.h"
+#include "SectionedUVMerge.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "SectionedUVCore.h"
+#include "Engine/Texture2DArray.h"
+#include "Materials/MaterialInstanceConstant.h"
+#include "Misc/PackageName.h"
+
+namespace SectionedUVTextureArrays
+{
+	const FName BaseColorParameterName = FName("BaseColorArray");
+	const FName NormalParameterName = FName("NormalArray");
+	const FName ORMParameterName = FName("ORMArray");
+	static const FName NumSectionsParameterName = FName("NumSections");
+	static const FName NumRowsParameterName = FName("NumRows");
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The material of every slot the sectioned mesh's slot indices refer to, the combined slots for a merged mesh
+	*/
+	static bool GetSourceSlotMaterials(const USectionedUVAssetUserData* userData, TArray<UMaterialInterface*>& outSlotMaterials)
+	{
+		TArray<UObject*> meshes;
+		meshes.Add(userData->SourceMesh.LoadSynchronous());
+		for(const TSoftObjectPtr<UObject>& mergedMesh : userData->MergedMeshes)
+		{
+			meshes.Add(mergedMesh.LoadSynchronous());
+		}
+
+		if(meshes.Contains(nullptr))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. A mesh the sectioned mesh was made from could not be loaded!"));
+			return false;
+		}
+
+		TArray<TArray<UMaterialInterface*>> meshMaterials;
+		for(UObject* mesh : meshes)
+		{
+			TArray<FName> slotNames;
+			SectionedUVMerge::GetMeshSlots(mesh, slotNames, meshMaterials.AddDefaulted_GetRef());
+		}
+
+		if(meshes.Num() == 1)
+		{
+			outSlotMaterials = meshMaterials[0];
+			return true;
+		}
+
+		SectionedUVMerge::FMergedSlots mergedSlots;
+		SectionedUVMerge::BuildMergedSlots(meshes, mergedSlots);
+		for(const SectionedUVMerge::FMergedSlot& mergedSlot : mergedSlots.Slots)
+		{
+			outSlotMaterials.Add(meshMaterials[mergedSlot.MeshIndex][mergedSlot.SlotIndex]);
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Per UV section of the sectioned slot, the source material which was merged into it. The slot mapping is rebuilt the
+	* same way the conversion built it so the layers line up with the sections written into the mesh.
+	*/
+	static bool GetSectionMaterials(const USectionedUVAssetUserData* userData, const FName sectionedSlotName, TArray<UMaterialInterface*>& outSectionMaterials)
+	{
+		TArray<UMaterialInterface*> slotMaterials;
+		if(!GetSourceSlotMaterials(userData, slotMaterials))
+		{
+			return false;
+		}
+
+		TArray<FName> groupSlotNames;
+		TArray<int32> slotGroups;
+		for(const FName slotName : userData->SectionedSlotNames)
+		{
+			slotGroups.Add(groupSlotNames.AddUnique(slotName));
+		}
+
+		const int32 group = groupSlotNames.Find(sectionedSlotName);
+		if(group == INDEX_NONE || slotGroups.Num() != userData->MaterialSlots.Num())
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. The mesh has no '%s' sectioned slot!"), *sectionedSlotName.ToString());
+			return false;
+		}
+
+		SectionedUVCore::FSlotMapping slotMapping;
+		if(!SectionedUVCore::BuildGroupedSlotMapping(slotMaterials.Num(), userData->MaterialSlots.GetData(), slotGroups.GetData(), userData->MaterialSlots.Num(), slotMapping))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. The source mesh slots changed since it was sectioned, convert it again first!"));
+			return false;
+		}
+
+		// Far LODs merging every slot put the other slots in the first sectioned slot's sections after its own
+		if(userData->MergeAllFromLOD != INDEX_NONE && group == 0)
+		{
+			SectionedUVCore::FSlotMapping collapsedMapping;
+			SectionedUVCore::BuildCollapsedSlotMapping(slotMapping, collapsedMapping);
+			slotMapping = MoveTemp(collapsedMapping);
+		}
+
+		for(int32 materialSlot = 0; materialSlot < slotMaterials.Num(); ++materialSlot)
+		{
+			if(SectionedUVCore::GetSlotGroup(slotMapping, materialSlot) == group)
+			{
+				const int32 uvSection = SectionedUVCore::GetUVSection(slotMapping, materialSlot);
+				outSectionMaterials.SetNum(FMath::Max(outSectionMaterials.Num(), uvSection + 1));
+				outSectionMaterials[uvSection] = slotMaterials[materialSlot];
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	UMaterialInstanceConstant* CreateTextureArrayMaterial(UObject* sectionedMesh, UMaterialInterface* parentMaterial, FName sectionedSlotName, const int32 textureSize)
+	{
+		USectionedUVAssetUserData* userData = SectionedUVCache::GetSectionedUserData(sectionedMesh);
+		if(!userData || !parentMaterial)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. Pass a mesh made by the sectioned UV tools and a parent material!"));
+			return nullptr;
+		}
+
+		if(userData->bAtlased)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. '%s' already samples an atlas through UV0, convert the source mesh without an atlas first!"), *sectionedMesh->GetPathName());
+			return nullptr;
+		}
+
+		if(textureSize < 4 || textureSize > 8192 || !FMath::IsPowerOfTwo(textureSize))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. The texture size should be a power of two between 4 and 8192."));
+			return nullptr;
+		}
+
+		if(sectionedSlotName.IsNone() && userData->SectionedSlotNames.Num())
+		{
+			sectionedSlotName = userData->SectionedSlotNames[0];
+		}
+
+		TArray<UMaterialInterface*> sectionMaterials;
+		if(!GetSectionMaterials(userData, sectionedSlotName, sectionMaterials))
+		{
+			return nullptr;
+		}
+
+		// All layers of a texture array source sit in one array, which has to be able to index every texel
+		const int32 numLayers = sectionMaterials.Num();
+		const int64 layerTexels = static_cast<int64>(textureSize) * textureSize;
+		const int64 numTexels = layerTexels * numLayers;
+		if(numTexels > MAX_int32)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot bake the sectioned materials. %d layers of %dx%d do not fit in a texture array, lower the texture size!"), numLayers, textureSize, textureSize);
+			return nullptr;
+		}
+
+		// Every layer is baked on its own and copied into its slice of the texture array sources
+		TArray<FColor> baseColorLayers;
+		TArray<FColor> normalLayers;
+		TArray<FColor> ormLayers;
+		baseColorLayers.SetNumUninitialized(static_cast<int32>(numTexels));
+		normalLayers.SetNumUninitialized(static_cast<int32>(numTexels));
+		ormLayers.SetNumUninitialized(static_cast<int32>(numTexels));
+		for(int32 layerIndex = 0; layerIndex < numLayers; ++layerIndex)
+		{
+			SectionedUVBake::FBakedMaterial baked;
+			SectionedUVBake::BakeMaterial(sectionMaterials[layerIndex], textureSize, textureSize, baked);
+			const int64 layerOffset = layerIndex * layerTexels;
+			FMemory::Memcpy(baseColorLayers.GetData() + layerOffset, baked.BaseColor.GetData(), layerTexels * sizeof(FColor));
+			FMemory::Memcpy(normalLayers.GetData() + layerOffset, baked.Normal.GetData(), layerTexels * sizeof(FColor));
+			FMemory::Memcpy(ormLayers.GetData() + layerOffset, baked.ORM.GetData(), layerTexels * sizeof(FColor));
+		}
+
+		const FString packagePath = FPackageName::GetLongPackagePath(sectionedMesh->GetPackage()->GetName());
+		const FString baseName = sectionedMesh->GetName() + TEXT("_") + sectionedSlotName.ToString();
+		UClass* textureArrayClass = UTexture2DArray::StaticClass();
+		UTexture* baseColorArray = SectionedUVBake::WriteTexture(textureArrayClass, packagePath, TEXT("T_") + baseName + TEXT("_BaseColor"), textureSize, textureSize, numLayers, baseColorLayers, true, TC_Default);
+		UTexture* normalArray = SectionedUVBake::WriteTexture(textureArrayClass, packagePath, TEXT("T_") + baseName + TEXT("_Normal"), textureSize, textureSize, numLayers, normalLayers, false, TC_Normalmap);
+		UTexture* ormArray = SectionedUVBake::WriteTexture(textureArrayClass, packagePath, TEXT("T_") + baseName + TEXT("_ORM"), textureSize, textureSize, numLayers, ormLayers, false, TC_Masks);
+		if(!baseColorArray || !normalArray || !ormArray)
+		{
+			return nullptr;
+		}
+
+		TMap<FName, UTexture*> textureParameters;
+		textureParameters.Add(BaseColorParameterName, baseColorArray);
+		textureParameters.Add(NormalParameterName, normalArray);
+		textureParameters.Add(ORMParameterName, ormArray);
+		TMap<FName, float> scalarParameters;
+		scalarParameters.Add(NumSectionsParameterName, static_cast<float>(userData->NumSections));
+		scalarParameters.Add(NumRowsParameterName, static_cast<float>(userData->NumRows));
+		UMaterialInstanceConstant* materialInstance = SectionedUVBake::WriteMaterialInstance(packagePath, TEXT("MI_") + baseName, parentMaterial, textureParameters, scalarParameters);
+		if(!materialInstance)
+		{
+			return nullptr;
+		}
+
+		SectionedUVBake::AssignSlotMaterial(sectionedMesh, sectionedSlotName, materialInstance);
+		UE_LOG(LogSectionedUVTools, Log, TEXT("Baked %d sections of '%s' into %dx%d texture arrays."), numLayers, *sectionedSlotName.ToString(), textureSize, textureSize);
+		return materialInstance;
+	}
+}
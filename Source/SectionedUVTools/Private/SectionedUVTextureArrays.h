@@ -0,0 +1,35 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UMaterialInstanceConstant;
+class UMaterialInterface;
+
+/**
+ * Bakes the source materials of a sectioned slot into texture arrays, one layer per UV section, so the sectioned
+ * material samples every merged material with a fixed number of fetches instead of one set per section.
+ */
+namespace SectionedUVTextureArrays
+{
+	/** Texture array parameter the baked base color goes into */
+	extern const FName BaseColorParameterName;
+
+	/** Texture array parameter the baked tangent space normal goes into */
+	extern const FName NormalParameterName;
+
+	/** Texture array parameter the baked occlusion, roughness and metallic go into, in R, G and B */
+	extern const FName ORMParameterName;
+
+	/**
+	 * Bakes the materials merged into a sectioned slot and creates a material instance sampling the bake.
+	 * The textures and the instance are created next to the mesh, baking again updates them in place.
+	 * @param sectionedMesh A static or skeletal mesh generated by the tools.
+	 * @param parentMaterial The material the instance is made from, taking the texture array parameters.
+	 * @param sectionedSlotName The sectioned slot to bake.
+	 * @param textureSize The width and height of each layer.
+	 * @return The material instance, or nullptr if the slot could not be baked.
+	 */
+	UMaterialInstanceConstant* CreateTextureArrayMaterial(UObject* sectionedMesh, UMaterialInterface* parentMaterial, FName sectionedSlotName, int32 textureSize);
+}
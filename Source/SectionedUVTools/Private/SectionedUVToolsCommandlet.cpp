@@ -0,0 +1,336 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVToolsCommandlet.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/PackageName.h"
+#include "UObject/SavePackage.h"
+#include "UObject/UObjectGlobals.h"
+
+namespace SectionedUVToolsCommandlet
+{
+	/**
+	* What happened to one asset, printed in the summary at the end
+	*/
+	struct FAssetResult
+	{
+		FString AssetPath;
+		FString SectionedPath;
+		double Seconds = 0.0;
+		int64 MemoryDelta = 0;
+		bool bSucceeded = false;
+		/** The sectioned mesh was already up to date */
+		bool bCached = false;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Finds the slots matching any of the rules. A rule is a slot index or a slot name with optional wildcards.
+	*/
+	static void ResolveSlotRules(const TArray<FName>& slotNames, const TArray<FString>& slotRules, TArray<int32>& outSlots)
+	{
+		for(int32 slotIndex = 0; slotIndex < slotNames.Num(); ++slotIndex)
+		{
+			const FString slotName = slotNames[slotIndex].ToString();
+			for(const FString& slotRule : slotRules)
+			{
+				const bool bMatches = slotRule.IsNumeric() ? FCString::Atoi(*slotRule) == slotIndex : slotName.MatchesWildcard(slotRule);
+				if(bMatches)
+				{
+					outSlots.Add(slotIndex);
+					break;
+				}
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	*/
+	static bool SaveAssetPackage(UObject* asset)
+	{
+		UPackage* package = asset->GetOutermost();
+		const FString filename = FPackageName::LongPackageNameToFilename(package->GetName(), FPackageName::GetAssetPackageExtension());
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1)
+		FSavePackageArgs saveArgs;
+		saveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		saveArgs.Error = GError;
+		return UPackage::SavePackage(package, asset, *filename, saveArgs);
+#else
+		return UPackage::SavePackage(package, asset, RF_Public | RF_Standalone, *filename, GError);
+#endif
+	}
+
+	static int64 GetUsedPhysicalMemory()
+	{
+		return static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Sums the stages of the conversions that did work, so the summary shows where the time went
+	*/
+	static void AddConversionStats(FSectionedUVConversionStats& totals, const FSectionedUVConversionStats& stats)
+	{
+		if(!stats.bSucceeded || stats.bUpToDate)
+		{
+			return;
+		}
+
+		totals.TotalSeconds += stats.TotalSeconds;
+		totals.HashSeconds += stats.HashSeconds;
+		totals.DuplicateSeconds += stats.DuplicateSeconds;
+		totals.AppendSeconds += stats.AppendSeconds;
+		totals.SlotRemapSeconds += stats.SlotRemapSeconds;
+		totals.SectionMergeSeconds += stats.SectionMergeSeconds;
+		totals.SectionRemovalSeconds += stats.SectionRemovalSeconds;
+		totals.OptimizeSeconds += stats.OptimizeSeconds;
+		totals.MorphFixupSeconds += stats.MorphFixupSeconds;
+		totals.BuildSeconds += stats.BuildSeconds;
+		totals.InitMorphTargetsSeconds += stats.InitMorphTargetsSeconds;
+		totals.NumVertices += stats.NumVertices;
+		totals.NumIndices += stats.NumIndices;
+		totals.NumMorphDeltas += stats.NumMorphDeltas;
+		totals.BytesAllocated += stats.BytesAllocated;
+		totals.VertexBufferBytes += stats.VertexBufferBytes;
+		totals.IndexBufferBytes += stats.IndexBufferBytes;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVToolsCommandlet::USectionedUVToolsCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+int32 USectionedUVToolsCommandlet::Main(const FString& Params)
+{
+	FString pathsParam;
+	FString slotsParam;
+	FString typeParam = TEXT("All");
+	FString encodingParam = TEXT("UVChannel");
+	int32 numSections = 16;
+	int32 numRows = 1;
+	int32 mergeAllFromLOD = INDEX_NONE;
+	int32 batchSize = 32;
+	FParse::Value(*Params, TEXT("Paths="), pathsParam, false);
+	FParse::Value(*Params, TEXT("Slots="), slotsParam, false);
+	FParse::Value(*Params, TEXT("Type="), typeParam);
+	FParse::Value(*Params, TEXT("Encoding="), encodingParam);
+	FParse::Value(*Params, TEXT("NumSections="), numSections);
+	FParse::Value(*Params, TEXT("NumRows="), numRows);
+	FParse::Value(*Params, TEXT("MergeAllFromLOD="), mergeAllFromLOD);
+	FParse::Value(*Params, TEXT("BatchSize="), batchSize);
+	const bool bNoSave = FParse::Param(*Params, TEXT("NoSave"));
+	const bool bAuto = FParse::Param(*Params, TEXT("Auto"));
+	batchSize = FMath::Max(batchSize, 1);
+
+	TArray<FString> paths;
+	pathsParam.ParseIntoArray(paths, TEXT("+"));
+	if(!paths.Num())
+	{
+		UE_LOG(LogSectionedUVTools, Error, TEXT("No content paths to search. Usage: -run=SectionedUVTools -Paths=/Game/Characters+/Game/Props [-Slots=0,2,Body*|-Auto] [-NumSections=16] [-NumRows=1] [-Encoding=UVChannel|VertexColorRed|...] [-MergeAllFromLOD=2] [-Type=All|Skeletal|Static] [-BatchSize=32] [-NoSave]"));
+		return 1;
+	}
+
+	const int64 encodingValue = StaticEnum<ESectionedUVEncoding>()->GetValueByNameString(encodingParam);
+	if(encodingValue == INDEX_NONE)
+	{
+		UE_LOG(LogSectionedUVTools, Error, TEXT("Unknown encoding '%s'. Use UVChannel, VertexColorRed, VertexColorGreen, VertexColorBlue or VertexColorAlpha."), *encodingParam);
+		return 1;
+	}
+	const ESectionedUVEncoding encoding = static_cast<ESectionedUVEncoding>(encodingValue);
+
+	TArray<FString> slotRules;
+	slotsParam.ParseIntoArray(slotRules, TEXT(","));
+
+	const bool bSkeletal = typeParam == TEXT("All") || typeParam == TEXT("Skeletal");
+	const bool bStatic = typeParam == TEXT("All") || typeParam == TEXT("Static");
+
+	// Find everything to convert
+	IAssetRegistry& assetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	assetRegistry.SearchAllAssets(true);
+
+	FARFilter filter;
+	filter.bRecursivePaths = true;
+	for(const FString& path : paths)
+	{
+		filter.PackagePaths.Add(FName(*path));
+	}
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1)
+	if(bSkeletal)
+	{
+		filter.ClassPaths.Add(USkeletalMesh::StaticClass()->GetClassPathName());
+	}
+	if(bStatic)
+	{
+		filter.ClassPaths.Add(UStaticMesh::StaticClass()->GetClassPathName());
+	}
+#else
+	if(bSkeletal)
+	{
+		filter.ClassNames.Add(USkeletalMesh::StaticClass()->GetFName());
+	}
+	if(bStatic)
+	{
+		filter.ClassNames.Add(UStaticMesh::StaticClass()->GetFName());
+	}
+#endif
+
+	TArray<FAssetData> assets;
+	assetRegistry.GetAssets(filter, assets);
+	assets.Sort([](const FAssetData& a, const FAssetData& b)
+	{
+		return a.PackageName.LexicalLess(b.PackageName);
+	});
+
+	UE_LOG(LogSectionedUVTools, Display, TEXT("Found %d meshes to section."), assets.Num());
+
+	TArray<SectionedUVToolsCommandlet::FAssetResult> results;
+	int32 numSkipped = 0;
+	double loadSeconds = 0.0;
+	FSectionedUVConversionStats stageTotals;
+	const double startSeconds = FPlatformTime::Seconds();
+
+	for(int32 batchStart = 0; batchStart < assets.Num(); batchStart += batchSize)
+	{
+		const int32 batchEnd = FMath::Min(batchStart + batchSize, assets.Num());
+
+		// Load the whole batch at once on the async loading thread
+		const double loadStartSeconds = FPlatformTime::Seconds();
+		for(int32 assetIndex = batchStart; assetIndex < batchEnd; ++assetIndex)
+		{
+			LoadPackageAsync(assets[assetIndex].PackageName.ToString());
+		}
+		FlushAsyncLoading();
+		loadSeconds += FPlatformTime::Seconds() - loadStartSeconds;
+
+		for(int32 assetIndex = batchStart; assetIndex < batchEnd; ++assetIndex)
+		{
+			const FAssetData& assetData = assets[assetIndex];
+			UObject* asset = assetData.GetAsset();
+			if(!asset || USectionedUVToolsFunctionLibrary::IsSectionedMesh(asset))
+			{
+				++numSkipped;
+				continue;
+			}
+
+			TArray<FName> slotNames;
+			USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(asset);
+			UStaticMesh* staticMesh = Cast<UStaticMesh>(asset);
+			if(skeletalMesh)
+			{
+				for(const FSkeletalMaterial& material : skeletalMesh->GetMaterials())
+				{
+					slotNames.Add(material.MaterialSlotName);
+				}
+			}
+			else if(staticMesh)
+			{
+				for(const FStaticMaterial& material : staticMesh->GetStaticMaterials())
+				{
+					slotNames.Add(material.MaterialSlotName);
+				}
+			}
+
+			// No rules means everything, but rules matching nothing means this mesh has nothing to merge
+			TArray<int32> materialSlots;
+			if(bAuto)
+			{
+				TArray<FName> sectionedSlotNames;
+				USectionedUVToolsFunctionLibrary::GetAutoSectionedSlots(asset, materialSlots, sectionedSlotNames);
+			}
+			else
+			{
+				SectionedUVToolsCommandlet::ResolveSlotRules(slotNames, slotRules, materialSlots);
+			}
+			if((bAuto || slotRules.Num()) && !materialSlots.Num())
+			{
+				++numSkipped;
+				continue;
+			}
+
+			SectionedUVToolsCommandlet::FAssetResult& result = results.AddDefaulted_GetRef();
+			result.AssetPath = assetData.PackageName.ToString();
+
+			const double assetStartSeconds = FPlatformTime::Seconds();
+			const int64 assetStartMemory = SectionedUVToolsCommandlet::GetUsedPhysicalMemory();
+
+			UObject* sectionedMesh = nullptr;
+			if(skeletalMesh)
+			{
+				sectionedMesh = bAuto ? USectionedUVToolsFunctionLibrary::CreateAutoSectionedUVSkeletalMesh(skeletalMesh, numSections, numRows, encoding, mergeAllFromLOD)
+									  : USectionedUVToolsFunctionLibrary::CreateSectionedUVSkeletalMesh(skeletalMesh, materialSlots, numSections, numRows, encoding, mergeAllFromLOD);
+			}
+			else if(staticMesh)
+			{
+				sectionedMesh = bAuto ? USectionedUVToolsFunctionLibrary::CreateAutoSectionedUVStaticMesh(staticMesh, numSections, numRows, encoding, mergeAllFromLOD)
+									  : USectionedUVToolsFunctionLibrary::CreateSectionedUVStaticMesh(staticMesh, materialSlots, numSections, numRows, encoding, mergeAllFromLOD);
+			}
+
+			if(sectionedMesh)
+			{
+				// Up to date meshes come back untouched, no need to save them again
+				result.SectionedPath = sectionedMesh->GetPathName();
+				result.bCached = !sectionedMesh->GetOutermost()->IsDirty();
+				result.bSucceeded = bNoSave || result.bCached || SectionedUVToolsCommandlet::SaveAssetPackage(sectionedMesh);
+				SectionedUVToolsCommandlet::AddConversionStats(stageTotals, USectionedUVToolsFunctionLibrary::GetLastConversionStats());
+			}
+
+			result.Seconds = FPlatformTime::Seconds() - assetStartSeconds;
+			result.MemoryDelta = SectionedUVToolsCommandlet::GetUsedPhysicalMemory() - assetStartMemory;
+		}
+
+		// Everything from this batch is saved, let it go before loading the next one
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	// Summary
+	int32 numFailed = 0;
+	int32 numCached = 0;
+	UE_LOG(LogSectionedUVTools, Display, TEXT("%-8s %10s %12s  %s"), TEXT("Result"), TEXT("Seconds"), TEXT("Memory MB"), TEXT("Asset"));
+	for(const SectionedUVToolsCommandlet::FAssetResult& result : results)
+	{
+		numFailed += result.bSucceeded ? 0 : 1;
+		numCached += result.bCached ? 1 : 0;
+		UE_LOG(LogSectionedUVTools, Display, TEXT("%-8s %10.3f %12.2f  %s -> %s"),
+			   !result.bSucceeded ? TEXT("FAILED") : result.bCached ? TEXT("CACHED") : TEXT("OK"),
+			   result.Seconds,
+			   result.MemoryDelta / (1024.0 * 1024.0),
+			   *result.AssetPath,
+			   result.SectionedPath.IsEmpty() ? TEXT("None") : *result.SectionedPath);
+	}
+
+	const FPlatformMemoryStats memoryStats = FPlatformMemory::GetStats();
+	UE_LOG(LogSectionedUVTools, Display, TEXT("Sectioned %d meshes, %d up to date, %d failed, %d skipped in %.2f seconds (%.2f seconds loading). Peak memory %.2f MB."),
+		   results.Num() - numFailed - numCached,
+		   numCached,
+		   numFailed,
+		   numSkipped,
+		   FPlatformTime::Seconds() - startSeconds,
+		   loadSeconds,
+		   memoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+
+	// Stage times of parallel work are summed over threads, so they can add up to more than the conversion time
+	UE_LOG(LogSectionedUVTools, Display, TEXT("Conversion stages: %.2fs total, hash %.2fs, duplicate %.2fs, slot remap %.2fs, section merge %.2fs, section removal %.2fs, optimize %.2fs, morph fixup %.2fs, build %.2fs, init morph targets %.2fs."),
+		   stageTotals.TotalSeconds, stageTotals.HashSeconds, stageTotals.DuplicateSeconds, stageTotals.SlotRemapSeconds, stageTotals.SectionMergeSeconds,
+		   stageTotals.SectionRemovalSeconds, stageTotals.OptimizeSeconds, stageTotals.MorphFixupSeconds, stageTotals.BuildSeconds, stageTotals.InitMorphTargetsSeconds);
+	UE_LOG(LogSectionedUVTools, Display, TEXT("Converted %lld vertices, %lld indices and %lld morph deltas, %.2f MB allocated. The sectioned render data holds %.2f MB of vertices and %.2f MB of indices."),
+		   stageTotals.NumVertices, stageTotals.NumIndices, stageTotals.NumMorphDeltas, stageTotals.BytesAllocated / (1024.0 * 1024.0),
+		   stageTotals.VertexBufferBytes / (1024.0 * 1024.0), stageTotals.IndexBufferBytes / (1024.0 * 1024.0));
+
+	return numFailed ? 1 : 0;
+}
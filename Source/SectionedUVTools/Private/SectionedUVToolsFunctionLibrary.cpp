@@ -1,13 +1,34 @@
 ﻿// Copyright (c) 2022 Solar Storm Interactive
 
 #include "SectionedUVToolsFunctionLibrary.h"
+#include "SectionedUVAssetUserData.h"
+#include "SectionedUVAtlas.h"
+#include "SectionedUVCache.h"
+#include "SectionedUVInstancing.h"
+#include "SectionedUVMerge.h"
+#include "SectionedUVStats.h"
+#include "SectionedUVTextureArrays.h"
 #include "Engine/SkeletalMesh.h"
 #include "Engine/StaticMesh.h"
-#include "RawMesh.h"
-#include "AssetRegistry/AssetRegistryModule.h"
+#include "GPUSkinVertexFactory.h"
+#include "Materials/Material.h"
 #include "MeshUtilities.h"
 #include "Rendering/SkeletalMeshModel.h"
-//#include "StaticMeshOperations.h"
+#include "Rendering/SkeletalMeshRenderData.h"
+#include "SectionedUVCore.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Ticker.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/MemStack.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "StaticMeshAttributes.h"
+#include "StaticMeshResources.h"
+#include "StaticMeshOperations.h"
+#include "Widgets/Notifications/SNotificationList.h"
+#include <atomic>
 
 DEFINE_LOG_CATEGORY(LogSectionedUVTools);
 
@@ -17,610 +38,2856 @@ namespace SectionedUVTools
 	
 	//--------------------------------------------------------------------------------------------------------------------
 	/**
+	* Builds the flat core section descriptions for a skeletal LOD model
 	*/
-	static bool RemoveMeshSection(FSkeletalMeshLODModel& Model, int32 SectionIndex) 
+	static std::vector<SectionedUVCore::FSection> MakeCoreSections(const TArray<FSkelMeshSection>& Sections)
 	{
-		// Need a valid section
-		if (!Model.Sections.IsValidIndex(SectionIndex))
+		std::vector<SectionedUVCore::FSection> coreSections;
+		coreSections.reserve(Sections.Num());
+		for(const FSkelMeshSection& section : Sections)
 		{
-			return false;
-		}
-
-		const FSkelMeshSection& SectionToRemove = Model.Sections[SectionIndex];
-
-		if (SectionToRemove.CorrespondClothAssetIndex != INDEX_NONE)
-		{
-			// Can't remove this, clothing currently relies on it
-			return false;
+			SectionedUVCore::FSection& coreSection = coreSections.emplace_back();
+			coreSection.BaseIndex = section.BaseIndex;
+			coreSection.NumTriangles = section.NumTriangles;
+			coreSection.BaseVertexIndex = section.BaseVertexIndex;
+			coreSection.NumVertices = section.GetNumVertices();
+			coreSection.MaterialIndex = section.MaterialIndex;
+			coreSection.ClothAssetIndex = section.CorrespondClothAssetIndex;
 		}
+		return coreSections;
+	}
 
-		const uint32 NumVertsToRemove   = SectionToRemove.GetNumVertices();
-		const uint32 BaseVertToRemove   = SectionToRemove.BaseVertexIndex;
-		const uint32 NumIndicesToRemove = SectionToRemove.NumTriangles * 3;
-		const uint32 BaseIndexToRemove  = SectionToRemove.BaseIndex;
+	static TAutoConsoleVariable<int32> CVarParallel(
+		TEXT("SectionedUVTools.Parallel"),
+		1,
+		TEXT("When non zero, LODs, source models and morph targets are sectioned in parallel on the task graph.\n")
+		TEXT("Set to 0 to run everything on the calling thread, the result is the same either way."));
+
+	static TAutoConsoleVariable<int32> CVarOptimizeMergedSection(
+		TEXT("SectionedUVTools.OptimizeMergedSection"),
+		1,
+		TEXT("When non zero, the triangles of each merged skeletal section are reordered for the post transform cache and overdraw,\n")
+		TEXT("and its vertices for fetch locality. The cache statistics before and after are logged per LOD."));
+
+	static TAutoConsoleVariable<int32> CVarWeldMergedSection(
+		TEXT("SectionedUVTools.WeldMergedSection"),
+		0,
+		TEXT("When non zero, vertices of each merged skeletal section which match in every attribute are welded into one,\n")
+		TEXT("dropping the duplicates source sections kept along their shared seams. Morph targets keep the first delta of welded vertices."));
+
+	static TAutoConsoleVariable<float> CVarWeldPositionTolerance(
+		TEXT("SectionedUVTools.WeldPositionTolerance"),
+		THRESH_POINTS_ARE_SAME,
+		TEXT("The largest distance between the positions of two welded vertices. Normals and UVs use the engine's import thresholds."));
+
+	/** Flags for the sectioning ParallelFors, LODs and morph targets vary a lot in size */
+	static EParallelForFlags GetParallelForFlags()
+	{
+		return CVarParallel.GetValueOnAnyThread() != 0 ? EParallelForFlags::Unbalanced : EParallelForFlags::ForceSingleThread;
+	}
 
+	//--------------------------------------------------------------------------------------------------------------------
+	/** Linear color component index of a color encoding, or INDEX_NONE for the UV channel encoding */
+	static int32 GetEncodedColorComponent(const ESectionedUVEncoding encoding)
+	{
+		return encoding == ESectionedUVEncoding::UVChannel ? INDEX_NONE : static_cast<int32>(encoding) - static_cast<int32>(ESectionedUVEncoding::VertexColorRed);
+	}
 
-		// Strip indices
-		Model.IndexBuffer.RemoveAt(BaseIndexToRemove, NumIndicesToRemove);
+	/**
+	* The mesh description color value which builds into the section id. The static mesh build converts RGB to sRGB
+	* when packing vertex colors, so the id has to go through the inverse to come out exact.
+	*/
+	static float GetEncodedLinearColor(const int32 uvSection, const int32 component)
+	{
+		const uint8 sectionId = static_cast<uint8>(uvSection);
+		return FLinearColor::FromSRGBColor(FColor(sectionId, sectionId, sectionId, sectionId)).Component(component);
+	}
 
-		Model.Sections.RemoveAt(SectionIndex);
+	/**
+	* What happened to one skeletal LOD, kept around so the morph targets can be remapped once all LODs are done
+	*/
+	struct FLODSectioning
+	{
+		bool bSectioned = false;
+		std::vector<SectionedUVCore::FSection> OldSections;
+		SectionedUVCore::FSectionMerge Merge;
+		std::vector<uint32> SectionBaseVertices;
+		/** The first merged section, the merged sections are split into several back to back when they need too many bones */
+		int32 SectionedSectionIndex = INDEX_NONE;
+		SectionedUVCore::FBoneMapMerge BoneMerge;
+		SectionedUVCore::FVertexRemap VertexRemap;
+		bool bHasVertexRemap = false;
+		/** Vertices of the merged sections were welded, so several morph deltas can now point at the same vertex */
+		bool bWelded = false;
+	};
 
-		// Fixup indices above base vert
-		for (uint32& Index : Model.IndexBuffer)
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* True if two vertices of a merged section can become one. Everything the vertex factory reads has to match,
+	* the section id included since it lives in the sectioned UV or the vertex color.
+	*/
+	static bool AreSoftVerticesWeldable(const FSoftSkinVertex& first, const FSoftSkinVertex& second, const int32 numTexCoords)
+	{
+		if(first.Color != second.Color ||
+		   FMemory::Memcmp(first.InfluenceBones, second.InfluenceBones, sizeof(first.InfluenceBones)) != 0 ||
+		   FMemory::Memcmp(first.InfluenceWeights, second.InfluenceWeights, sizeof(first.InfluenceWeights)) != 0)
 		{
-			if (Index >= BaseVertToRemove)
-			{
-				Index -= NumVertsToRemove;
-			}
+			return false;
 		}
 
-		Model.NumVertices -= NumVertsToRemove;
-
-		// Fixup anything needing section indices
-		for (FSkelMeshSection& Section : Model.Sections)
+		if(!first.TangentX.Equals(second.TangentX, THRESH_NORMALS_ARE_SAME) ||
+		   !first.TangentY.Equals(second.TangentY, THRESH_NORMALS_ARE_SAME) ||
+		   !first.TangentZ.Equals(second.TangentZ, THRESH_NORMALS_ARE_SAME))
 		{
-			// Push back clothing indices
-			if (Section.CorrespondClothAssetIndex > SectionIndex)
-			{
-				Section.CorrespondClothAssetIndex--;
-			}
-
-			// Removed indices, re-base further sections
-			if (Section.BaseIndex > BaseIndexToRemove)
-			{
-				Section.BaseIndex -= NumIndicesToRemove;
-			}
+			return false;
+		}
 
-			// Remove verts, re-base further sections
-			if (Section.BaseVertexIndex > BaseVertToRemove)
+		for(int32 uvIndex = 0; uvIndex < numTexCoords; ++uvIndex)
+		{
+			if(!first.UVs[uvIndex].Equals(second.UVs[uvIndex], THRESH_UVS_ARE_SAME))
 			{
-				Section.BaseVertexIndex -= NumVertsToRemove;
+				return false;
 			}
 		}
 		return true;
 	}
 
-	bool GetSectionFromVertexIndex(TArray<FSkelMeshSection>& Sections, int32 InVertIndex, int32& OutSectionIndex, int32& OutVertIndex)
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Welds the vertices of a merged section which match in every attribute. Source sections sharing a seam each keep
+	* their own copy of the seam vertices, which only stay apart once merged if their sectioned UVs differ.
+	* @param mergedIndices The merged section's triangles, relative to its first vertex.
+	* @param outWeldMap Per vertex before welding, its vertex after. Empty if nothing was welded.
+	*/
+	static void WeldMergedSection(FSkelMeshSection& mergedSection,
+								  uint32* mergedIndices,
+								  const size_t numMergedIndices,
+								  const int32 numTexCoords,
+								  const int32 lodIndex,
+								  const int32 chunkIndex,
+								  std::vector<uint32>& outWeldMap)
 	{
-		OutSectionIndex = 0;
-		OutVertIndex = 0;
-
-		int32 VertCount = 0;
-
-		// Iterate over each chunk
-		for (int32 SectionCount = 0; SectionCount < Sections.Num(); SectionCount++)
+		TArray<FSoftSkinVertex>& softVerts = mergedSection.SoftVertices;
+		const uint32 numVertices = static_cast<uint32>(softVerts.Num());
+		if(!numVertices)
 		{
-			const FSkelMeshSection& Section = Sections[SectionCount];
-			OutSectionIndex = SectionCount;
-
-			// Is it in Soft vertex range?
-			if (InVertIndex < VertCount + Section.GetNumVertices())
-			{
-				OutVertIndex = InVertIndex - VertCount;
-				return true;
-			}
-			VertCount += Section.GetNumVertices();
+			return;
 		}
 
-		return false;
-	}
-}
-
-//--------------------------------------------------------------------------------------------------------------------
-/**
-*/
-USkeletalMesh* USectionedUVToolsFunctionLibrary::CreateSectionedUVSkeletalMesh(USkeletalMesh* skeletalMesh,
-																			   TArray<int32> materialSlots,
-																			   const int32 numSections)
-{
-	if(!skeletalMesh || !skeletalMesh->GetPackage())
-	{
-		return nullptr;
-	}
+		const auto canWeld = [&softVerts, numTexCoords](const uint32 first, const uint32 second)
+		{
+			return AreSoftVerticesWeldable(softVerts[first], softVerts[second], numTexCoords);
+		};
+		const uint32 numWelded = SectionedUVCore::WeldVertices(mergedIndices, numMergedIndices, &softVerts[0].Position.X, sizeof(FSoftSkinVertex), numVertices,
+															   CVarWeldPositionTolerance.GetValueOnAnyThread(), canWeld, outWeldMap);
+		if(!numWelded)
+		{
+			UE_LOG(LogSectionedUVTools, Warning, TEXT("LOD %d merged section %d references vertices it does not have, leaving its vertices alone."), lodIndex, chunkIndex);
+			outWeldMap.clear();
+			return;
+		}
+		if(numWelded == numVertices)
+		{
+			outWeldMap.clear();
+			return;
+		}
 
-	if(numSections < 2)
-	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the skeletal mesh. Number of sections should be greater than 2. 8 or 16 are good choices."));
-		return nullptr;
+		SectionedUVCore::CompactWeldedVertices(softVerts.GetData(), numVertices, sizeof(FSoftSkinVertex), outWeldMap.data());
+		softVerts.SetNum(static_cast<int32>(numWelded), false);
+		mergedSection.NumVertices = static_cast<int32>(numWelded);
+		UE_LOG(LogSectionedUVTools, Log, TEXT("LOD %d merged section %d: welded %u vertices into %u."), lodIndex, chunkIndex, numVertices, numWelded);
 	}
 
-	for(FSkeletalMaterial& material : skeletalMesh->GetMaterials())
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Reorders the merged section's triangles for the post transform cache and overdraw, then its vertices for fetch
+	* locality. The concatenated source sections were each optimized on their own but never as a whole.
+	* @param mergedIndices The merged section's triangles, relative to its first vertex.
+	* @param bReorderVertices False to keep the vertex order, when morph targets cannot follow the vertices.
+	* @param outVertexOrder The vertex reorder applied to the merged section, empty if the vertices did not move.
+	*/
+	static void OptimizeMergedSection(FSkelMeshSection& mergedSection,
+									  uint32* mergedIndices,
+									  const size_t numMergedIndices,
+									  const int32 lodIndex,
+									  const int32 chunkIndex,
+									  const bool bReorderVertices,
+									  std::vector<uint32>& outVertexOrder)
 	{
-		if(material.MaterialSlotName == SectionedUVTools::SectionedSlotName)
+		const uint32 numVertices = static_cast<uint32>(mergedSection.SoftVertices.Num());
+		if(numMergedIndices < 6 || !numVertices)
 		{
-			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the skeletal mesh. Mesh already contains a 'sectioned' material slot!"));
-			return nullptr;
+			return;
 		}
-	}
-	
-	if(materialSlots.Num())
-	{
-		const TArray<FSkeletalMaterial>& materials = skeletalMesh->GetMaterials();
-		for(const int32& materialSlot : materialSlots)
+
+		const SectionedUVCore::FVertexCacheStats before = SectionedUVCore::AnalyzeVertexCache(mergedIndices, numMergedIndices, numVertices, SectionedUVCore::DefaultVertexCacheSize);
+		if(!SectionedUVCore::OptimizeVertexCache(mergedIndices, numMergedIndices, numVertices))
 		{
-			if(!materials.IsValidIndex(materialSlot))
-			{
-				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the skeletal mesh. Material slot index '%d' is invalid!"), materialSlot);
-				return nullptr;
-			}
+			UE_LOG(LogSectionedUVTools, Warning, TEXT("LOD %d merged section %d references vertices it does not have, leaving its order alone."), lodIndex, chunkIndex);
+			return;
 		}
+		SectionedUVCore::OptimizeOverdraw(mergedIndices, numMergedIndices, &mergedSection.SoftVertices[0].Position.X, sizeof(FSoftSkinVertex), numVertices);
 
-		// Make sure the slots are in order so we can reverse remove them
-		Algo::Sort(materialSlots, [](const int32& a, const int32& b) -> bool
-		{
-			return a < b;
-		});
-	}
-	else
-	{
-		const TArray<FSkeletalMaterial>& materials = skeletalMesh->GetMaterials();
-		for(int32 materialIndex = 0; materialIndex < materials.Num(); ++materialIndex)
+		if(bReorderVertices && SectionedUVCore::OptimizeVertexFetch(mergedIndices, numMergedIndices, numVertices, outVertexOrder))
 		{
-			materialSlots.Add(materialIndex);
+			SectionedUVCore::ReorderVertices(mergedSection.SoftVertices.GetData(), numVertices, sizeof(FSoftSkinVertex), outVertexOrder.data());
 		}
-	}
 
-	if(numSections < materialSlots.Num())
-	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the skeletal mesh. Number of sections needs to be greater than or equal to the number of materials!"));
-		return nullptr;
+		const SectionedUVCore::FVertexCacheStats after = SectionedUVCore::AnalyzeVertexCache(mergedIndices, numMergedIndices, numVertices, SectionedUVCore::DefaultVertexCacheSize);
+		UE_LOG(LogSectionedUVTools, Log, TEXT("LOD %d merged section %d: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%d vertex cache)."),
+			   lodIndex, chunkIndex, before.ACMR, after.ACMR, before.ATVR, after.ATVR, SectionedUVCore::DefaultVertexCacheSize);
 	}
 
-	TMap<int32, int32> matIndexToUVSection;
-	int32 curSectionIndex = 0;
-	for(const int32& materialSlot : materialSlots)
-	{
-		matIndexToUVSection.Add(materialSlot, curSectionIndex++);
-	}
-	
-	FString packageName = skeletalMesh->GetPackage()->GetPathName() + TEXT("_sectioned");
-	if(FindPackage(nullptr, *packageName))
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Merges the sections of one LOD which use the slots being sectioned. Only touches the LOD model so LODs can run in parallel.
+	* @param maxBonesPerSection The most bones a merged section may use, it is split into several sections past that.
+	* @param bAddSectionedUV False when an earlier sectioned slot of the same mesh already added the sectioned UV channel
+	*                        and filled it in for the kept sections.
+	* @param atlasRegions Per UV section, the atlas region its UV0 is moved into. nullptr to leave UV0 alone.
+	*/
+	static bool SectionLODModel(FSkeletalMeshLODModel& lodModel,
+								const int32 lodIndex,
+								const SectionedUVCore::FSlotMapping& slotMapping,
+								const int32 sectionedMatIndex,
+								const int32 numSections,
+								const int32 numRows,
+								const ESectionedUVEncoding encoding,
+								const int32 maxBonesPerSection,
+								const bool bAddSectionedUV,
+								const SectionedUVCore::FAtlasRegion* atlasRegions,
+								FLODSectioning& outSectioning)
 	{
-		int32 sectionIndex = 1;
-		while(FindPackage(nullptr, *(packageName + FString::FromInt(sectionIndex))))
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::SectionMerge);
+
+		// Scratch only needed while merging this LOD comes off the thread's memory stack and is released in one go on return
+		FMemMark scratchMark(FMemStack::Get());
+
+		// Work out the merge on the flat section layout before touching anything
+		std::vector<SectionedUVCore::FSection>& oldSections = outSectioning.OldSections;
+		SectionedUVCore::FSectionMerge& merge = outSectioning.Merge;
+		oldSections = MakeCoreSections(lodModel.Sections);
+		if(!SectionedUVCore::MergeSections(oldSections.data(), static_cast<int32>(oldSections.size()), lodModel.IndexBuffer.GetData(), lodModel.IndexBuffer.Num(), slotMapping, merge))
 		{
-			++sectionIndex;
+			UE_LOG(LogSectionedUVTools, Warning, TEXT("LOD %d has sections outside of its index buffer, skipping it."), lodIndex);
+			return false;
 		}
-		packageName = packageName + FString::FromInt(sectionIndex);
-	}
 
-	UPackage* skelMeshPackage = CreatePackage(*packageName);
-	if(!skelMeshPackage)
-	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create package for new sectioned mesh!"));
-		return nullptr;
-	}
-	
-	USkeletalMesh* sectionedMesh = DuplicateObject<USkeletalMesh>(skeletalMesh, skelMeshPackage, FName(*FPaths::GetBaseFilename(packageName)));
-	if(!sectionedMesh)
-	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create skeletal mesh asset to make into a sectioned mesh!"));
-		return nullptr;
-	}
+		// Share the bones the merged sections have in common, splitting the merged section if they still do not fit in one bone map
+		SectionedUVCore::FBoneMapMerge& boneMerge = outSectioning.BoneMerge;
+		{
+			// Only the merged sections' bone maps are gathered, kept sections get an empty range
+			TArray<uint32, TMemStackAllocator<>> boneMapOffsets;
+			boneMapOffsets.SetNumUninitialized(lodModel.Sections.Num() + 1);
+			uint32 numBones = 0;
+			for(int32 sectionIndex = 0; sectionIndex < lodModel.Sections.Num(); ++sectionIndex)
+			{
+				boneMapOffsets[sectionIndex] = numBones;
+				if(merge.MergedVertexOffset[sectionIndex] != SectionedUVCore::InvalidVertex)
+				{
+					numBones += lodModel.Sections[sectionIndex].BoneMap.Num();
+				}
+			}
+			boneMapOffsets[lodModel.Sections.Num()] = numBones;
 
-	FSkeletalMeshModel* skelMeshModel = sectionedMesh->GetImportedModel();
-	if(!skelMeshModel)
-	{
-		sectionedMesh->ConditionalBeginDestroy();
-		skelMeshPackage->ConditionalBeginDestroy();
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the skeletal mesh. No imported model on original skeletal mesh?!"));
-		return nullptr;
-	}
-	
-	// Get rid of the material slots we are merging
-	TArray<FSkeletalMaterial>& materials = sectionedMesh->GetMaterials();
+			TArray<uint16, TMemStackAllocator<>> boneMaps;
+			boneMaps.SetNumUninitialized(numBones);
+			for(const int32 sectionIndex : merge.SectionsToRemove)
+			{
+				const TArray<FBoneIndexType>& boneMap = lodModel.Sections[sectionIndex].BoneMap;
+				FMemory::Memcpy(boneMaps.GetData() + boneMapOffsets[sectionIndex], boneMap.GetData(), boneMap.Num() * sizeof(FBoneIndexType));
+			}
+			SectionedUVCore::MergeBoneMaps(oldSections.data(), static_cast<int32>(oldSections.size()), boneMaps.GetData(), boneMapOffsets.GetData(), merge, maxBonesPerSection, boneMerge);
+		}
 
-	// Create a mapping of what the material slots will be after to re-assign once we have removed the slots
-	TMap<int32, int32> slotRemap;
-	int32 actualSlotIndex = 0;
-	for(int32 materialSlotIndex = 0; materialSlotIndex < materials.Num(); ++materialSlotIndex, ++actualSlotIndex)
-	{
-		if(materialSlots.Contains(materialSlotIndex))
+		TArray<FSkelMeshSection> mergedChunks;
+		mergedChunks.SetNum(static_cast<int32>(boneMerge.Chunks.size()));
+		for(int32 chunkIndex = 0; chunkIndex < mergedChunks.Num(); ++chunkIndex)
 		{
-			--actualSlotIndex;
+			const std::vector<uint16>& chunkBoneMap = boneMerge.ChunkBoneMaps[chunkIndex];
+			FSkelMeshSection& mergedChunk = mergedChunks[chunkIndex];
+			mergedChunk.MaterialIndex = sectionedMatIndex;
+			mergedChunk.NumTriangles = boneMerge.Chunks[chunkIndex].NumTriangles;
+			mergedChunk.BoneMap.Append(chunkBoneMap.data(), static_cast<int32>(chunkBoneMap.size()));
+			mergedChunk.SoftVertices.Reserve(boneMerge.Chunks[chunkIndex].NumVertices);
 		}
-		else
+		if(mergedChunks.Num() > 1)
 		{
-			slotRemap.Add(materialSlotIndex, actualSlotIndex);
+			UE_LOG(LogSectionedUVTools, Log, TEXT("LOD %d merged section needs more than %d bones, split it into %d sections."), lodIndex, maxBonesPerSection, mergedChunks.Num());
 		}
-	}
 
-	// Remove the material slots we don't want
-	for(int32 materialSlotIndex = materialSlots.Num() - 1; materialSlotIndex >= 0; --materialSlotIndex)
-	{
-		materials.RemoveAt(materialSlots[materialSlotIndex]);
-	}
-
-	// Add the new material for the sectioned mesh parts
-	const int32 sectionedMatIndex = materials.Emplace(nullptr, true, false, SectionedUVTools::SectionedSlotName, SectionedUVTools::SectionedSlotName);
+		// Add the extra tex coord for the sectioning, color encodings write into the existing vertex colors instead
+		const bool bEncodeInUV = encoding == ESectionedUVEncoding::UVChannel;
+		int32 sectionedUVIndex = INDEX_NONE;
+		if(bEncodeInUV)
+		{
+			if(bAddSectionedUV)
+			{
+				lodModel.NumTexCoords += 1;
+			}
+			sectionedUVIndex = lodModel.NumTexCoords - 1;
+		}
 
-	TArray<UMorphTarget*>& morphTargets = sectionedMesh->GetMorphTargets();
-	
-	// Merge the sections which will use the new sectioned material
-	int32 lodIndex = 0;
-	for(FSkeletalMeshLODModel& lodModel : skelMeshModel->LODModels)
-	{
-		FSkelMeshSection mergedSections;
-		mergedSections.MaterialIndex = sectionedMatIndex;
-		TArray<uint32> mergedIndexBuffer;
-
-		int32 accumVertsCount = 0;
-		int32 mergedVertsCount = 0;
-		int32 boneMapAccum = 0;
-
-		TArray<int32> sectionsToRemove;
-
-		// Add the extra tex coord for the sectioning
-		lodModel.NumTexCoords += 1;
-		
-		TArray<int32> oldToNewSectionMap;
-		int32 newSectionIndex = 0;
-		
-		TMap<int32, int32> sectionedSectionMapping;
-		
 		for(int32 sectionIndex = 0; sectionIndex < lodModel.Sections.Num(); ++sectionIndex)
 		{
 			FSkelMeshSection& section = lodModel.Sections[sectionIndex];
-			if(materialSlots.Contains(section.MaterialIndex))
+			const int32 sectionToUse = SectionedUVCore::GetUVSection(slotMapping, section.MaterialIndex);
+			if(sectionToUse != SectionedUVCore::InvalidIndex)
 			{
-				oldToNewSectionMap.Add(INDEX_NONE);
-				
 				// This section will be merged into a new combined section
-				mergedSections.NumTriangles += section.NumTriangles;
+				FSkelMeshSection& mergedChunk = mergedChunks[boneMerge.SectionChunk[sectionIndex]];
+				mergedChunk.MaxBoneInfluences = FMath::Max(mergedChunk.MaxBoneInfluences, section.MaxBoneInfluences);
 
-				mergedSections.MaxBoneInfluences = FMath::Max(mergedSections.MaxBoneInfluences, section.MaxBoneInfluences);
-
-				const int32 sectionToUse = matIndexToUVSection.FindChecked(section.MaterialIndex);
 				section.MaterialIndex = sectionedMatIndex;
 
-				TArray<FSoftSkinVertex> softVerts = section.SoftVertices;
-				for(FSoftSkinVertex& vert : softVerts)
+				// The section is removed below, so its vertices are rewritten in place and moved into the chunk
+				TArray<FSoftSkinVertex>& softVerts = section.SoftVertices;
+				if(softVerts.Num())
 				{
-					for(int32 boneInfIndex = 0; boneInfIndex < section.MaxBoneInfluences; ++boneInfIndex)
+					size_t numRemapBones = 0;
+					const uint16* boneRemap = SectionedUVCore::GetSectionBoneRemap(boneMerge, sectionIndex, numRemapBones);
+					SectionedUVCore::RemapBoneInfluences(&softVerts[0].InfluenceBones[0], softVerts.Num(), sizeof(FSoftSkinVertex), section.MaxBoneInfluences, boneRemap, numRemapBones);
+
+					if(bEncodeInUV)
+					{
+						// Add a UV section with all verts UV x squished into the UV section
+						SectionedUVCore::WriteSectionedUVs(&softVerts[0].UVs[0].X, &softVerts[0].UVs[sectionedUVIndex].X, softVerts.Num(), sizeof(FSoftSkinVertex),
+														   SectionedUVCore::GetSectionCenterU(sectionToUse, numSections),
+														   SectionedUVCore::GetSectionCenterV(sectionToUse, numSections, numRows));
+					}
+					else
 					{
-						vert.InfluenceBones[boneInfIndex] += boneMapAccum;
+						SectionedUVCore::WriteSectionIds(SectionedUVEncoding::GetEncodedColorChannel(softVerts[0].Color, encoding), softVerts.Num(), sizeof(FSoftSkinVertex), static_cast<uint8>(sectionToUse));
 					}
 
-					// Add a UV section with all verts UV x squished into the UV section
-					vert.UVs[lodModel.NumTexCoords - 1] = vert.UVs[0];
-					const float halfStride = (1.0f / numSections) / 2.0f;
-					const float sectionMidX = sectionToUse * (1.0f / numSections) + halfStride;
-					vert.UVs[lodModel.NumTexCoords - 1].X = sectionMidX;
+					// The sectioned UV was made from the original UV0 above, only then move UV0 into the atlas
+					if(atlasRegions)
+					{
+						SectionedUVCore::WriteAtlasUVs(&softVerts[0].UVs[0].X, softVerts.Num(), sizeof(FSoftSkinVertex), atlasRegions[sectionToUse]);
+					}
 				}
-				
-				boneMapAccum += section.BoneMap.Num();
-				
-				mergedSections.SoftVertices.Append(softVerts);
-				mergedSections.BoneMap.Append(section.BoneMap);
 
-				mergedSections.NumVertices += section.NumVertices;
-				if(section.bUse16BitBoneIndex)
-				{
-					mergedSections.bUse16BitBoneIndex = true;
-				}
+				mergedChunk.SoftVertices.Append(MoveTemp(softVerts));
+				softVerts.Empty();
 
-				const uint32 numSectionIndices = section.NumTriangles * 3;
-				for(uint32 sectionVertIndex = 0; sectionVertIndex < numSectionIndices; ++sectionVertIndex)
+				mergedChunk.NumVertices += section.NumVertices;
+				if(section.bUse16BitBoneIndex)
 				{
-					// Add index, offsetting away the current accumulation to this point, and adding the merged count to this point
-					mergedIndexBuffer.Add((lodModel.IndexBuffer[section.BaseIndex + sectionVertIndex] - accumVertsCount) + mergedVertsCount);
+					mergedChunk.bUse16BitBoneIndex = true;
 				}
-
-				sectionedSectionMapping.Add(sectionIndex, mergedVertsCount);
-
-				mergedVertsCount += section.GetNumVertices();
-				accumVertsCount += section.GetNumVertices();
-				sectionsToRemove.Add(sectionIndex);
 			}
 			else
 			{
-				oldToNewSectionMap.Add(newSectionIndex++);
-				
-				accumVertsCount += section.GetNumVertices();
-
 				// Just assign the new material and create a copy of UV index 0
-				section.MaterialIndex = slotRemap.FindChecked(section.MaterialIndex);
-				for(FSoftSkinVertex& vert : section.SoftVertices)
+				section.MaterialIndex = slotMapping.SlotRemap[section.MaterialIndex];
+				if(bEncodeInUV && bAddSectionedUV && section.SoftVertices.Num())
 				{
-					vert.UVs[lodModel.NumTexCoords - 1] = vert.UVs[0];
+					SectionedUVCore::WriteSectionedUVs(&section.SoftVertices[0].UVs[0].X, &section.SoftVertices[0].UVs[sectionedUVIndex].X, section.SoftVertices.Num(),
+													   sizeof(FSoftSkinVertex), -1.0f);
 				}
 			}
 		}
 
-		// Copy all sections so we can reference how they were after to fixup morph targets
-		// This kinda sucks but is the easiest way I could think of without building mappings
-		// and adding a lot more code.
-		TArray<FSkelMeshSection> sectionsCopy = lodModel.Sections;
-		
-		// Actually remove the sections
-		for(int32 sectionIndex = sectionsToRemove.Num() - 1; sectionIndex >= 0; --sectionIndex)
+		// Actually remove the sections, compacting and re-basing the index buffer in one pass
+		stageTimer.Next(SectionedUVStats::EStage::SectionRemoval);
+		std::vector<SectionedUVCore::FSection> coreSections = oldSections;
+		std::vector<int32> removedSections;
+		size_t numIndices = lodModel.IndexBuffer.Num();
+		uint32 numVertices = lodModel.NumVertices;
+		SectionedUVCore::RemoveSections(coreSections, lodModel.IndexBuffer.GetData(), numIndices, numVertices,
+										merge.SectionsToRemove.data(), static_cast<int32>(merge.SectionsToRemove.size()), removedSections);
+
+		// Compact the kept sections in place, the merged chunks go into the slots the removed sections leave behind
+		int32 numKeptSections = 0;
+		auto removedIt = removedSections.begin();
+		for(int32 sectionIndex = 0; sectionIndex < lodModel.Sections.Num(); ++sectionIndex)
+		{
+			if(removedIt != removedSections.end() && *removedIt == sectionIndex)
+			{
+				++removedIt;
+				continue;
+			}
+
+			const SectionedUVCore::FSection& coreSection = coreSections[numKeptSections];
+			if(numKeptSections != sectionIndex)
+			{
+				lodModel.Sections[numKeptSections] = MoveTemp(lodModel.Sections[sectionIndex]);
+			}
+			FSkelMeshSection& section = lodModel.Sections[numKeptSections++];
+			section.BaseIndex = coreSection.BaseIndex;
+			section.BaseVertexIndex = coreSection.BaseVertexIndex;
+			section.CorrespondClothAssetIndex = static_cast<int16>(coreSection.ClothAssetIndex);
+		}
+		lodModel.Sections.SetNum(numKeptSections, false);
+		lodModel.NumVertices = numVertices;
+
+		// Weld and optimize each merged draw as a whole. Vertices only move when the morph targets can follow them through the vertex remap table.
+		stageTimer.Next(SectionedUVStats::EStage::Optimize);
+		const int32 numChunks = mergedChunks.Num();
+		std::vector<std::vector<uint32>> chunkVertexOrders(numChunks);
+		const bool bMoveVertices = lodModel.Sections.Num() + numChunks <= SectionedUVCore::MaxRemapSections;
+		const bool bWeld = bMoveVertices && CVarWeldMergedSection.GetValueOnAnyThread() != 0;
+		const bool bOptimize = CVarOptimizeMergedSection.GetValueOnAnyThread() != 0;
+		if(bWeld || bOptimize)
 		{
-			const int32& sectionToRemove = sectionsToRemove[sectionIndex];
-			SectionedUVTools::RemoveMeshSection(lodModel, sectionToRemove);
+			// Welding shrinks the chunks, so each one starts where the welded chunks before it end
+			uint32 chunkBaseVertex = 0;
+			for(int32 chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+			{
+				// Merged indices are relative to the first chunk, make them relative to this one while optimizing
+				const SectionedUVCore::FSection& chunk = boneMerge.Chunks[chunkIndex];
+				uint32* chunkIndices = merge.MergedIndices.data() + chunk.BaseIndex;
+				const size_t numChunkIndices = static_cast<size_t>(chunk.NumTriangles) * 3;
+				for(size_t index = 0; index < numChunkIndices; ++index)
+				{
+					chunkIndices[index] -= chunk.BaseVertexIndex;
+				}
+
+				std::vector<uint32>& vertexOrder = chunkVertexOrders[chunkIndex];
+				if(bWeld)
+				{
+					WeldMergedSection(mergedChunks[chunkIndex], chunkIndices, numChunkIndices, lodModel.NumTexCoords, lodIndex, chunkIndex, vertexOrder);
+					outSectioning.bWelded |= !vertexOrder.empty();
+				}
+				if(bOptimize)
+				{
+					// Chain the fetch order onto the weld so the vertex remap table takes both in one go
+					std::vector<uint32> fetchOrder;
+					OptimizeMergedSection(mergedChunks[chunkIndex], chunkIndices, numChunkIndices, lodIndex, chunkIndex, bMoveVertices, fetchOrder);
+					if(vertexOrder.empty())
+					{
+						vertexOrder = MoveTemp(fetchOrder);
+					}
+					else if(!fetchOrder.empty())
+					{
+						for(uint32& newVertex : vertexOrder)
+						{
+							newVertex = fetchOrder[newVertex];
+						}
+					}
+				}
+				SectionedUVCore::RebaseIndices(chunkIndices, numChunkIndices, chunkBaseVertex, chunkIndices);
+				chunkBaseVertex += mergedChunks[chunkIndex].SoftVertices.Num();
+			}
 		}
 
-		// Add the merged section in at the end
-		mergedSections.BaseIndex = lodModel.IndexBuffer.Num();
-		mergedSections.BaseVertexIndex = lodModel.NumVertices;
-		for(const int32& indexToReinsert : mergedIndexBuffer)
+		// Add the merged sections in at the end, back to back
+		stageTimer.Next(SectionedUVStats::EStage::SectionMerge);
+		lodModel.IndexBuffer.SetNum(static_cast<int32>(numIndices + merge.MergedIndices.size()), false);
+		SectionedUVCore::RebaseIndices(merge.MergedIndices.data(), merge.MergedIndices.size(), lodModel.NumVertices, lodModel.IndexBuffer.GetData() + numIndices);
+		outSectioning.SectionedSectionIndex = lodModel.Sections.Num();
+		for(int32 chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
 		{
-			lodModel.IndexBuffer.Add(indexToReinsert + lodModel.NumVertices);
+			FSkelMeshSection& mergedChunk = mergedChunks[chunkIndex];
+			mergedChunk.BaseIndex = static_cast<uint32>(numIndices) + boneMerge.Chunks[chunkIndex].BaseIndex;
+			mergedChunk.BaseVertexIndex = lodModel.NumVertices;
+			lodModel.NumVertices += mergedChunk.GetNumVertices();
+			SectionedUVStats::AddBytesAllocated(mergedChunk.SoftVertices.Num() * sizeof(FSoftSkinVertex));
+			lodModel.Sections.Add(MoveTemp(mergedChunk));
 		}
-		const int32 sectionedSectionIndex = lodModel.Sections.Add(mergedSections);
-		lodModel.NumVertices += mergedSections.GetNumVertices();
 
 		// Cache off the number of verts to each section so we can re-offset the morph targets next
-		TArray<int32> sectionBaseVertices;
-		int32 accumVerts = 0;
+		stageTimer.Next(SectionedUVStats::EStage::MorphFixup);
+		std::vector<uint32>& sectionBaseVertices = outSectioning.SectionBaseVertices;
+		sectionBaseVertices.reserve(lodModel.Sections.Num());
+		uint32 accumVerts = 0;
 		for(FSkelMeshSection& section : lodModel.Sections)
 		{
-			sectionBaseVertices.Add(accumVerts);
+			sectionBaseVertices.push_back(accumVerts);
 			accumVerts += section.GetNumVertices();
 		}
 
-		// Fixup all of the morph targets with the new vertex offsets
-		for(UMorphTarget* morphTarget : morphTargets)
+		// Build the old to new vertex table once, every morph target of this LOD goes through it
+		outSectioning.bHasVertexRemap = SectionedUVCore::BuildVertexRemap(oldSections.data(), static_cast<int32>(oldSections.size()), merge, sectionBaseVertices.data(),
+																		  lodModel.Sections.Num(), outSectioning.SectionedSectionIndex, outSectioning.VertexRemap,
+																		  boneMerge.SectionChunk.data());
+		for(int32 chunkIndex = 0; outSectioning.bHasVertexRemap && chunkIndex < numChunks; ++chunkIndex)
 		{
-#if ENGINE_MAJOR_VERSION >= 5
-			if(!morphTarget->GetMorphLODModels().IsValidIndex(lodIndex))
-#else
-			if(!morphTarget->MorphLODModels.IsValidIndex(lodIndex))
-#endif
+			if(!chunkVertexOrders[chunkIndex].empty())
 			{
-				continue;
+				// The table was built from the chunk sizes before welding
+				const int32 chunkSectionIndex = outSectioning.SectionedSectionIndex + chunkIndex;
+				const uint32 oldBaseVertex = sectionBaseVertices[outSectioning.SectionedSectionIndex] + boneMerge.Chunks[chunkIndex].BaseVertexIndex;
+				SectionedUVCore::ReorderMergedVertices(outSectioning.VertexRemap, chunkSectionIndex, oldBaseVertex, sectionBaseVertices[chunkSectionIndex],
+													   chunkVertexOrders[chunkIndex].data());
 			}
-#if ENGINE_MAJOR_VERSION >= 5
-			FMorphTargetLODModel& morphLOD = morphTarget->GetMorphLODModels()[lodIndex];
-#else
-			FMorphTargetLODModel& morphLOD = morphTarget->MorphLODModels[lodIndex];
-#endif
-			morphLOD.SectionIndices.Empty();
-			for(FMorphTargetDelta& morphVert : morphLOD.Vertices)
+		}
+		SectionedUVStats::AddBytesAllocated(merge.MergedIndices.size() * sizeof(uint32) +
+											outSectioning.VertexRemap.OldToNewVertex.size() * sizeof(uint32) +
+											outSectioning.VertexRemap.NewSection.size() * sizeof(uint16));
+		outSectioning.bSectioned = true;
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Remaps one LOD of a morph target into the sectioned layout of that LOD
+	*/
+	static void RemapMorphTargetLOD(FMorphTargetLODModel& morphLOD, const FLODSectioning& sectioning)
+	{
+		morphLOD.SectionIndices.Empty();
+		SectionedUVStats::AddMorphDeltas(morphLOD.Vertices.Num());
+		if(morphLOD.Vertices.Num())
+		{
+			std::vector<int32> morphSectionIndices;
+			if(sectioning.bHasVertexRemap)
 			{
-				// Get the original section and vertex index
-				int32 outSectionIndex; int32 outVertIndex;
-				SectionedUVTools::GetSectionFromVertexIndex(sectionsCopy, morphVert.SourceIdx, outSectionIndex, outVertIndex);
+				SectionedUVCore::RemapMorphDeltas(&morphLOD.Vertices[0].SourceIdx, morphLOD.Vertices.Num(), sizeof(FMorphTargetDelta), sectioning.VertexRemap, morphSectionIndices);
 
-				// Translate into the new section locations
-				int32 foundNewIndex = oldToNewSectionMap[outSectionIndex];
-				int32 subSectionVertCount = 0;
-				if(foundNewIndex == INDEX_NONE)
+				// Welded vertices keep the delta of the first vertex welded into them
+				if(sectioning.bWelded)
 				{
-					foundNewIndex = sectionedSectionIndex;
-					subSectionVertCount = sectionedSectionMapping[outSectionIndex];
+					TBitArray<> movedVertices(false, static_cast<int32>(sectioning.VertexRemap.OldToNewVertex.size()));
+					morphLOD.Vertices.RemoveAll([&movedVertices](const FMorphTargetDelta& delta)
+					{
+						if(!movedVertices.IsValidIndex(static_cast<int32>(delta.SourceIdx)))
+						{
+							return false;
+						}
+						FBitReference moved = movedVertices[static_cast<int32>(delta.SourceIdx)];
+						const bool bDuplicate = moved;
+						moved = true;
+						return bDuplicate;
+					});
 				}
-
-				morphVert.SourceIdx = outVertIndex + sectionBaseVertices[foundNewIndex] + subSectionVertCount;
-				morphLOD.SectionIndices.AddUnique(foundNewIndex);
 			}
-			
-			morphTarget->PostEditChange();
+			else
+			{
+				// Too many sections for the table, fall back to searching the sections per delta
+				SectionedUVCore::RemapMorphSourceIndices(&morphLOD.Vertices[0].SourceIdx, morphLOD.Vertices.Num(), sizeof(FMorphTargetDelta),
+														 sectioning.OldSections.data(), static_cast<int32>(sectioning.OldSections.size()), sectioning.Merge,
+														 sectioning.SectionBaseVertices.data(), sectioning.SectionedSectionIndex, morphSectionIndices,
+														 sectioning.BoneMerge.SectionChunk.data());
+			}
+			morphLOD.SectionIndices.Append(morphSectionIndices.data(), static_cast<int32>(morphSectionIndices.size()));
 		}
-
-		++lodIndex;
 	}
 
-	// Push new GUID so the DDC gets updated
-	sectionedMesh->InvalidateDeriveDataCacheGUID();
-
-	// Post edit to rebuild the resources etc and mark dirty
-	sectionedMesh->PostEditChange();
-	sectionedMesh->MarkPackageDirty();
-
-	sectionedMesh->InitMorphTargets();
-
-	FAssetRegistryModule::AssetCreated(sectionedMesh);
-	return sectionedMesh;
-}
+#if ENGINE_MAJOR_VERSION >= 5
+	typedef FVector2f FMeshUV;
+	typedef FVector4f FMeshColor;
+#else
+	typedef FVector2D FMeshUV;
+	typedef FVector4 FMeshColor;
+#endif
 
-//--------------------------------------------------------------------------------------------------------------------
-/**
-*/
-UStaticMesh* USectionedUVToolsFunctionLibrary::CreateSectionedUVStaticMesh(UStaticMesh* staticMesh,
-																		   TArray<int32> materialSlots,
-																		   const int32 numSections)
-{
-	if(!staticMesh || !staticMesh->GetPackage())
+	/**
+	* Where a static mesh section came from once its LOD has been sectioned
+	*/
+	struct FStaticSectionRemap
 	{
-		return nullptr;
-	}
+		/** The section index before sectioning, INDEX_NONE for the new sectioned section */
+		int32 OldSectionIndex = INDEX_NONE;
+		/** The material index the section uses after sectioning */
+		int32 MaterialIndex = INDEX_NONE;
+	};
 
-	if(numSections < 2)
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Sections one static mesh LOD directly in its mesh description. The sectioned UV or section id is written straight
+	* into the vertex instance UVs or colors and the merged polygon groups are folded into one sectioned group per
+	* sectioned slot in place. Only touches the mesh description so LODs can run in parallel.
+	* @param sectionedMatIndex The material index of the first sectioned slot, the others follow it.
+	* @param groupSlotNames The slot name of each sectioned slot.
+	* @param atlasRegions Per UV section, the atlas region its UV0 is moved into. nullptr to leave UV0 alone.
+	* @param outSections Per polygon group left in the mesh, in section order, where it came from and its new material.
+	*/
+	static bool SectionMeshDescription(FMeshDescription& meshDescription,
+									   const TArray<FName>& sourceSlotNames,
+									   const SectionedUVCore::FSlotMapping& slotMapping,
+									   const int32 sectionedMatIndex,
+									   const TArray<FName>& groupSlotNames,
+									   const int32 sectionedUVChannel,
+									   const int32 numSections,
+									   const int32 numRows,
+									   const ESectionedUVEncoding encoding,
+									   const SectionedUVCore::FAtlasRegion* atlasRegions,
+									   TArray<FStaticSectionRemap>& outSections)
 	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. Number of sections should be greater than 2. 8 or 16 are good choices."));
-		return nullptr;
-	}
+		FStaticMeshAttributes attributes(meshDescription);
+		TPolygonGroupAttributesRef<FName> slotNames = attributes.GetPolygonGroupMaterialSlotNames();
+		TVertexInstanceAttributesRef<FMeshColor> vertexInstanceColors = attributes.GetVertexInstanceColors();
+		const int32 colorComponent = GetEncodedColorComponent(encoding);
 
-	for(FStaticMaterial& material : staticMesh->GetStaticMaterials())
-	{
-		if(material.MaterialSlotName == SectionedUVTools::SectionedSlotName)
+		TArrayView<FMeshUV> sectionedUVs;
+		if(colorComponent == INDEX_NONE)
 		{
-			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. Mesh already contains a 'sectioned' material slot!"));
-			return nullptr;
+			// Make sure each LOD has the sectioned UV as the same index
+			while(attributes.GetVertexInstanceUVs().GetNumChannels() <= sectionedUVChannel)
+			{
+				if(!FStaticMeshOperations::AddUVChannel(meshDescription))
+				{
+					return false;
+				}
+			}
+
+			// Start the sectioned channel off as a copy of UV0, the merged groups get their U squished below
+			TVertexInstanceAttributesRef<FMeshUV> vertexInstanceUVs = attributes.GetVertexInstanceUVs();
+			TArrayView<FMeshUV> uv0 = vertexInstanceUVs.GetRawArray(0);
+			sectionedUVs = vertexInstanceUVs.GetRawArray(sectionedUVChannel);
+			FMemory::Memcpy(sectionedUVs.GetData(), uv0.GetData(), uv0.Num() * sizeof(FMeshUV));
+			SectionedUVStats::AddBytesAllocated(sectionedUVs.Num() * sizeof(FMeshUV));
 		}
-	}
-	
-	if(materialSlots.Num())
-	{
-		const TArray<FStaticMaterial>& materials = staticMesh->GetStaticMaterials();
-		for(const int32& materialSlot : materialSlots)
+
+		// Vertex instances are shared by the polygons around them, each one only moves into the atlas once
+		TArrayView<FMeshUV> atlasUVs;
+		TBitArray<> atlasedInstances;
+		if(atlasRegions)
+		{
+			atlasUVs = attributes.GetVertexInstanceUVs().GetRawArray(0);
+			atlasedInstances.Init(false, atlasUVs.Num());
+		}
+
+		// Section order and material of each polygon group before anything moves, flat by group ID. The sectioned groups
+		// are created after the source groups so they get room at the end.
+		TArray<FStaticSectionRemap> groupRemaps;
+		TArray<int32> groupMaterials;
+		groupRemaps.SetNum(meshDescription.PolygonGroups().GetArraySize() + slotMapping.NumGroups);
+		groupMaterials.SetNumUninitialized(meshDescription.PolygonGroups().GetArraySize());
+		TArray<TArray<FPolygonGroupID>> mergedGroups;
+		mergedGroups.SetNum(slotMapping.NumGroups);
+		int32 sectionIndex = 0;
+		for(const FPolygonGroupID groupID : meshDescription.PolygonGroups().GetElementIDs())
 		{
-			if(!materials.IsValidIndex(materialSlot))
+			// Same lookup the static mesh build uses, slot name first and the group index if that fails
+			int32 materialIndex = sourceSlotNames.IndexOfByKey(slotNames[groupID]);
+			if(materialIndex == INDEX_NONE)
+			{
+				materialIndex = groupID.GetValue();
+			}
+			groupMaterials[groupID.GetValue()] = materialIndex;
+
+			if(SectionedUVCore::GetUVSection(slotMapping, materialIndex) == SectionedUVCore::InvalidIndex)
+			{
+				FStaticSectionRemap& remap = groupRemaps[groupID.GetValue()];
+				remap.OldSectionIndex = sectionIndex;
+				remap.MaterialIndex = slotMapping.SlotRemap.IsValidIndex(materialIndex) ? slotMapping.SlotRemap[materialIndex] : materialIndex;
+			}
+			else
 			{
-				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. Material slot index '%d' is invalid!"), materialSlot);
-				return nullptr;
+				mergedGroups[SectionedUVCore::GetSlotGroup(slotMapping, materialIndex)].Add(groupID);
 			}
+			++sectionIndex;
 		}
 
-		// Make sure the slots are in order so we can reverse remove them
-		Algo::Sort(materialSlots, [](const int32& a, const int32& b) -> bool
+		for(int32 group = 0; group < mergedGroups.Num(); ++group)
 		{
-			return a < b;
-		});
-	}
-	else
-	{
-		const TArray<FStaticMaterial>& materials = staticMesh->GetStaticMaterials();
-		for(int32 materialIndex = 0; materialIndex < materials.Num(); ++materialIndex)
+			if(!mergedGroups[group].Num())
+			{
+				continue;
+			}
+
+			const FPolygonGroupID sectionedGroupID = meshDescription.CreatePolygonGroup();
+			slotNames[sectionedGroupID] = groupSlotNames[group];
+			if(!groupRemaps.IsValidIndex(sectionedGroupID.GetValue()))
+			{
+				groupRemaps.SetNum(sectionedGroupID.GetValue() + 1);
+			}
+			groupRemaps[sectionedGroupID.GetValue()].MaterialIndex = sectionedMatIndex + group;
+
+			for(const FPolygonGroupID groupID : mergedGroups[group])
+			{
+				const int32 uvSection = SectionedUVCore::GetUVSection(slotMapping, groupMaterials[groupID.GetValue()]);
+				const float sectionMidX = SectionedUVCore::GetSectionCenterU(uvSection, numSections);
+				const float sectionMidY = SectionedUVCore::GetSectionCenterV(uvSection, numSections, numRows);
+				const float encodedColor = colorComponent != INDEX_NONE ? GetEncodedLinearColor(uvSection, colorComponent) : 0.0f;
+
+#if ENGINE_MAJOR_VERSION >= 5
+				const TArray<FPolygonID> polygonIDs(meshDescription.GetPolygonGroupPolygonIDs(groupID));
+#else
+				const TArray<FPolygonID> polygonIDs(meshDescription.GetPolygonGroupPolygons(groupID));
+#endif
+				for(const FPolygonID polygonID : polygonIDs)
+				{
+					for(const FVertexInstanceID vertexInstanceID : meshDescription.GetPolygonVertexInstances(polygonID))
+					{
+						const int32 instanceIndex = vertexInstanceID.GetValue();
+						if(atlasRegions && !atlasedInstances[instanceIndex])
+						{
+							atlasedInstances[instanceIndex] = true;
+							SectionedUVCore::WriteAtlasUVs(&atlasUVs[instanceIndex].X, 1, sizeof(FMeshUV), atlasRegions[uvSection]);
+						}
+
+						if(colorComponent != INDEX_NONE)
+						{
+							vertexInstanceColors[vertexInstanceID][colorComponent] = encodedColor;
+							continue;
+						}
+
+						sectionedUVs[instanceIndex].X = sectionMidX;
+						if(sectionMidY >= 0.0f)
+						{
+							sectionedUVs[instanceIndex].Y = sectionMidY;
+						}
+					}
+					meshDescription.SetPolygonPolygonGroup(polygonID, sectionedGroupID);
+				}
+				meshDescription.DeletePolygonGroup(groupID);
+			}
+		}
+
+		SectionedUVStats::AddVertices(meshDescription.VertexInstances().Num());
+		SectionedUVStats::AddIndices(meshDescription.Triangles().Num() * 3);
+
+		// Sections are built in polygon group order
+		outSections.Reset(meshDescription.PolygonGroups().Num());
+		for(const FPolygonGroupID groupID : meshDescription.PolygonGroups().GetElementIDs())
 		{
-			materialSlots.Add(materialIndex);
+			outSections.Add(groupRemaps[groupID.GetValue()]);
 		}
+		return true;
 	}
 
-	if(numSections < materialSlots.Num())
+	/** True for the slots sectioning creates, 'sectioned' and the per group 'sectioned_<group>' slots */
+	static bool IsSectionedSlotName(const FName slotName)
 	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. Number of sections needs to be greater than or equal to the number of materials!"));
-		return nullptr;
+		return slotName == SectionedSlotName || slotName.ToString().StartsWith(SectionedSlotName.ToString() + TEXT("_"));
 	}
 
-	TMap<int32, int32> matIndexToUVSection;
-	int32 curSectionIndex = 0;
-	for(const int32& materialSlot : materialSlots)
-	{
-		matIndexToUVSection.Add(materialSlot, curSectionIndex++);
-	}
-	
-	FString packageName = staticMesh->GetPackage()->GetPathName() + TEXT("_sectioned");
-	if(FindPackage(nullptr, *packageName))
+	/**
+	* What slots have to agree on to render the same out of one merged section
+	*/
+	struct FMaterialGroupKey
 	{
-		int32 sectionIndex = 1;
-		while(FindPackage(nullptr, *(packageName + FString::FromInt(sectionIndex))))
+		EBlendMode BlendMode = BLEND_Opaque;
+		uint16 ShadingModels = 0;
+		EMaterialShadingModel FirstShadingModel = MSM_DefaultLit;
+		bool bTwoSided = false;
+		EMaterialDomain Domain = MD_Surface;
+
+		bool operator==(const FMaterialGroupKey& other) const
 		{
-			++sectionIndex;
+			return BlendMode == other.BlendMode && ShadingModels == other.ShadingModels && bTwoSided == other.bTwoSided && Domain == other.Domain;
+		}
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Reads the group key of a slot's material. Empty slots render with the default surface material.
+	*/
+	static FMaterialGroupKey GetMaterialGroupKey(UMaterialInterface* materialInterface)
+	{
+		if(!materialInterface)
+		{
+			materialInterface = UMaterial::GetDefaultMaterial(MD_Surface);
+		}
+
+		FMaterialGroupKey key;
+		key.BlendMode = materialInterface->GetBlendMode();
+		key.ShadingModels = materialInterface->GetShadingModels().GetShadingModelField();
+		key.FirstShadingModel = materialInterface->GetShadingModels().GetFirstShadingModel();
+		key.bTwoSided = materialInterface->IsTwoSided();
+		if(const UMaterial* material = materialInterface->GetMaterial())
+		{
+			key.Domain = material->MaterialDomain;
 		}
-		packageName = packageName + FString::FromInt(sectionIndex);
+		return key;
 	}
 
-	UPackage* staticMeshPackage = CreatePackage(*packageName);
-	if(!staticMeshPackage)
+	/** The lower case name of an enum value without its prefix, BLEND_Masked -> masked */
+	template<typename TEnum>
+	static FString GetEnumSlotName(const TEnum value)
 	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create package for new sectioned mesh!"));
-		return nullptr;
+		FString name = StaticEnum<TEnum>()->GetNameStringByValue(static_cast<int64>(value));
+		int32 prefixEnd = INDEX_NONE;
+		if(name.FindChar(TEXT('_'), prefixEnd))
+		{
+			name = name.RightChop(prefixEnd + 1);
+		}
+		return name.ToLower();
 	}
-	
-	UStaticMesh* sectionedMesh = DuplicateObject<UStaticMesh>(staticMesh, staticMeshPackage, FName(*FPaths::GetBaseFilename(packageName)));
-	if(!sectionedMesh)
+
+	/** The sectioned slot name of a group, sectioned_opaque, sectioned_masked_twosided, sectioned_opaque_subsurface... */
+	static FString MakeGroupSlotName(const FMaterialGroupKey& key)
 	{
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create static mesh asset to make into a sectioned mesh!"));
-		return nullptr;
+		FString slotName = SectionedSlotName.ToString() + TEXT("_") + GetEnumSlotName(key.BlendMode);
+		if(key.ShadingModels != (1 << MSM_DefaultLit))
+		{
+			slotName += TEXT("_") + GetEnumSlotName(key.FirstShadingModel);
+		}
+		if(key.bTwoSided)
+		{
+			slotName += TEXT("_twosided");
+		}
+		if(key.Domain != MD_Surface)
+		{
+			slotName += TEXT("_") + GetEnumSlotName(key.Domain);
+		}
+		return slotName;
 	}
-	
-	if(!sectionedMesh->GetNumSourceModels())
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Groups the slots whose materials can share a merged section. A slot without a compatible slot to merge with is left alone.
+	* @param slotMaterials The material of each slot.
+	* @param outMaterialSlots The slots to merge, ascending.
+	* @param outSectionedSlotNames Per entry of outMaterialSlots, the sectioned slot it goes into.
+	*/
+	static void GroupSlotsByMaterial(const TArray<UMaterialInterface*>& slotMaterials, TArray<int32>& outMaterialSlots, TArray<FName>& outSectionedSlotNames)
 	{
-		sectionedMesh->ConditionalBeginDestroy();
-		staticMeshPackage->ConditionalBeginDestroy();
-		UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. No source models in this mesh?"));
-		return nullptr;
+		TArray<FMaterialGroupKey> groupKeys;
+		TArray<TArray<int32>> groupSlots;
+		for(int32 slotIndex = 0; slotIndex < slotMaterials.Num(); ++slotIndex)
+		{
+			const FMaterialGroupKey key = GetMaterialGroupKey(slotMaterials[slotIndex]);
+			int32 group = groupKeys.IndexOfByKey(key);
+			if(group == INDEX_NONE)
+			{
+				group = groupKeys.Add(key);
+				groupSlots.AddDefaulted();
+			}
+			groupSlots[group].Add(slotIndex);
+		}
+
+		TArray<FName> slotGroupNames;
+		slotGroupNames.SetNum(slotMaterials.Num());
+		TSet<FString> usedNames;
+		for(int32 group = 0; group < groupKeys.Num(); ++group)
+		{
+			if(groupSlots[group].Num() < 2)
+			{
+				continue;
+			}
+
+			// Keys only differing in the shading models past the first one would get the same name
+			const FString baseName = MakeGroupSlotName(groupKeys[group]);
+			FString slotName = baseName;
+			for(int32 suffix = 1; usedNames.Contains(slotName); ++suffix)
+			{
+				slotName = baseName + FString::FromInt(suffix);
+			}
+			usedNames.Add(slotName);
+
+			for(const int32 slotIndex : groupSlots[group])
+			{
+				slotGroupNames[slotIndex] = FName(*slotName);
+			}
+		}
+
+		outMaterialSlots.Reset();
+		outSectionedSlotNames.Reset();
+		for(int32 slotIndex = 0; slotIndex < slotGroupNames.Num(); ++slotIndex)
+		{
+			if(!slotGroupNames[slotIndex].IsNone())
+			{
+				outMaterialSlots.Add(slotIndex);
+				outSectionedSlotNames.Add(slotGroupNames[slotIndex]);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Checks the slots to merge and builds the slot mapping. Each distinct sectioned slot name becomes a group, numbered
+	* in order of first use.
+	* @param meshType "skeletal" or "static", for the errors.
+	* @param outGroupSlotNames The slot name of each group.
+	*/
+	static bool BuildSectionedSlotMapping(const TCHAR* meshType,
+										  const TArray<FName>& meshSlotNames,
+										  const TArray<int32>& materialSlots,
+										  const TArray<FName>& sectionedSlotNames,
+										  const int32 numSections,
+										  const int32 numRows,
+										  const ESectionedUVEncoding encoding,
+										  SectionedUVCore::FSlotMapping& outSlotMapping,
+										  TArray<FName>& outGroupSlotNames)
+	{
+		if(numSections < 2 || numRows < 1)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Number of sections should be at least 2 and number of rows at least 1. 8 or 16 are good choices."), meshType);
+			return false;
+		}
+
+		for(const FName slotName : meshSlotNames)
+		{
+			if(IsSectionedSlotName(slotName))
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Mesh already contains a '%s' material slot!"), meshType, *slotName.ToString());
+				return false;
+			}
+		}
+
+		TArray<int32> slotGroups;
+		TArray<int32> groupSlotCounts;
+		outGroupSlotNames.Reset();
+		for(const FName sectionedSlotName : sectionedSlotNames)
+		{
+			const int32 group = outGroupSlotNames.AddUnique(sectionedSlotName);
+			slotGroups.Add(group);
+			groupSlotCounts.SetNumZeroed(outGroupSlotNames.Num());
+			++groupSlotCounts[group];
+		}
+
+		for(int32 group = 0; group < outGroupSlotNames.Num(); ++group)
+		{
+			if(numSections * numRows < groupSlotCounts[group])
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Number of sections times number of rows needs to be greater than or equal to the number of materials going into '%s'!"),
+					   meshType, *outGroupSlotNames[group].ToString());
+				return false;
+			}
+
+			if(encoding != ESectionedUVEncoding::UVChannel && groupSlotCounts[group] > SectionedUVCore::MaxPackedSections)
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Vertex color encodings hold at most %d sections!"), meshType, SectionedUVCore::MaxPackedSections);
+				return false;
+			}
+		}
+
+		if(!SectionedUVCore::BuildGroupedSlotMapping(meshSlotNames.Num(), materialSlots.GetData(), slotGroups.GetData(), materialSlots.Num(), outSlotMapping))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Material slots should not be listed more than once!"), meshType);
+			return false;
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Checks the far LODs merging every slot into the first sectioned slot still fit in its UV sections.
+	* @param mergeAllFromLOD The first LOD which merges every slot, INDEX_NONE for none.
+	*/
+	static bool CheckMergeAllFromLOD(const TCHAR* meshType,
+									 const SectionedUVCore::FSlotMapping& slotMapping,
+									 const int32 numSections,
+									 const int32 numRows,
+									 const ESectionedUVEncoding encoding,
+									 const bool bAtlased,
+									 const int32 mergeAllFromLOD)
+	{
+		if(mergeAllFromLOD == INDEX_NONE)
+		{
+			return true;
+		}
+
+		if(mergeAllFromLOD < 0 || bAtlased)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. The LOD to merge every slot from should be -1 for none or a valid LOD, and atlased meshes cannot use it!"), meshType);
+			return false;
+		}
+
+		SectionedUVCore::FSlotMapping collapsedMapping;
+		const int32 numCollapsedSections = SectionedUVCore::BuildCollapsedSlotMapping(slotMapping, collapsedMapping);
+		if(numSections * numRows < numCollapsedSections)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Merging every slot from LOD %d needs %d sections, number of sections times number of rows is only %d!"),
+				   meshType, mergeAllFromLOD, numCollapsedSections, numSections * numRows);
+			return false;
+		}
+
+		if(encoding != ESectionedUVEncoding::UVChannel && numCollapsedSections > SectionedUVCore::MaxPackedSections)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Vertex color encodings hold at most %d sections!"), meshType, SectionedUVCore::MaxPackedSections);
+			return false;
+		}
+		return true;
 	}
 
-	int32 sectionedUVChannel = 0;
-	for(int32 sourceModelIndex = 0; sourceModelIndex < sectionedMesh->GetNumSourceModels(); ++sourceModelIndex)
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Checks the explicit slot list of the function library and sorts it, no slots means all of them
+	*/
+	static bool ResolveMaterialSlots(const TCHAR* meshType, const int32 numMaterials, TArray<int32>& materialSlots)
 	{
-		FStaticMeshSourceModel& srcModel = sectionedMesh->GetSourceModel(sourceModelIndex);
-		const int32 numUVChannels = sectionedMesh->GetNumUVChannels(sourceModelIndex);
-		if(sourceModelIndex == 0)
+		if(materialSlots.Num())
 		{
-			sectionedUVChannel = numUVChannels;
-			if(srcModel.BuildSettings.bGenerateLightmapUVs)
+			for(const int32& materialSlot : materialSlots)
 			{
-				// Make sure it is after the generated lightmap UV
-				sectionedUVChannel = srcModel.BuildSettings.DstLightmapIndex + 1;
-				if(numUVChannels > sectionedUVChannel)
+				if(materialSlot < 0 || materialSlot >= numMaterials)
 				{
-					// Extra channels were already added, so put us after that
-					sectionedUVChannel = numUVChannels;
+					UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the %s mesh. Material slot index '%d' is invalid!"), meshType, materialSlot);
+					return false;
 				}
 			}
+
+			// Make sure the slots are in order so we can reverse remove them
+			Algo::Sort(materialSlots, [](const int32& a, const int32& b) -> bool
+			{
+				return a < b;
+			});
 		}
-		if(numUVChannels == MAX_MESH_TEXTURE_COORDS || numUVChannels > sectionedUVChannel)
+		else
 		{
-			sectionedMesh->ConditionalBeginDestroy();
-			staticMeshPackage->ConditionalBeginDestroy();
-			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. The mesh cannot support a new UV channel because of max channel limit or inconsistent UV num per LOD!"));
-			return nullptr;
+			for(int32 materialIndex = 0; materialIndex < numMaterials; ++materialIndex)
+			{
+				materialSlots.Add(materialIndex);
+			}
 		}
+		return true;
+	}
 
-		// Make sure each LOD has the sectioned UV as the same index
-		for(int32 UVChan = numUVChannels; UVChan < sectionedUVChannel + 1; ++UVChan)
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The slot names of a static or skeletal mesh
+	*/
+	static TArray<FName> GetMeshSlotNames(UObject* mesh)
+	{
+		TArray<FName> meshSlotNames;
+		if(const USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(mesh))
+		{
+			for(const FSkeletalMaterial& material : skeletalMesh->GetMaterials())
+			{
+				meshSlotNames.Add(material.MaterialSlotName);
+			}
+		}
+		else if(UStaticMesh* staticMesh = Cast<UStaticMesh>(mesh))
 		{
-			//FStaticMeshOperations::AddUVChannel(*srcModel.MeshDescription);
-			sectionedMesh->AddUVChannel(sourceModelIndex);
+			for(const FStaticMaterial& material : staticMesh->GetStaticMaterials())
+			{
+				meshSlotNames.Add(material.MaterialSlotName);
+			}
 		}
+		return meshSlotNames;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Picks the slots a single mesh conversion merges and the sectioned slot each goes into. Either the passed in slots
+	* all go into the sectioned slot, or the slots are grouped by material like the auto conversions do.
+	*/
+	static bool ResolveSectionedSlots(UObject* mesh, const bool bAutoSlots, TArray<int32>& materialSlots, TArray<FName>& outSectionedSlotNames)
+	{
+		if(bAutoSlots)
+		{
+			materialSlots.Reset();
+			USectionedUVToolsFunctionLibrary::GetAutoSectionedSlots(mesh, materialSlots, outSectionedSlotNames);
+			if(!materialSlots.Num())
+			{
+				UE_LOG(LogSectionedUVTools, Warning, TEXT("No two material slots of '%s' render the same way, there is nothing to merge."), *mesh->GetPathName());
+				return false;
+			}
+			return true;
+		}
+
+		if(!ResolveMaterialSlots(Cast<USkeletalMesh>(mesh) ? TEXT("skeletal") : TEXT("static"), GetMeshSlotNames(mesh).Num(), materialSlots))
+		{
+			return false;
+		}
+		outSectionedSlotNames.Init(SectionedSlotName, materialSlots.Num());
+		return true;
 	}
-	
-	// Get rid of the material slots we are merging
-	TArray<FStaticMaterial>& materials = sectionedMesh->GetStaticMaterials();
 
-	// Add the new material for the sectioned mesh parts
-	const int32 sectionedMatIndex = materials.AddDefaulted();
-	materials[sectionedMatIndex].MaterialSlotName = SectionedUVTools::SectionedSlotName;
-	materials[sectionedMatIndex].UVChannelData = FMeshUVChannelInfo(1.0f);
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The inputs of a single mesh conversion and what they work out to, see PrepareSectionedMesh
+	*/
+	struct FPreparedMesh
+	{
+		/** The slots to merge, sorted ascending */
+		TArray<int32> MaterialSlots;
+		/** Per entry of MaterialSlots, the sectioned slot it goes into */
+		TArray<FName> SectionedSlotNames;
+		int32 NumSections = 16;
+		int32 NumRows = 1;
+		ESectionedUVEncoding Encoding = ESectionedUVEncoding::UVChannel;
+		int32 MergeAllFromLOD = INDEX_NONE;
+		bool bAtlased = false;
+
+		/** The slot mapping built from MaterialSlots */
+		SectionedUVCore::FSlotMapping SlotMapping;
+		/** The slot name of each group */
+		TArray<FName> GroupSlotNames;
+		FString SourceHash;
+		/** The package the sectioned mesh lives in */
+		FString PackageName;
+		/** The sectioned mesh made from the mesh before, nullptr if there is none */
+		UObject* ExistingMesh = nullptr;
+		/** ExistingMesh was made from the same inputs, there is nothing to convert */
+		bool bUpToDate = false;
+	};
 
-	// Create a mapping of what the material slots will be after to re-assign once we have removed the slots
-	TMap<int32, int32> slotRemap;
-	int32 actualSlotIndex = 0;
-	for(int32 materialSlotIndex = 0; materialSlotIndex < materials.Num() - 1; ++materialSlotIndex, ++actualSlotIndex)
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Checks the inputs of a single static or skeletal mesh conversion, builds its slot mapping and finds the sectioned
+	* mesh made from it before. The blocking and async conversions both start here, so they agree on when the existing
+	* sectioned mesh is up to date.
+	* @param materialSlots The slots to merge, sorted ascending.
+	* @param sectionedSlotNames Per entry of materialSlots, the sectioned slot it goes into.
+	* @param mergeAllFromLOD The first LOD which merges every slot into the first sectioned slot, INDEX_NONE for none.
+	* @param atlasLayout The atlas UV0 of the merged sections is moved into, nullptr for none.
+	*/
+	static bool PrepareSectionedMesh(UObject* mesh,
+									 const TArray<int32>& materialSlots,
+									 const TArray<FName>& sectionedSlotNames,
+									 const int32 numSections,
+									 const int32 numRows,
+									 const ESectionedUVEncoding encoding,
+									 const int32 mergeAllFromLOD,
+									 const SectionedUVAtlas::FAtlasLayout* atlasLayout,
+									 FPreparedMesh& outPrepared)
 	{
-		if(materialSlots.Contains(materialSlotIndex))
+		USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(mesh);
+		const TCHAR* meshType = skeletalMesh ? TEXT("skeletal") : TEXT("static");
+		outPrepared.MaterialSlots = materialSlots;
+		outPrepared.SectionedSlotNames = sectionedSlotNames;
+		outPrepared.NumSections = numSections;
+		outPrepared.NumRows = numRows;
+		outPrepared.Encoding = encoding;
+		outPrepared.MergeAllFromLOD = mergeAllFromLOD;
+		outPrepared.bAtlased = atlasLayout != nullptr;
+
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::SlotRemap);
+		if(!BuildSectionedSlotMapping(meshType, GetMeshSlotNames(mesh), materialSlots, sectionedSlotNames, numSections, numRows, encoding, outPrepared.SlotMapping, outPrepared.GroupSlotNames) ||
+		   !CheckMergeAllFromLOD(meshType, outPrepared.SlotMapping, numSections, numRows, encoding, outPrepared.bAtlased, mergeAllFromLOD))
 		{
-			--actualSlotIndex;
-			slotRemap.Add(materialSlotIndex, sectionedMatIndex);
+			return false;
 		}
-		else
+
+		if(atlasLayout && (outPrepared.GroupSlotNames.Num() != 1 || atlasLayout->Regions.size() != static_cast<size_t>(materialSlots.Num())))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot atlas the %s mesh. Every merged slot needs a region in the atlas of a single sectioned slot!"), meshType);
+			return false;
+		}
+
+		// Reuse the sectioned mesh made from this mesh before, there is nothing to do if its inputs did not change
+		stageTimer.Next(SectionedUVStats::EStage::Hash);
+		outPrepared.SourceHash = skeletalMesh ? SectionedUVCache::HashSkeletalMesh(skeletalMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, atlasLayout, mergeAllFromLOD)
+											  : SectionedUVCache::HashStaticMesh(CastChecked<UStaticMesh>(mesh), materialSlots, sectionedSlotNames, numSections, numRows, encoding, atlasLayout, mergeAllFromLOD);
+		outPrepared.ExistingMesh = SectionedUVCache::FindSectionedMesh(mesh, outPrepared.PackageName, TArray<UObject*>(), outPrepared.bAtlased);
+		outPrepared.bUpToDate = outPrepared.ExistingMesh && SectionedUVCache::IsUpToDate(outPrepared.ExistingMesh, outPrepared.SourceHash);
+		if(outPrepared.bUpToDate)
+		{
+			UE_LOG(LogSectionedUVTools, Log, TEXT("Sectioned mesh '%s' is up to date, skipping."), *outPrepared.ExistingMesh->GetPathName());
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Records the prepared inputs on a converted mesh and puts it in place of the existing sectioned mesh, see
+	* SectionedUVCache::FinishSectionedMesh
+	*/
+	static void FinishPreparedMesh(UObject* sectionedMesh, UObject* sourceMesh, const FPreparedMesh& prepared)
+	{
+		SectionedUVCache::FinishSectionedMesh(sectionedMesh, prepared.ExistingMesh, sourceMesh, prepared.SourceHash, prepared.MaterialSlots, prepared.SectionedSlotNames,
+											 prepared.NumSections, prepared.NumRows, prepared.Encoding);
+		if(USectionedUVAssetUserData* userData = SectionedUVCache::GetSectionedUserData(sectionedMesh))
 		{
-			slotRemap.Add(materialSlotIndex, actualSlotIndex);
+			userData->MergeAllFromLOD = prepared.MergeAllFromLOD;
+			userData->bAtlased = prepared.bAtlased;
 		}
 	}
 
-	// Remove the material slots we don't want
-	for(int32 materialSlotIndex = materialSlots.Num() - 1; materialSlotIndex >= 0; --materialSlotIndex)
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Sectioning state of one duplicated mesh, handed between the steps of SectionSkeletalMeshModel and
+	* SectionStaticMeshModel. The begin and commit steps touch UObjects and stay on the game thread. The convert step only
+	* touches the geometry of the duplicate, which nothing else references yet, so the async conversion runs it on a worker.
+	*/
+	struct FModelSectioning
+	{
+		/** The slots to merge, sorted ascending */
+		TArray<int32> MaterialSlots;
+		/** The slot mapping built from MaterialSlots */
+		SectionedUVCore::FSlotMapping SlotMapping;
+		/** The slot name of each group */
+		TArray<FName> GroupSlotNames;
+		int32 NumSections = 16;
+		int32 NumRows = 1;
+		ESectionedUVEncoding Encoding = ESectionedUVEncoding::UVChannel;
+		/** Per UV section, the atlas region its UV0 is moved into. nullptr to leave UV0 alone. */
+		const SectionedUVCore::FAtlasRegion* AtlasRegions = nullptr;
+		/** The first LOD which merges every slot into the first sectioned slot, INDEX_NONE to use SlotMapping on every LOD */
+		int32 MergeAllFromLOD = INDEX_NONE;
+		/** The mapping those LODs merge with, see SectionedUVCore::BuildCollapsedSlotMapping */
+		SectionedUVCore::FSlotMapping CollapsedSlotMapping;
+
+		/** The slot mapping of a LOD or static source model */
+		const SectionedUVCore::FSlotMapping& GetLODSlotMapping(const int32 lodIndex) const
+		{
+			return MergeAllFromLOD != INDEX_NONE && lodIndex >= MergeAllFromLOD ? CollapsedSlotMapping : SlotMapping;
+		}
+
+		/** Skeletal meshes */
+		FSkeletalMeshModel* SkelMeshModel = nullptr;
+		TArray<UMorphTarget*> MorphTargets;
+		TArray<TArray<FLODSectioning>> LODSectionings;
+
+		/** Static meshes */
+		TArray<FMeshDescription*> MeshDescriptions;
+		TArray<FName> SourceSlotNames;
+		int32 SectionedUVChannel = INDEX_NONE;
+		TArray<TArray<FStaticSectionRemap>> SectionRemaps;
+		TArray<bool> SectionedModels;
+		FMeshSectionInfoMap OldSectionInfoMap;
+
+		/** LODs, source models and morph targets converted so far, read by the game thread while a worker converts */
+		std::atomic<int32> NumConverted{0};
+		/** Set by the game thread to stop converting early, the duplicate is thrown away after */
+		std::atomic<bool> bCancelled{false};
+		/** The stats the threads converting count into */
+		SectionedUVStats::FConversion* Stats = nullptr;
+
+		int32 GetNumConvertSteps() const
+		{
+			return LODSectionings.Num() + MorphTargets.Num() + MeshDescriptions.Num();
+		}
+
+		/** One step per morph target or source model, then one to rebuild the mesh */
+		int32 GetNumCommitSteps() const
+		{
+			return MorphTargets.Num() + MeshDescriptions.Num() + 1;
+		}
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* True if half precision UVs would round the sectioned UV's section centers out of their sections. The engine stores
+	* every UV channel of a LOD at the same precision, so the sectioned channel follows UV0 unless the grid needs more.
+	*/
+	static bool NeedsFullPrecisionUVs(const FModelSectioning& sectioning)
 	{
-		materials.RemoveAt(materialSlots[materialSlotIndex]);
+		return sectioning.Encoding == ESectionedUVEncoding::UVChannel && !SectionedUVCore::AreSectionCentersHalfSafe(sectioning.NumSections, sectioning.NumRows);
 	}
-	
-	for(int32 sourceModelIndex = 0; sourceModelIndex < sectionedMesh->GetNumSourceModels(); ++sourceModelIndex)
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Logs what one LOD of the rebuilt render data costs on the GPU and adds it to the conversion stats
+	*/
+	static void ReportLODRenderData(const int32 lodIndex, const int64 numVertices, const int64 vertexBufferBytes, const int64 indexBufferBytes, const bool b32BitIndices, const bool bFullPrecisionUVs)
 	{
-#if ENGINE_MAJOR_VERSION >= 5
-		FStaticMeshSourceModel& sourceModel = sectionedMesh->GetSourceModel(sourceModelIndex);
-#else
-		FStaticMeshSourceModel& sourceModel = sectionedMesh->GetSourceModels()[sourceModelIndex];
-#endif
-		
-		FRawMesh outRawMesh;
-		sourceModel.LoadRawMesh(outRawMesh);
-
-		// Create a copy of the wedge texture coordinates. We will modify the ones using the new section material.
-		outRawMesh.WedgeTexCoords[sectionedUVChannel] = outRawMesh.WedgeTexCoords[0];
-
-		// Remap the material indices to the new reduced set
-		for(int32 faceIndex = 0; faceIndex < outRawMesh.FaceMaterialIndices.Num(); ++faceIndex)
-		{
-			int32& matIndex = outRawMesh.FaceMaterialIndices[faceIndex];
-			int32* sectionToUse = matIndexToUVSection.Find(matIndex);
-			matIndex = slotRemap[matIndex];
-			if(matIndex == sectionedMatIndex)
-			{
-				check(sectionToUse);
-				const float halfStride = (1.0f / numSections) / 2.0f;
-				const float sectionMidX = *sectionToUse * (1.0f / numSections) + halfStride;
-				
-				// Update the UVs for this face
-				const int32 firstWedgeIndex = faceIndex * 3;
-				for(int32 wedgeIndex = 0; wedgeIndex < 3; ++wedgeIndex)
+		SectionedUVStats::AddRenderData(numVertices, vertexBufferBytes, indexBufferBytes);
+		UE_LOG(LogSectionedUVTools, Log, TEXT("LOD %d: %lld vertices at %.1f bytes each, %s UVs, %s bit indices (%.2f MB)."),
+			   lodIndex, numVertices, numVertices ? static_cast<double>(vertexBufferBytes) / numVertices : 0.0, bFullPrecisionUVs ? TEXT("full precision") : TEXT("half precision"),
+			   b32BitIndices ? TEXT("32") : TEXT("16"), (vertexBufferBytes + indexBufferBytes) / (1024.0 * 1024.0));
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Reports every LOD of a rebuilt skeletal mesh, see ReportLODRenderData. The build picks 16 bit indices for any LOD
+	* with few enough vertices on its own.
+	*/
+	static void ReportSkeletalRenderData(USkeletalMesh* sectionedMesh)
+	{
+		FSkeletalMeshRenderData* renderData = sectionedMesh->GetResourceForRendering();
+		if(!renderData)
+		{
+			return;
+		}
+
+		for(int32 lodIndex = 0; lodIndex < renderData->LODRenderData.Num(); ++lodIndex)
+		{
+			const FSkeletalMeshLODRenderData& lodData = renderData->LODRenderData[lodIndex];
+			const FStaticMeshVertexBuffers& vertexBuffers = lodData.StaticVertexBuffers;
+			const int64 vertexBufferBytes = static_cast<int64>(vertexBuffers.PositionVertexBuffer.GetStride()) * vertexBuffers.PositionVertexBuffer.GetNumVertices() +
+											vertexBuffers.StaticMeshVertexBuffer.GetResourceSize() +
+											static_cast<int64>(vertexBuffers.ColorVertexBuffer.GetStride()) * vertexBuffers.ColorVertexBuffer.GetNumVertices() +
+											lodData.SkinWeightVertexBuffer.GetVertexDataSize();
+			const uint8 indexSize = lodData.MultiSizeIndexContainer.GetDataTypeSize();
+			const int64 numIndices = lodData.MultiSizeIndexContainer.IsIndexBufferValid() ? lodData.MultiSizeIndexContainer.GetIndexBuffer()->Num() : 0;
+			ReportLODRenderData(lodIndex, lodData.GetNumVertices(), vertexBufferBytes, numIndices * indexSize, indexSize == sizeof(uint32),
+								vertexBuffers.StaticMeshVertexBuffer.GetUseFullPrecisionUVs());
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Static mesh version of ReportSkeletalRenderData
+	*/
+	static void ReportStaticRenderData(UStaticMesh* sectionedMesh)
+	{
+		const FStaticMeshRenderData* renderData = sectionedMesh->GetRenderData();
+		if(!renderData)
+		{
+			return;
+		}
+
+		for(int32 lodIndex = 0; lodIndex < renderData->LODResources.Num(); ++lodIndex)
+		{
+			const FStaticMeshLODResources& lodResources = renderData->LODResources[lodIndex];
+			const FStaticMeshVertexBuffers& vertexBuffers = lodResources.VertexBuffers;
+			const int64 vertexBufferBytes = static_cast<int64>(vertexBuffers.PositionVertexBuffer.GetStride()) * vertexBuffers.PositionVertexBuffer.GetNumVertices() +
+											vertexBuffers.StaticMeshVertexBuffer.GetResourceSize() +
+											static_cast<int64>(vertexBuffers.ColorVertexBuffer.GetStride()) * vertexBuffers.ColorVertexBuffer.GetNumVertices();
+			ReportLODRenderData(lodIndex, lodResources.GetNumVertices(), vertexBufferBytes, lodResources.IndexBuffer.GetIndexDataSize(), lodResources.IndexBuffer.Is32Bit(),
+								vertexBuffers.StaticMeshVertexBuffer.GetUseFullPrecisionUVs());
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Replaces the merged material slots of a skeletal mesh's duplicate and gathers what the convert step works on.
+	*/
+	static bool BeginSkeletalMeshModel(USkeletalMesh* sectionedMesh, FModelSectioning& sectioning)
+	{
+		sectioning.SkelMeshModel = sectionedMesh->GetImportedModel();
+		if(!sectioning.SkelMeshModel)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the skeletal mesh. No imported model on original skeletal mesh?!"));
+			return false;
+		}
+
+		// Every group's pass has to succeed on every LOD, check what they can fail on before anything is changed so a
+		// failed conversion never leaves earlier groups merged and the slots moved
+		for(int32 lodIndex = 0; lodIndex < sectioning.SkelMeshModel->LODModels.Num(); ++lodIndex)
+		{
+			const FSkeletalMeshLODModel& lodModel = sectioning.SkelMeshModel->LODModels[lodIndex];
+			for(const FSkelMeshSection& section : lodModel.Sections)
+			{
+				if(static_cast<int64>(section.BaseIndex) + static_cast<int64>(section.NumTriangles) * 3 > lodModel.IndexBuffer.Num())
+				{
+					UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the skeletal mesh. LOD %d has sections outside of its index buffer!"), lodIndex);
+					return false;
+				}
+			}
+		}
+
+		// Get rid of the material slots we are merging
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::SlotRemap);
+		TArray<FSkeletalMaterial>& materials = sectionedMesh->GetMaterials();
+
+		// Remove the material slots we don't want
+		for(int32 materialSlotIndex = sectioning.MaterialSlots.Num() - 1; materialSlotIndex >= 0; --materialSlotIndex)
+		{
+			materials.RemoveAt(sectioning.MaterialSlots[materialSlotIndex]);
+		}
+
+		// Add the new materials for the sectioned mesh parts, one per group right after the kept slots
+		for(const FName groupSlotName : sectioning.GroupSlotNames)
+		{
+			materials.Emplace(nullptr, true, false, groupSlotName, groupSlotName);
+		}
+
+		// Half precision UVs hold any grid the tools are normally used with, huge grids need the LODs at full precision
+		if(NeedsFullPrecisionUVs(sectioning))
+		{
+			for(int32 lodIndex = 0; lodIndex < sectionedMesh->GetLODNum(); ++lodIndex)
+			{
+				FSkeletalMeshLODInfo* lodInfo = sectionedMesh->GetLODInfo(lodIndex);
+				if(lodInfo && !lodInfo->BuildSettings.bUseFullPrecisionUVs)
 				{
-					outRawMesh.WedgeTexCoords[sectionedUVChannel][firstWedgeIndex + wedgeIndex].X = sectionMidX;
+					UE_LOG(LogSectionedUVTools, Warning, TEXT("Half precision UVs cannot tell %d x %d sections apart, LOD %d of the sectioned mesh uses full precision UVs."),
+						   sectioning.NumSections, sectioning.NumRows, lodIndex);
+					lodInfo->BuildSettings.bUseFullPrecisionUVs = true;
 				}
 			}
 		}
 
-		sourceModel.SaveRawMesh(outRawMesh);
+		const TArray<UMorphTarget*>& morphTargets = sectionedMesh->GetMorphTargets();
+		sectioning.MorphTargets = morphTargets;
+		sectioning.LODSectionings.SetNum(sectioning.SkelMeshModel->LODModels.Num());
+		return true;
 	}
 
-	// Post edit to rebuild the resources etc and mark dirty
-	sectionedMesh->PostEditChange();
-	sectionedMesh->MarkPackageDirty();
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Merges the sections of every LOD and remaps the morph targets onto them. Only touches the duplicate's LOD models
+	* and morph target deltas, so it can run on any thread.
+	*/
+	static void ConvertSkeletalMeshModel(FModelSectioning& sectioning)
+	{
+		// Merge the sections which will use the new sectioned materials, one group after the other. Each LOD only touches its own model.
+		FSkeletalMeshModel* skelMeshModel = sectioning.SkelMeshModel;
+		const SectionedUVCore::FSlotMapping& slotMapping = sectioning.SlotMapping;
+		const int32 maxBonesPerSection = FGPUBaseSkinVertexFactory::GetMaxGPUSkinBones();
+		ParallelFor(skelMeshModel->LODModels.Num(), [&](int32 lodIndex)
+		{
+			const SectionedUVStats::FConversionScope statsScope(sectioning.Stats);
+			if(sectioning.bCancelled)
+			{
+				return;
+			}
+
+			// Far LODs merge everything in a single pass into the first sectioned slot, its pass slot is the same in both mappings
+			FSkeletalMeshLODModel& lodModel = skelMeshModel->LODModels[lodIndex];
+			const SectionedUVCore::FSlotMapping& lodSlotMapping = sectioning.GetLODSlotMapping(lodIndex);
+			TArray<FLODSectioning>& groupSectionings = sectioning.LODSectionings[lodIndex];
+			groupSectionings.SetNum(lodSlotMapping.NumGroups);
+			SectionedUVCore::FSlotMapping passMapping;
+			for(int32 group = 0; group < lodSlotMapping.NumGroups; ++group)
+			{
+				// Every pass has the same slot count, so the pass mapping's tables are only allocated once per LOD
+				SectionedUVCore::BuildGroupPassMapping(lodSlotMapping, group, passMapping);
+				if(!SectionLODModel(lodModel, lodIndex, passMapping, SectionedUVCore::GetPassGroupSlot(slotMapping, group), sectioning.NumSections, sectioning.NumRows,
+									sectioning.Encoding, maxBonesPerSection, group == 0, sectioning.AtlasRegions, groupSectionings[group]))
+				{
+					break;
+				}
+			}
+
+			// The passes keep the source slot numbers, move everything onto the final slots
+			for(FSkelMeshSection& section : lodModel.Sections)
+			{
+				section.MaterialIndex = static_cast<uint16>(SectionedUVCore::GetGroupedMaterialIndex(slotMapping, section.MaterialIndex));
+			}
+			++sectioning.NumConverted;
+		}, GetParallelForFlags());
 
-	FAssetRegistryModule::AssetCreated(sectionedMesh);
-	
-	return sectionedMesh;
-}
+		for(const FSkeletalMeshLODModel& lodModel : skelMeshModel->LODModels)
+		{
+			SectionedUVStats::AddVertices(lodModel.NumVertices);
+			SectionedUVStats::AddIndices(lodModel.IndexBuffer.Num());
+		}
+
+		// Fixup all of the morph targets with the new vertex offsets, through each group's pass in order. Each morph target only touches its own LOD models.
+		const TArray<TArray<FLODSectioning>>& lodSectionings = sectioning.LODSectionings;
+		ParallelFor(sectioning.MorphTargets.Num(), [&](int32 morphIndex)
+		{
+			const SectionedUVStats::FConversionScope statsScope(sectioning.Stats);
+			SECTIONEDUV_STAGE_SCOPE(MorphFixup);
+			UMorphTarget* morphTarget = sectioning.MorphTargets[morphIndex];
+			if(!morphTarget || sectioning.bCancelled)
+			{
+				return;
+			}
+
+#if ENGINE_MAJOR_VERSION >= 5
+			TArray<FMorphTargetLODModel>& morphLODModels = morphTarget->GetMorphLODModels();
+#else
+			TArray<FMorphTargetLODModel>& morphLODModels = morphTarget->MorphLODModels;
+#endif
+			for(int32 lodIndex = 0; lodIndex < lodSectionings.Num() && lodIndex < morphLODModels.Num(); ++lodIndex)
+			{
+				for(const FLODSectioning& lodSectioning : lodSectionings[lodIndex])
+				{
+					if(lodSectioning.bSectioned)
+					{
+						RemapMorphTargetLOD(morphLODModels[lodIndex], lodSectioning);
+					}
+				}
+			}
+			++sectioning.NumConverted;
+		}, GetParallelForFlags());
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* One commit step of a converted skeletal mesh, see FModelSectioning::GetNumCommitSteps. Each morph target is
+	* post edited on its own step, the last step rebuilds the mesh.
+	*/
+	static void CommitSkeletalMeshModel(USkeletalMesh* sectionedMesh, const FModelSectioning& sectioning, const int32 step)
+	{
+		if(step < sectioning.MorphTargets.Num())
+		{
+			SECTIONEDUV_STAGE_SCOPE(MorphFixup);
+			if(UMorphTarget* morphTarget = sectioning.MorphTargets[step])
+			{
+				morphTarget->PostEditChange();
+			}
+			return;
+		}
+
+		// The section ids need the vertex colors to make it into the render data
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::Build);
+		if(sectioning.Encoding != ESectionedUVEncoding::UVChannel)
+		{
+#if ENGINE_MAJOR_VERSION >= 5
+			sectionedMesh->SetHasVertexColors(true);
+#else
+			sectionedMesh->bHasVertexColors = true;
+#endif
+		}
+
+		// Push new GUID so the DDC gets updated
+		sectionedMesh->InvalidateDeriveDataCacheGUID();
+
+		// Post edit to rebuild the resources etc and mark dirty
+		sectionedMesh->PostEditChange();
+		sectionedMesh->MarkPackageDirty();
+
+		stageTimer.Next(SectionedUVStats::EStage::InitMorphTargets);
+		sectionedMesh->InitMorphTargets();
+		stageTimer.Stop();
+
+		ReportSkeletalRenderData(sectionedMesh);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Fills in what every mesh type's sectioning starts from
+	*/
+	static void InitModelSectioning(FModelSectioning& sectioning,
+									const TArray<int32>& materialSlots,
+									const SectionedUVCore::FSlotMapping& slotMapping,
+									const TArray<FName>& groupSlotNames,
+									const int32 numSections,
+									const int32 numRows,
+									const ESectionedUVEncoding encoding,
+									const SectionedUVCore::FAtlasRegion* atlasRegions,
+									const int32 mergeAllFromLOD)
+	{
+		sectioning.MaterialSlots = materialSlots;
+		sectioning.SlotMapping = slotMapping;
+		sectioning.GroupSlotNames = groupSlotNames;
+		sectioning.NumSections = numSections;
+		sectioning.NumRows = numRows;
+		sectioning.Encoding = encoding;
+		sectioning.AtlasRegions = atlasRegions;
+		sectioning.MergeAllFromLOD = mergeAllFromLOD;
+		sectioning.Stats = SectionedUVStats::GetCurrentConversion();
+		if(mergeAllFromLOD != INDEX_NONE)
+		{
+			SectionedUVCore::BuildCollapsedSlotMapping(slotMapping, sectioning.CollapsedSlotMapping);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Sections the duplicate of a skeletal mesh in place, merging each group of slots into its own sectioned slot.
+	* @param materialSlots The slots to merge, sorted ascending.
+	* @param slotMapping The slot mapping built from materialSlots.
+	* @param groupSlotNames The slot name of each group.
+	* @param atlasRegions Per UV section, the atlas region its UV0 is moved into. nullptr to leave UV0 alone.
+	* @param mergeAllFromLOD The first LOD which merges every slot into the first sectioned slot, INDEX_NONE for none.
+	*/
+	static bool SectionSkeletalMeshModel(USkeletalMesh* sectionedMesh,
+										 const TArray<int32>& materialSlots,
+										 const SectionedUVCore::FSlotMapping& slotMapping,
+										 const TArray<FName>& groupSlotNames,
+										 const int32 numSections,
+										 const int32 numRows,
+										 const ESectionedUVEncoding encoding,
+										 const SectionedUVCore::FAtlasRegion* atlasRegions,
+										 const int32 mergeAllFromLOD = INDEX_NONE)
+	{
+		FModelSectioning sectioning;
+		InitModelSectioning(sectioning, materialSlots, slotMapping, groupSlotNames, numSections, numRows, encoding, atlasRegions, mergeAllFromLOD);
+		if(!BeginSkeletalMeshModel(sectionedMesh, sectioning))
+		{
+			return false;
+		}
+
+		ConvertSkeletalMeshModel(sectioning);
+		for(int32 step = 0; step < sectioning.GetNumCommitSteps(); ++step)
+		{
+			CommitSkeletalMeshModel(sectionedMesh, sectioning, step);
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Sections a skeletal mesh, merging each group of slots into its own sectioned slot.
+	* @param materialSlots The slots to merge, sorted ascending.
+	* @param sectionedSlotNames Per entry of materialSlots, the sectioned slot it goes into.
+	* @param mergeAllFromLOD The first LOD which merges every slot into the first sectioned slot, INDEX_NONE for none.
+	* @param atlasLayout The atlas to move UV0 of the merged sections into and bake their materials into, nullptr for none.
+	*                    Only a single sectioned slot can be atlased.
+	*/
+	static USkeletalMesh* SectionSkeletalMesh(USkeletalMesh* skeletalMesh,
+											  const TArray<int32>& materialSlots,
+											  const TArray<FName>& sectionedSlotNames,
+											  const int32 numSections,
+											  const int32 numRows,
+											  const ESectionedUVEncoding encoding,
+											  const int32 mergeAllFromLOD,
+											  const SectionedUVAtlas::FAtlasLayout* atlasLayout)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(SectionedUV_SectionSkeletalMesh, SectionedUVChannel);
+		SectionedUVStats::FScopedConversion conversion;
+
+		FPreparedMesh prepared;
+		if(!PrepareSectionedMesh(skeletalMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergeAllFromLOD, atlasLayout, prepared))
+		{
+			return nullptr;
+		}
+
+		USkeletalMesh* existingMesh = Cast<USkeletalMesh>(prepared.ExistingMesh);
+		if(prepared.bUpToDate)
+		{
+			conversion.Finish(true);
+			return existingMesh;
+		}
+
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::Duplicate);
+		USkeletalMesh* sectionedMesh = Cast<USkeletalMesh>(SectionedUVCache::DuplicateSourceMesh(skeletalMesh, existingMesh, prepared.PackageName));
+		stageTimer.Stop();
+		if(!sectionedMesh)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create skeletal mesh asset to make into a sectioned mesh!"));
+			return nullptr;
+		}
+
+		if(!SectionSkeletalMeshModel(sectionedMesh, materialSlots, prepared.SlotMapping, prepared.GroupSlotNames, numSections, numRows, encoding, atlasLayout ? atlasLayout->Regions.data() : nullptr, mergeAllFromLOD))
+		{
+			SectionedUVCache::DiscardSectionedMesh(sectionedMesh, existingMesh);
+			return nullptr;
+		}
+
+		// Bake while the existing mesh is still in place, a failed bake leaves it untouched
+		if(atlasLayout && !SectionedUVAtlas::BakeAtlasMaterial(sectionedMesh, prepared.PackageName, prepared.GroupSlotNames[0], *atlasLayout))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot atlas the skeletal mesh. Baking the atlas of '%s' failed!"), *prepared.PackageName);
+			SectionedUVCache::DiscardSectionedMesh(sectionedMesh, existingMesh);
+			return nullptr;
+		}
+
+		FinishPreparedMesh(sectionedMesh, skeletalMesh, prepared);
+		conversion.Finish();
+		return sectionedMesh;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Static mesh version of BeginSkeletalMeshModel. Picks the sectioned UV channel and loads the mesh descriptions,
+	* which touches the mesh so it stays on the game thread.
+	*/
+	static bool BeginStaticMeshModel(UStaticMesh* sectionedMesh, FModelSectioning& sectioning)
+	{
+		if(!sectionedMesh->GetNumSourceModels())
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. No source models in this mesh?"));
+			return false;
+		}
+
+		// The sectioned UV goes after every existing channel, color encodings don't need one
+		int32& sectionedUVChannel = sectioning.SectionedUVChannel;
+		if(sectioning.Encoding == ESectionedUVEncoding::UVChannel)
+		{
+			for(int32 sourceModelIndex = 0; sourceModelIndex < sectionedMesh->GetNumSourceModels(); ++sourceModelIndex)
+			{
+				FStaticMeshSourceModel& srcModel = sectionedMesh->GetSourceModel(sourceModelIndex);
+				const int32 numUVChannels = sectionedMesh->GetNumUVChannels(sourceModelIndex);
+				if(sourceModelIndex == 0)
+				{
+					sectionedUVChannel = numUVChannels;
+					if(srcModel.BuildSettings.bGenerateLightmapUVs)
+					{
+						// Make sure it is after the generated lightmap UV
+						sectionedUVChannel = srcModel.BuildSettings.DstLightmapIndex + 1;
+						if(numUVChannels > sectionedUVChannel)
+						{
+							// Extra channels were already added, so put us after that
+							sectionedUVChannel = numUVChannels;
+						}
+					}
+				}
+				if(numUVChannels == MAX_MESH_TEXTURE_COORDS || numUVChannels > sectionedUVChannel)
+				{
+					UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. The mesh cannot support a new UV channel because of max channel limit or inconsistent UV num per LOD!"));
+					return false;
+				}
+
+				// Half precision UVs hold any grid the tools are normally used with, huge grids need the LOD at full precision
+				if(NeedsFullPrecisionUVs(sectioning) && !srcModel.BuildSettings.bUseFullPrecisionUVs)
+				{
+					UE_LOG(LogSectionedUVTools, Warning, TEXT("Half precision UVs cannot tell %d x %d sections apart, LOD %d of the sectioned mesh uses full precision UVs."),
+						   sectioning.NumSections, sectioning.NumRows, sourceModelIndex);
+					srcModel.BuildSettings.bUseFullPrecisionUVs = true;
+				}
+
+			}
+		}
+
+		// Grab the mesh descriptions up front, loading them touches the mesh so it stays on this thread
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::SectionMerge);
+		for(int32 sourceModelIndex = 0; sourceModelIndex < sectionedMesh->GetNumSourceModels(); ++sourceModelIndex)
+		{
+			sectioning.MeshDescriptions.Add(sectionedMesh->GetMeshDescription(sourceModelIndex));
+		}
+		sectioning.SectionRemaps.SetNum(sectioning.MeshDescriptions.Num());
+		sectioning.SectionedModels.Init(false, sectioning.MeshDescriptions.Num());
+
+		// Slot names before the merge, polygon groups find their material through these
+		stageTimer.Next(SectionedUVStats::EStage::SlotRemap);
+		for(const FStaticMaterial& material : sectionedMesh->GetStaticMaterials())
+		{
+			sectioning.SourceSlotNames.Add(material.ImportedMaterialSlotName);
+		}
+
+		// Get rid of the material slots we are merging
+		TArray<FStaticMaterial>& materials = sectionedMesh->GetStaticMaterials();
+
+		// Add the new materials for the sectioned mesh parts, one per group
+		for(const FName groupSlotName : sectioning.GroupSlotNames)
+		{
+			FStaticMaterial& sectionedMaterial = materials.AddDefaulted_GetRef();
+			sectionedMaterial.MaterialSlotName = groupSlotName;
+			sectionedMaterial.ImportedMaterialSlotName = groupSlotName;
+			sectionedMaterial.UVChannelData = FMeshUVChannelInfo(1.0f);
+		}
+
+		// Remove the material slots we don't want
+		for(int32 materialSlotIndex = sectioning.MaterialSlots.Num() - 1; materialSlotIndex >= 0; --materialSlotIndex)
+		{
+			materials.RemoveAt(sectioning.MaterialSlots[materialSlotIndex]);
+		}
+
+		// The sections are pointed at their new slots as each source model is committed
+		FMeshSectionInfoMap& sectionInfoMap = sectionedMesh->GetSectionInfoMap();
+		sectioning.OldSectionInfoMap = sectionInfoMap;
+		sectionInfoMap.Clear();
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Static mesh version of ConvertSkeletalMeshModel. Only touches the duplicate's mesh descriptions.
+	*/
+	static void ConvertStaticMeshModel(FModelSectioning& sectioning)
+	{
+		// Each source model only touches its own mesh description so they can all be converted at once
+		ParallelFor(sectioning.MeshDescriptions.Num(), [&](int32 sourceModelIndex)
+		{
+			const SectionedUVStats::FConversionScope statsScope(sectioning.Stats);
+			SECTIONEDUV_STAGE_SCOPE(SectionMerge);
+			if(sectioning.MeshDescriptions[sourceModelIndex] && !sectioning.bCancelled)
+			{
+				sectioning.SectionedModels[sourceModelIndex] = SectionMeshDescription(*sectioning.MeshDescriptions[sourceModelIndex], sectioning.SourceSlotNames, sectioning.GetLODSlotMapping(sourceModelIndex),
+																					  sectioning.SlotMapping.NumKeptSlots, sectioning.GroupSlotNames, sectioning.SectionedUVChannel,
+																					  sectioning.NumSections, sectioning.NumRows, sectioning.Encoding, sectioning.AtlasRegions,
+																					  sectioning.SectionRemaps[sourceModelIndex]);
+			}
+			++sectioning.NumConverted;
+		}, GetParallelForFlags());
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* True if every source model with a mesh description was sectioned. The merged slots are already gone from the
+	* duplicate and its section info map is cleared, so a source model which failed cannot be committed as it was.
+	*/
+	static bool CheckStaticMeshModel(const FModelSectioning& sectioning)
+	{
+		for(int32 sourceModelIndex = 0; sourceModelIndex < sectioning.MeshDescriptions.Num(); ++sourceModelIndex)
+		{
+			if(sectioning.MeshDescriptions[sourceModelIndex] && !sectioning.SectionedModels[sourceModelIndex])
+			{
+				UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section the static mesh. Unable to section LOD %d!"), sourceModelIndex);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Static mesh version of CommitSkeletalMeshModel. Each source model's mesh description is committed on its own step.
+	* Only commit after CheckStaticMeshModel passed.
+	*/
+	static void CommitStaticMeshModel(UStaticMesh* sectionedMesh, const FModelSectioning& sectioning, const int32 sourceModelIndex)
+	{
+		// Commit the edits and point the sections at their new material slots
+		SECTIONEDUV_STAGE_SCOPE(Build);
+		FMeshSectionInfoMap& sectionInfoMap = sectionedMesh->GetSectionInfoMap();
+		if(sourceModelIndex < sectioning.MeshDescriptions.Num())
+		{
+			const TArray<FStaticSectionRemap>& sectionRemap = sectioning.SectionRemaps[sourceModelIndex];
+			for(int32 sectionIndex = 0; sectionIndex < sectionRemap.Num(); ++sectionIndex)
+			{
+				const FStaticSectionRemap& remap = sectionRemap[sectionIndex];
+				FMeshSectionInfo sectionInfo = remap.OldSectionIndex != INDEX_NONE ? sectioning.OldSectionInfoMap.Get(sourceModelIndex, remap.OldSectionIndex) : FMeshSectionInfo();
+				sectionInfo.MaterialIndex = remap.MaterialIndex;
+				sectionInfoMap.Set(sourceModelIndex, sectionIndex, sectionInfo);
+			}
+
+			if(sectioning.MeshDescriptions[sourceModelIndex])
+			{
+				sectionedMesh->CommitMeshDescription(sourceModelIndex);
+			}
+			return;
+		}
+		sectionedMesh->GetOriginalSectionInfoMap().CopyFrom(sectionInfoMap);
+
+		// Post edit to rebuild the resources etc and mark dirty
+		sectionedMesh->PostEditChange();
+		sectionedMesh->MarkPackageDirty();
+
+		ReportStaticRenderData(sectionedMesh);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Static mesh version of SectionSkeletalMeshModel
+	*/
+	static bool SectionStaticMeshModel(UStaticMesh* sectionedMesh,
+									   const TArray<int32>& materialSlots,
+									   const SectionedUVCore::FSlotMapping& slotMapping,
+									   const TArray<FName>& groupSlotNames,
+									   const int32 numSections,
+									   const int32 numRows,
+									   const ESectionedUVEncoding encoding,
+									   const SectionedUVCore::FAtlasRegion* atlasRegions,
+									   const int32 mergeAllFromLOD = INDEX_NONE)
+	{
+		FModelSectioning sectioning;
+		InitModelSectioning(sectioning, materialSlots, slotMapping, groupSlotNames, numSections, numRows, encoding, atlasRegions, mergeAllFromLOD);
+		if(!BeginStaticMeshModel(sectionedMesh, sectioning))
+		{
+			return false;
+		}
+
+		ConvertStaticMeshModel(sectioning);
+		if(!CheckStaticMeshModel(sectioning))
+		{
+			return false;
+		}
+
+		for(int32 step = 0; step < sectioning.GetNumCommitSteps(); ++step)
+		{
+			CommitStaticMeshModel(sectionedMesh, sectioning, step);
+		}
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Static mesh version of SectionSkeletalMesh
+	*/
+	static UStaticMesh* SectionStaticMesh(UStaticMesh* staticMesh,
+										  const TArray<int32>& materialSlots,
+										  const TArray<FName>& sectionedSlotNames,
+										  const int32 numSections,
+										  const int32 numRows,
+										  const ESectionedUVEncoding encoding,
+										  const int32 mergeAllFromLOD,
+										  const SectionedUVAtlas::FAtlasLayout* atlasLayout)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(SectionedUV_SectionStaticMesh, SectionedUVChannel);
+		SectionedUVStats::FScopedConversion conversion;
+
+		FPreparedMesh prepared;
+		if(!PrepareSectionedMesh(staticMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergeAllFromLOD, atlasLayout, prepared))
+		{
+			return nullptr;
+		}
+
+		UStaticMesh* existingMesh = Cast<UStaticMesh>(prepared.ExistingMesh);
+		if(prepared.bUpToDate)
+		{
+			conversion.Finish(true);
+			return existingMesh;
+		}
+
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::Duplicate);
+		UStaticMesh* sectionedMesh = Cast<UStaticMesh>(SectionedUVCache::DuplicateSourceMesh(staticMesh, existingMesh, prepared.PackageName));
+		stageTimer.Stop();
+		if(!sectionedMesh)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create static mesh asset to make into a sectioned mesh!"));
+			return nullptr;
+		}
+
+		if(!SectionStaticMeshModel(sectionedMesh, materialSlots, prepared.SlotMapping, prepared.GroupSlotNames, numSections, numRows, encoding, atlasLayout ? atlasLayout->Regions.data() : nullptr, mergeAllFromLOD))
+		{
+			SectionedUVCache::DiscardSectionedMesh(sectionedMesh, existingMesh);
+			return nullptr;
+		}
+
+		// Bake while the existing mesh is still in place, a failed bake leaves it untouched
+		if(atlasLayout && !SectionedUVAtlas::BakeAtlasMaterial(sectionedMesh, prepared.PackageName, prepared.GroupSlotNames[0], *atlasLayout))
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot atlas the static mesh. Baking the atlas of '%s' failed!"), *prepared.PackageName);
+			SectionedUVCache::DiscardSectionedMesh(sectionedMesh, existingMesh);
+			return nullptr;
+		}
+
+		FinishPreparedMesh(sectionedMesh, staticMesh, prepared);
+		conversion.Finish();
+		return sectionedMesh;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* The meshes after the first one, which is the source mesh of a merged mesh
+	*/
+	template<typename TMesh>
+	static TArray<UObject*> GetMergedMeshes(const TArray<TMesh*>& meshes)
+	{
+		TArray<UObject*> mergedMeshes;
+		for(int32 meshIndex = 1; meshIndex < meshes.Num(); ++meshIndex)
+		{
+			mergedMeshes.Add(meshes[meshIndex]);
+		}
+		return mergedMeshes;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Merges several skeletal meshes into one and sections it over their combined slots.
+	* @param materialSlots The combined slots to merge, sorted ascending.
+	* @param sectionedSlotNames Per entry of materialSlots, the sectioned slot it goes into.
+	*/
+	static USkeletalMesh* SectionMergedSkeletalMesh(const TArray<USkeletalMesh*>& skeletalMeshes,
+													const SectionedUVMerge::FMergedSlots& mergedSlots,
+													const TArray<int32>& materialSlots,
+													const TArray<FName>& sectionedSlotNames,
+													const int32 numSections,
+													const int32 numRows,
+													const ESectionedUVEncoding encoding)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(SectionedUV_SectionMergedSkeletalMesh, SectionedUVChannel);
+		SectionedUVStats::FScopedConversion conversion;
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::SlotRemap);
+
+		TArray<FName> meshSlotNames;
+		for(const SectionedUVMerge::FMergedSlot& mergedSlot : mergedSlots.Slots)
+		{
+			meshSlotNames.Add(mergedSlot.SlotName);
+		}
+
+		SectionedUVCore::FSlotMapping slotMapping;
+		TArray<FName> groupSlotNames;
+		if(!BuildSectionedSlotMapping(TEXT("skeletal"), meshSlotNames, materialSlots, sectionedSlotNames, numSections, numRows, encoding, slotMapping, groupSlotNames))
+		{
+			return nullptr;
+		}
+
+		// Reuse the sectioned mesh made from these meshes before, there is nothing to do if its inputs did not change
+		stageTimer.Next(SectionedUVStats::EStage::Hash);
+		const FString sourceHash = SectionedUVCache::HashMergedSkeletalMesh(skeletalMeshes, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+		const TArray<UObject*> mergedMeshes = GetMergedMeshes(skeletalMeshes);
+		FString packageName;
+		USkeletalMesh* existingMesh = Cast<USkeletalMesh>(SectionedUVCache::FindSectionedMesh(skeletalMeshes[0], packageName, mergedMeshes));
+		if(existingMesh && SectionedUVCache::IsUpToDate(existingMesh, sourceHash))
+		{
+			UE_LOG(LogSectionedUVTools, Log, TEXT("Sectioned mesh '%s' is up to date, skipping."), *existingMesh->GetPathName());
+			conversion.Finish(true);
+			return existingMesh;
+		}
+
+		stageTimer.Next(SectionedUVStats::EStage::Duplicate);
+		USkeletalMesh* sectionedMesh = Cast<USkeletalMesh>(SectionedUVCache::DuplicateSourceMesh(skeletalMeshes[0], existingMesh, packageName));
+		stageTimer.Stop();
+		if(!sectionedMesh)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create skeletal mesh asset to make into a sectioned mesh!"));
+			return nullptr;
+		}
+
+		stageTimer.Next(SectionedUVStats::EStage::Append);
+		const bool bAppended = SectionedUVMerge::AppendSkeletalMeshes(sectionedMesh, skeletalMeshes, mergedSlots);
+		stageTimer.Stop();
+		if(!bAppended ||
+		   !SectionSkeletalMeshModel(sectionedMesh, materialSlots, slotMapping, groupSlotNames, numSections, numRows, encoding, nullptr))
+		{
+			SectionedUVCache::DiscardSectionedMesh(sectionedMesh, existingMesh);
+			return nullptr;
+		}
+
+		SectionedUVCache::FinishSectionedMesh(sectionedMesh, existingMesh, skeletalMeshes[0], sourceHash, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergedMeshes);
+		conversion.Finish();
+		return sectionedMesh;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------
+	/**
+	* Static mesh version of SectionMergedSkeletalMesh
+	* @param transforms The transform of each mesh relative to the merged mesh.
+	*/
+	static UStaticMesh* SectionMergedStaticMesh(const TArray<UStaticMesh*>& staticMeshes,
+												const TArray<FTransform>& transforms,
+												const SectionedUVMerge::FMergedSlots& mergedSlots,
+												const TArray<int32>& materialSlots,
+												const TArray<FName>& sectionedSlotNames,
+												const int32 numSections,
+												const int32 numRows,
+												const ESectionedUVEncoding encoding)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(SectionedUV_SectionMergedStaticMesh, SectionedUVChannel);
+		SectionedUVStats::FScopedConversion conversion;
+		SectionedUVStats::FStageTimer stageTimer(SectionedUVStats::EStage::SlotRemap);
+
+		TArray<FName> meshSlotNames;
+		for(const SectionedUVMerge::FMergedSlot& mergedSlot : mergedSlots.Slots)
+		{
+			meshSlotNames.Add(mergedSlot.SlotName);
+		}
+
+		SectionedUVCore::FSlotMapping slotMapping;
+		TArray<FName> groupSlotNames;
+		if(!BuildSectionedSlotMapping(TEXT("static"), meshSlotNames, materialSlots, sectionedSlotNames, numSections, numRows, encoding, slotMapping, groupSlotNames))
+		{
+			return nullptr;
+		}
+
+		// Reuse the sectioned mesh made from these meshes before, there is nothing to do if its inputs did not change
+		stageTimer.Next(SectionedUVStats::EStage::Hash);
+		const FString sourceHash = SectionedUVCache::HashMergedStaticMesh(staticMeshes, transforms, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+		const TArray<UObject*> mergedMeshes = GetMergedMeshes(staticMeshes);
+		FString packageName;
+		UStaticMesh* existingMesh = Cast<UStaticMesh>(SectionedUVCache::FindSectionedMesh(staticMeshes[0], packageName, mergedMeshes));
+		if(existingMesh && SectionedUVCache::IsUpToDate(existingMesh, sourceHash))
+		{
+			UE_LOG(LogSectionedUVTools, Log, TEXT("Sectioned mesh '%s' is up to date, skipping."), *existingMesh->GetPathName());
+			conversion.Finish(true);
+			return existingMesh;
+		}
+
+		stageTimer.Next(SectionedUVStats::EStage::Duplicate);
+		UStaticMesh* sectionedMesh = Cast<UStaticMesh>(SectionedUVCache::DuplicateSourceMesh(staticMeshes[0], existingMesh, packageName));
+		stageTimer.Stop();
+		if(!sectionedMesh)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create static mesh asset to make into a sectioned mesh!"));
+			return nullptr;
+		}
+
+		stageTimer.Next(SectionedUVStats::EStage::Append);
+		const bool bAppended = SectionedUVMerge::AppendStaticMeshes(sectionedMesh, staticMeshes, transforms, mergedSlots);
+		stageTimer.Stop();
+		if(!bAppended ||
+		   !SectionStaticMeshModel(sectionedMesh, materialSlots, slotMapping, groupSlotNames, numSections, numRows, encoding, nullptr))
+		{
+			SectionedUVCache::DiscardSectionedMesh(sectionedMesh, existingMesh);
+			return nullptr;
+		}
+
+		SectionedUVCache::FinishSectionedMesh(sectionedMesh, existingMesh, staticMeshes[0], sourceHash, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergedMeshes);
+		conversion.Finish();
+		return sectionedMesh;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USkeletalMesh* USectionedUVToolsFunctionLibrary::CreateSectionedUVSkeletalMesh(USkeletalMesh* skeletalMesh,
+																			   TArray<int32> materialSlots,
+																			   const int32 numSections,
+																			   const int32 numRows,
+																			   const ESectionedUVEncoding encoding,
+																			   const int32 mergeAllFromLOD)
+{
+	if(!skeletalMesh || !skeletalMesh->GetPackage())
+	{
+		return nullptr;
+	}
+
+	TArray<FName> sectionedSlotNames;
+	if(!SectionedUVTools::ResolveSectionedSlots(skeletalMesh, false, materialSlots, sectionedSlotNames))
+	{
+		return nullptr;
+	}
+	return SectionedUVTools::SectionSkeletalMesh(skeletalMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergeAllFromLOD, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USkeletalMesh* USectionedUVToolsFunctionLibrary::CreateAutoSectionedUVSkeletalMesh(USkeletalMesh* skeletalMesh,
+																				   const int32 numSections,
+																				   const int32 numRows,
+																				   const ESectionedUVEncoding encoding,
+																				   const int32 mergeAllFromLOD)
+{
+	if(!skeletalMesh || !skeletalMesh->GetPackage())
+	{
+		return nullptr;
+	}
+
+	TArray<int32> materialSlots;
+	TArray<FName> sectionedSlotNames;
+	if(!SectionedUVTools::ResolveSectionedSlots(skeletalMesh, true, materialSlots, sectionedSlotNames))
+	{
+		return nullptr;
+	}
+	return SectionedUVTools::SectionSkeletalMesh(skeletalMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergeAllFromLOD, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+UStaticMesh* USectionedUVToolsFunctionLibrary::CreateSectionedUVStaticMesh(UStaticMesh* staticMesh,
+																		   TArray<int32> materialSlots,
+																		   const int32 numSections,
+																		   const int32 numRows,
+																		   const ESectionedUVEncoding encoding,
+																		   const int32 mergeAllFromLOD)
+{
+	if(!staticMesh || !staticMesh->GetPackage())
+	{
+		return nullptr;
+	}
+
+	TArray<FName> sectionedSlotNames;
+	if(!SectionedUVTools::ResolveSectionedSlots(staticMesh, false, materialSlots, sectionedSlotNames))
+	{
+		return nullptr;
+	}
+	return SectionedUVTools::SectionStaticMesh(staticMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergeAllFromLOD, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+UStaticMesh* USectionedUVToolsFunctionLibrary::CreateAutoSectionedUVStaticMesh(UStaticMesh* staticMesh,
+																			   const int32 numSections,
+																			   const int32 numRows,
+																			   const ESectionedUVEncoding encoding,
+																			   const int32 mergeAllFromLOD)
+{
+	if(!staticMesh || !staticMesh->GetPackage())
+	{
+		return nullptr;
+	}
+
+	TArray<int32> materialSlots;
+	TArray<FName> sectionedSlotNames;
+	if(!SectionedUVTools::ResolveSectionedSlots(staticMesh, true, materialSlots, sectionedSlotNames))
+	{
+		return nullptr;
+	}
+	return SectionedUVTools::SectionStaticMesh(staticMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, mergeAllFromLOD, nullptr);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USkeletalMesh* USectionedUVToolsFunctionLibrary::CreateSectionedUVMergedSkeletalMesh(TArray<USkeletalMesh*> skeletalMeshes,
+																					 TArray<int32> materialSlots,
+																					 const int32 numSections,
+																					 const int32 numRows,
+																					 const ESectionedUVEncoding encoding)
+{
+	if(!skeletalMeshes.Num() || skeletalMeshes.Contains(nullptr) || !skeletalMeshes[0]->GetPackage())
+	{
+		return nullptr;
+	}
+
+	// Nothing to merge, this is a regular conversion and shares its sectioned mesh
+	if(skeletalMeshes.Num() == 1)
+	{
+		return CreateSectionedUVSkeletalMesh(skeletalMeshes[0], materialSlots, numSections, numRows, encoding);
+	}
+
+	if(!SectionedUVMerge::CanMergeSkeletalMeshes(skeletalMeshes))
+	{
+		return nullptr;
+	}
+
+	SectionedUVMerge::FMergedSlots mergedSlots;
+	SectionedUVMerge::BuildMergedSlots(TArray<UObject*>(skeletalMeshes), mergedSlots);
+	if(!SectionedUVTools::ResolveMaterialSlots(TEXT("skeletal"), mergedSlots.Slots.Num(), materialSlots))
+	{
+		return nullptr;
+	}
+
+	TArray<FName> sectionedSlotNames;
+	sectionedSlotNames.Init(SectionedUVTools::SectionedSlotName, materialSlots.Num());
+	return SectionedUVTools::SectionMergedSkeletalMesh(skeletalMeshes, mergedSlots, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+UStaticMesh* USectionedUVToolsFunctionLibrary::CreateSectionedUVMergedStaticMesh(TArray<UStaticMesh*> staticMeshes,
+																				 TArray<FTransform> transforms,
+																				 TArray<int32> materialSlots,
+																				 const int32 numSections,
+																				 const int32 numRows,
+																				 const ESectionedUVEncoding encoding)
+{
+	if(!staticMeshes.Num() || staticMeshes.Contains(nullptr) || !staticMeshes[0]->GetPackage())
+	{
+		return nullptr;
+	}
+
+	// Nothing to merge, this is a regular conversion and shares its sectioned mesh
+	if(staticMeshes.Num() == 1)
+	{
+		return CreateSectionedUVStaticMesh(staticMeshes[0], materialSlots, numSections, numRows, encoding);
+	}
+
+	SectionedUVMerge::FMergedSlots mergedSlots;
+	SectionedUVMerge::BuildMergedSlots(TArray<UObject*>(staticMeshes), mergedSlots);
+	if(!SectionedUVTools::ResolveMaterialSlots(TEXT("static"), mergedSlots.Slots.Num(), materialSlots))
+	{
+		return nullptr;
+	}
+
+	TArray<FName> sectionedSlotNames;
+	sectionedSlotNames.Init(SectionedUVTools::SectionedSlotName, materialSlots.Num());
+	return SectionedUVTools::SectionMergedStaticMesh(staticMeshes, transforms, mergedSlots, materialSlots, sectionedSlotNames, numSections, numRows, encoding);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USkeletalMesh* USectionedUVToolsFunctionLibrary::CreateAtlasedUVSkeletalMesh(USkeletalMesh* skeletalMesh,
+																			 TArray<int32> materialSlots,
+																			 UMaterialInterface* parentMaterial,
+																			 const int32 maxSectionSize,
+																			 const int32 padding,
+																			 const int32 numSections,
+																			 const int32 numRows,
+																			 const ESectionedUVEncoding encoding)
+{
+	if(!skeletalMesh || !skeletalMesh->GetPackage())
+	{
+		return nullptr;
+	}
+
+	if(!SectionedUVTools::ResolveMaterialSlots(TEXT("skeletal"), skeletalMesh->GetMaterials().Num(), materialSlots))
+	{
+		return nullptr;
+	}
+
+	// A single sectioned slot hands out UV sections in slot order, so the atlas rectangles follow the slots
+	TArray<UMaterialInterface*> sectionMaterials;
+	for(const int32 materialSlot : materialSlots)
+	{
+		sectionMaterials.Add(skeletalMesh->GetMaterials()[materialSlot].MaterialInterface);
+	}
+
+	SectionedUVAtlas::FAtlasLayout atlasLayout;
+	if(!SectionedUVAtlas::BuildAtlasLayout(sectionMaterials, parentMaterial, maxSectionSize, padding, atlasLayout))
+	{
+		return nullptr;
+	}
+
+	TArray<FName> sectionedSlotNames;
+	sectionedSlotNames.Init(SectionedUVTools::SectionedSlotName, materialSlots.Num());
+	return SectionedUVTools::SectionSkeletalMesh(skeletalMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, INDEX_NONE, &atlasLayout);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+UStaticMesh* USectionedUVToolsFunctionLibrary::CreateAtlasedUVStaticMesh(UStaticMesh* staticMesh,
+																		 TArray<int32> materialSlots,
+																		 UMaterialInterface* parentMaterial,
+																		 const int32 maxSectionSize,
+																		 const int32 padding,
+																		 const int32 numSections,
+																		 const int32 numRows,
+																		 const ESectionedUVEncoding encoding)
+{
+	if(!staticMesh || !staticMesh->GetPackage())
+	{
+		return nullptr;
+	}
+
+	if(!SectionedUVTools::ResolveMaterialSlots(TEXT("static"), staticMesh->GetStaticMaterials().Num(), materialSlots))
+	{
+		return nullptr;
+	}
+
+	TArray<UMaterialInterface*> sectionMaterials;
+	for(const int32 materialSlot : materialSlots)
+	{
+		sectionMaterials.Add(staticMesh->GetStaticMaterials()[materialSlot].MaterialInterface);
+	}
+
+	SectionedUVAtlas::FAtlasLayout atlasLayout;
+	if(!SectionedUVAtlas::BuildAtlasLayout(sectionMaterials, parentMaterial, maxSectionSize, padding, atlasLayout))
+	{
+		return nullptr;
+	}
+
+	TArray<FName> sectionedSlotNames;
+	sectionedSlotNames.Init(SectionedUVTools::SectionedSlotName, materialSlots.Num());
+	return SectionedUVTools::SectionStaticMesh(staticMesh, materialSlots, sectionedSlotNames, numSections, numRows, encoding, INDEX_NONE, &atlasLayout);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+UMaterialInstanceConstant* USectionedUVToolsFunctionLibrary::CreateSectionedUVTextureArrayMaterial(UObject* sectionedMesh,
+																								   UMaterialInterface* parentMaterial,
+																								   const FName sectionedSlotName,
+																								   const int32 textureSize)
+{
+	return SectionedUVTextureArrays::CreateTextureArrayMaterial(sectionedMesh, parentMaterial, sectionedSlotName, textureSize);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVToolsFunctionLibrary::GetMergedMaterialSlots(const TArray<UObject*>& meshes, TArray<FName>& outSlotNames)
+{
+	outSlotNames.Reset();
+	if(meshes.Contains(nullptr))
+	{
+		return;
+	}
+
+	SectionedUVMerge::FMergedSlots mergedSlots;
+	SectionedUVMerge::BuildMergedSlots(meshes, mergedSlots);
+	for(const SectionedUVMerge::FMergedSlot& mergedSlot : mergedSlots.Slots)
+	{
+		outSlotNames.Add(mergedSlot.SlotName);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+FSectionedUVConversionStats USectionedUVToolsFunctionLibrary::GetLastConversionStats()
+{
+	return SectionedUVStats::GetLastConversionStats();
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVToolsFunctionLibrary::GetAutoSectionedSlots(UObject* mesh, TArray<int32>& outMaterialSlots, TArray<FName>& outSectionedSlotNames)
+{
+	TArray<UMaterialInterface*> slotMaterials;
+	if(USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(mesh))
+	{
+		for(const FSkeletalMaterial& material : skeletalMesh->GetMaterials())
+		{
+			slotMaterials.Add(material.MaterialInterface);
+		}
+	}
+	else if(UStaticMesh* staticMesh = Cast<UStaticMesh>(mesh))
+	{
+		for(const FStaticMaterial& material : staticMesh->GetStaticMaterials())
+		{
+			slotMaterials.Add(material.MaterialInterface);
+		}
+	}
+	SectionedUVTools::GroupSlotsByMaterial(slotMaterials, outMaterialSlots, outSectionedSlotNames);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+bool USectionedUVToolsFunctionLibrary::IsSectionedMesh(UObject* mesh)
+{
+	if(USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(mesh))
+	{
+		for(const FSkeletalMaterial& material : skeletalMesh->GetMaterials())
+		{
+			if(SectionedUVTools::IsSectionedSlotName(material.MaterialSlotName))
+			{
+				return true;
+			}
+		}
+	}
+	else if(UStaticMesh* staticMesh = Cast<UStaticMesh>(mesh))
+	{
+		for(const FStaticMaterial& material : staticMesh->GetStaticMaterials())
+		{
+			if(SectionedUVTools::IsSectionedSlotName(material.MaterialSlotName))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+int32 USectionedUVToolsFunctionLibrary::InstanceSectionedStaticMeshActors(UWorld* world,
+																		  const int32 numSections,
+																		  const int32 minInstances,
+																		  const float clusterSize,
+																		  const bool bHierarchical,
+																		  const FName colorParameterName,
+																		  const int32 firstDataIndex)
+{
+	SectionedUVInstancing::FSettings settings;
+	settings.NumSections = numSections;
+	settings.MinInstances = minInstances;
+	settings.ClusterSize = clusterSize;
+	settings.bHierarchical = bHierarchical;
+	settings.ColorParameterName = colorParameterName;
+	settings.FirstDataIndex = firstDataIndex;
+
+	TArray<UStaticMesh*> sectionedMeshes;
+	return SectionedUVInstancing::InstanceStaticMeshActors(world, settings, sectionedMeshes);
+}
+
+#define LOCTEXT_NAMESPACE "SectionedUVTools"
+
+namespace SectionedUVTools
+{
+	static TAutoConsoleVariable<float> CVarAsyncSliceMilliseconds(
+		TEXT("SectionedUVTools.AsyncSliceMilliseconds"),
+		10.0f,
+		TEXT("Game thread time async conversions may take per tick. Steps are never split, so a slow one can run over."));
+
+	/** Async conversions waiting to run, the first one is running */
+	static TArray<TSharedRef<FSectionedUVAsyncConversion>> AsyncConversionQueue;
+	static bool bAsyncQueueTicking = false;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+FSectionedUVAsyncConversion::FSectionedUVAsyncConversion()
+	: Sectioning(MakeUnique<SectionedUVTools::FModelSectioning>())
+	, Prepared(MakeUnique<SectionedUVTools::FPreparedMesh>())
+	, Stats(MakeUnique<SectionedUVStats::FConversion>())
+{
+	Sectioning->Stats = Stats.Get();
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+FSectionedUVAsyncConversion::~FSectionedUVAsyncConversion()
+{
+	// The worker converts straight into the sectioning state
+	if(Worker.IsValid())
+	{
+		Worker.Wait();
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+TSharedRef<FSectionedUVAsyncConversion> FSectionedUVAsyncConversion::Start(UObject* mesh,
+																			const TArray<int32>& materialSlots,
+																			const bool bAutoSlots,
+																			const int32 numSections,
+																			const int32 numRows,
+																			const ESectionedUVEncoding encoding)
+{
+	check(IsInGameThread());
+
+	TSharedRef<FSectionedUVAsyncConversion> conversion = MakeShareable(new FSectionedUVAsyncConversion());
+	conversion->MeshName = GetNameSafe(mesh);
+	conversion->SourceMesh.Reset(mesh);
+	conversion->MaterialSlots = materialSlots;
+	conversion->bAutoSlots = bAutoSlots;
+	conversion->Sectioning->NumSections = numSections;
+	conversion->Sectioning->NumRows = numRows;
+	conversion->Sectioning->Encoding = encoding;
+
+	// The notification shows from the moment the conversion is queued, so queued conversions can be cancelled too
+	if(FSlateApplication::IsInitialized() && !IsRunningCommandlet())
+	{
+		FNotificationInfo info(FText::GetEmpty());
+		info.bFireAndForget = false;
+		info.ExpireDuration = 3.0f;
+		info.ButtonDetails.Add(FNotificationButtonInfo(LOCTEXT("CancelSectioning", "Cancel"),
+													   LOCTEXT("CancelSectioningTooltip", "Stop sectioning this mesh, nothing is saved"),
+													   FSimpleDelegate::CreateSP(conversion, &FSectionedUVAsyncConversion::Cancel),
+													   SNotificationItem::CS_Pending));
+		conversion->Notification = FSlateNotificationManager::Get().AddNotification(info);
+		if(conversion->Notification)
+		{
+			conversion->Notification->SetCompletionState(SNotificationItem::CS_Pending);
+		}
+	}
+	conversion->UpdateNotification();
+
+	SectionedUVTools::AsyncConversionQueue.Add(conversion);
+	if(!SectionedUVTools::bAsyncQueueTicking)
+	{
+		SectionedUVTools::bAsyncQueueTicking = true;
+#if ENGINE_MAJOR_VERSION >= 5
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FSectionedUVAsyncConversion::TickQueue));
+#else
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FSectionedUVAsyncConversion::TickQueue));
+#endif
+	}
+	return conversion;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+TFuture<UObject*> FSectionedUVAsyncConversion::GetFuture()
+{
+	return Promise.GetFuture();
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void FSectionedUVAsyncConversion::Cancel()
+{
+	if(State == EState::Done)
+	{
+		return;
+	}
+
+	// A running worker sees this between LODs and morph targets, the game thread steps check it before doing anything
+	bCancelRequested = true;
+	Sectioning->bCancelled = true;
+	if(State == EState::Queued)
+	{
+		UE_LOG(LogSectionedUVTools, Display, TEXT("Sectioning '%s' was cancelled."), *MeshName);
+		Complete(nullptr);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+* Duplicating and rebuilding the mesh take about as long as sectioning its geometry, the progress is weighted to match
+*/
+float FSectionedUVAsyncConversion::GetProgress() const
+{
+	switch(State)
+	{
+	case EState::Queued:
+		return 0.0f;
+	case EState::Duplicate:
+		return 0.05f;
+	case EState::Begin:
+		return 0.1f;
+	case EState::Convert:
+	{
+		const int32 numConvertSteps = Sectioning->GetNumConvertSteps();
+		return 0.1f + 0.7f * (numConvertSteps ? static_cast<float>(Sectioning->NumConverted) / numConvertSteps : 1.0f);
+	}
+	case EState::Commit:
+		return 0.8f + 0.2f * static_cast<float>(CommitStep) / Sectioning->GetNumCommitSteps();
+	default:
+		return 1.0f;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+bool FSectionedUVAsyncConversion::TickQueue(float deltaTime)
+{
+	TArray<TSharedRef<FSectionedUVAsyncConversion>>& queue = SectionedUVTools::AsyncConversionQueue;
+	const auto isDone = [](const TSharedRef<FSectionedUVAsyncConversion>& queued)
+	{
+		return queued->IsDone();
+	};
+
+	// Conversions cancelled while queued completed right away, they are dropped without stepping
+	queue.RemoveAll(isDone);
+	const double endSeconds = FPlatformTime::Seconds() + SectionedUVTools::CVarAsyncSliceMilliseconds.GetValueOnGameThread() / 1000.0;
+	while(queue.Num() && FPlatformTime::Seconds() < endSeconds)
+	{
+		// Completing calls out, which may queue or cancel more conversions
+		TSharedRef<FSectionedUVAsyncConversion> conversion = queue[0];
+		const bool bContinue = conversion->Step();
+		if(!conversion->IsDone())
+		{
+			conversion->UpdateNotification();
+			conversion->OnProgress.ExecuteIfBound(conversion->GetProgress());
+		}
+
+		queue.RemoveAll(isDone);
+
+		// Waiting on the worker, check back next tick
+		if(!bContinue && !conversion->IsDone())
+		{
+			break;
+		}
+	}
+
+	SectionedUVTools::bAsyncQueueTicking = queue.Num() > 0;
+	return SectionedUVTools::bAsyncQueueTicking;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+* Checks the mesh and the slots, then skips the conversion if the existing sectioned mesh is up to date. Prepared the
+* same way as the blocking conversions, see SectionedUVTools::PrepareSectionedMesh.
+*/
+bool FSectionedUVAsyncConversion::Prepare()
+{
+	SectionedUVTools::FModelSectioning& sectioning = *Sectioning;
+	UObject* mesh = SourceMesh.Get();
+	if((!Cast<USkeletalMesh>(mesh) && !Cast<UStaticMesh>(mesh)) || !mesh->GetPackage())
+	{
+		UE_LOG(LogSectionedUVTools, Error, TEXT("Cannot section '%s'. Only static and skeletal mesh assets can be sectioned!"), *MeshName);
+		return false;
+	}
+
+	SectionedUVTools::FPreparedMesh& prepared = *Prepared;
+	if(!SectionedUVTools::ResolveSectionedSlots(mesh, bAutoSlots, MaterialSlots, SectionedSlotNames) ||
+	   !SectionedUVTools::PrepareSectionedMesh(mesh, MaterialSlots, SectionedSlotNames, sectioning.NumSections, sectioning.NumRows, sectioning.Encoding, INDEX_NONE, nullptr, prepared))
+	{
+		return false;
+	}
+
+	ExistingMesh.Reset(prepared.ExistingMesh);
+	if(prepared.bUpToDate)
+	{
+		Complete(ExistingMesh.Get(), true);
+		return true;
+	}
+
+	SectionedUVTools::InitModelSectioning(sectioning, MaterialSlots, prepared.SlotMapping, prepared.GroupSlotNames, prepared.NumSections, prepared.NumRows, prepared.Encoding,
+										  nullptr, prepared.MergeAllFromLOD);
+	State = EState::Duplicate;
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+bool FSectionedUVAsyncConversion::Step()
+{
+	SectionedUVTools::FModelSectioning& sectioning = *Sectioning;
+	const SectionedUVStats::FConversionScope statsScope(Stats.Get());
+
+	// Completed already, a second completion would end stats that were never begun and set the promise twice
+	if(State == EState::Done)
+	{
+		return false;
+	}
+
+	// The worker has to finish before the duplicate can go away
+	if(bCancelRequested && State != EState::Convert)
+	{
+		UE_LOG(LogSectionedUVTools, Display, TEXT("Sectioning '%s' was cancelled."), *MeshName);
+		if(SectionedMesh)
+		{
+			SectionedUVCache::DiscardSectionedMesh(SectionedMesh.Get(), ExistingMesh.Get());
+		}
+		Complete(nullptr);
+		return false;
+	}
+
+	switch(State)
+	{
+	case EState::Queued:
+	{
+		Stats->Begin();
+		State = EState::Duplicate;
+		if(!Prepare())
+		{
+			Complete(nullptr);
+		}
+		return State != EState::Done;
+	}
+	case EState::Duplicate:
+	{
+		{
+			SECTIONEDUV_STAGE_SCOPE(Duplicate);
+			SectionedMesh.Reset(SectionedUVCache::DuplicateSourceMesh(SourceMesh.Get(), ExistingMesh.Get(), Prepared->PackageName));
+		}
+		if(!SectionedMesh)
+		{
+			UE_LOG(LogSectionedUVTools, Error, TEXT("Unable to create a mesh asset to make '%s' into a sectioned mesh!"), *MeshName);
+			Complete(nullptr);
+			return false;
+		}
+		State = EState::Begin;
+		return true;
+	}
+	case EState::Begin:
+	{
+		USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(SectionedMesh.Get());
+		const bool bBegun = skeletalMesh ? SectionedUVTools::BeginSkeletalMeshModel(skeletalMesh, sectioning)
+										 : SectionedUVTools::BeginStaticMeshModel(CastChecked<UStaticMesh>(SectionedMesh.Get()), sectioning);
+		if(!bBegun)
+		{
+			SectionedUVCache::DiscardSectionedMesh(SectionedMesh.Get(), ExistingMesh.Get());
+			Complete(nullptr);
+			return false;
+		}
+
+		// Nothing references the duplicate yet, so its geometry can be sectioned away from the game thread
+		SectionedUVTools::FModelSectioning* workerSectioning = &sectioning;
+		const bool bSkeletal = skeletalMesh != nullptr;
+		Worker = Async(EAsyncExecution::ThreadPool, [workerSectioning, bSkeletal]()
+		{
+			const SectionedUVStats::FConversionScope statsScope(workerSectioning->Stats);
+			if(bSkeletal)
+			{
+				SectionedUVTools::ConvertSkeletalMeshModel(*workerSectioning);
+			}
+			else
+			{
+				SectionedUVTools::ConvertStaticMeshModel(*workerSectioning);
+			}
+		});
+		State = EState::Convert;
+		return true;
+	}
+	case EState::Convert:
+	{
+		if(!Worker.IsReady())
+		{
+			return false;
+		}
+		Worker.Reset();
+
+		// A source model which failed to section cannot be committed, its merged slots are already gone. Cancelled
+		// conversions skipped models on purpose, the next step throws them away.
+		if(!bCancelRequested && !Cast<USkeletalMesh>(SectionedMesh.Get()) && !SectionedUVTools::CheckStaticMeshModel(sectioning))
+		{
+			SectionedUVCache::DiscardSectionedMesh(SectionedMesh.Get(), ExistingMesh.Get());
+			Complete(nullptr);
+			return false;
+		}
+		State = EState::Commit;
+		return true;
+	}
+	case EState::Commit:
+	{
+		if(USkeletalMesh* skeletalMesh = Cast<USkeletalMesh>(SectionedMesh.Get()))
+		{
+			SectionedUVTools::CommitSkeletalMeshModel(skeletalMesh, sectioning, CommitStep);
+		}
+		else
+		{
+			SectionedUVTools::CommitStaticMeshModel(CastChecked<UStaticMesh>(SectionedMesh.Get()), sectioning, CommitStep);
+		}
+
+		if(++CommitStep == sectioning.GetNumCommitSteps())
+		{
+			SectionedUVTools::FinishPreparedMesh(SectionedMesh.Get(), SourceMesh.Get(), *Prepared);
+			Complete(SectionedMesh.Get());
+			return false;
+		}
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void FSectionedUVAsyncConversion::Complete(UObject* sectionedMesh, const bool bUpToDate)
+{
+	// Conversions cancelled while queued never started their stats
+	if(State != EState::Queued)
+	{
+		Stats->End(sectionedMesh != nullptr, bUpToDate);
+	}
+	State = EState::Done;
+
+	if(Notification)
+	{
+		const FText meshName = FText::FromString(MeshName);
+		if(sectionedMesh)
+		{
+			Notification->SetText(FText::Format(LOCTEXT("SectioningDone", "Sectioned {0}"), meshName));
+		}
+		else if(bCancelRequested)
+		{
+			Notification->SetText(FText::Format(LOCTEXT("SectioningCancelled", "Sectioning {0} was cancelled"), meshName));
+		}
+		else
+		{
+			Notification->SetText(FText::Format(LOCTEXT("SectioningFailed", "Sectioning {0} failed, see the log"), meshName));
+		}
+		Notification->SetCompletionState(sectionedMesh ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+		Notification->ExpireAndFadeout();
+		Notification.Reset();
+	}
+
+	SourceMesh.Reset();
+	ExistingMesh.Reset();
+	SectionedMesh.Reset();
+	OnComplete.ExecuteIfBound(sectionedMesh);
+	Promise.SetValue(sectionedMesh);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void FSectionedUVAsyncConversion::UpdateNotification()
+{
+	if(Notification)
+	{
+		Notification->SetText(FText::Format(LOCTEXT("SectioningProgress", "Sectioning {0}... {1}"), FText::FromString(MeshName), FText::AsPercent(GetProgress())));
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVConvertAction* USectionedUVConvertAction::CreateSectionedUVSkeletalMeshAsync(USkeletalMesh* skeletalMesh,
+																						 TArray<int32> materialSlots,
+																						 const int32 numSections,
+																						 const int32 numRows,
+																						 const ESectionedUVEncoding encoding)
+{
+	return MakeAction(skeletalMesh, materialSlots, false, numSections, numRows, encoding);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVConvertAction* USectionedUVConvertAction::CreateAutoSectionedUVSkeletalMeshAsync(USkeletalMesh* skeletalMesh,
+																							 const int32 numSections,
+																							 const int32 numRows,
+																							 const ESectionedUVEncoding encoding)
+{
+	return MakeAction(skeletalMesh, TArray<int32>(), true, numSections, numRows, encoding);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVConvertAction* USectionedUVConvertAction::CreateSectionedUVStaticMeshAsync(UStaticMesh* staticMesh,
+																					   TArray<int32> materialSlots,
+																					   const int32 numSections,
+																					   const int32 numRows,
+																					   const ESectionedUVEncoding encoding)
+{
+	return MakeAction(staticMesh, materialSlots, false, numSections, numRows, encoding);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVConvertAction* USectionedUVConvertAction::CreateAutoSectionedUVStaticMeshAsync(UStaticMesh* staticMesh,
+																						   const int32 numSections,
+																						   const int32 numRows,
+																						   const ESectionedUVEncoding encoding)
+{
+	return MakeAction(staticMesh, TArray<int32>(), true, numSections, numRows, encoding);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+USectionedUVConvertAction* USectionedUVConvertAction::MakeAction(UObject* mesh,
+																 const TArray<int32>& materialSlots,
+																 const bool bAutoSlots,
+																 const int32 numSections,
+																 const int32 numRows,
+																 const ESectionedUVEncoding encoding)
+{
+	USectionedUVConvertAction* action = NewObject<USectionedUVConvertAction>();
+	action->Mesh = mesh;
+	action->MaterialSlots = materialSlots;
+	action->bAutoSlots = bAutoSlots;
+	action->NumSections = numSections;
+	action->NumRows = numRows;
+	action->Encoding = encoding;
+	return action;
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVConvertAction::Cancel()
+{
+	if(Conversion)
+	{
+		Conversion->Cancel();
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVConvertAction::Activate()
+{
+	// Editor utilities have no game instance to register with, so the action keeps itself alive until the conversion ends
+	AddToRoot();
+	Conversion = FSectionedUVAsyncConversion::Start(Mesh, MaterialSlots, bAutoSlots, NumSections, NumRows, Encoding);
+	Conversion->OnProgress.BindUObject(this, &USectionedUVConvertAction::OnConversionProgress);
+	Conversion->OnComplete.BindUObject(this, &USectionedUVConvertAction::OnConversionComplete);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVConvertAction::OnConversionProgress(const float progress)
+{
+	Progress.Broadcast(nullptr, progress);
+}
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+void USectionedUVConvertAction::OnConversionComplete(UObject* sectionedMesh)
+{
+	if(sectionedMesh)
+	{
+		Completed.Broadcast(sectionedMesh, 1.0f);
+	}
+	else
+	{
+		Failed.Broadcast(nullptr, 1.0f);
+	}
+	Conversion.Reset();
+	RemoveFromRoot();
+	SetReadyToDestroy();
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,56 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#include "SectionedUVToolsFunctionLibrary.h"
+#include "Engine/StaticMesh.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Cancelling before the queue ticks completes the conversion once, right away, and the queue never steps it again
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSectionedUVCancelQueuedConversionTest,
+								 "SectionedUVTools.AsyncConversion.CancelBeforeFirstTick",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+//--------------------------------------------------------------------------------------------------------------------
+/**
+*/
+bool FSectionedUVCancelQueuedConversionTest::RunTest(const FString& Parameters)
+{
+	UStaticMesh* mesh = NewObject<UStaticMesh>(GetTransientPackage());
+	TSharedRef<FSectionedUVAsyncConversion> conversion = FSectionedUVAsyncConversion::Start(mesh, TArray<int32>());
+
+	TSharedRef<int32> numCompleted = MakeShared<int32>(0);
+	TSharedRef<UObject*> completedMesh = MakeShared<UObject*>(mesh);
+	conversion->OnComplete.BindLambda([numCompleted, completedMesh](UObject* sectionedMesh)
+	{
+		++*numCompleted;
+		*completedMesh = sectionedMesh;
+	});
+	TFuture<UObject*> future = conversion->GetFuture();
+
+	conversion->Cancel();
+	TestTrue(TEXT("Cancelled conversion is done"), conversion->IsDone());
+	TestEqual(TEXT("Completions after cancelling"), *numCompleted, 1);
+	TestNull(TEXT("Completed mesh"), *completedMesh);
+	TestTrue(TEXT("Future is set"), future.IsReady());
+	if(future.IsReady())
+	{
+		TestNull(TEXT("Future mesh"), future.Get());
+	}
+
+	// Cancelling again does nothing
+	conversion->Cancel();
+	TestEqual(TEXT("Completions after cancelling twice"), *numCompleted, 1);
+
+	// The queue ticks while waiting, it has to drop the cancelled conversion without completing it again
+	ADD_LATENT_AUTOMATION_COMMAND(FDelayedFunctionLatentCommand([this, conversion, numCompleted]()
+	{
+		TestTrue(TEXT("Cancelled conversion is still done"), conversion->IsDone());
+		TestEqual(TEXT("Completions after the queue ticked"), *numCompleted, 1);
+	}, 0.5f));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
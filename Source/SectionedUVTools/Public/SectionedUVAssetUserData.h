@@ -0,0 +1,64 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetUserData.h"
+#include "SectionedUVToolsFunctionLibrary.h"
+
+#include "SectionedUVAssetUserData.generated.h"
+
+/**
+ * Stored on every generated sectioned mesh. Records what the mesh was generated from so converting the same
+ * source again can update it in place, or skip it entirely when nothing changed.
+ */
+UCLASS()
+class SECTIONEDUVTOOLS_API USectionedUVAssetUserData : public UAssetUserData
+{
+	GENERATED_BODY()
+
+public:
+	/** The mesh this sectioned mesh was generated from */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	TSoftObjectPtr<UObject> SourceMesh;
+
+	/** The meshes merged after SourceMesh, empty unless the mesh was built from several meshes */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	TArray<TSoftObjectPtr<UObject>> MergedMeshes;
+
+	/** Hash of the source geometry, materials, slots and section count the mesh was generated with */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	FString SourceHash;
+
+	/** The material slots of the source mesh which were merged */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	TArray<int32> MaterialSlots;
+
+	/** Per entry of MaterialSlots, the sectioned slot it was merged into */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	TArray<FName> SectionedSlotNames;
+
+	/** The number of UV sections in a row */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	int32 NumSections = 0;
+
+	/** The number of rows of UV sections, more than 1 for a section grid */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	int32 NumRows = 1;
+
+	/** Where the section of each merged vertex is stored */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	ESectionedUVEncoding Encoding = ESectionedUVEncoding::UVChannel;
+
+	/** The first LOD which merges every slot into the first sectioned slot, -1 if every LOD merges MaterialSlots */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	int32 MergeAllFromLOD = -1;
+
+	/** True if UV0 of the merged sections was moved into an atlas of their materials */
+	UPROPERTY(VisibleAnywhere, Category = "Sectioned UV")
+	bool bAtlased = false;
+
+	//~ Begin UObject Interface
+	virtual bool IsEditorOnly() const override { return true; }
+	//~ End UObject Interface
+};
@@ -0,0 +1,38 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "SectionedUVInstanceCommandlet.generated.h"
+
+/**
+ * Replaces the static mesh actors placed in a set of maps with instances of their sectioned meshes and saves the maps
+ * along with the sectioned meshes, see InstanceSectionedStaticMeshActors in the function library.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=SectionedUVInstance -Maps=/Game/Maps/Town+/Game/Maps/Town_Props [-NumSections=16] [-MinInstances=2]
+ *                                   [-ClusterSize=5000] [-ISM] [-ColorParameter=Color] [-FirstDataIndex=0] [-NoSave]
+ *
+ * -Maps            Map packages to instance, separated by '+'. Required. Only the listed packages are changed, list
+ *                  streamed sublevels on their own.
+ * -NumSections     The number of horizontal sections of the converted meshes.
+ * -MinInstances    Meshes placed fewer times than this in a map keep their actors.
+ * -ClusterSize     Width of the grid cells instances are clustered by, one instance actor per cell. 0 clusters per map.
+ * -ISM             Use instanced static mesh components instead of hierarchical ones.
+ * -ColorParameter  The vector parameter of the merged slot materials which goes into the per instance custom data.
+ * -FirstDataIndex  The custom data index of section 0. A multiple of 4.
+ * -NoSave          Instance without saving, to see what would be replaced.
+ */
+UCLASS()
+class USectionedUVInstanceCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USectionedUVInstanceCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -0,0 +1,37 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "SectionedUVReportCommandlet.generated.h"
+
+/**
+ * Reports which meshes are worth sectioning without converting anything. Every skeletal and static mesh found under
+ * the content paths or placed in the maps gets its LOD0 draws and triangles per section, the draws left after an auto
+ * conversion (slots only merge with slots whose materials render the same way) and how often it is placed. The report
+ * is sorted by the draws saved over all placements.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=SectionedUVReport [-Paths=/Game/Characters+/Game/Props] [-Maps=/Game/Maps/Town+/Game/Maps/Town_Props]
+ *                                   [-Output=Report.csv|Report.json] [-Type=All|Skeletal|Static] [-BatchSize=32]
+ *
+ * -Paths      Content paths to search (recursive), separated by '+'.
+ * -Maps       Map packages whose placed meshes are counted, separated by '+'. Meshes placed in them are reported even
+ *             outside of -Paths. Only the listed packages are scanned, list streamed sublevels on their own.
+ * -Output     The report file, JSON if it ends in .json and CSV otherwise. Defaults to Saved/SectionedUVReport.csv.
+ * -Type       Only report skeletal or static meshes.
+ * -BatchSize  Number of meshes loaded before garbage is collected.
+ */
+UCLASS()
+class USectionedUVReportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USectionedUVReportCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -0,0 +1,40 @@
+// Copyright (c) 2022 Solar Storm Interactive
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "SectionedUVToolsCommandlet.generated.h"
+
+/**
+ * Bulk sections every skeletal and static mesh found under a set of content paths and saves the results.
+ * Meshes whose sectioned mesh is already up to date are not converted or saved again.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=SectionedUVTools -Paths=/Game/Characters+/Game/Props [-Slots=0,2,Body*|-Auto] [-NumSections=16]
+ *                                   [-NumRows=1] [-Encoding=UVChannel] [-MergeAllFromLOD=2] [-Type=All|Skeletal|Static] [-BatchSize=32] [-NoSave]
+ *
+ * -Paths        Content paths to search (recursive), separated by '+'. Required.
+ * -Slots        Slot rules, separated by ','. Each rule is a slot index or a slot name (wildcards allowed).
+ *               Slots matching any rule are merged. Leave empty to merge all slots.
+ * -Auto         Ignore -Slots and merge the slots whose materials render the same way, one sectioned slot per group.
+ * -NumSections  The number of horizontal sections, same as the function library.
+ * -NumRows      The number of vertical sections, above 1 the sections form a grid.
+ * -Encoding     Where the section is stored, UVChannel or VertexColorRed / Green / Blue / Alpha.
+ * -MergeAllFromLOD  From this LOD onward every slot is merged into the first sectioned slot. Off by default.
+ * -Type         Only convert skeletal or static meshes.
+ * -BatchSize    Number of assets loaded, converted and saved before garbage is collected.
+ * -NoSave       Convert without saving, useful to profile a run.
+ */
+UCLASS()
+class USectionedUVToolsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USectionedUVToolsCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -3,12 +3,117 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "UObject/StrongObjectPtr.h"
+#include "SectionedUVEncoding.h"
 
 #include "SectionedUVToolsFunctionLibrary.generated.h"
 
+namespace SectionedUVTools
+{
+	struct FModelSectioning;
+	struct FPreparedMesh;
+}
+
+namespace SectionedUVStats
+{
+	class FConversion;
+}
+
 DECLARE_LOG_CATEGORY_EXTERN(LogSectionedUVTools, Log, All);
 
+/**
+ * Where the time of a conversion went and how much data it went through. Stage times are summed over the threads
+ * converting LODs and morph targets in parallel, so they can add up to more than TotalSeconds.
+ */
+USTRUCT(BlueprintType)
+struct SECTIONEDUVTOOLS_API FSectionedUVConversionStats
+{
+	GENERATED_BODY()
+
+	/** The conversion produced a mesh */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	bool bSucceeded = false;
+
+	/** The existing sectioned mesh was up to date, nothing was converted */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	bool bUpToDate = false;
+
+	/** Wall clock time of the whole conversion */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float TotalSeconds = 0.0f;
+
+	/** Hashing the inputs to find out whether the existing sectioned mesh is up to date */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float HashSeconds = 0.0f;
+
+	/** Duplicating the source mesh into the sectioned mesh's package */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float DuplicateSeconds = 0.0f;
+
+	/** Appending the other meshes of a merge */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float AppendSeconds = 0.0f;
+
+	/** Building the slot mapping and replacing the merged material slots */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float SlotRemapSeconds = 0.0f;
+
+	/** Merging the sections, bone maps and sectioned UVs / section ids */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float SectionMergeSeconds = 0.0f;
+
+	/** Removing the merged sections and compacting the index buffers */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float SectionRemovalSeconds = 0.0f;
+
+	/** Vertex cache, overdraw and vertex fetch optimization of the merged sections */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float OptimizeSeconds = 0.0f;
+
+	/** Remapping the morph targets onto the merged sections */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float MorphFixupSeconds = 0.0f;
+
+	/** Committing the mesh descriptions and PostEditChange, which rebuilds the render data or pulls it from the DDC */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float BuildSeconds = 0.0f;
+
+	/** InitMorphTargets on the converted skeletal mesh */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float InitMorphTargetsSeconds = 0.0f;
+
+	/** Vertices of the sectioned LODs */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	int64 NumVertices = 0;
+
+	/** Indices of the sectioned LODs */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	int64 NumIndices = 0;
+
+	/** Morph target deltas remapped */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	int64 NumMorphDeltas = 0;
+
+	/** Bytes of the working buffers the conversion allocated: merged vertices and indices, remap tables and UV channels */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	int64 BytesAllocated = 0;
+
+	/** Vertex buffers of every LOD of the rebuilt render data: positions, tangents, UVs, colors and skin weights */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	int64 VertexBufferBytes = 0;
+
+	/** Index buffers of every LOD of the rebuilt render data */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	int64 IndexBufferBytes = 0;
+
+	/** VertexBufferBytes over the vertices of every LOD */
+	UPROPERTY(BlueprintReadOnly, Category = "Sectioned UV")
+	float BytesPerVertex = 0.0f;
+};
+
 /**
  * 
  */
@@ -21,24 +126,450 @@ class SECTIONEDUVTOOLS_API USectionedUVToolsFunctionLibrary : public UBlueprintF
 	 * Creates a sectioned UV for the passed in skeletal mesh and condenses the desired material slots into 1
 	 * Pass in and empty array for material slots to condense them all.
 	 * @param skeletalMesh The skeletal mesh to create a new sectioned mesh from. The new mesh will be suffixed with "_sectioned".
+	 *                     Converting the same mesh again updates its sectioned mesh in place, or returns it untouched if
+	 *                     the mesh, slots and number of sections did not change.
 	 * @param materialSlots The material slots to condense into a single slot which should use the sectioned UV material.
 	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections. Above 1 the sections form a numSections x numRows grid filled
+	 *                row by row, use the grid variant of the material function with these meshes.
+	 * @param encoding Where the section is stored. Vertex color encodings add no vertex data and work on meshes whose
+	 *                 UV channels are full, use the vertex color variant of the material function with these meshes.
+	 * @param mergeAllFromLOD From this LOD onward every slot is merged into the first sectioned slot, kept slots and
+	 *                        other sectioned slots included, so far LODs draw in one call. Those slots take the UV
+	 *                        sections after the sectioned slot's own. -1 uses the same slots on every LOD.
 	 * @return The created skeletal mesh, or None if the function failed.
 	 */
-	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections"), DisplayName="Create Sectioned UV Skeletal Mesh")
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections,numRows,encoding,mergeAllFromLOD"), DisplayName="Create Sectioned UV Skeletal Mesh")
 	static class USkeletalMesh* CreateSectionedUVSkeletalMesh(class USkeletalMesh* skeletalMesh,
 														       TArray<int32> materialSlots,
-														       const int32 numSections = 16);
+														       const int32 numSections = 16,
+														       const int32 numRows = 1,
+														       const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel,
+														       const int32 mergeAllFromLOD = -1);
+
+	/**
+	 * Creates a sectioned UV for the passed in skeletal mesh, picking the slots to merge from their materials.
+	 * Slots whose materials share the blend mode, shading model, two sidedness and domain are merged into one sectioned
+	 * slot per group, named after it (sectioned_opaque, sectioned_masked_twosided...). Slots without a compatible slot are kept.
+	 * @param skeletalMesh The skeletal mesh to create a new sectioned mesh from, see CreateSectionedUVSkeletalMesh.
+	 * @param numSections The number of horizonal sections. Each sectioned slot hands out its own sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 * @param mergeAllFromLOD From this LOD onward every slot is merged into the first sectioned slot, see CreateSectionedUVSkeletalMesh.
+	 * @return The created skeletal mesh, or None if the function failed or no slots could be merged.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections,numRows,encoding,mergeAllFromLOD"), DisplayName="Create Auto Sectioned UV Skeletal Mesh")
+	static class USkeletalMesh* CreateAutoSectionedUVSkeletalMesh(class USkeletalMesh* skeletalMesh,
+																  const int32 numSections = 16,
+																  const int32 numRows = 1,
+																  const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel,
+																  const int32 mergeAllFromLOD = -1);
 
 	/**
 	 * Creates a sectioned UV for the passed in static mesh and condenses the desired material slots into 1
 	 * @param staticMesh The static mesh to create a new sectioned mesh from. The new mesh will be suffixed with "_sectioned".
+	 *                   Converting the same mesh again updates its sectioned mesh in place, or returns it untouched if
+	 *                   the mesh, slots and number of sections did not change.
 	 * @param materialSlots The material slots to condense into a single slot which should use the sectioned UV material
 	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections. Above 1 the sections form a numSections x numRows grid filled
+	 *                row by row, use the grid variant of the material function with these meshes.
+	 * @param encoding Where the section is stored. Vertex color encodings add no vertex data and work on meshes whose
+	 *                 UV channels are full, use the vertex color variant of the material function with these meshes.
+	 * @param mergeAllFromLOD From this source model onward every slot is merged into the first sectioned slot, see
+	 *                        CreateSectionedUVSkeletalMesh. LODs reduced from LOD 0 at build time follow LOD 0.
 	 * @return The created static mesh, or None if the function failed.
 	 */
-	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections"), DisplayName="Create Sectioned UV Static Mesh")
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections,numRows,encoding,mergeAllFromLOD"), DisplayName="Create Sectioned UV Static Mesh")
 	static class UStaticMesh* CreateSectionedUVStaticMesh(class UStaticMesh* staticMesh,
 														  TArray<int32> materialSlots,
-														  const int32 numSections = 16);
+														  const int32 numSections = 16,
+														  const int32 numRows = 1,
+														  const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel,
+														  const int32 mergeAllFromLOD = -1);
+
+	/**
+	 * Static mesh version of CreateAutoSectionedUVSkeletalMesh.
+	 * @param staticMesh The static mesh to create a new sectioned mesh from, see CreateSectionedUVStaticMesh.
+	 * @param numSections The number of horizonal sections. Each sectioned slot hands out its own sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 * @param mergeAllFromLOD From this source model onward every slot is merged into the first sectioned slot, see CreateSectionedUVStaticMesh.
+	 * @return The created static mesh, or None if the function failed or no slots could be merged.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections,numRows,encoding,mergeAllFromLOD"), DisplayName="Create Auto Sectioned UV Static Mesh")
+	static class UStaticMesh* CreateAutoSectionedUVStaticMesh(class UStaticMesh* staticMesh,
+															  const int32 numSections = 16,
+															  const int32 numRows = 1,
+															  const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel,
+															  const int32 mergeAllFromLOD = -1);
+
+	/**
+	 * Merges several skeletal meshes into one sectioned mesh, sectioning over the slots of all of them. Handy for
+	 * modular characters whose parts would otherwise each cost their own draw calls.
+	 * @param skeletalMeshes The meshes to merge. They must share a skeleton and the first mesh's reference skeleton has
+	 *                       to hold every bone the others are skinned to. Only the first mesh may have clothing. The new
+	 *                       mesh is the first mesh suffixed with "_merged", converting the same meshes again updates it.
+	 * @param materialSlots The combined slots to condense, see GetMergedMaterialSlots. Empty condenses them all.
+	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 * @return The created skeletal mesh, or None if the function failed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections,numRows,encoding"), DisplayName="Create Sectioned UV Merged Skeletal Mesh")
+	static class USkeletalMesh* CreateSectionedUVMergedSkeletalMesh(TArray<class USkeletalMesh*> skeletalMeshes,
+																	TArray<int32> materialSlots,
+																	const int32 numSections = 16,
+																	const int32 numRows = 1,
+																	const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/**
+	 * Static mesh version of CreateSectionedUVMergedSkeletalMesh.
+	 * @param staticMeshes The meshes to merge. The new mesh is the first mesh suffixed with "_merged".
+	 * @param transforms The transform of each mesh relative to the merged mesh. Missing entries are the identity.
+	 *                   A single mesh is converted like CreateSectionedUVStaticMesh does and keeps its placement.
+	 * @param materialSlots The combined slots to condense, see GetMergedMaterialSlots. Empty condenses them all.
+	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 * @return The created static mesh, or None if the function failed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections,numRows,encoding"), DisplayName="Create Sectioned UV Merged Static Mesh")
+	static class UStaticMesh* CreateSectionedUVMergedStaticMesh(TArray<class UStaticMesh*> staticMeshes,
+																TArray<FTransform> transforms,
+																TArray<int32> materialSlots,
+																const int32 numSections = 16,
+																const int32 numRows = 1,
+																const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/**
+	 * Sections a skeletal mesh like CreateSectionedUVSkeletalMesh and also bakes the merged slots' materials into one
+	 * atlas, moving UV0 of each merged section into its material's rectangle. The sectioned slot then draws with a
+	 * single ordinary material, no texture arrays or section lookups needed in the shader. UV0 outside of 0-1 is
+	 * clamped, tiling materials should use the sectioned or texture array variants instead. The atlas textures
+	 * (T_<mesh>_sectioned_Atlas_BaseColor, _Normal, _ORM) and instance (MI_<mesh>_sectioned_Atlas) are created next to the mesh.
+	 * @param skeletalMesh The skeletal mesh to create a new atlased mesh from. The new mesh will be suffixed with "_atlased".
+	 * @param materialSlots The material slots to condense into the atlased slot. Empty condenses them all.
+	 * @param parentMaterial The material the atlas instance is made from. It takes BaseColorAtlas, NormalAtlas and
+	 *                       ORMAtlas texture parameters sampled with UV0, see the readme.
+	 * @param maxSectionSize The largest a material's rectangle may be, gutter included. A power of two. Each material
+	 *                       gets the size of the largest texture it samples up to this.
+	 * @param padding The gutter around each rectangle in texels, filled with the rectangle's edge so filtering and
+	 *                mips do not bleed the neighbouring material in.
+	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 * @return The created skeletal mesh, or None if the function failed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="maxSectionSize,padding,numSections,numRows,encoding"), DisplayName="Create Atlased UV Skeletal Mesh")
+	static class USkeletalMesh* CreateAtlasedUVSkeletalMesh(class USkeletalMesh* skeletalMesh,
+															TArray<int32> materialSlots,
+															class UMaterialInterface* parentMaterial,
+															const int32 maxSectionSize = 1024,
+															const int32 padding = 4,
+															const int32 numSections = 16,
+															const int32 numRows = 1,
+															const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/**
+	 * Static mesh version of CreateAtlasedUVSkeletalMesh.
+	 * @param staticMesh The static mesh to create a new atlased mesh from. The new mesh will be suffixed with "_atlased".
+	 * @param materialSlots The material slots to condense into the atlased slot. Empty condenses them all.
+	 * @param parentMaterial The material the atlas instance is made from.
+	 * @param maxSectionSize The largest a material's rectangle may be, gutter included. A power of two.
+	 * @param padding The gutter around each rectangle in texels.
+	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 * @return The created static mesh, or None if the function failed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="maxSectionSize,padding,numSections,numRows,encoding"), DisplayName="Create Atlased UV Static Mesh")
+	static class UStaticMesh* CreateAtlasedUVStaticMesh(class UStaticMesh* staticMesh,
+														TArray<int32> materialSlots,
+														class UMaterialInterface* parentMaterial,
+														const int32 maxSectionSize = 1024,
+														const int32 padding = 4,
+														const int32 numSections = 16,
+														const int32 numRows = 1,
+														const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/**
+	 * Bakes the source materials merged into a sectioned slot into base color, normal and ORM texture arrays with one
+	 * layer per UV section, and creates a material instance sampling them. The merged draw then costs three texture
+	 * fetches however many materials went into it. The textures (T_<mesh>_<slot>_BaseColor, _Normal, _ORM) and the
+	 * instance (MI_<mesh>_<slot>) are created next to the mesh, baking again updates them.
+	 * @param sectionedMesh A static or skeletal mesh made by the sectioned UV tools.
+	 * @param parentMaterial The material the instance is made from. It takes BaseColorArray, NormalArray and ORMArray
+	 *                       texture array parameters and NumSections / NumRows scalar parameters, see the readme.
+	 * @param sectionedSlotName The sectioned slot to bake. None bakes the first one.
+	 * @param textureSize The width and height of each layer, a power of two. All layers of an array have to fit in
+	 *                    2^31 texels, 8192 holds up to 31 layers and 4096 up to 127.
+	 * @return The material instance, assigned to the sectioned slot, or None if the function failed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="sectionedSlotName,textureSize"), DisplayName="Create Sectioned UV Texture Array Material")
+	static class UMaterialInstanceConstant* CreateSectionedUVTextureArrayMaterial(class UObject* sectionedMesh,
+																				  class UMaterialInterface* parentMaterial,
+																				  const FName sectionedSlotName = NAME_None,
+																				  const int32 textureSize = 1024);
+
+	/**
+	 * The combined slots of a merge, the slot indices the merged variants take refer to these. Each mesh's slots
+	 * follow the previous mesh's. Slots with the same name and material on different meshes are shared, other
+	 * repeated names get a _1, _2... suffix.
+	 * @param meshes The static or skeletal meshes in merge order.
+	 * @param outSlotNames The name of each combined slot.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", DisplayName="Get Merged Material Slots")
+	static void GetMergedMaterialSlots(const TArray<class UObject*>& meshes, TArray<FName>& outSlotNames);
+
+	/**
+	 * Where the time of the last conversion on this editor went, see FSectionedUVConversionStats. The stages are also
+	 * traced on the SectionedUV channel, run the editor with -trace=cpu,SectionedUV to see them in Insights.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Sectioned UV", DisplayName="Get Last Conversion Stats")
+	static FSectionedUVConversionStats GetLastConversionStats();
+
+	/**
+	 * The slots the auto variants would merge and the sectioned slot each one goes into, to preview an auto conversion.
+	 * @param mesh The static or skeletal mesh to inspect.
+	 * @param outMaterialSlots The slots which would be merged, ascending. Empty if nothing can be merged.
+	 * @param outSectionedSlotNames Per entry of outMaterialSlots, the sectioned slot it would go into.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", DisplayName="Get Auto Sectioned Slots")
+	static void GetAutoSectionedSlots(class UObject* mesh, TArray<int32>& outMaterialSlots, TArray<FName>& outSectionedSlotNames);
+
+	/**
+	 * Checks if a static or skeletal mesh already went through sectioning.
+	 * @param mesh The static or skeletal mesh to check.
+	 * @return True if the mesh has a 'sectioned' or 'sectioned_*' material slot.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Sectioned UV", DisplayName="Is Sectioned Mesh")
+	static bool IsSectionedMesh(class UObject* mesh);
+
+	/**
+	 * Replaces the static mesh actors placed in a world with instances of their sectioned meshes, turning a draw per
+	 * actor per slot into a draw per mesh per cluster. Meshes placed at least minInstances times in a level are auto
+	 * sectioned once (see CreateAutoSectionedUVStaticMesh) and their actors become instances of one instanced component
+	 * per cluster and kept slot materials. Merged slots drop their material overrides, the colorParameterName vector of
+	 * each override goes into the section's per instance custom data instead, see USectionedUVCustomDataLibrary. The
+	 * sections of each sectioned slot follow the ones of the sectioned slot before it. Only plain static mesh actors
+	 * without attachments are replaced. Can be undone, the sectioned meshes stay.
+	 * @param world The world whose loaded levels to instance. World partition maps are not supported.
+	 * @param numSections The number of horizontal sections of the converted meshes.
+	 * @param minInstances Meshes placed fewer times than this in a level keep their actors.
+	 * @param clusterSize Width of the grid cells instances are clustered by, one actor per cell. 0 clusters per level.
+	 * @param bHierarchical Use hierarchical instanced components, which cull and LOD per instance cluster.
+	 * @param colorParameterName The vector parameter of the merged slot materials holding their section's color.
+	 * @param firstDataIndex The custom data index of section 0. A multiple of 4.
+	 * @return The number of actors replaced, or -1 if the world cannot be instanced.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(AdvancedDisplay="numSections,minInstances,clusterSize,bHierarchical,colorParameterName,firstDataIndex"), DisplayName="Instance Sectioned Static Mesh Actors")
+	static int32 InstanceSectionedStaticMeshActors(class UWorld* world,
+												   const int32 numSections = 16,
+												   const int32 minInstances = 2,
+												   const float clusterSize = 0.0f,
+												   const bool bHierarchical = true,
+												   const FName colorParameterName = "Color",
+												   const int32 firstDataIndex = 0);
+};
+
+/**
+ * Called on the game thread when an async conversion ends.
+ * @param sectionedMesh The sectioned mesh, or nullptr if the conversion failed or was cancelled.
+ */
+DECLARE_DELEGATE_OneParam(FOnSectionedUVConversionComplete, UObject* /*sectionedMesh*/);
+
+/** Called on the game thread as an async conversion moves along, with its progress from 0 to 1 */
+DECLARE_DELEGATE_OneParam(FOnSectionedUVConversionProgress, float /*progress*/);
+
+/**
+ * Sections a static or skeletal mesh without blocking the editor. The game thread does the UObject work in slices of
+ * about SectionedUVTools.AsyncSliceMilliseconds per tick and the geometry is sectioned on a worker thread in between.
+ * Progress and a cancel button show in an editor notification. Conversions are queued and run one at a time in the
+ * order they were started. Duplicating the source mesh and rebuilding its render data at the end are single engine
+ * calls which still block for as long as they take.
+ */
+class SECTIONEDUVTOOLS_API FSectionedUVAsyncConversion : public TSharedFromThis<FSectionedUVAsyncConversion>
+{
+public:
+	~FSectionedUVAsyncConversion();
+
+	/**
+	 * Queues a conversion like USectionedUVToolsFunctionLibrary::CreateSectionedUVSkeletalMesh and
+	 * CreateSectionedUVStaticMesh do. Must be called on the game thread.
+	 * @param mesh The static or skeletal mesh to section.
+	 * @param materialSlots The slots to condense into the sectioned slot. Empty condenses them all.
+	 * @param bAutoSlots Group the slots by material like the auto variants do, materialSlots is ignored.
+	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 */
+	static TSharedRef<FSectionedUVAsyncConversion> Start(UObject* mesh,
+														 const TArray<int32>& materialSlots,
+														 bool bAutoSlots = false,
+														 int32 numSections = 16,
+														 int32 numRows = 1,
+														 ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/** Set on the game thread to the sectioned mesh, nullptr if the conversion failed or was cancelled. Can only be taken once. */
+	TFuture<UObject*> GetFuture();
+
+	/** Stops the conversion at its next slice and throws the partly sectioned mesh away. Does nothing once done. */
+	void Cancel();
+
+	/** How far along the conversion is, from 0 to 1 */
+	float GetProgress() const;
+
+	bool IsDone() const { return State == EState::Done; }
+
+	/** Called when the conversion ends, before the future is set */
+	FOnSectionedUVConversionComplete OnComplete;
+
+	/** Called after each tick the conversion made progress in */
+	FOnSectionedUVConversionProgress OnProgress;
+
+private:
+	enum class EState : uint8
+	{
+		Queued,
+		Duplicate,
+		Begin,
+		Convert,
+		Commit,
+		Done
+	};
+
+	FSectionedUVAsyncConversion();
+
+	/** Runs the queued conversions for a slice of the game thread */
+	static bool TickQueue(float deltaTime);
+
+	/** Runs the next step, false when the conversion has to wait for its worker or is done */
+	bool Step();
+	bool Prepare();
+	void Complete(UObject* sectionedMesh, bool bUpToDate = false);
+	void UpdateNotification();
+
+	EState State = EState::Queued;
+	FString MeshName;
+	TStrongObjectPtr<UObject> SourceMesh;
+	TStrongObjectPtr<UObject> ExistingMesh;
+	TStrongObjectPtr<UObject> SectionedMesh;
+	TArray<int32> MaterialSlots;
+	TArray<FName> SectionedSlotNames;
+	bool bAutoSlots = false;
+	TUniquePtr<SectionedUVTools::FPreparedMesh> Prepared;
+	TUniquePtr<SectionedUVTools::FModelSectioning> Sectioning;
+	TUniquePtr<SectionedUVStats::FConversion> Stats;
+	TFuture<void> Worker;
+	int32 CommitStep = 0;
+	bool bCancelRequested = false;
+	TPromise<UObject*> Promise;
+	TSharedPtr<class SNotificationItem> Notification;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSectionedUVConvertPin, UObject*, SectionedMesh, float, Progress);
+
+/**
+ * Blueprint nodes for FSectionedUVAsyncConversion, for editor utilities converting meshes without freezing the editor.
+ */
+UCLASS()
+class SECTIONEDUVTOOLS_API USectionedUVConvertAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	/** Fires as the conversion moves along, with its progress from 0 to 1 */
+	UPROPERTY(BlueprintAssignable)
+	FSectionedUVConvertPin Progress;
+
+	/** The sectioned mesh */
+	UPROPERTY(BlueprintAssignable)
+	FSectionedUVConvertPin Completed;
+
+	/** The conversion failed or was cancelled, see the log */
+	UPROPERTY(BlueprintAssignable)
+	FSectionedUVConvertPin Failed;
+
+	/**
+	 * CreateSectionedUVSkeletalMesh without blocking the editor, see FSectionedUVAsyncConversion.
+	 * @param skeletalMesh The skeletal mesh to create a new sectioned mesh from.
+	 * @param materialSlots The material slots to condense into the sectioned slot. Empty condenses them all.
+	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(BlueprintInternalUseOnly="true", AdvancedDisplay="numSections,numRows,encoding"), DisplayName="Create Sectioned UV Skeletal Mesh Async")
+	static USectionedUVConvertAction* CreateSectionedUVSkeletalMeshAsync(class USkeletalMesh* skeletalMesh,
+																		TArray<int32> materialSlots,
+																		const int32 numSections = 16,
+																		const int32 numRows = 1,
+																		const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/**
+	 * CreateAutoSectionedUVSkeletalMesh without blocking the editor, see FSectionedUVAsyncConversion.
+	 * @param skeletalMesh The skeletal mesh to create a new sectioned mesh from.
+	 * @param numSections The number of horizonal sections. Each sectioned slot hands out its own sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(BlueprintInternalUseOnly="true", AdvancedDisplay="numSections,numRows,encoding"), DisplayName="Create Auto Sectioned UV Skeletal Mesh Async")
+	static USectionedUVConvertAction* CreateAutoSectionedUVSkeletalMeshAsync(class USkeletalMesh* skeletalMesh,
+																			const int32 numSections = 16,
+																			const int32 numRows = 1,
+																			const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/**
+	 * CreateSectionedUVStaticMesh without blocking the editor, see FSectionedUVAsyncConversion.
+	 * @param staticMesh The static mesh to create a new sectioned mesh from.
+	 * @param materialSlots The material slots to condense into the sectioned slot. Empty condenses them all.
+	 * @param numSections The number of horizonal sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(BlueprintInternalUseOnly="true", AdvancedDisplay="numSections,numRows,encoding"), DisplayName="Create Sectioned UV Static Mesh Async")
+	static USectionedUVConvertAction* CreateSectionedUVStaticMeshAsync(class UStaticMesh* staticMesh,
+																	  TArray<int32> materialSlots,
+																	  const int32 numSections = 16,
+																	  const int32 numRows = 1,
+																	  const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/**
+	 * CreateAutoSectionedUVStaticMesh without blocking the editor, see FSectionedUVAsyncConversion.
+	 * @param staticMesh The static mesh to create a new sectioned mesh from.
+	 * @param numSections The number of horizonal sections. Each sectioned slot hands out its own sections.
+	 * @param numRows The number of vertical sections.
+	 * @param encoding Where the section is stored.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV", meta=(BlueprintInternalUseOnly="true", AdvancedDisplay="numSections,numRows,encoding"), DisplayName="Create Auto Sectioned UV Static Mesh Async")
+	static USectionedUVConvertAction* CreateAutoSectionedUVStaticMeshAsync(class UStaticMesh* staticMesh,
+																		  const int32 numSections = 16,
+																		  const int32 numRows = 1,
+																		  const ESectionedUVEncoding encoding = ESectionedUVEncoding::UVChannel);
+
+	/** Stops the conversion, Failed fires once the partly sectioned mesh has been thrown away */
+	UFUNCTION(BlueprintCallable, Category = "Sectioned UV")
+	void Cancel();
+
+	//~ Begin UBlueprintAsyncActionBase Interface
+	virtual void Activate() override;
+	//~ End UBlueprintAsyncActionBase Interface
+
+private:
+	static USectionedUVConvertAction* MakeAction(UObject* mesh, const TArray<int32>& materialSlots, bool bAutoSlots, int32 numSections, int32 numRows, ESectionedUVEncoding encoding);
+
+	void OnConversionProgress(float progress);
+	void OnConversionComplete(UObject* sectionedMesh);
+
+	UPROPERTY()
+	UObject* Mesh = nullptr;
+
+	UPROPERTY()
+	TArray<int32> MaterialSlots;
+
+	bool bAutoSlots = false;
+	int32 NumSections = 16;
+	int32 NumRows = 1;
+	ESectionedUVEncoding Encoding = ESectionedUVEncoding::UVChannel;
+	TSharedPtr<FSectionedUVAsyncConversion> Conversion;
 };
@@ -27,6 +27,7 @@ public class SectionedUVTools : ModuleRules
 			new string[]
 			{
 				"Core",
+				"SectionedUVRuntime",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -37,13 +38,18 @@ public class SectionedUVTools : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"RenderCore",
+				"RHI",
 				"Slate",
 				"SlateCore",
 				"MeshBuilder",
 				"MaterialUtilities",
-				"RawMesh",
 				"MeshUtilities",
+				"MeshDescription",
 				"StaticMeshDescription",
+				"Json",
+				"UnrealEd",
+				"SectionedUVCore",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);